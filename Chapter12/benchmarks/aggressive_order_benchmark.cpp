@@ -0,0 +1,74 @@
+#include "matcher/matching_engine.h"
+
+static constexpr size_t loop_count = 100000;
+
+/// Resting quantity at the touch, the aggressive orders are twice as large so that half of each one does not match.
+static constexpr Qty resting_qty = 50;
+
+/// Nothing consumes the matching engine's outgoing queues in this benchmark, drain them and return the number of market updates drained.
+size_t drainQueues(Exchange::ClientResponseLFQueue *client_responses, Exchange::MEMarketUpdateLFQueue *market_updates) {
+  size_t num_market_updates = 0;
+  while (client_responses->getNextToRead())
+    client_responses->updateReadIndex();
+  while (market_updates->getNextToRead()) {
+    market_updates->updateReadIndex();
+    ++num_market_updates;
+  }
+  return num_market_updates;
+}
+
+/// Before every aggressive buy a new sell order is added at the touch outside of the measured section, then send_aggressive_order() is timed.
+/// Prints the average clock cycles and the number of market updates published per aggressive order.
+template<typename F>
+void benchmarkAggressiveOrders(const std::string &name, Exchange::MEOrderBook *order_book, Exchange::ClientResponseLFQueue *client_responses,
+                               Exchange::MEMarketUpdateLFQueue *market_updates, F &&send_aggressive_order) {
+  const ClientId maker_client_id = 1, taker_client_id = 2;
+  size_t total_rdtsc = 0, num_market_updates = 0;
+
+  for (OrderId order_id = 0; order_id < loop_count; ++order_id) {
+    order_book->add(maker_client_id, order_id, 0, Side::SELL, 100, resting_qty);
+    drainQueues(client_responses, market_updates);
+
+    const auto start = Common::rdtsc();
+    send_aggressive_order(taker_client_id, order_id);
+    total_rdtsc += (Common::rdtsc() - start);
+    num_market_updates += drainQueues(client_responses, market_updates);
+  }
+
+  std::cout << name << " " << total_rdtsc / loop_count << " CLOCK CYCLES PER AGGRESSIVE ORDER "
+            << static_cast<double>(num_market_updates) / loop_count << " MARKET UPDATES PER AGGRESSIVE ORDER." << std::endl;
+}
+
+int main(int, char **) {
+  Common::Logger logger("aggressive_order_benchmark.log");
+  Exchange::ClientRequestLFQueue client_requests(ME_MAX_CLIENT_UPDATES);
+  Exchange::ClientResponseLFQueue client_responses(ME_MAX_CLIENT_UPDATES);
+  Exchange::MEMarketUpdateLFQueue market_updates(ME_MAX_MARKET_UPDATES);
+  auto matching_engine = new Exchange::MatchingEngine<Exchange::MEOrderBook>(&client_requests, &client_responses, &market_updates);
+
+  {
+    // What LiquidityTaker used to do, a DAY limit order at the touch whose remaining quantity rests until it is canceled.
+    auto order_book = new Exchange::MEOrderBook(0, &logger, matching_engine);
+    benchmarkAggressiveOrders("LIMIT + CANCEL", order_book, &client_responses, &market_updates, [&](ClientId client_id, OrderId order_id) {
+      order_book->add(client_id, order_id, 0, Side::BUY, 100, resting_qty * 2);
+      order_book->cancel(client_id, order_id, 0);
+    });
+  }
+
+  {
+    auto order_book = new Exchange::MEOrderBook(0, &logger, matching_engine);
+    benchmarkAggressiveOrders("IOC", order_book, &client_responses, &market_updates, [&](ClientId client_id, OrderId order_id) {
+      order_book->addImmediate(client_id, order_id, 0, Side::BUY, 100, resting_qty * 2, Exchange::TimeInForce::IOC);
+    });
+  }
+
+  {
+    // Every other order finds too little quantity at the touch and is canceled without matching, the others fill in full against two resting orders.
+    auto order_book = new Exchange::MEOrderBook(0, &logger, matching_engine);
+    benchmarkAggressiveOrders("FOK", order_book, &client_responses, &market_updates, [&](ClientId client_id, OrderId order_id) {
+      order_book->addImmediate(client_id, order_id, 0, Side::BUY, 100, resting_qty * 2, Exchange::TimeInForce::FOK);
+    });
+  }
+
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,160 @@
+#include "matcher/matching_engine.h"
+
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+static constexpr size_t num_clients = 4;
+static constexpr size_t num_resting_orders = 1000 * 1000;
+static constexpr size_t num_tail_requests = 100 * 1000;
+
+static const std::string checkpoint_file = "checkpoint_benchmark.bin";
+
+/// num_resting_orders passive orders spread over all the tickers, bids at [100, 200) and asks at [200, 300), followed by num_tail_requests cancels,
+/// modifies and IOC orders against them - the requests journaled after the checkpoint.
+std::vector<Exchange::MEClientRequest> randomRequests() {
+  srand(0);
+
+  std::vector<OrderId> next_order_id(num_clients, 0);
+  std::vector<Exchange::MEClientRequest> requests;
+  requests.reserve(num_resting_orders + num_tail_requests);
+  while (requests.size() < num_resting_orders) {
+    const ClientId client_id = rand() % num_clients;
+    const TickerId ticker_id = rand() % ME_MAX_TICKERS;
+    const Side side = (rand() % 2 ? Side::BUY : Side::SELL);
+    const Price price = (side == Side::BUY ? 100 : 200) + (rand() % 100);
+    requests.push_back({Exchange::ClientRequestType::NEW, client_id, ticker_id, next_order_id[client_id]++, side, price,
+                        static_cast<Qty>(1 + (rand() % 100))});
+  }
+
+  while (requests.size() < num_resting_orders + num_tail_requests) {
+    auto request = requests[rand() % num_resting_orders];
+    switch (rand() % 3) {
+      case 0:
+        request.type_ = Exchange::ClientRequestType::CANCEL;
+        break;
+      case 1:
+        request.type_ = Exchange::ClientRequestType::MODIFY;
+        request.price_ = (request.side_ == Side::BUY ? 100 : 200) + (rand() % 100);
+        break;
+      default:
+        request.order_id_ = next_order_id[request.client_id_]++;
+        request.side_ = (request.side_ == Side::BUY ? Side::SELL : Side::BUY);
+        request.time_in_force_ = Exchange::TimeInForce::IOC;
+        break;
+    }
+    requests.push_back(request);
+  }
+
+  return requests;
+}
+
+/// Everything the matching engine published, in the order it was published.
+struct Outputs {
+  std::vector<Exchange::MEClientResponse> client_responses_;
+  std::vector<Exchange::MEMarketUpdate> market_updates_;
+
+  /// Consume everything the matching engine published so far, keeping it only if keep is set.
+  auto drain(Exchange::ClientResponseLFQueue *client_responses, Exchange::MEMarketUpdateLFQueue *market_updates, bool keep) {
+    for (auto responses = client_responses->getNextBatchToRead(ME_MAX_QUEUE_BATCH); !responses.empty();
+         responses = client_responses->getNextBatchToRead(ME_MAX_QUEUE_BATCH)) {
+      if (keep)
+        client_responses_.insert(client_responses_.end(), responses.begin(), responses.end());
+      client_responses->updateReadIndex(responses.size());
+    }
+    for (auto updates = market_updates->getNextBatchToRead(ME_MAX_QUEUE_BATCH); !updates.empty();
+         updates = market_updates->getNextBatchToRead(ME_MAX_QUEUE_BATCH)) {
+      if (keep)
+        market_updates_.insert(market_updates_.end(), updates.begin(), updates.end());
+      market_updates->updateReadIndex(updates.size());
+    }
+  }
+};
+
+/// Byte for byte comparison of the messages, the message structures are packed so there is no padding to differ.
+template<typename T>
+bool identical(const std::vector<T> &lhs, const std::vector<T> &rhs) {
+  return lhs.size() == rhs.size() && !std::memcmp(lhs.data(), rhs.data(), lhs.size() * sizeof(T));
+}
+
+/// ./checkpoint_benchmark
+/// Checkpoints order books holding num_resting_orders orders, then restarts from the checkpoint plus the requests journaled after it, and from
+/// the whole journal. Prints the matching engine pause, the restart times and whether the restart from the checkpoint processed the requests after
+/// it exactly like the matching engine that wrote it. The copy-on-write cost after the fork() is the difference between processing the requests
+/// after the checkpoint while the child writes it and the same requests without a checkpoint, in time and page faults.
+int main(int, char **) {
+  // As in exchange_main with MEOrderBook, see OptCommon::setHugeTlbEnabled().
+  OptCommon::setHugeTlbEnabled(false);
+
+  const auto requests = randomRequests();
+  const std::span<const Exchange::MEClientRequest> journal(requests);
+  std::remove(checkpoint_file.c_str());
+
+  Exchange::ClientRequestLFQueue client_requests(ME_MAX_CLIENT_UPDATES);
+  Exchange::ClientResponseLFQueue client_responses(ME_MAX_CLIENT_UPDATES);
+  Exchange::MEMarketUpdateLFQueue market_updates(ME_MAX_MARKET_UPDATES);
+
+  Outputs live_outputs;
+  {
+    auto matching_engine = new Exchange::MatchingEngine<Exchange::MEOrderBook>(&client_requests, &client_responses, &market_updates);
+    matching_engine->enableCheckpoints(checkpoint_file, 0);
+    matching_engine->replay(journal.first(num_resting_orders), [&]() { live_outputs.drain(&client_responses, &market_updates, false); });
+
+    const auto start = Common::getCurrentNanos();
+    matching_engine->checkpoint();
+    const auto pause = Common::getCurrentNanos() - start;
+
+    // The requests journaled after the checkpoint, processed while the child writes it - replay() skips the ones the matching engine already
+    // processed. The first write to every page shared with the child copies the page.
+    const auto tail_faults = Common::threadMinorFaults();
+    matching_engine->replay(journal, [&]() { live_outputs.drain(&client_responses, &market_updates, true); });
+    const auto tail_elapsed = Common::getCurrentNanos() - start - pause;
+    matching_engine->waitForCheckpoint(true);
+    const auto elapsed = Common::getCurrentNanos() - start;
+
+    std::cout << "CHECKPOINT resting orders:" << num_resting_orders << " matching engine paused for:" << pause / NANOS_TO_MICROS
+              << "us written in:" << elapsed / NANOS_TO_MILLIS << "ms size:" << std::filesystem::file_size(checkpoint_file) << " bytes" << std::endl;
+    std::cout << "TAIL WHILE CHECKPOINTING requests:" << num_tail_requests << " elapsed:" << tail_elapsed / NANOS_TO_MILLIS
+              << "ms page faults:" << Common::threadMinorFaults() - tail_faults << std::endl;
+    delete matching_engine;
+  }
+
+  {
+    Outputs restart_outputs;
+    auto matching_engine = new Exchange::MatchingEngine<Exchange::MEOrderBook>(&client_requests, &client_responses, &market_updates);
+    matching_engine->enableCheckpoints(checkpoint_file, 0);
+
+    const auto start = Common::getCurrentNanos();
+    const auto restored = matching_engine->restoreCheckpoint(journal, [&]() { restart_outputs.drain(&client_responses, &market_updates, false); });
+    matching_engine->replay(journal, [&]() { restart_outputs.drain(&client_responses, &market_updates, true); });
+    const auto elapsed = Common::getCurrentNanos() - start;
+
+    std::cout << "RESTART FROM CHECKPOINT restored:" << restored << " replayed requests:" << num_tail_requests << " elapsed:"
+              << elapsed / NANOS_TO_MILLIS << "ms client responses:" << restart_outputs.client_responses_.size()
+              << (identical(live_outputs.client_responses_, restart_outputs.client_responses_) ? " IDENTICAL" : " DIFFERENT")
+              << " market updates:" << restart_outputs.market_updates_.size()
+              << (identical(live_outputs.market_updates_, restart_outputs.market_updates_) ? " IDENTICAL" : " DIFFERENT") << std::endl;
+    delete matching_engine;
+  }
+
+  {
+    Outputs restart_outputs;
+    auto matching_engine = new Exchange::MatchingEngine<Exchange::MEOrderBook>(&client_requests, &client_responses, &market_updates);
+
+    const auto start = Common::getCurrentNanos();
+    matching_engine->replay(journal.first(num_resting_orders), [&]() { restart_outputs.drain(&client_responses, &market_updates, false); });
+    const auto tail_start = Common::getCurrentNanos();
+    const auto tail_faults = Common::threadMinorFaults();
+    matching_engine->replay(journal, [&]() { restart_outputs.drain(&client_responses, &market_updates, false); });
+    const auto elapsed = Common::getCurrentNanos() - start;
+
+    std::cout << "RESTART FROM JOURNAL replayed requests:" << journal.size() << " elapsed:" << elapsed / NANOS_TO_MILLIS << "ms" << std::endl;
+    std::cout << "TAIL WITHOUT CHECKPOINT requests:" << num_tail_requests << " elapsed:" << (Common::getCurrentNanos() - tail_start) / NANOS_TO_MILLIS
+              << "ms page faults:" << Common::threadMinorFaults() - tail_faults << std::endl;
+    delete matching_engine;
+  }
+
+  std::remove(checkpoint_file.c_str());
+
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "common/logging.h"
+
+static constexpr size_t loop_count = 1000 * 1000;
+
+/// Call the clock loop_count times and report the mean, standard deviation, p99 and max clock cycles per call.
+template<typename F>
+void benchmarkClock(const std::string &name, F &&clock) {
+  std::vector<uint64_t> cycles(loop_count);
+  int64_t sink = 0;
+  for (size_t i = 0; i < loop_count; ++i) {
+    const auto start = Common::rdtsc();
+    sink += clock();
+    cycles[i] = Common::rdtsc() - start;
+  }
+
+  double mean = 0, variance = 0;
+  for (auto c: cycles)
+    mean += static_cast<double>(c);
+  mean /= loop_count;
+  for (auto c: cycles)
+    variance += (static_cast<double>(c) - mean) * (static_cast<double>(c) - mean);
+  std::sort(cycles.begin(), cycles.end());
+
+  std::cout << name << " MEAN:" << static_cast<size_t>(mean) << " STDDEV:" << static_cast<size_t>(std::sqrt(variance / loop_count))
+            << " P99:" << cycles[loop_count * 99 / 100] << " MAX:" << cycles.back() << " CLOCK CYCLES PER CALL. (" << (sink & 1) << ")" << std::endl;
+}
+
+int main(int, char **) {
+  // The LogDrain thread started with the first Logger re-anchors the TSC clock.
+  Common::Logger logger("clock_benchmark.log");
+
+  std::cout << "TSC CLOCK " << (Common::tsc_clock.usesTSC() ? "USES TSC" : "FALLS BACK TO CLOCK_GETTIME") << " " << Common::tsc_clock.nanosPerTick() << " NANOS PER TICK." << std::endl;
+
+  benchmarkClock("STD::CHRONO::SYSTEM_CLOCK", []() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  });
+
+  benchmarkClock("CLOCK_GETTIME(CLOCK_REALTIME)", []() {
+    return Common::clockNanos(CLOCK_REALTIME);
+  });
+
+  benchmarkClock("TSC CLOCK", []() {
+    return Common::tsc_clock.nowNanos();
+  });
+
+  // Difference between the TSC clock and the system clock, sampled across a few re-anchors to show the drift correction. The TSC clock is read
+  // in a busy loop in between, it must never go backwards when the LogDrain thread re-anchors it.
+  size_t num_backward_steps = 0;
+  for (int i = 0; i < 3; ++i) {
+    const auto system_nanos = Common::clockNanos(CLOCK_REALTIME);
+    const auto tsc_nanos = Common::tsc_clock.nowNanos();
+    std::cout << "TSC CLOCK - CLOCK_REALTIME " << (tsc_nanos - system_nanos) << " NANOS." << std::endl;
+
+    auto last_nanos = Common::tsc_clock.nowNanos();
+    while (Common::clockNanos(CLOCK_REALTIME) - system_nanos < 1500 * 1000 * 1000) {
+      const auto nanos = Common::tsc_clock.nowNanos();
+      num_backward_steps += (nanos < last_nanos);
+      last_nanos = nanos;
+    }
+  }
+  std::cout << "TSC CLOCK BACKWARD STEPS:" << num_backward_steps << std::endl;
+
+  exit(EXIT_SUCCESS);
+}
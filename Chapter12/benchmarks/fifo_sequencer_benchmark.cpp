@@ -0,0 +1,99 @@
+#include "common/logging.h"
+#include "common/perf_utils.h"
+#include "order_server/fifo_sequencer.h"
+
+#include <random>
+
+static constexpr size_t num_requests = 100 * 1000;
+
+/// A request as the FIFOSequencer used to keep it before sorting all of them on every poll cycle.
+struct SortedClientRequest {
+  Nanos recv_time_ = 0;
+  Exchange::MEClientRequest request_;
+
+  auto operator<(const SortedClientRequest &rhs) const {
+    return (recv_time_ < rhs.recv_time_);
+  }
+};
+
+/// Poll cycles where every one of num_clients connections delivers burst_size requests in a single read, the connections read one after the
+/// other with their receive times in random order. Requests carry their receive time in order_id_ so the published order can be checked.
+std::vector<std::vector<SortedClientRequest>> randomCycles(size_t num_clients, size_t burst_size) {
+  std::mt19937_64 random(0);
+  std::vector<std::vector<SortedClientRequest>> cycles(num_requests / (num_clients * burst_size));
+  Nanos cycle_start = 0;
+  for (auto &cycle: cycles) {
+    for (size_t client = 0; client < num_clients; ++client) {
+      const auto rx_time = cycle_start + static_cast<Nanos>(random() % (num_clients * 1000));
+      for (size_t i = 0; i < burst_size; ++i) {
+        const Exchange::MEClientRequest request{Exchange::ClientRequestType::NEW, static_cast<ClientId>(client), static_cast<TickerId>(i % ME_MAX_TICKERS),
+                                                static_cast<OrderId>(rx_time), Side::BUY, 100, 10};
+        cycle.push_back({rx_time, request});
+      }
+    }
+    cycle_start += static_cast<Nanos>(num_clients * 1000);
+  }
+  return cycles;
+}
+
+/// Hand every cycle to the FIFOSequencer and time addClientRequest() and sequenceAndPublish(), returns the nanoseconds per request.
+/// The shard queue is drained outside the timed section, checking the requests came out in receive time order.
+double sequenceCycles(const std::vector<std::vector<SortedClientRequest>> &cycles, Exchange::FIFOSequencer &fifo_sequencer,
+                      Exchange::ClientRequestLFQueue &client_requests) {
+  Nanos elapsed = 0;
+  size_t num_sequenced = 0;
+  for (const auto &cycle: cycles) {
+    const auto start = getCurrentNanos();
+    for (const auto &client_request: cycle)
+      fifo_sequencer.addClientRequest(client_request.recv_time_, client_request.request_);
+    fifo_sequencer.sequenceAndPublish();
+    elapsed += getCurrentNanos() - start;
+
+    OrderId last_rx_time = 0;
+    for (auto requests = client_requests.getNextBatchToRead(ME_MAX_QUEUE_BATCH); !requests.empty();
+         requests = client_requests.getNextBatchToRead(ME_MAX_QUEUE_BATCH)) {
+      for (const auto &request: requests) {
+        ASSERT(request.order_id_ >= last_rx_time, "Request published out of receive time order:" + request.toString());
+        last_rx_time = request.order_id_;
+      }
+      num_sequenced += requests.size();
+      client_requests.updateReadIndex(requests.size());
+    }
+  }
+  ASSERT(num_sequenced == cycles.size() * cycles.front().size(), "Requests lost:" + std::to_string(num_sequenced));
+
+  return static_cast<double>(elapsed) / static_cast<double>(num_sequenced);
+}
+
+/// ./fifo_sequencer_benchmark
+/// Sequencing cost per request against the number of active connections and the number of requests each of them delivers per poll cycle.
+/// MERGED is the FIFOSequencer on the cycles as received, SINGLE RUN the same requests already in receive time order so nothing needs merging,
+/// and STD::SORT the cost of sorting the cycles alone, which the FIFOSequencer used to pay on every poll cycle on top of publishing.
+int main(int, char **) {
+  Common::Logger logger("fifo_sequencer_benchmark.log");
+  Exchange::ClientRequestLFQueue client_requests(ME_MAX_CLIENT_UPDATES);
+  Exchange::FIFOSequencer fifo_sequencer({&client_requests}, &logger);
+
+  for (const size_t num_clients: {1, 16, 256}) {
+    for (const size_t burst_size: {1, 8, 64}) {
+      auto cycles = randomCycles(num_clients, burst_size);
+
+      const auto merged = sequenceCycles(cycles, fifo_sequencer, client_requests);
+
+      Nanos sort_elapsed = 0;
+      for (auto &cycle: cycles) {
+        const auto start = getCurrentNanos();
+        std::sort(cycle.begin(), cycle.end());
+        sort_elapsed += getCurrentNanos() - start;
+      }
+
+      const auto single_run = sequenceCycles(cycles, fifo_sequencer, client_requests);
+
+      std::cout << "CLIENTS:" << num_clients << " BURST:" << burst_size << " REQUESTS PER CYCLE:" << cycles.front().size()
+                << " MERGED:" << merged << "ns SINGLE RUN:" << single_run << "ns"
+                << " STD::SORT:" << static_cast<double>(sort_elapsed) / static_cast<double>(cycles.size() * cycles.front().size()) << "ns" << std::endl;
+    }
+  }
+
+  exit(EXIT_SUCCESS);
+}
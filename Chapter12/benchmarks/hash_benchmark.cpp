@@ -1,13 +1,162 @@
 #include "matcher/matching_engine.h"
 #include "matcher/unordered_map_me_order_book.h"
+#include "matcher/ladder_me_order_book.h"
+
+#include <fstream>
+#include <unordered_map>
+
+#include <unistd.h>
 
 static constexpr size_t loop_count = 100000;
 
+/// Resident set size of the process in bytes.
+size_t residentBytes() {
+  std::ifstream statm("/proc/self/statm");
+  size_t size = 0, resident = 0;
+  statm >> size >> resident;
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+/// The (ClientId, OrderId) -> MEOrder lookup as MEOrderBook used to hold it, a 2GB table of pointers mapped without being touched upfront.
+class ArrayOrderIndex {
+public:
+  ArrayOrderIndex() : table_(static_cast<Table *>(OptCommon::allocateHugePages(sizeof(Table), false))) {
+  }
+
+  auto insert(const Exchange::ClientOrderKey &key, Exchange::MEOrder *order) noexcept {
+    (*table_)[key.client_id_][key.client_order_id_] = order;
+  }
+
+  auto find(const Exchange::ClientOrderKey &key) const noexcept {
+    return (*table_)[key.client_id_][key.client_order_id_];
+  }
+
+  auto erase(const Exchange::ClientOrderKey &key) noexcept {
+    (*table_)[key.client_id_][key.client_order_id_] = nullptr;
+  }
+
+private:
+  typedef std::array<std::array<Exchange::MEOrder *, ME_MAX_ORDER_IDS>, ME_MAX_NUM_CLIENTS> Table;
+  Table *table_ = nullptr;
+};
+
+/// The lookup as UnorderedMapMEOrderBook holds it.
+class UnorderedMapOrderIndex {
+public:
+  auto insert(const Exchange::ClientOrderKey &key, Exchange::MEOrder *order) noexcept {
+    table_[key.client_id_][key.client_order_id_] = order;
+  }
+
+  auto find(const Exchange::ClientOrderKey &key) const noexcept -> Exchange::MEOrder * {
+    const auto client_itr = table_.find(key.client_id_);
+    if (client_itr == table_.end())
+      return nullptr;
+    const auto order_itr = client_itr->second.find(key.client_order_id_);
+    return (order_itr == client_itr->second.end() ? nullptr : order_itr->second);
+  }
+
+  auto erase(const Exchange::ClientOrderKey &key) noexcept {
+    table_[key.client_id_].erase(key.client_order_id_);
+  }
+
+private:
+  std::unordered_map<ClientId, std::unordered_map<OrderId, Exchange::MEOrder *>> table_;
+};
+
+/// The lookup as MEOrderBook holds it now, the flat hash map sized by live orders.
+class FlatOrderIndex {
+public:
+  auto insert(const Exchange::ClientOrderKey &key, Exchange::MEOrder *order) noexcept {
+    table_.insert(key, order);
+  }
+
+  auto find(const Exchange::ClientOrderKey &key) const noexcept {
+    const auto order = table_.find(key);
+    return (order ? *order : nullptr);
+  }
+
+  auto erase(const Exchange::ClientOrderKey &key) noexcept {
+    table_.erase(key);
+  }
+
+private:
+  Exchange::ClientOrderHashMap table_{Exchange::ME_ORDER_INDEX_CAPACITY};
+};
+
+/// One operation on an order lookup.
+struct OrderIndexOperation {
+  enum class Type { INSERT, FIND, ERASE } type_;
+  Exchange::ClientOrderKey key_;
+};
+
+/// Orders from all ME_MAX_NUM_CLIENTS clients with increasing order ids per client, each new order followed by a lookup of a random live order
+/// and, most of the time, a cancel of a random live order, so that there are a few thousand live orders at any time like in a busy book.
+auto orderIndexOperations() {
+  std::vector<OrderIndexOperation> operations;
+  std::vector<Exchange::ClientOrderKey> live_keys;
+  std::vector<OrderId> next_order_id(ME_MAX_NUM_CLIENTS, 0);
+  for (size_t i = 0; i < loop_count * 10; ++i) {
+    const ClientId client_id = rand() % ME_MAX_NUM_CLIENTS;
+    live_keys.push_back({client_id, next_order_id[client_id]++});
+    operations.push_back({OrderIndexOperation::Type::INSERT, live_keys.back()});
+    operations.push_back({OrderIndexOperation::Type::FIND, live_keys[rand() % live_keys.size()]});
+    if (live_keys.size() > 4096 || rand() % 4) {
+      const auto index = rand() % live_keys.size();
+      operations.push_back({OrderIndexOperation::Type::ERASE, live_keys[index]});
+      live_keys[index] = live_keys.back();
+      live_keys.pop_back();
+    }
+  }
+  return operations;
+}
+
+/// Report construction time, average clock cycles per operation and how much the resident set size grew.
+template<typename T>
+void benchmarkOrderIndex(const std::string &name, const std::vector<OrderIndexOperation> &operations) {
+  static Exchange::MEOrder order;
+
+  const auto start_rss = residentBytes();
+  const auto start_nanos = Common::getCurrentNanos();
+  auto index = new T();
+  const auto construction_nanos = Common::getCurrentNanos() - start_nanos;
+
+  size_t total_rdtsc = 0, found = 0;
+  for (const auto &operation: operations) {
+    const auto start = Common::rdtsc();
+    switch (operation.type_) {
+      case OrderIndexOperation::Type::INSERT:
+        index->insert(operation.key_, &order);
+        break;
+      case OrderIndexOperation::Type::FIND:
+        found += (index->find(operation.key_) != nullptr);
+        break;
+      case OrderIndexOperation::Type::ERASE:
+        index->erase(operation.key_);
+        break;
+    }
+    total_rdtsc += (Common::rdtsc() - start);
+  }
+
+  std::cout << name << " CONSTRUCTION:" << construction_nanos / 1000 << "us " << total_rdtsc / operations.size() << " CLOCK CYCLES PER OPERATION"
+            << " RSS GROWTH:" << (residentBytes() - start_rss) / (1024 * 1024) << "MB (found:" << found << ")" << std::endl;
+}
+
+/// Nothing consumes the matching engine's outgoing queues in this benchmark, so drain them outside the measured sections.
+void drainQueues(Exchange::ClientResponseLFQueue *client_responses, Exchange::MEMarketUpdateLFQueue *market_updates) {
+  while (client_responses->getNextToRead())
+    client_responses->updateReadIndex();
+  while (market_updates->getNextToRead())
+    market_updates->updateReadIndex();
+}
+
 template<typename T>
-size_t benchmarkHashMap(T *order_book, const std::vector<Exchange::MEClientRequest>& client_requests) {
-  size_t total_rdtsc = 0;
+size_t benchmarkHashMap(T *order_book, const std::vector<Exchange::MEClientRequest>& client_requests,
+                        Exchange::ClientResponseLFQueue *client_responses, Exchange::MEMarketUpdateLFQueue *market_updates) {
+  size_t total_rdtsc = 0, num_operations = 0;
+
+  for (size_t i = 0; i < client_requests.size(); ++i) {
+    drainQueues(client_responses, market_updates);
 
-  for (size_t i = 0; i < loop_count; ++i) {
     const auto& client_request = client_requests[i];
     switch (client_request.type_) {
       case Exchange::ClientRequestType::NEW: {
@@ -15,6 +164,7 @@ size_t benchmarkHashMap(T *order_book, const std::vector<Exchange::MEClientReque
         order_book->add(client_request.client_id_, client_request.order_id_, client_request.ticker_id_,
                         client_request.side_, client_request.price_, client_request.qty_);
         total_rdtsc += (Common::rdtsc() - start);
+        ++num_operations;
       }
         break;
 
@@ -22,6 +172,7 @@ size_t benchmarkHashMap(T *order_book, const std::vector<Exchange::MEClientReque
         const auto start = Common::rdtsc();
         order_book->cancel(client_request.client_id_, client_request.order_id_, client_request.ticker_id_);
         total_rdtsc += (Common::rdtsc() - start);
+        ++num_operations;
       }
         break;
 
@@ -30,46 +181,123 @@ size_t benchmarkHashMap(T *order_book, const std::vector<Exchange::MEClientReque
     }
   }
 
-  return (total_rdtsc / (loop_count * 2));
+  return (total_rdtsc / num_operations);
 }
 
-int main(int, char **) {
-  srand(0);
-
-  Common::Logger logger("hash_benchmark.log");
-  Exchange::ClientRequestLFQueue client_requests(ME_MAX_CLIENT_UPDATES);
-  Exchange::ClientResponseLFQueue client_responses(ME_MAX_CLIENT_UPDATES);
-  Exchange::MEMarketUpdateLFQueue market_updates(ME_MAX_MARKET_UPDATES);
-  auto matching_engine = new Exchange::MatchingEngine(&client_requests, &client_responses, &market_updates);
+/// Append a cancel of a random earlier request, cancels of orders that already filled or were already canceled get rejected.
+void addRandomCancel(std::vector<Exchange::MEClientRequest> *client_requests) {
+  auto cxl_request = (*client_requests)[rand() % client_requests->size()];
+  cxl_request.type_ = Exchange::ClientRequestType::CANCEL;
+  client_requests->push_back(cxl_request);
+}
 
+/// Orders at 10 prices close to each other, every new order followed by a random cancel.
+auto narrowBookRequests() {
   Common::OrderId order_id = 1000;
-  std::vector<Exchange::MEClientRequest> client_requests_vec;
+  std::vector<Exchange::MEClientRequest> client_requests;
   Price base_price = (rand() % 100) + 100;
-  while (client_requests_vec.size() < loop_count) {
+  while (client_requests.size() < loop_count) {
     const Price price = base_price + (rand() % 10) + 1;
     const Qty qty = 1 + (rand() % 100) + 1;
     const Side side = (rand() % 2 ? Common::Side::BUY : Common::Side::SELL);
 
-    Exchange::MEClientRequest new_request{Exchange::ClientRequestType::NEW, 0, 0, order_id++, side, price, qty};
-    client_requests_vec.push_back(new_request);
+    client_requests.push_back({Exchange::ClientRequestType::NEW, 0, 0, order_id++, side, price, qty});
+    addRandomCancel(&client_requests);
+  }
+  return client_requests;
+}
 
-    const auto cxl_index = rand() % client_requests_vec.size();
-    auto cxl_request = client_requests_vec[cxl_index];
-    cxl_request.type_ = Exchange::ClientRequestType::CANCEL;
+/// Passive orders spread over 200 prices on each side of a fixed mid price and only one cancel per 4 new orders, so the book gets deep.
+/// New price levels are inserted anywhere in the book, not just close to the top, and prices stay within the 256 levels MEOrderBook supports.
+auto deepBookRequests() {
+  Common::OrderId order_id = 1000;
+  std::vector<Exchange::MEClientRequest> client_requests;
+  const Price mid_price = 1000;
+  while (client_requests.size() < loop_count) {
+    const Side side = (rand() % 2 ? Common::Side::BUY : Common::Side::SELL);
+    const Price price = (side == Side::BUY ? mid_price - 1 - (rand() % 100) * 2 : mid_price + 1 + (rand() % 100) * 2);
+    const Qty qty = 1 + (rand() % 100) + 1;
 
-    client_requests_vec.push_back(cxl_request);
+    client_requests.push_back({Exchange::ClientRequestType::NEW, 0, 0, order_id++, side, price, qty});
+    if (!(rand() % 4))
+      addRandomCancel(&client_requests);
   }
+  return client_requests;
+}
+
+/// Orders within 5000 ticks of a mid price which drifts upwards by about 100000 ticks over the run, with some aggressive orders crossing the spread.
+/// Prices 256 ticks apart share a slot in MEOrderBook and UnorderedMapMEOrderBook, so only the ladder book handles this correctly.
+auto wideBookRequests() {
+  Common::OrderId order_id = 1000;
+  std::vector<Exchange::MEClientRequest> client_requests;
+  Price mid_price = 1000000;
+  while (client_requests.size() < loop_count) {
+    mid_price += rand() % 3;
+    const Side side = (rand() % 2 ? Common::Side::BUY : Common::Side::SELL);
+    const Price offset = (rand() % 10 ? 1 + rand() % 5000 : -(rand() % 50));
+    const Price price = (side == Side::BUY ? mid_price - offset : mid_price + offset);
+    const Qty qty = 1 + (rand() % 100) + 1;
+
+    client_requests.push_back({Exchange::ClientRequestType::NEW, 0, 0, order_id++, side, price, qty});
+    addRandomCancel(&client_requests);
+  }
+  return client_requests;
+}
+
+int main(int, char **) {
+  srand(0);
+
+  Common::Logger logger("hash_benchmark.log");
+  Exchange::ClientRequestLFQueue client_requests(ME_MAX_CLIENT_UPDATES);
+  Exchange::ClientResponseLFQueue client_responses(ME_MAX_CLIENT_UPDATES);
+  Exchange::MEMarketUpdateLFQueue market_updates(ME_MAX_MARKET_UPDATES);
+  auto matching_engine = new Exchange::MatchingEngine<Exchange::MEOrderBook>(&client_requests, &client_responses, &market_updates);
 
   {
-    auto me_order_book = new Exchange::MEOrderBook(0, &logger, matching_engine);
-    const auto cycles = benchmarkHashMap(me_order_book, client_requests_vec);
-    std::cout << "ARRAY HASHMAP " << cycles << " CLOCK CYCLES PER OPERATION." << std::endl;
+    const auto operations = orderIndexOperations();
+    benchmarkOrderIndex<ArrayOrderIndex>("ORDER INDEX ARRAY", operations);
+    benchmarkOrderIndex<UnorderedMapOrderIndex>("ORDER INDEX UNORDERED-MAP", operations);
+    benchmarkOrderIndex<FlatOrderIndex>("ORDER INDEX FLAT HASHMAP", operations);
+  }
+
+  {
+    const auto start_rss = residentBytes();
+    const auto start_nanos = Common::getCurrentNanos();
+    std::vector<Exchange::MEOrderBook *> order_books;
+    for (size_t i = 0; i < ME_MAX_TICKERS; ++i)
+      order_books.push_back(new Exchange::MEOrderBook(i, &logger, matching_engine));
+    std::cout << ME_MAX_TICKERS << " MEORDERBOOKS CONSTRUCTION:" << (Common::getCurrentNanos() - start_nanos) / 1000 << "us"
+              << " RSS GROWTH:" << (residentBytes() - start_rss) / (1024 * 1024) << "MB" << std::endl;
+  }
+
+  const auto narrow_requests = narrowBookRequests();
+  const auto deep_requests = deepBookRequests();
+  const auto wide_requests = wideBookRequests();
+
+  for (const auto &[scenario, client_requests_vec]: {std::pair{"NARROW", &narrow_requests}, {"DEEP", &deep_requests}}) {
+    {
+      auto me_order_book = new Exchange::MEOrderBook(0, &logger, matching_engine);
+      const auto cycles = benchmarkHashMap(me_order_book, *client_requests_vec, &client_responses, &market_updates);
+      std::cout << scenario << " FLAT HASHMAP " << cycles << " CLOCK CYCLES PER OPERATION." << std::endl;
+    }
+
+    {
+      auto me_order_book = new Exchange::UnorderedMapMEOrderBook(0, &logger, matching_engine);
+      const auto cycles = benchmarkHashMap(me_order_book, *client_requests_vec, &client_responses, &market_updates);
+      std::cout << scenario << " UNORDERED-MAP HASHMAP " << cycles << " CLOCK CYCLES PER OPERATION." << std::endl;
+    }
+
+    {
+      auto me_order_book = new Exchange::LadderMEOrderBook(0, &logger, matching_engine);
+      const auto cycles = benchmarkHashMap(me_order_book, *client_requests_vec, &client_responses, &market_updates);
+      std::cout << scenario << " PRICE LADDER " << cycles << " CLOCK CYCLES PER OPERATION." << std::endl;
+    }
   }
 
   {
-    auto me_order_book = new Exchange::UnorderedMapMEOrderBook(0, &logger, matching_engine);
-    const auto cycles = benchmarkHashMap(me_order_book, client_requests_vec);
-    std::cout << "UNORDERED-MAP HASHMAP " << cycles << " CLOCK CYCLES PER OPERATION." << std::endl;
+    auto me_order_book = new Exchange::LadderMEOrderBook(0, &logger, matching_engine);
+    const auto cycles = benchmarkHashMap(me_order_book, wide_requests, &client_responses, &market_updates);
+    std::cout << "WIDE PRICE LADDER " << cycles << " CLOCK CYCLES PER OPERATION." << std::endl;
   }
 
   exit(EXIT_SUCCESS);
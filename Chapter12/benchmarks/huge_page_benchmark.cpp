@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <random>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+
+#include "matcher/matching_engine.h"
+
+static constexpr size_t num_orders = 100000;
+
+/// Spread the orders over this many clients so the (client-id, order-id) keys look like a busy book's. The order index hashes them to
+/// random slots of a table of several MB anyway, so consecutive cancels land on different pages of it and of the MEOrder pool either way.
+static constexpr size_t num_clients = ME_MAX_NUM_CLIENTS / 8;
+
+/// Open a counter for user space dTLB load misses of the calling thread, returns -1 if the PMU is not available (e.g. in some VMs).
+int openDTLBMissCounter() {
+  perf_event_attr attr{};
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.size = sizeof(attr);
+  attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+/// Nothing consumes the matching engine's outgoing queues in this benchmark, so drain them outside the measured sections.
+void drainQueues(Exchange::ClientResponseLFQueue *client_responses, Exchange::MEMarketUpdateLFQueue *market_updates) {
+  while (client_responses->getNextToRead())
+    client_responses->updateReadIndex();
+  while (market_updates->getNextToRead())
+    market_updates->updateReadIndex();
+}
+
+/// Rest num_orders non-crossing orders with random client-ids and order-ids in a fresh order book, then cancel them in a different random order.
+/// Returns clock cycles per cancel and dTLB load misses per cancel (or -1 if the counter is not available).
+std::pair<size_t, double> benchmarkCancel(bool huge_pages, Exchange::MatchingEngineBase *matching_engine, Common::Logger *logger,
+                                          Exchange::ClientResponseLFQueue *client_responses, Exchange::MEMarketUpdateLFQueue *market_updates) {
+  OptCommon::setHugePagesEnabled(huge_pages);
+  auto me_order_book = new Exchange::MEOrderBook(0, logger, matching_engine);
+
+  srand(0);
+  std::vector<std::pair<ClientId, OrderId>> orders;
+  std::vector<bool> used(num_clients * ME_MAX_ORDER_IDS, false);
+  while (orders.size() < num_orders) {
+    const ClientId client_id = rand() % num_clients;
+    const OrderId order_id = rand() % ME_MAX_ORDER_IDS;
+    if (used[client_id * ME_MAX_ORDER_IDS + order_id])
+      continue;
+    used[client_id * ME_MAX_ORDER_IDS + order_id] = true;
+    orders.emplace_back(client_id, order_id);
+
+    const Side side = (rand() % 2 ? Common::Side::BUY : Common::Side::SELL);
+    const Price price = (side == Common::Side::BUY ? 100 : 200) + (rand() % 50);
+    me_order_book->add(client_id, order_id, 0, side, price, 1 + (rand() % 100));
+  }
+  drainQueues(client_responses, market_updates);
+
+  std::shuffle(orders.begin(), orders.end(), std::mt19937(0));
+
+  const auto fd = openDTLBMissCounter();
+  if (fd >= 0) {
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+
+  const auto start = Common::rdtsc();
+  for (const auto &[client_id, order_id]: orders)
+    me_order_book->cancel(client_id, order_id, 0);
+  const auto cycles = (Common::rdtsc() - start) / num_orders;
+
+  double dtlb_misses = -1;
+  if (fd >= 0) {
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    uint64_t count = 0;
+    if (read(fd, &count, sizeof(count)) == sizeof(count))
+      dtlb_misses = static_cast<double>(count) / num_orders;
+    close(fd);
+  }
+  drainQueues(client_responses, market_updates);
+  delete me_order_book;
+
+  return {cycles, dtlb_misses};
+}
+
+int main(int, char **) {
+  Common::Logger logger("huge_page_benchmark.log");
+  Exchange::ClientRequestLFQueue client_requests(ME_MAX_CLIENT_UPDATES);
+  Exchange::ClientResponseLFQueue client_responses(ME_MAX_CLIENT_UPDATES);
+  Exchange::MEMarketUpdateLFQueue market_updates(ME_MAX_MARKET_UPDATES);
+  auto matching_engine = new Exchange::MatchingEngine<Exchange::MEOrderBook>(&client_requests, &client_responses, &market_updates);
+
+  {
+    const auto [cycles, dtlb_misses] = benchmarkCancel(false, matching_engine, &logger, &client_responses, &market_updates);
+    std::cout << "4KB PAGES MEORDERBOOK::CANCEL " << cycles << " CLOCK CYCLES " << dtlb_misses << " DTLB MISSES PER OPERATION." << std::endl;
+    std::cout << OptCommon::hugePageReport() << std::endl;
+  }
+
+  {
+    const auto [cycles, dtlb_misses] = benchmarkCancel(true, matching_engine, &logger, &client_responses, &market_updates);
+    std::cout << "HUGE PAGES MEORDERBOOK::CANCEL " << cycles << " CLOCK CYCLES " << dtlb_misses << " DTLB MISSES PER OPERATION." << std::endl;
+    std::cout << OptCommon::hugePageReport() << std::endl;
+  }
+
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,207 @@
+#include "matcher/matching_engine.h"
+#include "order_server/fifo_sequencer.h"
+#include "order_server/request_journal.h"
+
+#include <cstring>
+#include <vector>
+
+static constexpr size_t num_clients = 4;
+static constexpr size_t num_requests = 500 * 1000;
+
+/// Requests are handed to the FIFOSequencer in batches of this size, the way the order server does after a round of socket reads.
+static constexpr size_t sequencer_batch_size = 256;
+
+static const std::string journal_file = "journal_benchmark.journal";
+
+/// Two runs of the requests and the cancels of the orders the first one left resting.
+static constexpr size_t journal_capacity = 3 * num_requests;
+
+/// New orders spread over all the tickers and num_clients clients, each followed by a cancel, a modify or an IOC order.
+std::vector<Exchange::MEClientRequest> randomRequests() {
+  srand(0);
+
+  std::vector<Price> ticker_base_price(ME_MAX_TICKERS);
+  for (auto &base_price: ticker_base_price)
+    base_price = (rand() % 100) + 100;
+
+  std::vector<std::vector<Exchange::MEClientRequest>> client_orders(num_clients);
+  std::vector<Exchange::MEClientRequest> requests;
+  requests.reserve(num_requests);
+  while (requests.size() < num_requests) {
+    const ClientId client_id = rand() % num_clients;
+    auto &orders = client_orders[client_id];
+    const TickerId ticker_id = rand() % ME_MAX_TICKERS;
+    const Price price = ticker_base_price[ticker_id] + (rand() % 10) + 1;
+    const Qty qty = 1 + (rand() % 100) + 1;
+    const Side side = (rand() % 2 ? Side::BUY : Side::SELL);
+
+    requests.push_back({Exchange::ClientRequestType::NEW, client_id, ticker_id, static_cast<OrderId>(orders.size()), side, price, qty});
+    orders.push_back(requests.back());
+
+    auto request = orders[rand() % orders.size()];
+    switch (rand() % 3) {
+      case 0:
+        request.type_ = Exchange::ClientRequestType::CANCEL;
+        break;
+      case 1:
+        request.type_ = Exchange::ClientRequestType::MODIFY;
+        request.price_ = ticker_base_price[ticker_id] + (rand() % 10) + 1;
+        break;
+      default:
+        request = {Exchange::ClientRequestType::NEW, client_id, ticker_id, static_cast<OrderId>(orders.size()), side, price, qty,
+                   Exchange::TimeInForce::IOC};
+        orders.push_back(request);
+        break;
+    }
+    requests.push_back(request);
+  }
+
+  return requests;
+}
+
+/// Everything the matching engine published, in the order it was published.
+struct Outputs {
+  std::vector<Exchange::MEClientResponse> client_responses_;
+  std::vector<Exchange::MEMarketUpdate> market_updates_;
+
+  /// Consume everything the matching engine published so far, as the order server and market data publisher would.
+  auto drain(Exchange::ClientResponseLFQueue *client_responses, Exchange::MEMarketUpdateLFQueue *market_updates) {
+    for (auto responses = client_responses->getNextBatchToRead(ME_MAX_QUEUE_BATCH); !responses.empty();
+         responses = client_responses->getNextBatchToRead(ME_MAX_QUEUE_BATCH)) {
+      client_responses_.insert(client_responses_.end(), responses.begin(), responses.end());
+      client_responses->updateReadIndex(responses.size());
+    }
+    for (auto updates = market_updates->getNextBatchToRead(ME_MAX_QUEUE_BATCH); !updates.empty();
+         updates = market_updates->getNextBatchToRead(ME_MAX_QUEUE_BATCH)) {
+      market_updates_.insert(market_updates_.end(), updates.begin(), updates.end());
+      market_updates->updateReadIndex(updates.size());
+    }
+  }
+};
+
+/// Byte for byte comparison of the messages, the message structures are packed so there is no padding to differ.
+template<typename T>
+bool identical(const std::vector<T> &lhs, const std::vector<T> &rhs) {
+  return lhs.size() == rhs.size() && !std::memcmp(lhs.data(), rhs.data(), lhs.size() * sizeof(T));
+}
+
+/// Same as identical() except for the market order ids, which a restarted exchange carries on from where the previous run left them.
+bool identicalButMarketOrderIds(const Outputs &lhs, const Outputs &rhs) {
+  auto without_market_order_ids = [](Outputs outputs) {
+    for (auto &client_response: outputs.client_responses_)
+      client_response.market_order_id_ = OrderId_INVALID;
+    for (auto &market_update: outputs.market_updates_)
+      market_update.order_id_ = OrderId_INVALID;
+    return outputs;
+  };
+  const auto lhs_outputs = without_market_order_ids(lhs), rhs_outputs = without_market_order_ids(rhs);
+  return identical(lhs_outputs.client_responses_, rhs_outputs.client_responses_) && identical(lhs_outputs.market_updates_, rhs_outputs.market_updates_);
+}
+
+/// How a live run starts from the journal left by the previous ones.
+enum class Restart {
+  NONE,          // the journal is empty.
+  KEEP_JOURNAL,  // the order books are rebuilt from the journal and their orders canceled, the cancels are journaled.
+  RESET_JOURNAL  // same, the journal is then reset as exchange_main does by default.
+};
+
+/// Live run: the requests go through the FIFOSequencer to a running matching engine and to the journal.
+Outputs runLive(const std::vector<Exchange::MEClientRequest> &requests, int matching_engine_core, int journal_core, Restart restart) {
+  Common::Logger logger("journal_benchmark.log");
+  Exchange::ClientRequestLFQueue client_requests(ME_MAX_CLIENT_UPDATES);
+  Exchange::ClientResponseLFQueue client_responses(ME_MAX_CLIENT_UPDATES);
+  Exchange::MEMarketUpdateLFQueue market_updates(ME_MAX_MARKET_UPDATES);
+
+  auto matching_engine = new Exchange::MatchingEngine<Exchange::MEOrderBook>(&client_requests, &client_responses, &market_updates);
+  auto request_journal = new Exchange::RequestJournal(journal_file, journal_capacity);
+  if (restart != Restart::NONE) {
+    Outputs restart_outputs;
+    const auto drain_outputs = [&]() { restart_outputs.drain(&client_responses, &market_updates); };
+    matching_engine->replay(request_journal->recoveredRequests(), drain_outputs);
+    const auto cancels = matching_engine->cancelOrders(drain_outputs);
+    if (restart == Restart::RESET_JOURNAL) {
+      matching_engine->resetProcessedRequests();
+      request_journal->reset();
+    } else
+      request_journal->append(cancels);
+  }
+  const auto num_journaled = request_journal->size() + requests.size();
+  matching_engine->start(matching_engine_core);
+  request_journal->start(journal_core);
+  Exchange::FIFOSequencer fifo_sequencer({&client_requests}, &logger, request_journal->requestQueue());
+
+  Outputs outputs;
+  for (size_t i = 0; i < requests.size(); ++i) {
+    fifo_sequencer.addClientRequest(static_cast<Nanos>(i), requests[i]);
+    if ((i + 1) % sequencer_batch_size == 0 || i + 1 == requests.size()) {
+      fifo_sequencer.sequenceAndPublish();
+      outputs.drain(&client_responses, &market_updates);
+    }
+  }
+  while (client_requests.size() || request_journal->size() < num_journaled)
+    outputs.drain(&client_responses, &market_updates);
+  outputs.drain(&client_responses, &market_updates);
+
+  delete matching_engine;
+  delete request_journal;
+  return outputs;
+}
+
+/// ./journal_benchmark [MATCHING_ENGINE_CORE JOURNAL_CORE]
+/// Journals the requests of a live run, then rebuilds the order books of a new matching engine from the journal file the way exchange_main does
+/// on startup. Prints the replay rate and whether the replay published exactly the same client responses and market updates as the live run.
+/// Then restarts on the journal and runs the same requests again, reusing every order id of the first run, which must be handled exactly as
+/// they were the first time. Restarts once more resetting the journal, the requests must then be handled exactly as the first time including
+/// the market order ids, and leave only themselves in the journal. Exits with a failure if anything differs.
+int main(int argc, char **argv) {
+  const int matching_engine_core = (argc > 2 ? atoi(argv[1]) : -1);
+  const int journal_core = (argc > 2 ? atoi(argv[2]) : -1);
+
+  const auto requests = randomRequests();
+  std::remove(journal_file.c_str());
+  const auto live_outputs = runLive(requests, matching_engine_core, journal_core, Restart::NONE);
+
+  Exchange::ClientRequestLFQueue client_requests(ME_MAX_CLIENT_UPDATES);
+  Exchange::ClientResponseLFQueue client_responses(ME_MAX_CLIENT_UPDATES);
+  Exchange::MEMarketUpdateLFQueue market_updates(ME_MAX_MARKET_UPDATES);
+  auto matching_engine = new Exchange::MatchingEngine<Exchange::MEOrderBook>(&client_requests, &client_responses, &market_updates);
+  auto request_journal = new Exchange::RequestJournal(journal_file, journal_capacity);
+
+  Outputs replay_outputs;
+  const auto journaled_requests = request_journal->recoveredRequests();
+  const auto start = Common::getCurrentNanos();
+  matching_engine->replay(journaled_requests, [&]() { replay_outputs.drain(&client_responses, &market_updates); });
+  const auto elapsed = Common::getCurrentNanos() - start;
+
+  const auto replay_identical = (identical(live_outputs.client_responses_, replay_outputs.client_responses_) &&
+                                 identical(live_outputs.market_updates_, replay_outputs.market_updates_));
+  std::cout << "REPLAYED requests:" << journaled_requests.size() << " of:" << requests.size() << " elapsed:" << elapsed / NANOS_TO_MILLIS
+            << "ms requests per second:" << static_cast<double>(journaled_requests.size()) * NANOS_TO_SECS / static_cast<double>(elapsed)
+            << " client responses:" << replay_outputs.client_responses_.size()
+            << (identical(live_outputs.client_responses_, replay_outputs.client_responses_) ? " IDENTICAL" : " DIFFERENT")
+            << " market updates:" << replay_outputs.market_updates_.size()
+            << (identical(live_outputs.market_updates_, replay_outputs.market_updates_) ? " IDENTICAL" : " DIFFERENT") << std::endl;
+
+  delete matching_engine;
+  delete request_journal;
+
+  const auto restart_outputs = runLive(requests, matching_engine_core, journal_core, Restart::KEEP_JOURNAL);
+  const auto restart_identical = identicalButMarketOrderIds(live_outputs, restart_outputs);
+  std::cout << "RESTARTED requests:" << requests.size() << " reusing the order ids of the previous run, client responses:"
+            << restart_outputs.client_responses_.size() << " market updates:" << restart_outputs.market_updates_.size()
+            << (restart_identical ? " IDENTICAL" : " DIFFERENT") << " to the previous run but market order ids" << std::endl;
+
+  const auto reset_outputs = runLive(requests, matching_engine_core, journal_core, Restart::RESET_JOURNAL);
+  request_journal = new Exchange::RequestJournal(journal_file, journal_capacity);
+  const auto reset_identical = (identical(live_outputs.client_responses_, reset_outputs.client_responses_) &&
+                                identical(live_outputs.market_updates_, reset_outputs.market_updates_) &&
+                                request_journal->size() == requests.size());
+  std::cout << "RESET JOURNAL requests:" << requests.size() << " journaled:" << request_journal->size() << " client responses:"
+            << reset_outputs.client_responses_.size() << " market updates:" << reset_outputs.market_updates_.size()
+            << (reset_identical ? " IDENTICAL" : " DIFFERENT") << " to the first run" << std::endl;
+  delete request_journal;
+
+  std::remove(journal_file.c_str());
+
+  exit(replay_identical && restart_identical && reset_identical ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,141 @@
+#include "common/lf_queue.h"
+#include "common/opt_lf_queue.h"
+#include "common/perf_utils.h"
+#include "common/thread_utils.h"
+#include "common/time_utils.h"
+
+#include "exchange/order_server/client_request.h"
+
+static constexpr size_t queue_size = 256 * 1024;
+static constexpr size_t latency_loop_count = 100000;
+static constexpr size_t throughput_loop_count = 10 * 1000 * 1000;
+
+/// Each message carries the rdtsc value at which it was written so the consumer can compute one-way latency.
+struct TimedRequest {
+  uint64_t write_rdtsc_ = 0;
+  Exchange::MEClientRequest request_;
+};
+
+/// Consumer thread: reads loop_count messages, accumulates write -> read latency and the total time spent draining.
+template<typename T>
+void consume(T *queue, size_t loop_count, size_t *total_latency_rdtsc) {
+  *total_latency_rdtsc = 0;
+  for (size_t i = 0; i < loop_count;) {
+    const auto msg = queue->getNextToRead();
+    if (msg) {
+      *total_latency_rdtsc += (Common::rdtsc() - msg->write_rdtsc_);
+      queue->updateReadIndex();
+      ++i;
+    }
+  }
+}
+
+/// One message in flight at a time, so the measurement reflects the cost of the handoff and not queueing delay.
+template<typename T>
+size_t benchmarkLatency(int producer_core, int consumer_core) {
+  T queue(queue_size);
+  size_t total_latency_rdtsc = 0;
+
+  auto consumer = Common::createAndStartThread(consumer_core, "Benchmark/Consumer", consume<T>, &queue, latency_loop_count, &total_latency_rdtsc);
+  if (producer_core >= 0)
+    Common::setThreadCore(producer_core);
+
+  for (size_t i = 0; i < latency_loop_count; ++i) {
+    auto next_write = queue.getNextToWriteTo();
+    next_write->write_rdtsc_ = Common::rdtsc();
+    queue.updateWriteIndex();
+    while (queue.size());
+  }
+  consumer->join();
+
+  return (total_latency_rdtsc / latency_loop_count);
+}
+
+/// Producer writes as fast as possible, returns the average number of clock cycles per message end to end.
+template<typename T>
+size_t benchmarkThroughput(int producer_core, int consumer_core) {
+  T queue(queue_size);
+  size_t total_latency_rdtsc = 0;
+
+  auto consumer = Common::createAndStartThread(consumer_core, "Benchmark/Consumer", consume<T>, &queue, throughput_loop_count, &total_latency_rdtsc);
+  if (producer_core >= 0)
+    Common::setThreadCore(producer_core);
+
+  const auto start = Common::rdtsc();
+  for (size_t i = 0; i < throughput_loop_count; ++i) {
+    // The original LFQueue does not guard against overwriting unread elements, OptLFQueue::getNextToWriteTo() waits for a free slot itself.
+    if constexpr (std::is_same_v<T, Common::LFQueue<TimedRequest>>)
+      while (queue.size() >= queue_size);
+    auto next_write = queue.getNextToWriteTo();
+    next_write->write_rdtsc_ = Common::rdtsc();
+    queue.updateWriteIndex();
+  }
+  consumer->join();
+
+  return ((Common::rdtsc() - start) / throughput_loop_count);
+}
+
+/// Consumer thread for the batch benchmark: drains up to batch_size messages per index update.
+void consumeBatch(OptCommon::OptLFQueue<TimedRequest> *queue, size_t loop_count, size_t batch_size) {
+  for (size_t i = 0; i < loop_count;) {
+    const auto msgs = queue->getNextBatchToRead(batch_size);
+    if (!msgs.empty()) {
+      queue->updateReadIndex(msgs.size());
+      i += msgs.size();
+    }
+  }
+}
+
+/// Producer and consumer both move batch_size messages per index update, returns the number of messages per second end to end.
+size_t benchmarkBatchThroughput(int producer_core, int consumer_core, size_t batch_size) {
+  OptCommon::OptLFQueue<TimedRequest> queue(queue_size);
+
+  auto consumer = Common::createAndStartThread(consumer_core, "Benchmark/Consumer", consumeBatch, &queue, throughput_loop_count, batch_size);
+  if (producer_core >= 0)
+    Common::setThreadCore(producer_core);
+
+  const auto start = Common::getCurrentNanos();
+  for (size_t i = 0; i < throughput_loop_count;) {
+    auto next_writes = queue.getNextBatchToWriteTo(std::min(batch_size, throughput_loop_count - i));
+    for (auto &next_write: next_writes)
+      next_write.write_rdtsc_ = i;
+    queue.updateWriteIndex(next_writes.size());
+    i += next_writes.size();
+  }
+  consumer->join();
+
+  return (throughput_loop_count * Common::NANOS_TO_SECS / (Common::getCurrentNanos() - start));
+}
+
+/// ./lf_queue_benchmark [PRODUCER_CORE CONSUMER_CORE]
+int main(int argc, char **argv) {
+  const int producer_core = (argc > 2 ? atoi(argv[1]) : 1);
+  const int consumer_core = (argc > 2 ? atoi(argv[2]) : 2);
+
+  {
+    const auto cycles = benchmarkLatency<Common::LFQueue<TimedRequest>>(producer_core, consumer_core);
+    std::cout << "ORIGINAL LFQUEUE " << cycles << " CLOCK CYCLES ONE-WAY LATENCY." << std::endl;
+  }
+
+  {
+    const auto cycles = benchmarkLatency<OptCommon::OptLFQueue<TimedRequest>>(producer_core, consumer_core);
+    std::cout << "OPTIMIZED LFQUEUE " << cycles << " CLOCK CYCLES ONE-WAY LATENCY." << std::endl;
+  }
+
+  {
+    const auto cycles = benchmarkThroughput<Common::LFQueue<TimedRequest>>(producer_core, consumer_core);
+    std::cout << "ORIGINAL LFQUEUE " << cycles << " CLOCK CYCLES PER MESSAGE THROUGHPUT." << std::endl;
+  }
+
+  {
+    const auto cycles = benchmarkThroughput<OptCommon::OptLFQueue<TimedRequest>>(producer_core, consumer_core);
+    std::cout << "OPTIMIZED LFQUEUE " << cycles << " CLOCK CYCLES PER MESSAGE THROUGHPUT." << std::endl;
+  }
+
+  for (const size_t batch_size: {1, 8, 32, 128}) {
+    const auto msgs_per_sec = benchmarkBatchThroughput(producer_core, consumer_core, batch_size);
+    std::cout << "OPTIMIZED LFQUEUE BATCH " << batch_size << " " << msgs_per_sec << " MESSAGES PER SECOND THROUGHPUT." << std::endl;
+  }
+
+  exit(EXIT_SUCCESS);
+}
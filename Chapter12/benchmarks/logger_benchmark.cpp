@@ -1,5 +1,9 @@
+#include <algorithm>
+
 #include "common/logging.h"
+#include "common/original_logging.h"
 #include "common/opt_logging.h"
+#include "common/binary_logging.h"
 
 std::string random_string(size_t length) {
   auto randchar = []() -> char {
@@ -29,12 +33,32 @@ size_t benchmarkLogging(T *logger) {
   return (total_rdtsc / loop_count);
 }
 
+/// Same shape as the heavily logged lines in MatchingEngine::sendClientResponse() and MEOrderBook::match(), mostly literal characters and several arguments.
+template<typename T>
+size_t benchmarkFormatting(T *logger) {
+  constexpr size_t loop_count = 100000;
+  size_t total_rdtsc = 0;
+  std::string time_str;
+  for (size_t i = 0; i < loop_count; ++i) {
+    const auto s = random_string(64);
+    Common::formatCurrentTimeStr(&time_str);
+    const auto start = Common::rdtsc();
+    logger->log("%:% %() % Sending MEClientResponse [type:% client:% ticker:% %]\n", __FILE__, __LINE__, __FUNCTION__, time_str, 'F', i, 3, s);
+    total_rdtsc += (Common::rdtsc() - start);
+  }
+
+  return (total_rdtsc / loop_count);
+}
+
+/// ./logger_benchmark
+/// Cycles per log() call of the original runtime parsed Logger kept in common/original_logging.h, the OptLogger, the compile time parsed
+/// Common::TextLogger and the BinaryLogger, first on a single string argument and then on a line shaped like the heavily logged ones.
 int main(int, char **) {
   using namespace std::literals::chrono_literals;
 
   {
-    Common::Logger logger("logger_benchmark_original.log");
-    const auto cycles = benchmarkLogging(&logger);
+    OriginalCommon::Logger original_logger("logger_benchmark_original.log");
+    const auto cycles = benchmarkLogging(&original_logger);
     std::cout << "ORIGINAL LOGGER " << cycles << " CLOCK CYCLES PER OPERATION." << std::endl;
     std::this_thread::sleep_for(10s);
   }
@@ -46,5 +70,47 @@ int main(int, char **) {
     std::this_thread::sleep_for(10s);
   }
 
+  {
+    Common::TextLogger logger("logger_benchmark_compile_time.log");
+    const auto cycles = benchmarkLogging(&logger);
+    std::cout << "COMPILE TIME PARSED LOGGER " << cycles << " CLOCK CYCLES PER OPERATION." << std::endl;
+    std::this_thread::sleep_for(10s);
+  }
+
+  {
+    OptCommon::BinaryLogger binary_logger("logger_benchmark_binary.log");
+    const auto cycles = benchmarkLogging(&binary_logger);
+    std::cout << "BINARY LOGGER " << cycles << " CLOCK CYCLES PER OPERATION." << std::endl;
+    std::this_thread::sleep_for(10s);
+  }
+
+  {
+    OriginalCommon::Logger original_logger("logger_benchmark_original_format.log");
+    const auto cycles = benchmarkFormatting(&original_logger);
+    std::cout << "RUNTIME PARSED FORMAT ORIGINAL LOGGER " << cycles << " CLOCK CYCLES PER OPERATION." << std::endl;
+    std::this_thread::sleep_for(10s);
+  }
+
+  {
+    OptCommon::OptLogger opt_logger("logger_benchmark_optimized_format.log");
+    const auto cycles = benchmarkFormatting(&opt_logger);
+    std::cout << "RUNTIME PARSED FORMAT OPTIMIZED LOGGER " << cycles << " CLOCK CYCLES PER OPERATION." << std::endl;
+    std::this_thread::sleep_for(10s);
+  }
+
+  {
+    Common::TextLogger logger("logger_benchmark_compile_time_format.log");
+    const auto cycles = benchmarkFormatting(&logger);
+    std::cout << "COMPILE TIME PARSED FORMAT LOGGER " << cycles << " CLOCK CYCLES PER OPERATION." << std::endl;
+    std::this_thread::sleep_for(10s);
+  }
+
+  {
+    OptCommon::BinaryLogger binary_logger("logger_benchmark_binary_format.log");
+    const auto cycles = benchmarkFormatting(&binary_logger);
+    std::cout << "BINARY FORMAT LOGGER " << cycles << " CLOCK CYCLES PER OPERATION." << std::endl;
+    std::this_thread::sleep_for(10s);
+  }
+
   exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,47 @@
+#include <memory>
+
+#include "common/logging.h"
+#include "common/thread_utils.h"
+
+/// Number of lines each component logs as fast as it can.
+static constexpr size_t loop_count = 2 * 1000 * 1000;
+
+/// One logger per component of the exchange, each with its own producer thread, all logging at the same time.
+static const std::vector<std::string> components = {"matching_engine", "market_data_publisher", "snapshot_synthesizer", "order_server", "exchange_main"};
+
+/// Producer thread: logs lines shaped like MatchingEngine::sendClientResponse() and reports the average clock cycles per log() call.
+void produce(Common::TextLogger *logger, size_t *cycles) {
+  std::string time_str;
+  Common::formatCurrentTimeStr(&time_str);
+
+  size_t total_rdtsc = 0;
+  for (size_t i = 0; i < loop_count; ++i) {
+    const auto start = Common::rdtsc();
+    logger->log("%:% %() % Sending MEClientResponse [type:% client:% ticker:% coid:% moid:% side:% exec_qty:% leaves_qty:% price:%]\n",
+                __FILE__, __LINE__, __FUNCTION__, time_str, 'F', i % 256, i % 8, i, i, 'B', i % 100, i % 50, 100.0 + (i % 100));
+    total_rdtsc += (Common::rdtsc() - start);
+  }
+  *cycles = total_rdtsc / loop_count;
+}
+
+int main(int, char **) {
+  std::vector<std::unique_ptr<Common::TextLogger>> loggers;
+  for (const auto &component: components)
+    loggers.emplace_back(std::make_unique<Common::TextLogger>("logger_stress_benchmark_" + component + ".log"));
+
+  std::vector<size_t> cycles(components.size(), 0);
+  std::vector<std::thread *> producers;
+  for (size_t i = 0; i < components.size(); ++i)
+    producers.push_back(Common::createAndStartThread(-1, "Benchmark/Producer " + components[i], produce, loggers[i].get(), &cycles[i]));
+  for (auto producer: producers)
+    producer->join();
+
+  // The background threads write out the staging buffer every time they drain the queue, so the counters are final shortly after the producers are done.
+  using namespace std::literals::chrono_literals;
+  std::this_thread::sleep_for(1s);
+
+  for (size_t i = 0; i < components.size(); ++i)
+    std::cout << "LOGGER STRESS " << components[i] << " " << cycles[i] << " CLOCK CYCLES PER OPERATION " << loggers[i]->stats().toString() << std::endl;
+
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,74 @@
+#include "market_data/market_data_publisher.h"
+#include "market_data/market_data_consumer.h"
+
+static constexpr size_t num_updates = 20 * 1000;
+
+/// Publish num_updates market updates in bursts of burst_size, waiting for the consumer to decode every burst before publishing the next one.
+/// The latency of an update is from writing its burst to the publisher's queue until this thread reads it from the consumer's queue.
+/// Returns false if updates were lost, the consumer is then recovering from the snapshot stream and the next benchmark cannot run.
+bool benchmarkBursts(size_t burst_size, Exchange::MEMarketUpdateLFQueue *publisher_updates, Exchange::MEMarketUpdateLFQueue *consumer_updates,
+                     OrderId *next_order_id) {
+  size_t total_latency = 0, num_received = 0;
+  const auto start = Common::getCurrentNanos();
+  for (size_t num_sent = 0; num_sent < num_updates; num_sent += burst_size) {
+    const auto burst_start = Common::getCurrentNanos();
+    for (size_t i = 0; i < burst_size;) {
+      const auto next_writes = publisher_updates->getNextBatchToWriteTo(burst_size - i);
+      for (auto &next_write: next_writes)
+        next_write = {Exchange::MarketUpdateType::ADD, (*next_order_id)++, 0, Side::BUY, 100, 10, 1};
+      publisher_updates->updateWriteIndex(next_writes.size());
+      i += next_writes.size();
+    }
+
+    for (size_t i = 0; i < burst_size;) {
+      const auto updates = consumer_updates->getNextBatchToRead(burst_size - i);
+      if (updates.empty()) {
+        if (UNLIKELY(Common::getCurrentNanos() - burst_start > NANOS_TO_SECS)) {
+          std::cout << "BURST SIZE:" << burst_size << " LOST " << burst_size - i << " UPDATES." << std::endl;
+          return false;
+        }
+        continue;
+      }
+      total_latency += (updates.size() * Common::getCurrentNanos() - updates.size() * burst_start);
+      consumer_updates->updateReadIndex(updates.size());
+      i += updates.size();
+      num_received += updates.size();
+    }
+  }
+  const auto elapsed = Common::getCurrentNanos() - start;
+
+  std::cout << "BURST SIZE:" << burst_size << " PACKETS PER BURST:" << (burst_size + Exchange::MDP_MAX_PACKET_UPDATES - 1) / Exchange::MDP_MAX_PACKET_UPDATES
+            << " UPDATES PER SECOND:" << static_cast<double>(num_received) * NANOS_TO_SECS / static_cast<double>(elapsed)
+            << " AVERAGE LATENCY:" << total_latency / num_received << "ns." << std::endl;
+  return true;
+}
+
+/// ./market_data_benchmark
+/// Publishes market updates on the incremental multicast stream over the loopback interface to a market data consumer, in bursts of several sizes.
+int main(int, char **) {
+  const std::string iface = "lo";
+  const std::string snapshot_ip = "233.252.14.1", incremental_ip = "233.252.14.3";
+  const int snapshot_port = 20000, incremental_port = 20001;
+
+  Exchange::MEMarketUpdateLFQueue publisher_updates(ME_MAX_MARKET_UPDATES);
+  Exchange::MEMarketUpdateLFQueue consumer_updates(ME_MAX_MARKET_UPDATES);
+
+  auto market_data_consumer = new Trading::MarketDataConsumer(1, &consumer_updates, iface, snapshot_ip, snapshot_port, incremental_ip, incremental_port);
+  market_data_consumer->start();
+  auto market_data_publisher = new Exchange::MarketDataPublisher({&publisher_updates}, iface, snapshot_ip, snapshot_port, incremental_ip, incremental_port);
+  market_data_publisher->start();
+
+  using namespace std::literals::chrono_literals;
+  std::this_thread::sleep_for(1s);
+
+  OrderId next_order_id = 0;
+  for (const size_t burst_size: {1, 10, 43, 100, 1000}) {
+    if (!benchmarkBursts(burst_size, &publisher_updates, &consumer_updates, &next_order_id))
+      break;
+  }
+
+  delete market_data_publisher;
+  delete market_data_consumer;
+
+  exit(EXIT_SUCCESS);
+}
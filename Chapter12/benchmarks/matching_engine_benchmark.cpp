@@ -0,0 +1,117 @@
+#include "matcher/matching_engine.h"
+#include "order_server/fifo_sequencer.h"
+
+#include <vector>
+
+static constexpr size_t num_clients = 4;
+static constexpr size_t num_requests = 200 * 1000;
+
+/// Requests are handed to the FIFOSequencer in batches of this size, the way the order server does after a round of socket reads.
+static constexpr size_t sequencer_batch_size = 256;
+
+/// The order flow of trading_main's RANDOM algorithm, spread over all the tickers and num_clients clients.
+/// Every new order is followed by a cancel of a random earlier order of the same client, which may already be filled or canceled.
+std::vector<Exchange::MEClientRequest> randomRequests() {
+  srand(0);
+
+  std::vector<Price> ticker_base_price(ME_MAX_TICKERS);
+  for (auto &base_price: ticker_base_price)
+    base_price = (rand() % 100) + 100;
+
+  std::vector<std::vector<Exchange::MEClientRequest>> client_orders(num_clients);
+  std::vector<Exchange::MEClientRequest> requests;
+  requests.reserve(num_requests);
+  while (requests.size() < num_requests) {
+    const ClientId client_id = rand() % num_clients;
+    auto &orders = client_orders[client_id];
+    const TickerId ticker_id = rand() % ME_MAX_TICKERS;
+    const Price price = ticker_base_price[ticker_id] + (rand() % 10) + 1;
+    const Qty qty = 1 + (rand() % 100) + 1;
+    const Side side = (rand() % 2 ? Side::BUY : Side::SELL);
+
+    requests.push_back({Exchange::ClientRequestType::NEW, client_id, ticker_id, static_cast<OrderId>(orders.size()), side, price, qty});
+    orders.push_back(requests.back());
+
+    auto cancel_request = orders[rand() % orders.size()];
+    cancel_request.type_ = Exchange::ClientRequestType::CANCEL;
+    requests.push_back(cancel_request);
+  }
+
+  return requests;
+}
+
+/// Consume everything the matching engine shards published, as the order server and market data publisher would.
+size_t drainOutputs(std::vector<Exchange::ClientResponseLFQueue *> &client_responses, std::vector<Exchange::MEMarketUpdateLFQueue *> &market_updates) {
+  size_t num_responses = 0;
+  for (auto queue: client_responses) {
+    for (auto responses = queue->getNextBatchToRead(ME_MAX_QUEUE_BATCH); !responses.empty(); responses = queue->getNextBatchToRead(ME_MAX_QUEUE_BATCH)) {
+      num_responses += responses.size();
+      queue->updateReadIndex(responses.size());
+    }
+  }
+  for (auto queue: market_updates) {
+    for (auto updates = queue->getNextBatchToRead(ME_MAX_QUEUE_BATCH); !updates.empty(); updates = queue->getNextBatchToRead(ME_MAX_QUEUE_BATCH))
+      queue->updateReadIndex(updates.size());
+  }
+  return num_responses;
+}
+
+/// Time from the first request handed to the FIFOSequencer until the last one has been processed by its shard.
+/// Shard i is pinned to first_core + i when first_core >= 0.
+void benchmarkShards(const std::vector<Exchange::MEClientRequest> &requests, size_t num_shards, int first_core) {
+  Common::Logger logger("matching_engine_benchmark.log");
+
+  std::vector<Exchange::ClientRequestLFQueue *> client_requests;
+  std::vector<Exchange::ClientResponseLFQueue *> client_responses;
+  std::vector<Exchange::MEMarketUpdateLFQueue *> market_updates;
+  std::vector<Exchange::MatchingEngine<Exchange::MEOrderBook> *> matching_engines;
+  for (size_t shard = 0; shard < num_shards; ++shard) {
+    client_requests.push_back(new Exchange::ClientRequestLFQueue(ME_MAX_CLIENT_UPDATES));
+    client_responses.push_back(new Exchange::ClientResponseLFQueue(ME_MAX_CLIENT_UPDATES));
+    market_updates.push_back(new Exchange::MEMarketUpdateLFQueue(ME_MAX_MARKET_UPDATES));
+    matching_engines.push_back(new Exchange::MatchingEngine<Exchange::MEOrderBook>(client_requests.back(), client_responses.back(),
+                                                                                   market_updates.back(), shard, num_shards));
+    matching_engines.back()->start(first_core >= 0 ? first_core + static_cast<int>(shard) : -1);
+  }
+
+  Exchange::FIFOSequencer fifo_sequencer(client_requests, &logger);
+
+  size_t num_responses = 0;
+  const auto start = Common::getCurrentNanos();
+  for (size_t i = 0; i < requests.size(); ++i) {
+    fifo_sequencer.addClientRequest(static_cast<Nanos>(i), requests[i]);
+    if ((i + 1) % sequencer_batch_size == 0 || i + 1 == requests.size()) {
+      fifo_sequencer.sequenceAndPublish();
+      num_responses += drainOutputs(client_responses, market_updates);
+    }
+  }
+  for (auto queue: client_requests) {
+    while (queue->size())
+      num_responses += drainOutputs(client_responses, market_updates);
+  }
+  const auto elapsed = Common::getCurrentNanos() - start;
+  num_responses += drainOutputs(client_responses, market_updates);
+
+  std::cout << "MATCHING ENGINE SHARDS:" << num_shards << " requests:" << requests.size() << " responses:" << num_responses
+            << " elapsed:" << elapsed / NANOS_TO_MILLIS << "ms requests per second:"
+            << static_cast<double>(requests.size()) * NANOS_TO_SECS / static_cast<double>(elapsed) << std::endl;
+
+  for (auto matching_engine: matching_engines)
+    delete matching_engine;
+  for (size_t shard = 0; shard < num_shards; ++shard) {
+    delete client_requests[shard];
+    delete client_responses[shard];
+    delete market_updates[shard];
+  }
+}
+
+/// Usage: matching_engine_benchmark [FIRST_CORE], shards are pinned to consecutive cores starting at FIRST_CORE, unpinned by default.
+int main(int argc, char **argv) {
+  const int first_core = (argc > 1 ? atoi(argv[1]) : -1);
+
+  const auto requests = randomRequests();
+  for (const size_t num_shards: {1, 2, 4, 8})
+    benchmarkShards(requests, num_shards, first_core);
+
+  exit(EXIT_SUCCESS);
+}
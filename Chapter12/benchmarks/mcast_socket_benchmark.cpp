@@ -0,0 +1,64 @@
+#include "common/mcast_socket.h"
+
+using namespace Common;
+
+static constexpr size_t num_datagrams = 200 * 1000;
+static constexpr size_t burst_size = McastMaxBatchDatagrams;
+static constexpr size_t datagram_size = 64;
+
+/// Send num_datagrams datagrams of datagram_size bytes in bursts of burst_size from sender to receiver, both limited to max_batch_datagrams
+/// datagrams per system call, reading every burst before sending the next one. The receiver polls in a busy loop, so the reads that find nothing
+/// are counted separately from the ones that return datagrams.
+void benchmarkBatch(size_t max_batch_datagrams, Common::Logger &logger, const std::string &ip, const std::string &iface, int port) {
+  Common::McastSocket sender(logger, max_batch_datagrams), receiver(logger, max_batch_datagrams);
+  size_t num_received = 0, num_burst_received = 0, num_reads = 0;
+  receiver.recv_callback_ = [&](Common::McastSocket *socket) {
+    num_burst_received += socket->num_rcv_datagrams_;
+    ++num_reads;
+  };
+  ASSERT(receiver.init(ip, iface, port, true) >= 0 && receiver.join(ip), "Unable to create receiver mcast socket.");
+  ASSERT(sender.init(ip, iface, port, false) >= 0, "Unable to create sender mcast socket.");
+
+  const std::array<char, datagram_size> datagram{};
+  const auto start = Common::getCurrentNanos();
+  for (size_t num_sent = 0; num_sent < num_datagrams; num_sent += burst_size) {
+    for (size_t i = 0; i < burst_size; ++i) {
+      sender.send(datagram.data(), datagram.size());
+      sender.endDatagram();
+    }
+    sender.sendAndRecv();
+
+    // Datagrams the kernel dropped never arrive, give up on the rest of the burst after a while.
+    const auto burst_start = Common::getCurrentNanos();
+    for (num_burst_received = 0; num_burst_received < burst_size && Common::getCurrentNanos() - burst_start < NANOS_TO_SECS;)
+      receiver.sendAndRecv();
+    num_received += num_burst_received;
+  }
+  const auto elapsed = Common::getCurrentNanos() - start;
+
+  std::cout << "MAX BATCH DATAGRAMS:" << max_batch_datagrams << " DATAGRAMS PER SECOND:"
+            << static_cast<double>(num_received) * NANOS_TO_SECS / static_cast<double>(elapsed)
+            << " SEND SYSCALLS PER DATAGRAM:" << static_cast<double>(sender.num_send_calls_) / num_datagrams
+            << " DATAGRAMS PER READ:" << static_cast<double>(num_received) / static_cast<double>(std::max<size_t>(num_reads, 1))
+            << " EMPTY READS:" << receiver.num_recv_calls_ - num_reads << " PUBLISHER READS:" << sender.num_recv_calls_
+            << " LOST:" << num_datagrams - num_received << std::endl;
+
+  // Once a socket has left its stream, polling it is free.
+  receiver.leave(ip, port);
+  const auto num_recv_calls = receiver.num_recv_calls_;
+  for (size_t i = 0; i < num_datagrams; ++i)
+    receiver.sendAndRecv();
+  std::cout << "MAX BATCH DATAGRAMS:" << max_batch_datagrams << " IDLE POLLS:" << num_datagrams
+            << " SYSCALLS:" << receiver.num_recv_calls_ - num_recv_calls << std::endl;
+  sender.leave(ip, port);
+}
+
+/// ./mcast_socket_benchmark
+/// Sends datagrams over loopback multicast with one datagram per system call and with batched sendmmsg() / recvmmsg() system calls.
+int main(int, char **) {
+  Common::Logger logger("mcast_socket_benchmark.log");
+  for (const size_t max_batch_datagrams: {static_cast<size_t>(1), McastMaxBatchDatagrams})
+    benchmarkBatch(max_batch_datagrams, logger, "233.252.14.5", "lo", 20005);
+
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,120 @@
+#include "matcher/matching_engine.h"
+
+#include <algorithm>
+#include <vector>
+
+static constexpr size_t loop_count = 10000;
+
+/// A single client talking to a MatchingEngine through its lock free queues, the way the order gateway and order server would hand requests over.
+class QuoteClient {
+public:
+  QuoteClient(Exchange::ClientRequestLFQueue *client_requests, Exchange::ClientResponseLFQueue *client_responses,
+              Exchange::MEMarketUpdateLFQueue *market_updates)
+      : client_requests_(client_requests), client_responses_(client_responses), market_updates_(market_updates) {
+  }
+
+  auto send(const Exchange::MEClientRequest &request) noexcept {
+    *client_requests_->getNextToWriteTo() = request;
+    client_requests_->updateWriteIndex();
+  }
+
+  /// Spin until a client response of the provided type arrives, discarding market updates along the way.
+  auto waitFor(Exchange::ClientResponseType type) noexcept {
+    while (true) {
+      for (auto updates = market_updates_->getNextBatchToRead(ME_MAX_QUEUE_BATCH); !updates.empty(); updates = market_updates_->getNextBatchToRead(ME_MAX_QUEUE_BATCH))
+        market_updates_->updateReadIndex(updates.size());
+
+      const auto response = client_responses_->getNextToRead();
+      if (response) {
+        const auto response_type = response->type_;
+        client_responses_->updateReadIndex();
+        if (response_type == type)
+          return;
+      }
+    }
+  }
+
+private:
+  Exchange::ClientRequestLFQueue *client_requests_ = nullptr;
+  Exchange::ClientResponseLFQueue *client_responses_ = nullptr;
+  Exchange::MEMarketUpdateLFQueue *market_updates_ = nullptr;
+};
+
+/// Prints the average, median and 99th percentile of the round trips in clock cycles.
+void printRoundTrips(const std::string &name, std::vector<size_t> &round_trips) {
+  std::sort(round_trips.begin(), round_trips.end());
+  size_t total = 0;
+  for (auto round_trip: round_trips)
+    total += round_trip;
+  std::cout << name << " AVG:" << total / round_trips.size() << " P50:" << round_trips[round_trips.size() / 2]
+            << " P99:" << round_trips[round_trips.size() * 99 / 100] << " CLOCK CYCLES QUOTE UPDATE ROUND TRIP." << std::endl;
+}
+
+/// ./modify_benchmark [MATCHING_ENGINE_CORE CLIENT_CORE]
+/// A resting bid is moved back and forth between two prices that never cross. The round trip is measured from sending the first request
+/// until the order is acknowledged at its new price, i.e. CANCELED then ACCEPTED for cancel / new, and MODIFIED for modify.
+int main(int argc, char **argv) {
+  const int matching_engine_core = (argc > 2 ? atoi(argv[1]) : -1);
+  const int client_core = (argc > 2 ? atoi(argv[2]) : -1);
+
+  Exchange::ClientRequestLFQueue client_requests(ME_MAX_CLIENT_UPDATES);
+  Exchange::ClientResponseLFQueue client_responses(ME_MAX_CLIENT_UPDATES);
+  Exchange::MEMarketUpdateLFQueue market_updates(ME_MAX_MARKET_UPDATES);
+
+  auto matching_engine = new Exchange::MatchingEngine<Exchange::MEOrderBook>(&client_requests, &client_responses, &market_updates);
+  matching_engine->start(matching_engine_core);
+  if (client_core >= 0)
+    Common::setThreadCore(client_core);
+
+  QuoteClient client(&client_requests, &client_responses, &market_updates);
+  const ClientId client_id = 0;
+  const TickerId ticker_id = 0;
+  const Qty qty = 100;
+  OrderId order_id = 1;
+
+  {
+    std::vector<size_t> round_trips;
+    Exchange::MEClientRequest order{Exchange::ClientRequestType::NEW, client_id, ticker_id, order_id++, Side::BUY, 100, qty};
+    client.send(order);
+    client.waitFor(Exchange::ClientResponseType::ACCEPTED);
+
+    for (size_t i = 0; i < loop_count; ++i) {
+      const auto start = Common::rdtsc();
+      order.type_ = Exchange::ClientRequestType::CANCEL;
+      client.send(order);
+      client.waitFor(Exchange::ClientResponseType::CANCELED);
+
+      order = {Exchange::ClientRequestType::NEW, client_id, ticker_id, order_id++, Side::BUY, (i % 2 ? 100 : 101), qty};
+      client.send(order);
+      client.waitFor(Exchange::ClientResponseType::ACCEPTED);
+      round_trips.push_back(Common::rdtsc() - start);
+    }
+
+    order.type_ = Exchange::ClientRequestType::CANCEL;
+    client.send(order);
+    client.waitFor(Exchange::ClientResponseType::CANCELED);
+    printRoundTrips("CANCEL / NEW", round_trips);
+  }
+
+  {
+    std::vector<size_t> round_trips;
+    Exchange::MEClientRequest order{Exchange::ClientRequestType::NEW, client_id, ticker_id, order_id++, Side::BUY, 100, qty};
+    client.send(order);
+    client.waitFor(Exchange::ClientResponseType::ACCEPTED);
+
+    order.type_ = Exchange::ClientRequestType::MODIFY;
+    for (size_t i = 0; i < loop_count; ++i) {
+      const auto start = Common::rdtsc();
+      order.price_ = (i % 2 ? 100 : 101);
+      client.send(order);
+      client.waitFor(Exchange::ClientResponseType::MODIFIED);
+      round_trips.push_back(Common::rdtsc() - start);
+    }
+
+    printRoundTrips("MODIFY", round_trips);
+  }
+
+  delete matching_engine;
+
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,164 @@
+#include "matcher/matching_engine.h"
+
+#include <cstring>
+#include <vector>
+
+static constexpr size_t num_clients = 8;
+static constexpr size_t num_requests = 200 * 1000;
+
+/// Self-trade prevention mode of every client, so that each mode is exercised against every order book.
+static constexpr std::array<Exchange::SelfTradePrevention, 4> client_self_trade_prevention = {
+    Exchange::SelfTradePrevention::NONE, Exchange::SelfTradePrevention::CANCEL_NEWEST,
+    Exchange::SelfTradePrevention::CANCEL_OLDEST, Exchange::SelfTradePrevention::DECREMENT_BOTH};
+
+/// Resting orders, IOC, FOK and market orders, cancels and modifies spread over all the tickers and num_clients clients, a few of them for orders
+/// that do not exist any more and get rejected.
+std::vector<Exchange::MEClientRequest> randomRequests() {
+  srand(0);
+
+  std::vector<Price> ticker_base_price(ME_MAX_TICKERS);
+  for (auto &base_price: ticker_base_price)
+    base_price = (rand() % 100) + 100;
+
+  std::vector<std::vector<Exchange::MEClientRequest>> client_orders(num_clients);
+  std::vector<Exchange::MEClientRequest> requests;
+  requests.reserve(num_requests);
+  while (requests.size() < num_requests) {
+    const ClientId client_id = rand() % num_clients;
+    auto &orders = client_orders[client_id];
+    const TickerId ticker_id = rand() % ME_MAX_TICKERS;
+    const Price price = ticker_base_price[ticker_id] + (rand() % 20) - 10;
+    const Qty qty = 1 + (rand() % 100);
+    const Side side = (rand() % 2 ? Side::BUY : Side::SELL);
+
+    Exchange::MEClientRequest request{Exchange::ClientRequestType::NEW, client_id, ticker_id, static_cast<OrderId>(orders.size()), side, price, qty};
+    switch (rand() % 10) {
+      case 0:
+        request.time_in_force_ = Exchange::TimeInForce::IOC;
+        break;
+      case 1:
+        request.time_in_force_ = Exchange::TimeInForce::FOK;
+        break;
+      case 2:
+        request.type_ = Exchange::ClientRequestType::MARKET;
+        request.time_in_force_ = (rand() % 2 ? Exchange::TimeInForce::FOK : Exchange::TimeInForce::IOC);
+        break;
+      case 3:
+      case 4:
+        if (!orders.empty()) {
+          request = orders[rand() % orders.size()];
+          request.type_ = Exchange::ClientRequestType::CANCEL;
+        }
+        break;
+      case 5:
+      case 6:
+        if (!orders.empty()) {
+          request = orders[rand() % orders.size()];
+          request.type_ = Exchange::ClientRequestType::MODIFY;
+          request.price_ = price;
+          request.qty_ = qty;
+        }
+        break;
+      default:
+        break;
+    }
+    if (request.type_ == Exchange::ClientRequestType::NEW || request.type_ == Exchange::ClientRequestType::MARKET)
+      orders.push_back(request);
+    requests.push_back(request);
+  }
+
+  return requests;
+}
+
+/// Everything the matching engine published, in the order it was published.
+struct Outputs {
+  std::vector<Exchange::MEClientResponse> client_responses_;
+  std::vector<Exchange::MEMarketUpdate> market_updates_;
+
+  auto drain(Exchange::ClientResponseLFQueue *client_responses, Exchange::MEMarketUpdateLFQueue *market_updates) {
+    for (auto responses = client_responses->getNextBatchToRead(ME_MAX_QUEUE_BATCH); !responses.empty();
+         responses = client_responses->getNextBatchToRead(ME_MAX_QUEUE_BATCH)) {
+      client_responses_.insert(client_responses_.end(), responses.begin(), responses.end());
+      client_responses->updateReadIndex(responses.size());
+    }
+    for (auto updates = market_updates->getNextBatchToRead(ME_MAX_QUEUE_BATCH); !updates.empty();
+         updates = market_updates->getNextBatchToRead(ME_MAX_QUEUE_BATCH)) {
+      market_updates_.insert(market_updates_.end(), updates.begin(), updates.end());
+      market_updates->updateReadIndex(updates.size());
+    }
+  }
+};
+
+/// Index of the first message that differs, byte for byte, or the size of the shorter vector if one is a prefix of the other.
+template<typename T>
+size_t firstDifference(const std::vector<T> &lhs, const std::vector<T> &rhs) {
+  size_t i = 0;
+  while (i < lhs.size() && i < rhs.size() && !std::memcmp(&lhs[i], &rhs[i], sizeof(T)))
+    ++i;
+  return i;
+}
+
+/// Process every request with a MatchingEngine using OrderBookT on the calling thread and return what it published.
+template<typename OrderBookT>
+Outputs runOrderBook(const std::string &name, const std::vector<Exchange::MEClientRequest> &requests, Exchange::FillReporting fill_reporting) {
+  Exchange::ClientRequestLFQueue client_requests(ME_MAX_CLIENT_UPDATES);
+  Exchange::ClientResponseLFQueue client_responses(ME_MAX_CLIENT_UPDATES);
+  Exchange::MEMarketUpdateLFQueue market_updates(ME_MAX_MARKET_UPDATES);
+  auto matching_engine = new Exchange::MatchingEngine<OrderBookT>(&client_requests, &client_responses, &market_updates, 0, 1, fill_reporting);
+  for (size_t client_id = 0; client_id < num_clients; ++client_id)
+    matching_engine->setSelfTradePrevention(client_id, client_self_trade_prevention[client_id % client_self_trade_prevention.size()]);
+
+  Outputs outputs;
+  const auto start = Common::getCurrentNanos();
+  matching_engine->replay(requests, [&]() { outputs.drain(&client_responses, &market_updates); });
+  const auto elapsed = Common::getCurrentNanos() - start;
+
+  std::cout << name << " FILL REPORTING:" << (fill_reporting == Exchange::FillReporting::PER_LEVEL ? "PER_LEVEL" : "PER_ORDER")
+            << " requests:" << requests.size() << " client responses:" << outputs.client_responses_.size()
+            << " market updates:" << outputs.market_updates_.size() << " per request:" << elapsed / requests.size() << "ns";
+
+  delete matching_engine;
+  return outputs;
+}
+
+/// Compare what OrderBookT published with the reference MEOrderBook, prints the first difference of each kind of message if there is one.
+template<typename OrderBookT>
+bool conforms(const std::string &name, const std::vector<Exchange::MEClientRequest> &requests, Exchange::FillReporting fill_reporting,
+              const Outputs &reference) {
+  const auto outputs = runOrderBook<OrderBookT>(name, requests, fill_reporting);
+
+  const auto response_index = firstDifference(reference.client_responses_, outputs.client_responses_);
+  const auto update_index = firstDifference(reference.market_updates_, outputs.market_updates_);
+  const auto identical = (response_index == reference.client_responses_.size() && response_index == outputs.client_responses_.size() &&
+                          update_index == reference.market_updates_.size() && update_index == outputs.market_updates_.size());
+  std::cout << (identical ? " IDENTICAL" : " DIFFERENT") << std::endl;
+
+  if (!identical) {
+    if (response_index < std::min(reference.client_responses_.size(), outputs.client_responses_.size()))
+      std::cout << "  client response:" << response_index << " expected:" << reference.client_responses_[response_index].toString()
+                << " got:" << outputs.client_responses_[response_index].toString() << std::endl;
+    if (update_index < std::min(reference.market_updates_.size(), outputs.market_updates_.size()))
+      std::cout << "  market update:" << update_index << " expected:" << reference.market_updates_[update_index].toString()
+                << " got:" << outputs.market_updates_[update_index].toString() << std::endl;
+  }
+  return identical;
+}
+
+/// ./order_book_conformance_benchmark
+/// Replays the same request stream, with every self-trade prevention mode in use, into a MatchingEngine with each order book implementation and
+/// both fill reporting modes. Every order book must publish exactly the same client responses and market updates as MEOrderBook, the program
+/// exits with a failure otherwise. Also prints the time per request of each order book.
+int main(int, char **) {
+  const auto requests = randomRequests();
+
+  auto all_identical = true;
+  for (const auto fill_reporting: {Exchange::FillReporting::PER_ORDER, Exchange::FillReporting::PER_LEVEL}) {
+    const auto reference = runOrderBook<Exchange::MEOrderBook>("MEOrderBook", requests, fill_reporting);
+    std::cout << " REFERENCE" << std::endl;
+
+    all_identical = conforms<Exchange::LadderMEOrderBook>("LadderMEOrderBook", requests, fill_reporting, reference) && all_identical;
+    all_identical = conforms<Exchange::UnorderedMapMEOrderBook>("UnorderedMapMEOrderBook", requests, fill_reporting, reference) && all_identical;
+  }
+
+  exit(all_identical ? EXIT_SUCCESS : EXIT_FAILURE);
+}
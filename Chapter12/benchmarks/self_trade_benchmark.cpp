@@ -0,0 +1,173 @@
+#include "matcher/matching_engine.h"
+
+static constexpr size_t loop_count = 10000;
+
+/// Every aggressive order sweeps sweep_levels price levels of sweep_orders_per_level resting orders each.
+static constexpr size_t sweep_levels = 5;
+static constexpr size_t sweep_orders_per_level = 4;
+
+/// Nothing consumes the matching engine's outgoing queues in this benchmark, drain them and return the number of messages drained.
+size_t drainQueues(Exchange::ClientResponseLFQueue *client_responses, Exchange::MEMarketUpdateLFQueue *market_updates) {
+  size_t num_messages = 0;
+  while (client_responses->getNextToRead()) {
+    client_responses->updateReadIndex();
+    ++num_messages;
+  }
+  while (market_updates->getNextToRead()) {
+    market_updates->updateReadIndex();
+    ++num_messages;
+  }
+  return num_messages;
+}
+
+/// Before every sweep the resting sell orders are added outside of the measured section, every self_trade_every-th one of them belonging to the
+/// aggressor's client (none if 0). Only the aggressive IOC buy is timed, a client without self-trade prevention then sweeps what is left.
+void benchmarkSweeps(const std::string &name, Exchange::SelfTradePrevention self_trade_prevention, size_t self_trade_every) {
+  Common::Logger logger("self_trade_benchmark.log");
+  Exchange::ClientResponseLFQueue client_responses(ME_MAX_CLIENT_UPDATES);
+  Exchange::MEMarketUpdateLFQueue market_updates(ME_MAX_MARKET_UPDATES);
+  Exchange::MatchingEngineBase matching_engine(&client_responses, &market_updates, "self_trade_benchmark_matching_engine.log");
+
+  const ClientId maker_client_id = 1, taker_client_id = 2, cleanup_client_id = 3;
+  matching_engine.setSelfTradePrevention(taker_client_id, self_trade_prevention);
+  auto order_book = new Exchange::MEOrderBook(0, &logger, &matching_engine);
+
+  OrderId order_id = 0;
+  size_t total_rdtsc = 0, num_messages = 0;
+  for (size_t i = 0; i < loop_count; ++i) {
+    for (size_t level = 0, n = 0; level < sweep_levels; ++level) {
+      for (size_t j = 0; j < sweep_orders_per_level; ++j, ++n) {
+        const auto client_id = (self_trade_every && n % self_trade_every == 0 ? taker_client_id : maker_client_id);
+        order_book->add(client_id, order_id++, 0, Side::SELL, static_cast<Price>(100 + level), 10);
+      }
+    }
+    drainQueues(&client_responses, &market_updates);
+
+    const auto start = Common::rdtsc();
+    order_book->addImmediate(taker_client_id, order_id++, 0, Side::BUY, static_cast<Price>(100 + sweep_levels),
+                             sweep_levels * sweep_orders_per_level * 10, Exchange::TimeInForce::IOC);
+    total_rdtsc += (Common::rdtsc() - start);
+    num_messages += drainQueues(&client_responses, &market_updates);
+
+    order_book->addImmediate(cleanup_client_id, order_id++, 0, Side::BUY, Exchange::MARKET_BUY_PRICE,
+                             sweep_levels * sweep_orders_per_level * 10, Exchange::TimeInForce::IOC);
+    drainQueues(&client_responses, &market_updates);
+  }
+
+  std::cout << name << " " << total_rdtsc / loop_count << " CLOCK CYCLES PER SWEEP "
+            << static_cast<double>(num_messages) / loop_count << " MESSAGES PER SWEEP." << std::endl;
+
+  delete order_book;
+}
+
+/// The outcome of an aggressive order against a book holding, in FIFO order, a maker's 10@100, 10@100 of the aggressor's own client and a
+/// maker's 10@101, as seen in the client responses. A CANCELED response reports the quantity the order had left when it was canceled.
+struct SelfTradeOutcome {
+  Qty aggressor_filled_qty_ = 0;    // total quantity of the aggressor's fills.
+  Qty own_resting_qty_ = 0;         // what is left of the aggressor client's resting order, 0 if it was filled or canceled.
+  Qty aggressor_canceled_qty_ = 0;  // leaves_qty_ of the aggressor's CANCELED response, 0 if there is none.
+  Qty own_canceled_qty_ = 0;        // leaves_qty_ of the CANCELED response of the aggressor client's resting order, 0 if there is none.
+
+  bool operator==(const SelfTradeOutcome &rhs) const = default;
+};
+
+/// Run a single BUY of qty at 101 with the provided self-trade prevention mode and time in force into a new OrderBookT and check its outcome.
+template<typename OrderBookT>
+bool checkSelfTrade(const std::string &name, Exchange::SelfTradePrevention self_trade_prevention, Exchange::TimeInForce time_in_force, Qty qty,
+                    SelfTradeOutcome expected) {
+  Common::Logger logger("self_trade_benchmark.log");
+  Exchange::ClientResponseLFQueue client_responses(ME_MAX_CLIENT_UPDATES);
+  Exchange::MEMarketUpdateLFQueue market_updates(ME_MAX_MARKET_UPDATES);
+  Exchange::MatchingEngineBase matching_engine(&client_responses, &market_updates, "self_trade_benchmark_matching_engine.log");
+
+  const ClientId maker_client_id = 1, taker_client_id = 2;
+  const OrderId own_order_id = 1, aggressor_order_id = 3;
+  matching_engine.setSelfTradePrevention(taker_client_id, self_trade_prevention);
+  auto order_book = new OrderBookT(0, &logger, &matching_engine);
+
+  order_book->add(maker_client_id, 0, 0, Side::SELL, 100, 10);
+  order_book->add(taker_client_id, own_order_id, 0, Side::SELL, 100, 10);
+  order_book->add(maker_client_id, 2, 0, Side::SELL, 101, 10);
+  drainQueues(&client_responses, &market_updates);
+
+  order_book->addImmediate(taker_client_id, aggressor_order_id, 0, Side::BUY, 101, qty, time_in_force);
+
+  SelfTradeOutcome outcome{0, 10, 0, 0};
+  for (auto client_response = client_responses.getNextToRead(); client_response; client_response = client_responses.getNextToRead()) {
+    const auto canceled = (client_response->type_ == Exchange::ClientResponseType::CANCELED);
+    if (client_response->client_id_ == taker_client_id && client_response->client_order_id_ == aggressor_order_id) {
+      if (client_response->type_ == Exchange::ClientResponseType::FILLED)
+        outcome.aggressor_filled_qty_ += client_response->exec_qty_;
+      if (canceled)
+        outcome.aggressor_canceled_qty_ = client_response->leaves_qty_;
+    }
+    if (client_response->client_id_ == taker_client_id && client_response->client_order_id_ == own_order_id) {
+      outcome.own_resting_qty_ = (canceled ? 0 : client_response->leaves_qty_);
+      if (canceled)
+        outcome.own_canceled_qty_ = client_response->leaves_qty_;
+    }
+    client_responses.updateReadIndex();
+  }
+  drainQueues(&client_responses, &market_updates);
+  delete order_book;
+
+  const auto passed = (outcome == expected);
+  std::cout << name << " " << (time_in_force == Exchange::TimeInForce::FOK ? "FOK" : "IOC") << " QTY:" << qty
+            << " FILLED:" << outcome.aggressor_filled_qty_ << " OWN RESTING:" << outcome.own_resting_qty_
+            << " CANCELED:" << outcome.aggressor_canceled_qty_ << " OWN CANCELED:" << outcome.own_canceled_qty_ << (passed ? " PASSED" : " FAILED") << std::endl;
+  return passed;
+}
+
+/// Every self-trade prevention mode with IOC and FOK orders, a FOK order must fill in full or not at all.
+template<typename OrderBookT>
+bool checkSelfTradePrevention(const std::string &name) {
+  using Exchange::SelfTradePrevention;
+  using Exchange::TimeInForce;
+
+  auto passed = true;
+  passed = checkSelfTrade<OrderBookT>(name + " STP NONE", SelfTradePrevention::NONE, TimeInForce::IOC, 20, {20, 0, 0, 0}) && passed;
+  passed = checkSelfTrade<OrderBookT>(name + " STP NONE", SelfTradePrevention::NONE, TimeInForce::FOK, 20, {20, 0, 0, 0}) && passed;
+
+  // The aggressor is canceled when it reaches its own order, which is left untouched.
+  passed = checkSelfTrade<OrderBookT>(name + " STP CANCEL_NEWEST", SelfTradePrevention::CANCEL_NEWEST, TimeInForce::IOC, 20, {10, 10, 10, 0}) && passed;
+  passed = checkSelfTrade<OrderBookT>(name + " STP CANCEL_NEWEST", SelfTradePrevention::CANCEL_NEWEST, TimeInForce::FOK, 20, {0, 10, 20, 0}) && passed;
+  passed = checkSelfTrade<OrderBookT>(name + " STP CANCEL_NEWEST", SelfTradePrevention::CANCEL_NEWEST, TimeInForce::FOK, 10, {10, 10, 0, 0}) && passed;
+
+  // The own order is canceled and the aggressor carries on to the next level.
+  passed = checkSelfTrade<OrderBookT>(name + " STP CANCEL_OLDEST", SelfTradePrevention::CANCEL_OLDEST, TimeInForce::IOC, 20, {20, 0, 0, 10}) && passed;
+  passed = checkSelfTrade<OrderBookT>(name + " STP CANCEL_OLDEST", SelfTradePrevention::CANCEL_OLDEST, TimeInForce::FOK, 20, {20, 0, 0, 10}) && passed;
+  passed = checkSelfTrade<OrderBookT>(name + " STP CANCEL_OLDEST", SelfTradePrevention::CANCEL_OLDEST, TimeInForce::FOK, 30, {0, 10, 30, 0}) && passed;
+
+  // Both lose the 10 they would have matched, which is all that was left of the aggressor after the maker's order.
+  passed = checkSelfTrade<OrderBookT>(name + " STP DECREMENT_BOTH", SelfTradePrevention::DECREMENT_BOTH, TimeInForce::IOC, 20, {10, 0, 10, 10}) && passed;
+  passed = checkSelfTrade<OrderBookT>(name + " STP DECREMENT_BOTH", SelfTradePrevention::DECREMENT_BOTH, TimeInForce::IOC, 15, {10, 5, 5, 0}) && passed;
+  passed = checkSelfTrade<OrderBookT>(name + " STP DECREMENT_BOTH", SelfTradePrevention::DECREMENT_BOTH, TimeInForce::FOK, 20, {0, 10, 20, 0}) && passed;
+
+  // The aggressor has 25 left after the maker's order and keeps 15 of it, the own order has 10 left and is canceled with all of them.
+  passed = checkSelfTrade<OrderBookT>(name + " STP DECREMENT_BOTH", SelfTradePrevention::DECREMENT_BOTH, TimeInForce::IOC, 35, {20, 0, 5, 10}) && passed;
+
+  return passed;
+}
+
+/// ./self_trade_benchmark
+/// Checks the outcome of every self-trade prevention mode with every order book, exits with a failure if one of them is wrong, and then
+/// benchmarks the cost of the match loop with and without self trades.
+int main(int, char **) {
+  auto passed = checkSelfTradePrevention<Exchange::MEOrderBook>("MEOrderBook");
+  passed = checkSelfTradePrevention<Exchange::LadderMEOrderBook>("LadderMEOrderBook") && passed;
+  passed = checkSelfTradePrevention<Exchange::UnorderedMapMEOrderBook>("UnorderedMapMEOrderBook") && passed;
+  if (!passed)
+    exit(EXIT_FAILURE);
+
+  // Flow without self trades, the match loop cost should not depend on whether the aggressor has self-trade prevention enabled.
+  benchmarkSweeps("NO SELF TRADES, STP NONE", Exchange::SelfTradePrevention::NONE, 0);
+  benchmarkSweeps("NO SELF TRADES, STP CANCEL_OLDEST", Exchange::SelfTradePrevention::CANCEL_OLDEST, 0);
+
+  // Every 4th resting order belongs to the aggressor's client.
+  benchmarkSweeps("SELF TRADES, STP NONE", Exchange::SelfTradePrevention::NONE, 4);
+  benchmarkSweeps("SELF TRADES, STP CANCEL_NEWEST", Exchange::SelfTradePrevention::CANCEL_NEWEST, 4);
+  benchmarkSweeps("SELF TRADES, STP CANCEL_OLDEST", Exchange::SelfTradePrevention::CANCEL_OLDEST, 4);
+  benchmarkSweeps("SELF TRADES, STP DECREMENT_BOTH", Exchange::SelfTradePrevention::DECREMENT_BOTH, 4);
+
+  exit(EXIT_SUCCESS);
+}
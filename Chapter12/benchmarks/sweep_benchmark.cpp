@@ -0,0 +1,83 @@
+#include "matcher/matching_engine.h"
+
+static constexpr size_t loop_count = 1000;
+
+/// Every sweep takes out sweep_levels price levels of sweep_orders_per_level resting orders each.
+static constexpr size_t sweep_levels = 10;
+static constexpr size_t sweep_orders_per_level = 5;
+
+/// Consume everything the matching engine published, as the order server and market data publisher would, returns the number of messages.
+size_t drainOutputs(Exchange::ClientResponseLFQueue *client_responses, Exchange::MEMarketUpdateLFQueue *market_updates) {
+  size_t num_messages = 0;
+  for (auto responses = client_responses->getNextBatchToRead(ME_MAX_QUEUE_BATCH); !responses.empty();
+       responses = client_responses->getNextBatchToRead(ME_MAX_QUEUE_BATCH)) {
+    num_messages += responses.size();
+    client_responses->updateReadIndex(responses.size());
+  }
+  for (auto updates = market_updates->getNextBatchToRead(ME_MAX_QUEUE_BATCH); !updates.empty();
+       updates = market_updates->getNextBatchToRead(ME_MAX_QUEUE_BATCH)) {
+    num_messages += updates.size();
+    market_updates->updateReadIndex(updates.size());
+  }
+  return num_messages;
+}
+
+/// Send the requests to the matching engine and wait until it has processed them and everything it published has been consumed.
+size_t sendAndWait(Exchange::ClientRequestLFQueue *client_requests, Exchange::ClientResponseLFQueue *client_responses,
+                   Exchange::MEMarketUpdateLFQueue *market_updates, const std::vector<Exchange::MEClientRequest> &requests) {
+  auto next_writes = client_requests->getNextBatchToWriteTo(requests.size());
+  std::copy(requests.begin(), requests.end(), next_writes.begin());
+  client_requests->updateWriteIndex(requests.size());
+
+  size_t num_messages = 0;
+  while (client_requests->size())
+    num_messages += drainOutputs(client_responses, market_updates);
+  return num_messages + drainOutputs(client_responses, market_updates);
+}
+
+/// Measures from sending an IOC order that sweeps all the resting orders until the last client response and market update it caused is consumed.
+void benchmarkSweep(const std::string &name, Exchange::FillReporting fill_reporting, int matching_engine_core) {
+  Exchange::ClientRequestLFQueue client_requests(ME_MAX_CLIENT_UPDATES);
+  Exchange::ClientResponseLFQueue client_responses(ME_MAX_CLIENT_UPDATES);
+  Exchange::MEMarketUpdateLFQueue market_updates(ME_MAX_MARKET_UPDATES);
+  auto matching_engine = new Exchange::MatchingEngine<Exchange::MEOrderBook>(&client_requests, &client_responses, &market_updates, 0, 1, fill_reporting);
+  matching_engine->start(matching_engine_core);
+
+  const ClientId maker_client_id = 1, taker_client_id = 2;
+  OrderId maker_order_id = 0;
+  size_t total_rdtsc = 0, num_messages = 0;
+  std::vector<Exchange::MEClientRequest> resting_orders;
+  for (OrderId taker_order_id = 0; taker_order_id < loop_count; ++taker_order_id) {
+    resting_orders.clear();
+    for (size_t level = 0; level < sweep_levels; ++level) {
+      for (size_t i = 0; i < sweep_orders_per_level; ++i)
+        resting_orders.push_back({Exchange::ClientRequestType::NEW, maker_client_id, 0, maker_order_id++, Side::SELL,
+                                  static_cast<Price>(100 + level), 1});
+    }
+    sendAndWait(&client_requests, &client_responses, &market_updates, resting_orders);
+
+    const auto start = Common::rdtsc();
+    num_messages += sendAndWait(&client_requests, &client_responses, &market_updates,
+                                {{Exchange::ClientRequestType::NEW, taker_client_id, 0, taker_order_id, Side::BUY,
+                                  static_cast<Price>(100 + sweep_levels), sweep_levels * sweep_orders_per_level, Exchange::TimeInForce::IOC}});
+    total_rdtsc += (Common::rdtsc() - start);
+  }
+
+  std::cout << name << " " << num_messages / loop_count << " MESSAGES PER SWEEP " << total_rdtsc / loop_count
+            << " CLOCK CYCLES END TO END." << std::endl;
+
+  delete matching_engine;
+}
+
+/// ./sweep_benchmark [MATCHING_ENGINE_CORE CLIENT_CORE]
+int main(int argc, char **argv) {
+  const int matching_engine_core = (argc > 2 ? atoi(argv[1]) : -1);
+  const int client_core = (argc > 2 ? atoi(argv[2]) : -1);
+  if (client_core >= 0)
+    Common::setThreadCore(client_core);
+
+  benchmarkSweep("PER-ORDER FILLS", Exchange::FillReporting::PER_ORDER, matching_engine_core);
+  benchmarkSweep("PER-LEVEL FILLS", Exchange::FillReporting::PER_LEVEL, matching_engine_core);
+
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,119 @@
+#include "common/tcp_socket.h"
+#include "common/huge_page_allocator.h"
+#include "order_server/client_request.h"
+
+#include <fstream>
+
+using namespace Common;
+
+static constexpr size_t num_messages = 1000 * 1000;
+static constexpr size_t num_passes = 10;
+static constexpr size_t num_connections = 16;
+
+/// Bytes handed over by every read, a full sized TCP segment on an ethernet link, so most reads end with a partial message.
+static constexpr size_t read_size = 1448;
+
+/// Size of the compacted receive buffers TCPSocket used to have, one for sending and one for receiving.
+static constexpr size_t compacted_buffer_size = 64 * 1024 * 1024;
+
+/// The receive path TCPSocket used to have: a flat buffer, with the partial message at the end copied back to its start after every parse.
+struct CompactedBuffer {
+  std::vector<char, OptCommon::HugePageAllocator<char>> data_ = std::vector<char, OptCommon::HugePageAllocator<char>>(compacted_buffer_size);
+  size_t next_valid_index_ = 0;
+};
+
+/// Value in bytes of the line starting with key in a /proc file that reports sizes in KB.
+/// The rings are shared memory, counted by the system wide Shmem - the resident memory of the process counts their pages once per mapping.
+size_t memoryBytes(const std::string &file, const std::string &key) {
+  std::ifstream proc_file(file);
+  for (std::string line; std::getline(proc_file, line);) {
+    if (line.starts_with(key))
+      return std::stoull(line.substr(key.size())) * 1024;
+  }
+  return 0;
+}
+
+/// Parse every complete request the way OrderServer::recvCallback() does, returns the number of bytes consumed.
+inline size_t parseRequests(const char *data, size_t size, size_t *num_parsed, size_t *checksum) {
+  size_t i = 0;
+  for (; i + sizeof(Exchange::OMClientRequest) <= size; i += sizeof(Exchange::OMClientRequest)) {
+    const auto request = reinterpret_cast<const Exchange::OMClientRequest *>(data + i);
+    *checksum += request->seq_num_ + request->me_client_request_.qty_;
+    ++*num_parsed;
+  }
+  return i;
+}
+
+/// ./tcp_buffer_benchmark
+/// Memory per connection and receive parse cost per request of the compacted flat buffers TCPSocket used to have and its mirrored rings.
+int main(int, char **) {
+  Logger logger("tcp_buffer_benchmark.log");
+
+  {
+    const auto start = memoryBytes("/proc/meminfo", "Shmem:");
+    std::vector<TCPSocket *> sockets;
+    for (size_t i = 0; i < num_connections; ++i)
+      sockets.push_back(new TCPSocket(logger));
+    std::cout << "MIRRORED RINGS memory per connection:" << (memoryBytes("/proc/meminfo", "Shmem:") - start) / num_connections / 1024 << "KB"
+              << std::endl;
+    for (auto socket: sockets)
+      delete socket;
+  }
+
+  {
+    const auto start = memoryBytes("/proc/self/status", "RssAnon:");
+    std::vector<CompactedBuffer *> buffers;
+    for (size_t i = 0; i < 2 * num_connections; ++i)
+      buffers.push_back(new CompactedBuffer());
+    std::cout << "COMPACTED BUFFERS memory per connection:" << (memoryBytes("/proc/self/status", "RssAnon:") - start) / num_connections / 1024 << "KB"
+              << std::endl;
+    for (auto buffer: buffers)
+      delete buffer;
+  }
+  std::vector<char> stream(num_messages * sizeof(Exchange::OMClientRequest));
+  for (size_t i = 0; i < num_messages; ++i) {
+    Exchange::OMClientRequest request;
+    request.seq_num_ = i + 1;
+    request.me_client_request_.qty_ = static_cast<Qty>(i % 100);
+    std::memcpy(stream.data() + i * sizeof(request), &request, sizeof(request));
+  }
+
+  {
+    CompactedBuffer buffer;
+    size_t num_parsed = 0, checksum = 0;
+    const auto start = getCurrentNanos();
+    for (size_t pass = 0; pass < num_passes; ++pass) {
+      for (size_t offset = 0; offset < stream.size(); offset += read_size) {
+        const auto n = std::min(read_size, stream.size() - offset);
+        std::memcpy(buffer.data_.data() + buffer.next_valid_index_, stream.data() + offset, n);
+        buffer.next_valid_index_ += n;
+
+        const auto i = parseRequests(buffer.data_.data(), buffer.next_valid_index_, &num_parsed, &checksum);
+        std::memcpy(buffer.data_.data(), buffer.data_.data() + i, buffer.next_valid_index_ - i);
+        buffer.next_valid_index_ -= i;
+      }
+    }
+    const auto elapsed = getCurrentNanos() - start;
+    std::cout << "COMPACTED BUFFER parsed:" << num_parsed << " checksum:" << checksum << " per request:"
+              << static_cast<double>(elapsed) / static_cast<double>(num_parsed) << "ns" << std::endl;
+  }
+  {
+    MirroredRingBuffer buffer(TCPBufferSize);
+    size_t num_parsed = 0, checksum = 0;
+    const auto start = getCurrentNanos();
+    for (size_t pass = 0; pass < num_passes; ++pass) {
+      for (size_t offset = 0; offset < stream.size(); offset += read_size) {
+        const auto n = std::min(read_size, stream.size() - offset);
+        std::memcpy(buffer.writeData(), stream.data() + offset, n);
+        buffer.updateWriteIndex(n);
+
+        buffer.updateReadIndex(parseRequests(buffer.readData(), buffer.size(), &num_parsed, &checksum));
+      }
+    }
+    const auto elapsed = getCurrentNanos() - start;
+    std::cout << "MIRRORED RING parsed:" << num_parsed << " checksum:" << checksum << " per request:"
+              << static_cast<double>(elapsed) / static_cast<double>(num_parsed) << "ns" << std::endl;
+  }
+
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,101 @@
+#include "common/tcp_server.h"
+
+using namespace Common;
+
+/// Roughly the size of a sequenced client request.
+static constexpr size_t message_size = 40;
+static constexpr size_t num_messages = 20 * 1000;
+static constexpr size_t num_idle_loops = 100 * 1000;
+
+static const std::string iface = "lo";
+static constexpr int port = 12346;
+
+/// Connect num_clients clients to a TCPServer using backend that echoes everything it reads back, then time the server's poll() and
+/// sendAndRecv() loop while idle and while every client sends a message and waits for the echo, num_messages messages in total.
+/// The clients are plain non-blocking sockets, the server allocates a TCPSocket with its buffers for every one of them.
+void benchmarkBackend(TCPServerBackend backend, size_t num_clients, Logger &logger) {
+  const auto socket_buffers_size = (num_clients + 1) * 2 * TCPBufferSize;
+  const auto available_size = static_cast<size_t>(sysconf(_SC_AVPHYS_PAGES)) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  if (socket_buffers_size > available_size) {
+    std::cout << "BACKEND:" << tcpServerBackendToString(backend) << " CLIENTS:" << num_clients << " SKIPPED socket buffers need:"
+              << socket_buffers_size / (1024 * 1024) << "MB available:" << available_size / (1024 * 1024) << "MB" << std::endl;
+    return;
+  }
+
+  auto server = new TCPServer(logger, backend);
+  server->recv_callback_ = [](TCPSocket *socket, Nanos) {
+    socket->send(socket->inbound_data_.readData(), socket->inbound_data_.size());
+    socket->inbound_data_.updateReadIndex(socket->inbound_data_.size());
+  };
+  server->recv_finished_callback_ = []() {};
+  server->listen(iface, port);
+
+  std::vector<int> client_fds;
+  for (size_t i = 0; i < num_clients; ++i)
+    client_fds.push_back(createSocket(logger, {"127.0.0.1", iface, port, false, false, false}));
+  while (server->receive_sockets_.size() < num_clients) {
+    server->poll();
+    server->sendAndRecv();
+  }
+
+  const auto idle_start = getCurrentNanos();
+  for (size_t i = 0; i < num_idle_loops; ++i) {
+    server->poll();
+    server->sendAndRecv();
+  }
+  const auto idle_elapsed = getCurrentNanos() - idle_start;
+
+  const std::array<char, message_size> message{};
+  std::array<char, message_size> reply{};
+  std::vector<size_t> received(num_clients);
+  const auto num_rounds = num_messages / num_clients;
+  const auto num_enter_calls = (server->io_uring_ ? server->io_uring_->num_enter_calls_ : 0);
+  Nanos server_elapsed = 0;
+  const auto start = getCurrentNanos();
+  for (size_t round = 0; round < num_rounds; ++round) {
+    for (const auto fd: client_fds)
+      ASSERT(::send(fd, message.data(), message.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(message.size()),
+             "Client send failed. error:" + std::string(std::strerror(errno)));
+
+    std::fill(received.begin(), received.end(), 0);
+    for (size_t num_replies = 0; num_replies < num_clients;) {
+      const auto server_start = getCurrentNanos();
+      server->poll();
+      server->sendAndRecv();
+      server_elapsed += getCurrentNanos() - server_start;
+
+      for (size_t i = 0; i < num_clients; ++i) {
+        if (received[i] == message_size)
+          continue;
+        const auto n = recv(client_fds[i], reply.data(), message_size - received[i], MSG_DONTWAIT);
+        if (n > 0 && (received[i] += n) == message_size)
+          ++num_replies;
+      }
+    }
+  }
+  const auto elapsed = getCurrentNanos() - start;
+  const auto num_sent = num_rounds * num_clients;
+
+  std::cout << "BACKEND:" << tcpServerBackendToString(backend) << " CLIENTS:" << num_clients
+            << " IDLE LOOP:" << idle_elapsed / num_idle_loops << "ns"
+            << " SERVER TIME PER MESSAGE:" << server_elapsed / num_sent << "ns"
+            << " ROUND TRIP:" << elapsed / num_rounds << "ns"
+            << " IO_URING_ENTER PER MESSAGE:" << static_cast<double>((server->io_uring_ ? server->io_uring_->num_enter_calls_ : 0) - num_enter_calls) / num_sent
+            << std::endl;
+
+  for (const auto fd: client_fds)
+    close(fd);
+  delete server;
+}
+
+/// ./tcp_server_benchmark
+/// Compares the TCPServer backends with 1, 16 and 256 clients connected over the loopback interface.
+int main(int, char **) {
+  Logger logger("tcp_server_benchmark.log");
+
+  for (const size_t num_clients: {1, 16, 256})
+    for (const auto backend: {TCPServerBackend::EPOLL, TCPServerBackend::IO_URING, TCPServerBackend::IO_URING_SQPOLL})
+      benchmarkBackend(backend, num_clients, logger);
+
+  exit(EXIT_SUCCESS);
+}
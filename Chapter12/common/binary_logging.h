@@ -0,0 +1,263 @@
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <unordered_set>
+
+#include "macros.h"
+#include "logging.h"
+#include "opt_lf_queue.h"
+#include "opt_logging.h"
+#include "time_utils.h"
+
+namespace OptCommon {
+  /// Number of records in the lock free queue of the binary logger, records are much larger than a LogElement but there is only one per log() call.
+  /// With BINARY_LOGGING every component has one, so the queue takes as much memory as the one of a Common::TextLogger.
+  constexpr size_t BINARY_LOG_QUEUE_SIZE = 64 * 1024;
+
+  /// Size of a single record in the lock free queue, a whole number of cache lines.
+  constexpr size_t BINARY_LOG_RECORD_SIZE = 4 * CACHE_LINE_SIZE;
+
+  /// Minimum interval between two SYNC entries written while there are records to write.
+  constexpr Common::Nanos BINARY_LOG_SYNC_INTERVAL_NANOS = 10 * Common::NANOS_TO_MILLIS;
+
+  /// Argument type byte of a Common::LogTimestamp, it has no value, the decoder renders the time of day of the record in its place.
+  constexpr char BINARY_LOG_TIMESTAMP_ARG = 'T';
+
+  /// Tags of the entries in the binary log file, each entry starts with one of these bytes.
+  enum class BinaryLogTag : char {
+    FORMAT = 'F',   /// uint64_t format id, uint32_t length, format string bytes.
+    SYNC = 'S',     /// uint64_t rdtsc, int64_t nanoseconds since epoch, used by the decoder to convert rdtsc to wall clock time.
+    RECORD = 'R'    /// uint64_t format id, uint64_t rdtsc, uint16_t arguments size, argument bytes.
+  };
+
+  /// Format string of a log() call, its id is a hash of the string literal computed at compile time.
+  /// The constructor is implicit so existing log("...", args...) call sites compile unchanged.
+  struct BinaryLogFormat {
+    template<size_t N>
+    consteval BinaryLogFormat(const char (&format)[N]) : format_(format) {
+      id_ = 14695981039346656037ULL; // FNV-1a
+      for (size_t i = 0; i < N - 1; ++i) {
+        id_ ^= static_cast<unsigned char>(format[i]);
+        id_ *= 1099511628211ULL;
+      }
+    }
+
+    const char *format_;
+    uint64_t id_ = 0;
+  };
+
+  /// Represents a single log() call, the arguments are stored as a LogType byte followed by the raw value.
+  /// Strings are stored as a LogType byte, a uint16_t length and the characters, truncated to fit in the record.
+  struct alignas(CACHE_LINE_SIZE) BinaryLogRecord {
+    uint64_t format_id_ = 0;
+
+    /// Points to the string literal, only dereferenced by the background thread the first time it sees this format id.
+    const char *format_ = nullptr;
+
+    uint64_t rdtsc_ = 0;
+    uint16_t args_size_ = 0;
+    char args_[BINARY_LOG_RECORD_SIZE - 3 * sizeof(uint64_t) - sizeof(uint16_t)];
+  };
+  static_assert(sizeof(BinaryLogRecord) == BINARY_LOG_RECORD_SIZE);
+
+  /// Logger with the same log() interface as Common::TextLogger and OptLogger, which does no text formatting at all.
+  /// log() copies the format id, an rdtsc timestamp and the raw arguments into one record, the background thread appends the records to the file as is.
+  /// The file is rendered to text offline by the log_decoder tool. Like Common::TextLogger it is serviced by the process wide LogDrain thread.
+  /// It is the Common::Logger of the components when they are built with the BINARY_LOGGING CMake option.
+  class BinaryLogger final : public Common::DrainableLogger {
+  public:
+    /// Consumes from the lock free queue of log records and writes them to the output log file.
+    /// Called by the LogDrain thread, returns whether there were any records in the queue.
+    auto drainQueue() noexcept -> bool override {
+      auto next = queue_.getNextToRead();
+      if (!next)
+        return false;
+
+      if (Common::getCurrentNanos() - last_sync_nanos_ >= BINARY_LOG_SYNC_INTERVAL_NANOS)
+        writeSync();
+
+      for (; next; next = queue_.getNextToRead()) {
+        if (UNLIKELY(!written_formats_.count(next->format_id_))) {
+          // First record for this format, write the format string once so records only need to carry the id.
+          const auto length = static_cast<uint32_t>(strlen(next->format_));
+          write(BinaryLogTag::FORMAT);
+          write(next->format_id_);
+          write(length);
+          file_.write(next->format_, length);
+          written_formats_.insert(next->format_id_);
+        }
+
+        write(BinaryLogTag::RECORD);
+        write(next->format_id_);
+        write(next->rdtsc_);
+        write(next->args_size_);
+        file_.write(next->args_, next->args_size_);
+        queue_.updateReadIndex();
+      }
+      file_.flush();
+
+      return true;
+    }
+
+    explicit BinaryLogger(const std::string &file_name)
+        : file_name_(file_name), queue_(BINARY_LOG_QUEUE_SIZE) {
+      file_.open(file_name, std::ios::binary);
+      ASSERT(file_.is_open(), "Could not open log file:" + file_name);
+      writeSync();
+      Common::logDrain().add(this);
+    }
+
+    ~BinaryLogger() {
+      std::string time_str;
+      std::cerr << Common::getCurrentTimeStr(&time_str) << " Flushing and closing BinaryLogger for " << file_name_ << std::endl;
+
+      while (queue_.size()) {
+        using namespace std::literals::chrono_literals;
+        std::this_thread::sleep_for(1s);
+      }
+      Common::logDrain().remove(this);
+
+      writeSync();
+      file_.close();
+      std::cerr << Common::getCurrentTimeStr(&time_str) << " BinaryLogger for " << file_name_ << " exiting. dropped_records:" << dropped_records_
+                << std::endl;
+    }
+
+    /// Overloaded methods to append the different argument types to a record, same overload set as Logger::pushValue().
+    /// Arguments that do not fit in the record any more are dropped and rendered as missing by the decoder.
+    template<typename T>
+    auto pushRaw(BinaryLogRecord *record, LogType type, const T &value) noexcept {
+      if (UNLIKELY(record->args_size_ + sizeof(type) + sizeof(value) > sizeof(record->args_)))
+        return;
+      record->args_[record->args_size_] = static_cast<char>(type);
+      memcpy(record->args_ + record->args_size_ + sizeof(type), &value, sizeof(value));
+      record->args_size_ += sizeof(type) + sizeof(value);
+    }
+
+    auto pushValue(BinaryLogRecord *record, const char value) noexcept {
+      pushRaw(record, LogType::CHAR, value);
+    }
+
+    auto pushValue(BinaryLogRecord *record, const int value) noexcept {
+      pushRaw(record, LogType::INTEGER, value);
+    }
+
+    auto pushValue(BinaryLogRecord *record, const long value) noexcept {
+      pushRaw(record, LogType::LONG_INTEGER, value);
+    }
+
+    auto pushValue(BinaryLogRecord *record, const long long value) noexcept {
+      pushRaw(record, LogType::LONG_LONG_INTEGER, value);
+    }
+
+    auto pushValue(BinaryLogRecord *record, const unsigned value) noexcept {
+      pushRaw(record, LogType::UNSIGNED_INTEGER, value);
+    }
+
+    auto pushValue(BinaryLogRecord *record, const unsigned long value) noexcept {
+      pushRaw(record, LogType::UNSIGNED_LONG_INTEGER, value);
+    }
+
+    auto pushValue(BinaryLogRecord *record, const unsigned long long value) noexcept {
+      pushRaw(record, LogType::UNSIGNED_LONG_LONG_INTEGER, value);
+    }
+
+    auto pushValue(BinaryLogRecord *record, const float value) noexcept {
+      pushRaw(record, LogType::FLOAT, value);
+    }
+
+    auto pushValue(BinaryLogRecord *record, const double value) noexcept {
+      pushRaw(record, LogType::DOUBLE, value);
+    }
+
+    auto pushValue(BinaryLogRecord *record, const char *value, size_t length) noexcept {
+      constexpr auto header_size = sizeof(LogType) + sizeof(uint16_t);
+      if (UNLIKELY(record->args_size_ + header_size > sizeof(record->args_)))
+        return;
+      const auto stored_length = static_cast<uint16_t>(std::min(length, sizeof(record->args_) - record->args_size_ - header_size));
+      record->args_[record->args_size_] = static_cast<char>(LogType::STRING);
+      memcpy(record->args_ + record->args_size_ + sizeof(LogType), &stored_length, sizeof(stored_length));
+      memcpy(record->args_ + record->args_size_ + header_size, value, stored_length);
+      record->args_size_ += header_size + stored_length;
+    }
+
+    auto pushValue(BinaryLogRecord *record, const char *value) noexcept {
+      pushValue(record, value, strlen(value));
+    }
+
+    auto pushValue(BinaryLogRecord *record, const std::string &value) noexcept {
+      pushValue(record, value.data(), value.size());
+    }
+
+#if defined(BINARY_LOGGING)
+    auto pushValue(BinaryLogRecord *record, const Common::LogTimestamp &) noexcept {
+      if (UNLIKELY(record->args_size_ + sizeof(BINARY_LOG_TIMESTAMP_ARG) > sizeof(record->args_)))
+        return;
+      record->args_[record->args_size_++] = BINARY_LOG_TIMESTAMP_ARG;
+    }
+#endif
+
+    /// Write the format id, the current rdtsc and the raw arguments to a single record in the lock free queue.
+    /// Placeholders are not parsed here, the decoder substitutes % with the arguments in order.
+    /// If the queue is full the record is dropped and counted instead of stalling the thread logging.
+    template<typename... A>
+    auto log(BinaryLogFormat format, const A &... args) noexcept {
+      const auto slot = queue_.tryGetNextBatchToWriteTo(1).first;
+      if (UNLIKELY(slot.empty())) {
+        dropped_records_.store(dropped_records_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+      }
+
+      auto record = slot.data();
+      record->format_id_ = format.id_;
+      record->format_ = format.format_;
+      record->rdtsc_ = Common::rdtsc();
+      record->args_size_ = 0;
+      (pushValue(record, args), ...);
+      queue_.updateWriteIndex();
+    }
+
+    /// Deleted default, copy & move constructors and assignment-operators.
+    BinaryLogger() = delete;
+
+    BinaryLogger(const BinaryLogger &) = delete;
+
+    BinaryLogger(const BinaryLogger &&) = delete;
+
+    BinaryLogger &operator=(const BinaryLogger &) = delete;
+
+    BinaryLogger &operator=(const BinaryLogger &&) = delete;
+
+  private:
+    template<typename T>
+    auto write(const T &value) noexcept -> void {
+      file_.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    /// Write a pair of rdtsc and wall clock nanoseconds so the decoder can map record timestamps to time of day.
+    auto writeSync() noexcept -> void {
+      last_sync_nanos_ = Common::getCurrentNanos();
+      write(BinaryLogTag::SYNC);
+      write(Common::rdtsc());
+      write(static_cast<int64_t>(last_sync_nanos_));
+    }
+
+    /// File to which the log records will be written.
+    const std::string file_name_;
+    std::ofstream file_;
+
+    /// Format ids whose format string has already been written to the file, only accessed by the background thread.
+    std::unordered_set<uint64_t> written_formats_;
+
+    /// Time of the last SYNC entry, only accessed by the LogDrain thread once the logger is added to it.
+    Common::Nanos last_sync_nanos_ = 0;
+
+    /// Lock free queue of log records from main logging thread to the LogDrain disk writer thread.
+    OptLFQueue<BinaryLogRecord> queue_;
+
+    /// log() calls dropped because the queue was full, maintained by the thread logging.
+    std::atomic<size_t> dropped_records_ = {0};
+  };
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <emmintrin.h>
+
+#include "macros.h"
+#include "huge_page_allocator.h"
+
+namespace OptCommon {
+  /// Number of control bytes compared at once with SSE2 while probing.
+  constexpr size_t FLAT_HASH_MAP_GROUP_SIZE = 16;
+
+  /// Open addressing hash map in the style of SwissTable, sized by the number of live entries instead of the key space.
+  /// Every slot has a control byte, either EMPTY or the low 7 bits of the key's hash. Lookups compare a group of 16 control bytes against
+  /// those 7 bits in one SSE2 instruction and only compare keys for the slots that match, so a lookup usually touches one control group and
+  /// one slot. Probing is linear, which lets erase() shift the entries after a removed one back instead of leaving a tombstone, so the table
+  /// never has to be rebuilt to reclaim the slots of erased entries. Keys and values must be trivially copyable, and erase() can move other
+  /// entries, so a pointer returned by find() is only valid until the next erase().
+  template<typename K, typename V, typename Hash>
+  class FlatHashMap final {
+  public:
+    /// Capacity is rounded up to a power of two and only grows, when the table is more than 7/8 full.
+    explicit FlatHashMap(size_t initial_capacity) {
+      rehash(std::max(initial_capacity, FLAT_HASH_MAP_GROUP_SIZE));
+    }
+
+    /// Pointer to the value stored for the key, nullptr if there is none.
+    auto find(const K &key) noexcept -> V * {
+      const auto index = findIndex(key, hash_(key));
+      return (index == NOT_FOUND ? nullptr : &slots_[index].value_);
+    }
+
+    auto find(const K &key) const noexcept -> const V * {
+      const auto index = findIndex(key, hash_(key));
+      return (index == NOT_FOUND ? nullptr : &slots_[index].value_);
+    }
+
+    /// Insert the key or overwrite the value already stored for it.
+    /// Allocates only when the table has to grow, callers size it upfront so that this does not happen on the critical path.
+    auto insert(const K &key, const V &value) noexcept {
+      const auto hash = hash_(key);
+      auto index = findIndex(key, hash);
+      if (LIKELY(index == NOT_FOUND)) {
+        if (UNLIKELY(size_ >= maxLoad(capacity_)))
+          rehash(capacity_ * 2);
+        index = findInsertIndex(hash);
+        setCtrl(index, static_cast<int8_t>(hash & 0x7f));
+        slots_[index].key_ = key;
+        ++size_;
+      }
+      slots_[index].value_ = value;
+    }
+
+    /// Remove the key, returns false if it was not present.
+    auto erase(const K &key) noexcept {
+      const auto index = findIndex(key, hash_(key));
+      if (UNLIKELY(index == NOT_FOUND))
+        return false;
+
+      // Backward shift deletion: every entry up to the next EMPTY slot whose home slot is not between the hole and itself would no longer be
+      // reachable from its home slot, so it moves into the hole and leaves a new hole behind. The load factor keeps these runs short.
+      auto hole = index;
+      for (auto next = (index + 1) & (capacity_ - 1); ctrl_[next] != CTRL_EMPTY; next = (next + 1) & (capacity_ - 1)) {
+        const auto home = homeIndex(hash_(slots_[next].key_));
+        if (((next - home) & (capacity_ - 1)) >= ((next - hole) & (capacity_ - 1))) {
+          setCtrl(hole, ctrl_[next]);
+          slots_[hole] = slots_[next];
+          hole = next;
+        }
+      }
+      setCtrl(hole, CTRL_EMPTY);
+      --size_;
+      return true;
+    }
+
+    auto size() const noexcept {
+      return size_;
+    }
+
+    auto capacity() const noexcept {
+      return capacity_;
+    }
+
+    /// Capacity at which num_entries live entries fit under the maximum load factor, to construct a table that does not grow until then.
+    static constexpr auto capacityFor(size_t num_entries) noexcept -> size_t {
+      return (num_entries * 8 + 6) / 7;
+    }
+
+    /// Bytes allocated for control bytes and slots.
+    auto memoryUsage() const noexcept {
+      return ctrl_.capacity() * sizeof(int8_t) + slots_.capacity() * sizeof(Slot);
+    }
+
+    /// Deleted default, copy & move constructors and assignment-operators.
+    FlatHashMap() = delete;
+
+    FlatHashMap(const FlatHashMap &) = delete;
+
+    FlatHashMap(const FlatHashMap &&) = delete;
+
+    FlatHashMap &operator=(const FlatHashMap &) = delete;
+
+    FlatHashMap &operator=(const FlatHashMap &&) = delete;
+
+  private:
+    static constexpr int8_t CTRL_EMPTY = -128;
+    static constexpr size_t NOT_FOUND = std::numeric_limits<size_t>::max();
+
+    struct Slot {
+      K key_;
+      V value_;
+    };
+
+    static constexpr auto maxLoad(size_t capacity) noexcept {
+      return capacity - capacity / 8;
+    }
+
+    /// Bitmask of the slots in the group starting at index whose control byte equals ctrl.
+    auto match(size_t index, int8_t ctrl) const noexcept -> uint32_t {
+      const auto group = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&ctrl_[index]));
+      return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(ctrl))));
+    }
+
+    /// EMPTY is the only control byte with the sign bit set.
+    auto matchEmpty(size_t index) const noexcept -> uint32_t {
+      const auto group = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&ctrl_[index]));
+      return static_cast<uint32_t>(_mm_movemask_epi8(group));
+    }
+
+    auto homeIndex(size_t hash) const noexcept -> size_t {
+      return (hash >> 7) & (capacity_ - 1);
+    }
+
+    /// An entry sits in the first EMPTY slot after its home slot at the time it was inserted, and erase() keeps every slot between the two
+    /// occupied. Probing therefore visits consecutive groups from the home slot and stops at the first group containing an EMPTY slot.
+    auto findIndex(const K &key, size_t hash) const noexcept -> size_t {
+      const auto h2 = static_cast<int8_t>(hash & 0x7f);
+      auto index = homeIndex(hash);
+      for (;;) {
+        for (auto matches = match(index, h2); matches; matches &= (matches - 1)) {
+          const auto candidate = (index + __builtin_ctz(matches)) & (capacity_ - 1);
+          if (LIKELY(slots_[candidate].key_ == key))
+            return candidate;
+        }
+        if (LIKELY(matchEmpty(index)))
+          return NOT_FOUND;
+        index = (index + FLAT_HASH_MAP_GROUP_SIZE) & (capacity_ - 1);
+      }
+    }
+
+    /// First EMPTY slot at or after the home slot of the hash, the load factor guarantees there is one.
+    auto findInsertIndex(size_t hash) const noexcept -> size_t {
+      auto index = homeIndex(hash);
+      for (;;) {
+        const auto matches = matchEmpty(index);
+        if (LIKELY(matches))
+          return (index + __builtin_ctz(matches)) & (capacity_ - 1);
+        index = (index + FLAT_HASH_MAP_GROUP_SIZE) & (capacity_ - 1);
+      }
+    }
+
+    /// The first 16 control bytes are mirrored after the last one, so that a group starting anywhere can be loaded with a single unaligned load.
+    auto setCtrl(size_t index, int8_t ctrl) noexcept {
+      ctrl_[index] = ctrl;
+      if (index < FLAT_HASH_MAP_GROUP_SIZE)
+        ctrl_[capacity_ + index] = ctrl;
+    }
+
+    /// Move every entry to a new table of the provided capacity.
+    auto rehash(size_t capacity) -> void {
+      capacity = std::max(capacity, FLAT_HASH_MAP_GROUP_SIZE);
+      if (capacity & (capacity - 1))
+        capacity = 1ULL << (64 - __builtin_clzll(capacity));
+
+      std::vector<int8_t, HugePageAllocator<int8_t>> old_ctrl(capacity + FLAT_HASH_MAP_GROUP_SIZE, CTRL_EMPTY);
+      std::vector<Slot, HugePageAllocator<Slot>> old_slots(capacity);
+      old_ctrl.swap(ctrl_);
+      old_slots.swap(slots_);
+      const auto old_capacity = capacity_;
+      capacity_ = capacity;
+
+      for (size_t i = 0; i < old_capacity; ++i) {
+        if (old_ctrl[i] >= 0) {
+          const auto hash = hash_(old_slots[i].key_);
+          const auto index = findInsertIndex(hash);
+          setCtrl(index, static_cast<int8_t>(hash & 0x7f));
+          slots_[index] = old_slots[i];
+        }
+      }
+    }
+
+    /// capacity_ + FLAT_HASH_MAP_GROUP_SIZE control bytes, the last ones mirroring the first ones.
+    std::vector<int8_t, HugePageAllocator<int8_t>> ctrl_;
+    std::vector<Slot, HugePageAllocator<Slot>> slots_;
+
+    size_t capacity_ = 0;
+    size_t size_ = 0;
+
+    Hash hash_;
+  };
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "macros.h"
+
+namespace Common {
+  /// Three levels of 64 bit words, i.e. 64 * 64 * 64 bits.
+  constexpr size_t HIERARCHICAL_BITMAP_SIZE = 64 * 64 * 64;
+
+  /// Fixed size set of indices in [0, HIERARCHICAL_BITMAP_SIZE) with O(1) next / previous set index lookups.
+  /// Every bit of a summary word tells if the corresponding word one level below has any bit set, so a lookup is at most one tzcnt / lzcnt per level.
+  class HierarchicalBitmap final {
+  public:
+    /// Returned by the lookups when there is no set index in the requested direction.
+    static constexpr size_t NONE = HIERARCHICAL_BITMAP_SIZE;
+
+    HierarchicalBitmap() = default;
+
+    auto set(size_t index) noexcept {
+      words_[index >> 6] |= (1ULL << (index & 63));
+      summary_[index >> 12] |= (1ULL << ((index >> 6) & 63));
+      top_ |= (1ULL << (index >> 12));
+    }
+
+    auto clear(size_t index) noexcept {
+      words_[index >> 6] &= ~(1ULL << (index & 63));
+      if (words_[index >> 6])
+        return;
+      summary_[index >> 12] &= ~(1ULL << ((index >> 6) & 63));
+      if (summary_[index >> 12])
+        return;
+      top_ &= ~(1ULL << (index >> 12));
+    }
+
+    auto test(size_t index) const noexcept {
+      return (words_[index >> 6] >> (index & 63)) & 1;
+    }
+
+    auto empty() const noexcept {
+      return !top_;
+    }
+
+    /// Smallest set index >= index, NONE if there is none.
+    auto findFirstAtOrAbove(size_t index) const noexcept -> size_t {
+      if (UNLIKELY(index >= HIERARCHICAL_BITMAP_SIZE))
+        return NONE;
+
+      const auto word_index = index >> 6;
+      const auto word = words_[word_index] & (~0ULL << (index & 63));
+      if (word)
+        return (word_index << 6) | __builtin_ctzll(word);
+
+      const auto summary_index = word_index >> 6;
+      const auto summary = summary_[summary_index] & maskAbove(word_index & 63);
+      if (summary)
+        return lowestInWord((summary_index << 6) | __builtin_ctzll(summary));
+
+      const auto top = top_ & maskAbove(summary_index);
+      if (!top)
+        return NONE;
+      const size_t next_summary_index = __builtin_ctzll(top);
+      return lowestInWord((next_summary_index << 6) | __builtin_ctzll(summary_[next_summary_index]));
+    }
+
+    /// Largest set index <= index, NONE if there is none.
+    auto findLastAtOrBelow(size_t index) const noexcept -> size_t {
+      if (UNLIKELY(index >= HIERARCHICAL_BITMAP_SIZE))
+        index = HIERARCHICAL_BITMAP_SIZE - 1;
+
+      const auto word_index = index >> 6;
+      const auto word = words_[word_index] & (~0ULL >> (63 - (index & 63)));
+      if (word)
+        return (word_index << 6) | (63 - __builtin_clzll(word));
+
+      const auto summary_index = word_index >> 6;
+      const auto summary = summary_[summary_index] & maskBelow(word_index & 63);
+      if (summary)
+        return highestInWord((summary_index << 6) | (63 - __builtin_clzll(summary)));
+
+      const auto top = top_ & maskBelow(summary_index);
+      if (!top)
+        return NONE;
+      const size_t prev_summary_index = 63 - __builtin_clzll(top);
+      return highestInWord((prev_summary_index << 6) | (63 - __builtin_clzll(summary_[prev_summary_index])));
+    }
+
+    /// Deleted copy & move constructors and assignment-operators.
+    HierarchicalBitmap(const HierarchicalBitmap &) = delete;
+
+    HierarchicalBitmap(const HierarchicalBitmap &&) = delete;
+
+    HierarchicalBitmap &operator=(const HierarchicalBitmap &) = delete;
+
+    HierarchicalBitmap &operator=(const HierarchicalBitmap &&) = delete;
+
+  private:
+    /// Bits strictly above / below the provided bit position.
+    static constexpr auto maskAbove(size_t bit) noexcept -> uint64_t {
+      return (bit == 63 ? 0 : (~0ULL << (bit + 1)));
+    }
+
+    static constexpr auto maskBelow(size_t bit) noexcept -> uint64_t {
+      return ((1ULL << bit) - 1);
+    }
+
+    auto lowestInWord(size_t word_index) const noexcept -> size_t {
+      return (word_index << 6) | __builtin_ctzll(words_[word_index]);
+    }
+
+    auto highestInWord(size_t word_index) const noexcept -> size_t {
+      return (word_index << 6) | (63 - __builtin_clzll(words_[word_index]));
+    }
+
+    uint64_t top_ = 0;
+    uint64_t summary_[64] = {};
+    uint64_t words_[64 * 64] = {};
+  };
+}
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <new>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#include <linux/mman.h>
+
+#include "macros.h"
+
+namespace OptCommon {
+  constexpr size_t PAGE_SIZE_4K = 4 * 1024;
+  constexpr size_t PAGE_SIZE_2M = 2 * 1024 * 1024;
+  constexpr size_t PAGE_SIZE_1G = 1024 * 1024 * 1024;
+
+  /// Allocations smaller than this come from the regular heap, it is not worth dedicating a huge page to them.
+  constexpr size_t HUGE_PAGE_MIN_ALLOC_SIZE = PAGE_SIZE_2M / 2;
+
+  /// Kind of pages that ended up backing a region, in order of preference.
+  enum class PageKind : uint8_t {
+    HUGETLB_1G = 0,
+    HUGETLB_2M = 1,
+    TRANSPARENT_HUGE = 2,
+    NORMAL = 3,
+    MAX = 4
+  };
+
+  inline auto pageKindToString(PageKind kind) -> std::string {
+    switch (kind) {
+      case PageKind::HUGETLB_1G:
+        return "HUGETLB_1G";
+      case PageKind::HUGETLB_2M:
+        return "HUGETLB_2M";
+      case PageKind::TRANSPARENT_HUGE:
+        return "TRANSPARENT_HUGE";
+      case PageKind::NORMAL:
+        return "NORMAL";
+      case PageKind::MAX:
+        return "MAX";
+    }
+
+    return "UNKNOWN";
+  }
+
+  /// Process wide counters of how many regions and bytes are backed by each kind of page, used for the startup report.
+  struct HugePageStats {
+    std::atomic<size_t> regions_[static_cast<size_t>(PageKind::MAX)] = {};
+    std::atomic<size_t> bytes_[static_cast<size_t>(PageKind::MAX)] = {};
+  };
+
+  inline HugePageStats huge_page_stats;
+
+  /// Runtime switch, when disabled every region is mapped on 4KB pages with transparent huge pages explicitly turned off.
+  /// Mostly useful to benchmark against the default page size.
+  inline std::atomic<bool> huge_pages_enabled = {true};
+
+  inline auto setHugePagesEnabled(bool enabled) noexcept {
+    huge_pages_enabled = enabled;
+  }
+
+  /// Runtime switch for the hugetlb pool alone, transparent huge pages are still used when it is disabled.
+  /// After a fork() the first write to a MAP_PRIVATE hugetlb page copies the whole 2MB or 1GB page, and if the pool has no free page for the
+  /// copy the kernel takes the page away from the child, which gets SIGBUS when it next reads it. Processes that fork() disable it before
+  /// allocating anything, a transparent huge page is split on such a write and only the 4KB page written to is copied.
+  inline std::atomic<bool> hugetlb_enabled = {true};
+
+  inline auto setHugeTlbEnabled(bool enabled) noexcept {
+    hugetlb_enabled = enabled;
+  }
+
+  /// Length of the mapping backing an allocation of the provided size.
+  /// Only depends on the size so that freeHugePages() can compute it without storing the page kind that was actually used.
+  inline constexpr auto hugePageMappingSize(size_t bytes) noexcept {
+    const auto page_size = (bytes >= PAGE_SIZE_1G ? PAGE_SIZE_1G : PAGE_SIZE_2M);
+    return (bytes + page_size - 1) / page_size * page_size;
+  }
+
+  /// Largest NUMA node id a region can be bound to, the size in bits of the node mask passed to mbind().
+  constexpr int MAX_NUMA_NODES = 64;
+
+  /// NUMA node of the provided cpu, read from sysfs so there is no dependency on libnuma. -1 for cpu -1 or if it is not known.
+  inline auto numaNodeOfCpu(int cpu) noexcept -> int {
+    if (cpu < 0)
+      return -1;
+    for (int node = 0; node < MAX_NUMA_NODES; ++node) {
+      const auto path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/node" + std::to_string(node);
+      if (access(path.c_str(), F_OK) == 0)
+        return node;
+    }
+    return -1;
+  }
+
+  /// NUMA node the regions allocated by the calling thread are bound to, -1 for the node of the cpu it is running on. Set with NumaNodeScope.
+  inline thread_local int allocation_numa_node = -1;
+
+  /// Bind the regions the calling thread allocates while this object exists to the provided NUMA node, -1 for the node of the cpu it is running
+  /// on. Used when a component is created on one thread and used by another pinned to a core, e.g. numaNodeOfCpu() of that core.
+  class NumaNodeScope {
+  public:
+    explicit NumaNodeScope(int numa_node) noexcept : previous_numa_node_(allocation_numa_node) {
+      allocation_numa_node = numa_node;
+    }
+
+    ~NumaNodeScope() {
+      allocation_numa_node = previous_numa_node_;
+    }
+
+    /// Deleted default, copy & move constructors and assignment-operators.
+    NumaNodeScope() = delete;
+
+    NumaNodeScope(const NumaNodeScope &) = delete;
+
+    NumaNodeScope(const NumaNodeScope &&) = delete;
+
+    NumaNodeScope &operator=(const NumaNodeScope &) = delete;
+
+    NumaNodeScope &operator=(const NumaNodeScope &&) = delete;
+
+  private:
+    const int previous_numa_node_;
+  };
+
+  /// Prefer the provided NUMA node for the pages of this region, or with -1 the node of the cpu the calling thread is running on.
+  /// Uses the raw system call so there is no dependency on libnuma, failure is not fatal since it is only a hint.
+  inline auto bindToNumaNode(void *ptr, size_t len, int numa_node) noexcept {
+    unsigned cpu = 0, node = numa_node;
+    if (numa_node < 0 && getcpu(&cpu, &node) != 0)
+      return false;
+    if (node >= static_cast<unsigned>(MAX_NUMA_NODES))
+      return false;
+
+    unsigned long node_mask = (1UL << node);
+    return (syscall(SYS_mbind, ptr, len, MPOL_PREFERRED, &node_mask, sizeof(node_mask) * 8, 0) == 0);
+  }
+
+  /// Whether the kernel hands out transparent huge pages to regions that ask for them with MADV_HUGEPAGE. madvise() succeeds regardless, even
+  /// when transparent huge pages are disabled system wide with "never", so the mode is read from sysfs, once.
+  inline auto transparentHugePagesAvailable() noexcept -> bool {
+    static const auto available = []() {
+      char mode[128] = {};
+      const auto fd = open("/sys/kernel/mm/transparent_hugepage/enabled", O_RDONLY);
+      if (fd < 0)
+        return false;
+      const auto n = read(fd, mode, sizeof(mode) - 1);
+      close(fd);
+      return (n > 0 && !strstr(mode, "[never]"));
+    }();
+    return available;
+  }
+
+  /// Map an anonymous region for the provided number of bytes backed by the largest pages available:
+  /// explicit 1GB or 2MB huge pages from the hugetlb pool unless hugetlb_enabled is off, then transparent huge pages, then regular 4KB pages.
+  /// The region is bound to numa_node, by default allocation_numa_node, and if requested pre-faulted so the first accesses on the critical path do
+  /// not page fault. Pre-faulting on another node's cpu still places the pages on numa_node.
+  inline auto allocateHugePages(size_t bytes, bool prefault, int numa_node = allocation_numa_node) noexcept -> void * {
+    const auto len = hugePageMappingSize(bytes);
+    void *ptr = MAP_FAILED;
+    auto kind = PageKind::NORMAL;
+
+    if (huge_pages_enabled && hugetlb_enabled) {
+      if (len >= PAGE_SIZE_1G) {
+        ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_1GB, -1, 0);
+        kind = PageKind::HUGETLB_1G;
+      }
+      if (ptr == MAP_FAILED) {
+        ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+        kind = PageKind::HUGETLB_2M;
+      }
+    }
+    if (ptr == MAP_FAILED) {
+      // No (or not enough) reserved huge pages, fall back to normal pages and ask for transparent huge pages when enabled.
+      ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (ptr == MAP_FAILED)
+        return nullptr;
+      kind = (huge_pages_enabled && madvise(ptr, len, MADV_HUGEPAGE) == 0 && transparentHugePagesAvailable()) ? PageKind::TRANSPARENT_HUGE
+                                                                                                               : PageKind::NORMAL;
+      if (!huge_pages_enabled)
+        madvise(ptr, len, MADV_NOHUGEPAGE);
+    }
+
+    bindToNumaNode(ptr, len, numa_node);
+
+    if (prefault) {
+      // Touch one byte per page, anonymous mappings are zero filled so this does not change the contents.
+      // Transparent huge pages are not guaranteed - the region need not be 2MB aligned and the kernel falls back to 4KB pages when it has no
+      // free huge page - so those regions are touched every 4KB too, which costs no extra fault wherever a huge page was mapped.
+      const auto touch_size = (kind == PageKind::HUGETLB_1G || kind == PageKind::HUGETLB_2M ? PAGE_SIZE_2M : PAGE_SIZE_4K);
+      for (size_t i = 0; i < bytes; i += touch_size)
+        static_cast<volatile char *>(ptr)[i] = 0;
+    }
+
+    huge_page_stats.regions_[static_cast<size_t>(kind)] += 1;
+    huge_page_stats.bytes_[static_cast<size_t>(kind)] += len;
+
+    return ptr;
+  }
+
+  /// Unmap a region returned by allocateHugePages() for the same number of bytes.
+  inline auto freeHugePages(void *ptr, size_t bytes) noexcept {
+    if (ptr)
+      munmap(ptr, hugePageMappingSize(bytes));
+  }
+
+  /// Whether the hugetlb pool is used and one entry per page kind with the number of regions and MB mapped with it, logged at startup.
+  inline auto hugePageReport() -> std::string {
+    std::string ret = "HugePageReport hugetlb:";
+    ret.append(hugetlb_enabled ? "enabled" : "disabled");
+    for (size_t i = 0; i < static_cast<size_t>(PageKind::MAX); ++i) {
+      ret.append(" ").append(pageKindToString(static_cast<PageKind>(i)));
+      ret.append(":[regions:").append(std::to_string(huge_page_stats.regions_[i]));
+      ret.append(" MB:").append(std::to_string(huge_page_stats.bytes_[i] / (1024 * 1024))).append("]");
+    }
+    return ret;
+  }
+
+  /// Base class of large objects that each get huge pages of their own, bound to allocation_numa_node. They are not pre-faulted since
+  /// they are mostly sparse lookup tables most of which is never touched, the memory pools and containers they own are.
+  class HugePageObject {
+  public:
+    static auto operator new(size_t size) -> void * {
+      auto ptr = allocateHugePages(size, false);
+      if (UNLIKELY(!ptr))
+        throw std::bad_alloc();
+      return ptr;
+    }
+
+    static auto operator delete(void *ptr, size_t size) noexcept -> void {
+      freeHugePages(ptr, size);
+    }
+  };
+
+  /// Standard library compatible allocator that backs large containers (memory pools, lock free queues, socket buffers) with huge pages.
+  /// Small allocations go to the regular heap. Regions are pre-faulted since these containers are sized once at startup.
+  template<typename T>
+  class HugePageAllocator {
+  public:
+    using value_type = T;
+
+    HugePageAllocator() noexcept = default;
+
+    template<typename U>
+    HugePageAllocator(const HugePageAllocator<U> &) noexcept {
+    }
+
+    auto allocate(size_t n) -> T * {
+      const auto bytes = n * sizeof(T);
+      if (bytes < HUGE_PAGE_MIN_ALLOC_SIZE)
+        return static_cast<T *>(::operator new(bytes));
+
+      auto ptr = allocateHugePages(bytes, true);
+      if (UNLIKELY(!ptr))
+        throw std::bad_alloc();
+      return static_cast<T *>(ptr);
+    }
+
+    auto deallocate(T *ptr, size_t n) noexcept {
+      const auto bytes = n * sizeof(T);
+      if (bytes < HUGE_PAGE_MIN_ALLOC_SIZE)
+        ::operator delete(ptr);
+      else
+        freeHugePages(ptr, bytes);
+    }
+
+    template<typename U>
+    auto operator==(const HugePageAllocator<U> &) const noexcept {
+      return true;
+    }
+  };
+}
@@ -0,0 +1,136 @@
+#include "io_uring.h"
+
+namespace Common {
+  IoUring::IoUring(unsigned entries, bool sqpoll, unsigned max_fixed_files) : sqpoll_(sqpoll) {
+    // A multishot receive posts a completion per read without a new submission, so the completion queue is sized well above the submission queue.
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL;
+    params.cq_entries = entries * 4;
+    if (sqpoll_) {
+      params.flags |= IORING_SETUP_SQPOLL;
+      params.sq_thread_idle = 1000; // milliseconds without submissions before the kernel polling thread goes to sleep.
+    }
+    ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    ASSERT(ring_fd_ >= 0, "io_uring_setup() failed. error:" + std::string(std::strerror(errno)));
+    ASSERT(params.features & IORING_FEAT_SINGLE_MMAP, "io_uring needs IORING_FEAT_SINGLE_MMAP.");
+    ASSERT(params.features & IORING_FEAT_NODROP, "io_uring needs IORING_FEAT_NODROP.");
+
+    ring_size_ = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned), params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    ring_ptr_ = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    ASSERT(ring_ptr_ != MAP_FAILED, "mmap() of io_uring rings failed. error:" + std::string(std::strerror(errno)));
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    auto sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    ASSERT(sqes != MAP_FAILED, "mmap() of io_uring submission queue entries failed. error:" + std::string(std::strerror(errno)));
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    const auto ring = static_cast<char *>(ring_ptr_);
+    sq_head_ = reinterpret_cast<unsigned *>(ring + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned *>(ring + params.sq_off.tail);
+    sq_flags_ = reinterpret_cast<unsigned *>(ring + params.sq_off.flags);
+    sq_mask_ = *reinterpret_cast<unsigned *>(ring + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sqe_tail_ = *sq_tail_;
+    cq_head_ = reinterpret_cast<unsigned *>(ring + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(ring + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned *>(ring + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(ring + params.cq_off.cqes);
+
+    // Submission queue entries are always used in ring order, so the indirection array is set up once as the identity.
+    const auto sq_array = reinterpret_cast<unsigned *>(ring + params.sq_off.array);
+    for (unsigned i = 0; i < sq_entries_; ++i)
+      sq_array[i] = i;
+
+    // Sparse fixed file table, the slots are filled in by setFixedFile().
+    const std::vector<int> fds(max_fixed_files, -1);
+    ASSERT(!syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_FILES, fds.data(), max_fixed_files),
+           "io_uring_register() IORING_REGISTER_FILES failed. error:" + std::string(std::strerror(errno)));
+  }
+
+  IoUring::~IoUring() {
+    // Closing the ring cancels every request still in flight.
+    munmap(sqes_, sqes_size_);
+    munmap(ring_ptr_, ring_size_);
+    close(ring_fd_);
+    ring_fd_ = -1;
+    if (buf_ring_)
+      munmap(buf_ring_, buf_ring_size_);
+  }
+
+  auto IoUring::enter(unsigned to_submit, unsigned flags) noexcept -> int {
+    ++num_enter_calls_;
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, to_submit, 0, flags, nullptr, 0));
+  }
+
+  /// Next submission queue entry, zeroed. Submits what is pending to make room if the submission queue is full.
+  auto IoUring::getSqe() noexcept -> io_uring_sqe * {
+    while (UNLIKELY(sqe_tail_ - std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire) >= sq_entries_))
+      submit();
+
+    auto sqe = &sqes_[sqe_tail_ & sq_mask_];
+    ++sqe_tail_;
+    std::memset(sqe, 0, sizeof(io_uring_sqe));
+    return sqe;
+  }
+
+  /// Hand the submission queue entries filled since the last call to the kernel. Makes no system call if there are none.
+  auto IoUring::submit() noexcept -> void {
+    const auto to_submit = sqe_tail_ - std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+    if (!to_submit)
+      return;
+    std::atomic_ref<unsigned>(*sq_tail_).store(sqe_tail_, std::memory_order_release);
+
+    if (sqpoll_) {
+      // The kernel polling thread picks the new tail up by itself unless it has gone to sleep.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (LIKELY(!(std::atomic_ref<unsigned>(*sq_flags_).load(std::memory_order_relaxed) & IORING_SQ_NEED_WAKEUP)))
+        return;
+      enter(0, IORING_ENTER_SQ_WAKEUP);
+      return;
+    }
+
+    enter(to_submit, 0);
+  }
+
+  /// Install fd in slot index of the fixed file table, submission queue entries then refer to it by index with IOSQE_FIXED_FILE.
+  auto IoUring::setFixedFile(unsigned index, int fd) noexcept -> bool {
+    io_uring_files_update update{index, 0, reinterpret_cast<uint64_t>(&fd)};
+    return syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_FILES_UPDATE, &update, 1) == 1;
+  }
+
+  /// Register num_buffers buffers of buffer_size bytes each as the provided buffer group buffer_group, num_buffers must be a power of 2.
+  auto IoUring::setupBufferRing(uint16_t buffer_group, unsigned num_buffers, unsigned buffer_size) -> void {
+    ASSERT(!buf_ring_, "IoUring supports a single provided buffer group.");
+    ASSERT(num_buffers && !(num_buffers & (num_buffers - 1)) && num_buffers <= 32768,
+           "Provided buffer ring size must be a power of 2 up to 32768:" + std::to_string(num_buffers));
+
+    buf_ring_size_ = num_buffers * sizeof(io_uring_buf);
+    auto ptr = mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    ASSERT(ptr != MAP_FAILED, "mmap() of provided buffer ring failed. error:" + std::string(std::strerror(errno)));
+    buf_ring_ = static_cast<io_uring_buf_ring *>(ptr);
+    buf_ring_mask_ = num_buffers - 1;
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+    reg.ring_entries = num_buffers;
+    reg.bgid = buffer_group;
+    ASSERT(!syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1),
+           "io_uring_register() IORING_REGISTER_PBUF_RING failed. error:" + std::string(std::strerror(errno)));
+
+    buffer_size_ = buffer_size;
+    buffers_.resize(static_cast<size_t>(num_buffers) * buffer_size_);
+    for (unsigned i = 0; i < num_buffers; ++i)
+      recycleBuffer(static_cast<uint16_t>(i));
+  }
+
+  /// Give a provided buffer back to the kernel once its contents have been consumed.
+  auto IoUring::recycleBuffer(uint16_t buffer_id) noexcept -> void {
+    // The ring is an array of io_uring_buf whose first entry overlays the tail. Not indexed through io_uring_buf_ring::bufs, in C++ its
+    // flexible array member declaration adds an empty struct in front of it and shifts it.
+    auto &buf = reinterpret_cast<io_uring_buf *>(buf_ring_)[buf_ring_tail_ & buf_ring_mask_];
+    buf.addr = reinterpret_cast<uint64_t>(bufferData(buffer_id));
+    buf.len = static_cast<uint32_t>(buffer_size_);
+    buf.bid = buffer_id;
+    ++buf_ring_tail_;
+    std::atomic_ref<uint16_t>(buf_ring_->tail).store(buf_ring_tail_, std::memory_order_release);
+  }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "macros.h"
+#include "huge_page_allocator.h"
+
+namespace Common {
+  /// Minimal io_uring built directly on the io_uring_setup(), io_uring_enter() and io_uring_register() system calls - liburing is not a dependency.
+  /// One submission and one completion queue shared with the kernel, a table of fixed files and one group of provided receive buffers.
+  /// Not thread safe, owned and used by a single thread.
+  class IoUring final {
+  public:
+    /// With sqpoll a kernel thread picks up the submissions, so submit() only makes a system call when that thread has gone idle.
+    IoUring(unsigned entries, bool sqpoll, unsigned max_fixed_files);
+
+    ~IoUring();
+
+    /// Next submission queue entry, zeroed. Submits what is pending to make room if the submission queue is full.
+    auto getSqe() noexcept -> io_uring_sqe *;
+
+    /// Hand the submission queue entries filled since the last call to the kernel. Makes no system call if there are none.
+    auto submit() noexcept -> void;
+
+    /// Call fn on every available completion queue entry, then release them to the kernel.
+    /// Makes no system call unless the completion queue overflowed.
+    template<typename F>
+    auto forEachCqe(F &&fn) noexcept -> size_t {
+      auto head = *cq_head_;
+      const auto tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+      for (; head != tail; ++head)
+        fn(cqes_[head & cq_mask_]);
+      const auto n = head - *cq_head_;
+      if (n)
+        std::atomic_ref<unsigned>(*cq_head_).store(head, std::memory_order_release);
+
+      if (UNLIKELY(std::atomic_ref<unsigned>(*sq_flags_).load(std::memory_order_relaxed) & IORING_SQ_CQ_OVERFLOW))
+        enter(0, IORING_ENTER_GETEVENTS);
+
+      return n;
+    }
+
+    /// Install fd in slot index of the fixed file table, submission queue entries then refer to it by index with IOSQE_FIXED_FILE.
+    /// An fd of -1 empties the slot.
+    auto setFixedFile(unsigned index, int fd) noexcept -> bool;
+
+    /// Register num_buffers buffers of buffer_size bytes each as the provided buffer group buffer_group, num_buffers must be a power of 2.
+    /// Receives submitted with IOSQE_BUFFER_SELECT pick a buffer from the group and report its id in the completion.
+    auto setupBufferRing(uint16_t buffer_group, unsigned num_buffers, unsigned buffer_size) -> void;
+
+    auto bufferData(uint16_t buffer_id) noexcept -> char * {
+      return buffers_.data() + static_cast<size_t>(buffer_id) * buffer_size_;
+    }
+
+    /// Give a provided buffer back to the kernel once its contents have been consumed.
+    auto recycleBuffer(uint16_t buffer_id) noexcept -> void;
+
+    /// Deleted default, copy & move constructors and assignment-operators.
+    IoUring() = delete;
+
+    IoUring(const IoUring &) = delete;
+
+    IoUring(const IoUring &&) = delete;
+
+    IoUring &operator=(const IoUring &) = delete;
+
+    IoUring &operator=(const IoUring &&) = delete;
+
+    /// Number of io_uring_enter() system calls made.
+    size_t num_enter_calls_ = 0;
+
+  private:
+    auto enter(unsigned to_submit, unsigned flags) noexcept -> int;
+
+    int ring_fd_ = -1;
+    const bool sqpoll_ = false;
+
+    /// The submission and completion queue rings share one mapping, the submission queue entries are a second one.
+    void *ring_ptr_ = nullptr;
+    size_t ring_size_ = 0;
+    io_uring_sqe *sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned *sq_head_ = nullptr;
+    unsigned *sq_tail_ = nullptr;
+    unsigned *sq_flags_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    /// Tail of the submission queue entries handed out by getSqe(), published to the kernel by submit().
+    unsigned sqe_tail_ = 0;
+
+    unsigned *cq_head_ = nullptr;
+    unsigned *cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe *cqes_ = nullptr;
+
+    /// Provided buffer ring and the buffers it hands out to receives.
+    io_uring_buf_ring *buf_ring_ = nullptr;
+    size_t buf_ring_size_ = 0;
+    unsigned buf_ring_mask_ = 0;
+    uint16_t buf_ring_tail_ = 0;
+    std::vector<char, OptCommon::HugePageAllocator<char>> buffers_;
+    size_t buffer_size_ = 0;
+  };
+}
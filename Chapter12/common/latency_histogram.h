@@ -0,0 +1,332 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "macros.h"
+#include "perf_utils.h"
+#include "tsc_clock.h"
+
+namespace Common {
+  /// Each power of two range of values is split into 2^LATENCY_HISTOGRAM_SUB_BUCKET_BITS linear buckets, i.e. about 3% precision.
+  constexpr size_t LATENCY_HISTOGRAM_SUB_BUCKET_BITS = 5;
+  constexpr size_t LATENCY_HISTOGRAM_SUB_BUCKETS = 1 << LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+
+  /// Values are rdtsc() ticks, anything at or above 2^LATENCY_HISTOGRAM_MAX_BITS ticks (tens of seconds) is counted in the last bucket.
+  constexpr size_t LATENCY_HISTOGRAM_MAX_BITS = 36;
+  constexpr size_t LATENCY_HISTOGRAM_NUM_BUCKETS = (LATENCY_HISTOGRAM_MAX_BITS - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1) * LATENCY_HISTOGRAM_SUB_BUCKETS;
+
+  /// Log-linear histogram of rdtsc() tick counts, written by a single thread and read by the dumper.
+  /// The counters are atomics only so that the dumper can read them concurrently, recording is a plain load, add and store.
+  class LatencyHistogram final {
+  public:
+    explicit LatencyHistogram(const char *tag) : tag_(tag) {
+    }
+
+    static constexpr auto bucketIndex(uint64_t value) noexcept -> size_t {
+      if (value < LATENCY_HISTOGRAM_SUB_BUCKETS)
+        return value;
+      if (UNLIKELY(value >> LATENCY_HISTOGRAM_MAX_BITS))
+        return LATENCY_HISTOGRAM_NUM_BUCKETS - 1;
+
+      const size_t exponent = 63 - __builtin_clzll(value);
+      const auto shift = exponent - LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+      return ((shift + 1) << LATENCY_HISTOGRAM_SUB_BUCKET_BITS) + ((value >> shift) & (LATENCY_HISTOGRAM_SUB_BUCKETS - 1));
+    }
+
+    /// Smallest value counted in the bucket.
+    static constexpr auto bucketLowerBound(size_t index) noexcept -> uint64_t {
+      if (index < LATENCY_HISTOGRAM_SUB_BUCKETS)
+        return index;
+
+      const auto shift = (index >> LATENCY_HISTOGRAM_SUB_BUCKET_BITS) - 1;
+      return (LATENCY_HISTOGRAM_SUB_BUCKETS + (index & (LATENCY_HISTOGRAM_SUB_BUCKETS - 1))) << shift;
+    }
+
+    auto record(uint64_t ticks) noexcept {
+      auto &count = counts_[bucketIndex(ticks)];
+      count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      if (UNLIKELY(ticks > max_.load(std::memory_order_relaxed)))
+        max_.store(ticks, std::memory_order_relaxed);
+    }
+
+    auto tag() const noexcept {
+      return tag_;
+    }
+
+    auto count(size_t index) const noexcept {
+      return counts_[index].load(std::memory_order_relaxed);
+    }
+
+    auto max() const noexcept {
+      return max_.load(std::memory_order_relaxed);
+    }
+
+    /// Deleted default, copy & move constructors and assignment-operators.
+    LatencyHistogram() = delete;
+
+    LatencyHistogram(const LatencyHistogram &) = delete;
+
+    LatencyHistogram(const LatencyHistogram &&) = delete;
+
+    LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+    LatencyHistogram &operator=(const LatencyHistogram &&) = delete;
+
+  private:
+    const char *tag_;
+    std::atomic<uint64_t> counts_[LATENCY_HISTOGRAM_NUM_BUCKETS] = {};
+    std::atomic<uint64_t> max_ = {0};
+  };
+
+  /// rdtsc() value and tag of the previous TTT_MEASURE on this thread, nullptr tag before the first one.
+  inline thread_local uint64_t last_ttt_rdtsc = 0;
+  inline thread_local const char *last_ttt_tag = nullptr;
+
+  /// Hops between TTT_MEASURE call sites on different threads or in different processes, the ones perf_analysis.ipynb lists in HOPS.
+  /// The hops within a thread are recorded from last_ttt_tag, these are paired through the shared TTTStamps instead.
+  constexpr std::pair<const char *, const char *> TTT_CROSS_THREAD_HOPS[] = {
+      {"T2_OrderServer_LFQueue_write", "T3_MatchingEngine_LFQueue_read"},
+      {"T4_MatchingEngine_LFQueue_write", "T5_MarketDataPublisher_LFQueue_read"},
+      {"T4t_MatchingEngine_LFQueue_write", "T5t_OrderServer_LFQueue_read"},
+      {"T6_MarketDataPublisher_UDP_write", "T7_MarketDataConsumer_UDP_read"},
+      {"T6t_OrderServer_TCP_write", "T7t_OrderGateway_TCP_read"},
+      {"T8_MarketDataConsumer_LFQueue_write", "T9_TradeEngine_LFQueue_read"},
+      {"T8t_OrderGateway_LFQueue_write", "T9t_TradeEngine_LFQueue_read"},
+      {"T10_TradeEngine_LFQueue_write", "T11_OrderGateway_LFQueue_read"},
+      {"T12_OrderGateway_TCP_write", "T1_OrderServer_TCP_read"},
+  };
+
+  constexpr size_t TTT_STAMPS_MAX_TAGS = 64;
+  constexpr size_t TTT_STAMP_TAG_SIZE = 56;
+
+  /// File shared by the exchange and trading processes of the host, the invariant TSC makes their rdtsc() values comparable.
+  constexpr auto TTT_STAMPS_FILE_NAME = "/dev/shm/low_latency_ttt_stamps";
+
+  /// rdtsc() value of the latest TTT_MEASURE of a tag in any process, on its own cache line.
+  struct alignas(64) TTTStamp {
+    std::atomic<uint64_t> rdtsc_ = {0};
+    char tag_[TTT_STAMP_TAG_SIZE] = {};
+  };
+
+  /// Slots are claimed by tag under flock() on the file, once per call site per thread, and never released. A slot with an empty tag is free.
+  struct TTTStamps {
+    TTTStamp stamps_[TTT_STAMPS_MAX_TAGS];
+  };
+
+  /// rdtsc() when the process started, stamps older than that were left in the file by an earlier run and are never paired.
+  inline const uint64_t ttt_process_start_rdtsc = rdtsc();
+
+  /// All the histograms of the process, one per measurement tag per thread. Histograms are never freed so the dumper can still read those of threads that exited.
+  struct LatencyHistogramRegistry {
+    std::mutex mutex_;
+    std::vector<std::pair<std::thread::id, LatencyHistogram *>> histograms_;
+    std::string at_exit_file_name_;
+  };
+
+  /// Never destroyed, so that histograms can still be recorded and dumped from atexit handlers.
+  inline auto latencyHistogramRegistry() noexcept -> LatencyHistogramRegistry & {
+    static auto registry = new LatencyHistogramRegistry();
+    return *registry;
+  }
+
+  /// Map TTT_STAMPS_FILE_NAME, or fall back to memory of this process only if it cannot be, the cross-process hops are then not recorded.
+  inline auto tttStampsFd() noexcept -> int & {
+    static int fd = -1;
+    return fd;
+  }
+
+  inline auto tttStamps() noexcept -> TTTStamps & {
+    static auto stamps = []() {
+      auto &fd = tttStampsFd();
+      fd = open(TTT_STAMPS_FILE_NAME, O_RDWR | O_CREAT, 0666);
+      if (fd >= 0 && ftruncate(fd, sizeof(TTTStamps)) == 0) {
+        auto ptr = mmap(nullptr, sizeof(TTTStamps), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (ptr != MAP_FAILED)
+          return static_cast<TTTStamps *>(ptr);
+      }
+      if (fd >= 0)
+        close(fd);
+      fd = -1;
+      return new TTTStamps();
+    }();
+    return *stamps;
+  }
+
+  /// Stamp of the provided tag, claiming a free slot for it on first use. Called once per call site per thread, the pointer is kept.
+  inline auto tttStamp(const char *tag) noexcept -> std::atomic<uint64_t> * {
+    auto &stamps = tttStamps();
+    std::lock_guard<std::mutex> lock(latencyHistogramRegistry().mutex_);
+    const auto fd = tttStampsFd();
+    if (fd >= 0)
+      flock(fd, LOCK_EX);
+
+    TTTStamp *found = nullptr;
+    for (auto &stamp: stamps.stamps_) {
+      if (!strncmp(stamp.tag_, tag, TTT_STAMP_TAG_SIZE - 1)) {
+        found = &stamp;
+        break;
+      }
+      if (!stamp.tag_[0]) {
+        strncpy(stamp.tag_, tag, TTT_STAMP_TAG_SIZE - 1);
+        found = &stamp;
+        break;
+      }
+    }
+
+    if (fd >= 0)
+      flock(fd, LOCK_UN);
+    ASSERT(found, "Too many TTT_MEASURE tags, more than:" + std::to_string(TTT_STAMPS_MAX_TAGS));
+    return &found->rdtsc_;
+  }
+
+  /// Histogram of the provided tag for the calling thread, created on first use.
+  /// Called once per call site per thread, the measurement macros keep the returned pointer in a thread_local.
+  inline auto latencyHistogram(const std::string &tag) noexcept -> LatencyHistogram * {
+    auto &registry = latencyHistogramRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex_);
+    for (auto &[thread_id, histogram]: registry.histograms_) {
+      if (thread_id == std::this_thread::get_id() && tag == histogram->tag())
+        return histogram;
+    }
+    registry.histograms_.emplace_back(std::this_thread::get_id(), new LatencyHistogram(strdup(tag.c_str())));
+    return registry.histograms_.back().second;
+  }
+
+  /// The histograms of one TTT_MEASURE call site on one thread, keyed by the tag of the TTT_MEASURE before it on the thread - "PREVIOUS->TAG".
+  /// A hop reached from different places, e.g. the first hop of a loop after the last hop of the previous iteration and so after the idle gap
+  /// between two messages, is then not mixed up with the hop it is usually measuring.
+  /// The hops of TTT_CROSS_THREAD_HOPS ending at this call site are recorded in the same "PREVIOUS->TAG" histograms, from the latest stamp of
+  /// the previous tag if it was stamped since this call site's last measurement, like perf_analysis.ipynb pairs the logged timestamps. Of a
+  /// burst of messages queued up between two threads, only the first one read is measured.
+  class TTTHistograms final {
+  public:
+    explicit TTTHistograms(const char *tag)
+        : tag_(tag), other_histogram_(latencyHistogram(std::string("OTHER->") + tag)), stamp_(tttStamp(tag)) {
+      for (const auto &[previous_tag, next_tag]: TTT_CROSS_THREAD_HOPS) {
+        if (!strcmp(next_tag, tag))
+          cross_thread_hops_[num_cross_thread_hops_++] = {tttStamp(previous_tag), latencyHistogram(std::string(previous_tag) + "->" + tag)};
+      }
+    }
+
+    /// Record the hops ending at this call site at time now, then stamp it for the call sites after it.
+    auto record(uint64_t now) noexcept {
+      if (LIKELY(last_ttt_tag))
+        get(last_ttt_tag)->record(now - last_ttt_rdtsc);
+      last_ttt_rdtsc = now;
+      last_ttt_tag = tag_;
+
+      for (size_t i = 0; i < num_cross_thread_hops_; ++i) {
+        const auto previous = cross_thread_hops_[i].first->load(std::memory_order_relaxed);
+        if (previous > last_rdtsc_ && previous <= now)
+          cross_thread_hops_[i].second->record(now - previous);
+      }
+      last_rdtsc_ = now;
+      stamp_->store(now, std::memory_order_relaxed);
+    }
+
+    /// Histogram of the hop from previous_tag to this call site. Tags are string literals, so the few previous tags a call site sees are
+    /// found by comparing pointers, the registry is only searched the first time each of them is seen. Previous tags beyond the ones the
+    /// cache holds are all counted in the "OTHER->TAG" histogram, so the registry is never searched again once the cache is full.
+    auto get(const char *previous_tag) noexcept -> LatencyHistogram * {
+      for (size_t i = 0; i < num_histograms_; ++i) {
+        if (histograms_[i].first == previous_tag)
+          return histograms_[i].second;
+      }
+
+      if (UNLIKELY(num_histograms_ == histograms_.size()))
+        return other_histogram_;
+      histograms_[num_histograms_] = {previous_tag, latencyHistogram(std::string(previous_tag) + "->" + tag_)};
+      return histograms_[num_histograms_++].second;
+    }
+
+    /// Deleted default, copy & move constructors and assignment-operators.
+    TTTHistograms() = delete;
+
+    TTTHistograms(const TTTHistograms &) = delete;
+
+    TTTHistograms(const TTTHistograms &&) = delete;
+
+    TTTHistograms &operator=(const TTTHistograms &) = delete;
+
+    TTTHistograms &operator=(const TTTHistograms &&) = delete;
+
+  private:
+    const char *tag_;
+    std::array<std::pair<const char *, LatencyHistogram *>, 16> histograms_ = {};
+    size_t num_histograms_ = 0;
+    LatencyHistogram *other_histogram_;
+
+    std::atomic<uint64_t> *stamp_;
+    uint64_t last_rdtsc_ = ttt_process_start_rdtsc;
+    std::array<std::pair<std::atomic<uint64_t> *, LatencyHistogram *>, std::size(TTT_CROSS_THREAD_HOPS)> cross_thread_hops_ = {};
+    size_t num_cross_thread_hops_ = 0;
+  };
+
+  /// Write count, p50, p90, p99, p99.9 and max in nanoseconds per tag, merging the histograms of the same tag across threads.
+  /// Percentiles are reported as the upper bound of the bucket they fall in.
+  inline auto dumpLatencyHistograms(std::ostream &out) noexcept {
+    std::map<std::string, std::pair<std::vector<uint64_t>, uint64_t>> merged;
+    {
+      auto &registry = latencyHistogramRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex_);
+      for (const auto &[thread_id, histogram]: registry.histograms_) {
+        auto &[counts, max] = merged[histogram->tag()];
+        counts.resize(LATENCY_HISTOGRAM_NUM_BUCKETS, 0);
+        for (size_t i = 0; i < LATENCY_HISTOGRAM_NUM_BUCKETS; ++i)
+          counts[i] += histogram->count(i);
+        max = std::max(max, histogram->max());
+      }
+    }
+
+    for (const auto &[tag, histogram]: merged) {
+      const auto &[counts, max] = histogram;
+      uint64_t total = 0;
+      for (auto count: counts)
+        total += count;
+      if (!total)
+        continue;
+
+      out << tag << " count:" << total;
+      for (const auto &[name, quantile]: {std::pair{"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"p99.9", 0.999}}) {
+        const auto rank = static_cast<uint64_t>(quantile * static_cast<double>(total));
+        uint64_t cumulative = 0;
+        size_t index = 0;
+        for (; index < LATENCY_HISTOGRAM_NUM_BUCKETS - 1; ++index) {
+          cumulative += counts[index];
+          if (cumulative > rank)
+            break;
+        }
+        const auto upper_bound = std::min(LatencyHistogram::bucketLowerBound(index + 1) - 1, max);
+        out << " " << name << ":" << tsc_clock.ticksToNanos(upper_bound);
+      }
+      out << " max:" << tsc_clock.ticksToNanos(max) << " (nanoseconds)" << std::endl;
+    }
+  }
+
+  /// Dump the histograms to the provided file when the process exits, e.g. through exit() in the signal handlers of the main binaries.
+  inline auto dumpLatencyHistogramsAtExit(const std::string &file_name) noexcept {
+    auto &registry = latencyHistogramRegistry();
+    {
+      std::lock_guard<std::mutex> lock(registry.mutex_);
+      registry.at_exit_file_name_ = file_name;
+    }
+    std::atexit([]() {
+      std::ofstream file(latencyHistogramRegistry().at_exit_file_name_);
+      dumpLatencyHistograms(file);
+    });
+  }
+}
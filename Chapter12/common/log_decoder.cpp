@@ -0,0 +1,170 @@
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+#include "binary_logging.h"
+
+using namespace OptCommon;
+
+/// Sequential reader over the contents of a binary log file.
+struct Reader {
+  const std::vector<char> &data_;
+  size_t index_ = 0;
+
+  auto done() const noexcept {
+    return index_ >= data_.size();
+  }
+
+  template<typename T>
+  auto read() {
+    ASSERT(index_ + sizeof(T) <= data_.size(), "Truncated binary log at offset:" + std::to_string(index_));
+    T value;
+    memcpy(&value, data_.data() + index_, sizeof(T));
+    index_ += sizeof(T);
+    return value;
+  }
+
+  auto readString(size_t length) {
+    ASSERT(index_ + length <= data_.size(), "Truncated binary log at offset:" + std::to_string(index_));
+    std::string value(data_.data() + index_, length);
+    index_ += length;
+    return value;
+  }
+};
+
+/// Render the next argument of a record to the output stream, returns false if there are no more arguments.
+/// A Common::LogTimestamp argument is rendered as the time of day of the record.
+auto renderValue(Reader *args, const char *record_time, std::ostream &out) {
+  if (args->done())
+    return false;
+
+  const auto type = args->read<char>();
+  if (type == BINARY_LOG_TIMESTAMP_ARG) {
+    out << record_time;
+    return true;
+  }
+
+  switch (static_cast<LogType>(type)) {
+    case LogType::CHAR:
+      out << args->read<char>();
+      break;
+    case LogType::INTEGER:
+      out << args->read<int>();
+      break;
+    case LogType::LONG_INTEGER:
+      out << args->read<long>();
+      break;
+    case LogType::LONG_LONG_INTEGER:
+      out << args->read<long long>();
+      break;
+    case LogType::UNSIGNED_INTEGER:
+      out << args->read<unsigned>();
+      break;
+    case LogType::UNSIGNED_LONG_INTEGER:
+      out << args->read<unsigned long>();
+      break;
+    case LogType::UNSIGNED_LONG_LONG_INTEGER:
+      out << args->read<unsigned long long>();
+      break;
+    case LogType::FLOAT:
+      out << args->read<float>();
+      break;
+    case LogType::DOUBLE:
+      out << args->read<double>();
+      break;
+    case LogType::STRING:
+      out << args->readString(args->read<uint16_t>());
+      break;
+  }
+
+  return true;
+}
+
+/// Decode a file written by OptCommon::BinaryLogger and write it out as text, one record per log() call prefixed with its time of day.
+/// Records are rendered exactly like Logger::log() would have, substituting % with the arguments in order and %% with %.
+int main(int argc, char **argv) {
+  if (argc != 2)
+    FATAL("USAGE log_decoder BINARY_LOG_FILE");
+
+  std::ifstream file(argv[1], std::ios::binary);
+  ASSERT(file.is_open(), "Could not open log file:" + std::string(argv[1]));
+  const std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  // First pass: rdtsc to wall clock conversion from the first and last sync entries.
+  std::pair<uint64_t, int64_t> first_sync = {0, 0}, last_sync = {0, 0};
+  for (Reader reader{data}; !reader.done();) {
+    switch (static_cast<BinaryLogTag>(reader.read<char>())) {
+      case BinaryLogTag::FORMAT:
+        reader.read<uint64_t>();
+        reader.readString(reader.read<uint32_t>());
+        break;
+      case BinaryLogTag::SYNC: {
+        const auto rdtsc = reader.read<uint64_t>();
+        const auto nanos = reader.read<int64_t>();
+        last_sync = {rdtsc, nanos};
+        if (!first_sync.first)
+          first_sync = last_sync;
+      }
+        break;
+      case BinaryLogTag::RECORD:
+        reader.read<uint64_t>();
+        reader.read<uint64_t>();
+        reader.readString(reader.read<uint16_t>());
+        break;
+      default:
+        FATAL("Unknown entry in binary log at offset:" + std::to_string(reader.index_ - 1));
+    }
+  }
+  const auto nanos_per_tick = (last_sync.first > first_sync.first ?
+                               static_cast<double>(last_sync.second - first_sync.second) / static_cast<double>(last_sync.first - first_sync.first) : 0);
+
+  // Second pass: render the records.
+  std::unordered_map<uint64_t, std::string> formats;
+  std::string time_str;
+  for (Reader reader{data}; !reader.done();) {
+    switch (static_cast<BinaryLogTag>(reader.read<char>())) {
+      case BinaryLogTag::FORMAT: {
+        const auto id = reader.read<uint64_t>();
+        formats[id] = reader.readString(reader.read<uint32_t>());
+      }
+        break;
+      case BinaryLogTag::SYNC:
+        reader.read<uint64_t>();
+        reader.read<int64_t>();
+        break;
+      case BinaryLogTag::RECORD: {
+        const auto id = reader.read<uint64_t>();
+        const auto rdtsc = reader.read<uint64_t>();
+        const auto args_data = reader.readString(reader.read<uint16_t>());
+        const std::vector<char> args_bytes(args_data.begin(), args_data.end());
+        Reader args{args_bytes};
+
+        const auto nanos = first_sync.second + static_cast<int64_t>(static_cast<double>(static_cast<int64_t>(rdtsc - first_sync.first)) * nanos_per_tick);
+        const auto secs = static_cast<time_t>(nanos / Common::NANOS_TO_SECS);
+        char nanos_str[24];
+        sprintf(nanos_str, "%.8s.%09ld", ctime(&secs) + 11, nanos % Common::NANOS_TO_SECS);
+        std::cout << nanos_str << ' ';
+
+        ASSERT(formats.count(id), "Record with unknown format id:" + std::to_string(id));
+        for (auto s = formats[id].c_str(); *s; ++s) {
+          if (*s == '%') {
+            if (*(s + 1) == '%') {
+              ++s;
+            } else {
+              if (!renderValue(&args, nanos_str, std::cout))
+                std::cout << "<missing>";
+              continue;
+            }
+          }
+          std::cout << *s;
+        }
+      }
+        break;
+      default:
+        FATAL("Unknown entry in binary log at offset:" + std::to_string(reader.index_ - 1));
+    }
+  }
+
+  return 0;
+}
@@ -1,17 +1,42 @@
 #pragma once
 
 #include <string>
-#include <fstream>
 #include <cstdio>
+#include <array>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <type_traits>
+#include <vector>
+#include <mutex>
+#include <span>
+
+#include <fcntl.h>
 
 #include "macros.h"
-#include "lf_queue.h"
+#include "opt_lf_queue.h"
+#include "huge_page_allocator.h"
 #include "thread_utils.h"
 #include "time_utils.h"
 
 namespace Common {
   /// Maximum size of the lock free queue of data to be logged.
-  constexpr size_t LOG_QUEUE_SIZE = 8 * 1024 * 1024;
+  /// Literals and strings are packed LOG_ELEMENT_MAX_CHARS per element and a single drain thread services every queue, so this is well below one element per character.
+  /// A log() call that does not fit in the queue is dropped and counted rather than waited for.
+  constexpr size_t LOG_QUEUE_SIZE = 1024 * 1024;
+
+  /// Size of the page aligned buffer the background thread formats log entries into before handing them to the kernel with a single write().
+  constexpr size_t LOG_STAGING_BUFFER_SIZE = 4 * 1024 * 1024;
+
+  /// Maximum number of characters a single LogElement can format to, the staging buffer is written out when less than this is left.
+  constexpr size_t LOG_ELEMENT_MAX_TEXT_SIZE = 32;
+
+  /// Maximum number of LogElements formatted per batch read from the lock free queue.
+  constexpr size_t LOG_MAX_QUEUE_BATCH = 4096;
+
+  /// Bounds of the adaptive sleep of the drain thread when all the queues are empty, it doubles on every empty pass up to the maximum.
+  constexpr int64_t LOG_MIN_SLEEP_MICROS = 50;
+  constexpr int64_t LOG_MAX_SLEEP_MICROS = 10 * 1000;
 
   /// Type of LogElement message.
   enum class LogType : int8_t {
@@ -23,9 +48,13 @@ namespace Common {
     UNSIGNED_LONG_INTEGER = 5,
     UNSIGNED_LONG_LONG_INTEGER = 6,
     FLOAT = 7,
-    DOUBLE = 8
+    DOUBLE = 8,
+    CHARS = 9
   };
 
+  /// Number of format string characters packed into a single CHARS LogElement.
+  constexpr size_t LOG_ELEMENT_MAX_CHARS = 8;
+
   /// Represents a single and primitive log entry.
   struct LogElement {
     LogType type_ = LogType::CHAR;
@@ -39,185 +68,474 @@ namespace Common {
       unsigned long long ull;
       float f;
       double d;
+      char s[LOG_ELEMENT_MAX_CHARS]; // not null terminated if all characters are used.
     } u_;
   };
 
-  class Logger final {
-  public:
-    /// Consumes from the lock free queue of log entries and writes to the output log file.
-    auto flushQueue() noexcept {
-      while (running_) {
-
-        for (auto next = queue_.getNextToRead(); queue_.size() && next; next = queue_.getNextToRead()) {
-          switch (next->type_) {
-            case LogType::CHAR:
-              file_ << next->u_.c;
-              break;
-            case LogType::INTEGER:
-              file_ << next->u_.i;
-              break;
-            case LogType::LONG_INTEGER:
-              file_ << next->u_.l;
-              break;
-            case LogType::LONG_LONG_INTEGER:
-              file_ << next->u_.ll;
-              break;
-            case LogType::UNSIGNED_INTEGER:
-              file_ << next->u_.u;
-              break;
-            case LogType::UNSIGNED_LONG_INTEGER:
-              file_ << next->u_.ul;
-              break;
-            case LogType::UNSIGNED_LONG_LONG_INTEGER:
-              file_ << next->u_.ull;
-              break;
-            case LogType::FLOAT:
-              file_ << next->u_.f;
-              break;
-            case LogType::DOUBLE:
-              file_ << next->u_.d;
-              break;
+  /// Not constexpr, calling it while evaluating a LogFormat constructor is what makes a mismatched log() call fail to compile.
+  inline auto logFormatArgumentCountMismatch() noexcept {
+  }
+
+  /// Number of CHARS LogElements a string of the specified length is packed into.
+  constexpr auto numCharsElements(size_t length) noexcept -> size_t {
+    return (length + LOG_ELEMENT_MAX_CHARS - 1) / LOG_ELEMENT_MAX_CHARS;
+  }
+
+  /// Format string of a log() call parsed at compile time into the literal segments around each % argument slot.
+  /// The constructor is consteval and implicit, so log("...", args...) call sites compile unchanged,
+  /// but fail to compile if the number of % placeholders does not match the number of arguments.
+  template<typename... A>
+  struct LogFormat {
+    /// Literal characters between two argument slots, segments with a %% escape are unescaped while they are copied.
+    struct Segment {
+      uint16_t offset_ = 0;
+      uint16_t length_ = 0;
+      bool has_escapes_ = false;
+    };
+
+    template<size_t N>
+    consteval LogFormat(const char (&format)[N]) : format_(format) {
+      size_t slot = 0, start = 0, num_chars = 0;
+      bool has_escapes = false;
+      for (size_t i = 0; i < N - 1; ++i) {
+        if (format[i] == '%') {
+          if (format[i + 1] == '%') { // to allow %% -> % escape character.
+            has_escapes = true;
+            ++i;
+            ++num_chars;
+            continue;
           }
-          queue_.updateReadIndex();
+          if (slot == sizeof...(A))
+            logFormatArgumentCountMismatch(); // more % placeholders than arguments.
+          segments_[slot++] = {static_cast<uint16_t>(start), static_cast<uint16_t>(i - start), has_escapes};
+          num_literal_elements_ += numCharsElements(num_chars);
+          start = i + 1;
+          num_chars = 0;
+          has_escapes = false;
+          continue;
         }
-        file_.flush();
+        ++num_chars;
+      }
+      if (slot != sizeof...(A))
+        logFormatArgumentCountMismatch(); // more arguments than % placeholders.
+      segments_[slot] = {static_cast<uint16_t>(start), static_cast<uint16_t>(N - 1 - start), has_escapes};
+      num_literal_elements_ += numCharsElements(num_chars);
+    }
 
-        using namespace std::literals::chrono_literals;
-        std::this_thread::sleep_for(10ms);
+    const char *format_;
+    std::array<Segment, sizeof...(A) + 1> segments_;
+
+    /// Number of LogElements the literal segments are packed into, so a log() call knows how many to reserve without looking at them.
+    size_t num_literal_elements_ = 0;
+  };
+
+  /// Slots of the lock free queue reserved for the LogElements of a single TextLogger::log() call.
+  /// They run from next_ to end_ and continue in wrapped_ if they wrap around the end of the queue.
+  struct LogSlots {
+    LogElement *next_ = nullptr;
+    LogElement *end_ = nullptr;
+    std::span<LogElement> wrapped_;
+
+    auto next() noexcept -> LogElement * {
+      if (UNLIKELY(next_ == end_)) {
+        next_ = wrapped_.data();
+        end_ = next_ + wrapped_.size();
+      }
+      return next_++;
+    }
+  };
+
+  /// Counters maintained by the background thread of a TextLogger.
+  struct LoggerStats {
+    /// Bytes handed to the kernel.
+    std::atomic<size_t> bytes_written_ = {0};
+
+    /// Largest number of LogElements found waiting in the queue at the start of a pass of the background thread.
+    std::atomic<size_t> peak_queue_depth_ = {0};
+
+    /// Bytes of formatted log entries lost because writing to the file failed.
+    std::atomic<size_t> dropped_bytes_ = {0};
+
+    /// log() calls dropped because the queue did not have room for them, maintained by the thread logging and not by the background thread.
+    alignas(OptCommon::CACHE_LINE_SIZE) std::atomic<size_t> dropped_entries_ = {0};
+
+    auto toString() const {
+      return "LoggerStats[bytes_written:" + std::to_string(bytes_written_) + " peak_queue_depth:" + std::to_string(peak_queue_depth_) +
+             " dropped_bytes:" + std::to_string(dropped_bytes_) + " dropped_entries:" + std::to_string(dropped_entries_) + "]";
+    }
+  };
+
+  /// Loggers serviced by the LogDrain thread, TextLogger and OptCommon::BinaryLogger.
+  class DrainableLogger {
+  public:
+    /// Consume the logger's queue and write what was in it to its file. Called by the LogDrain thread, returns whether there was anything in the queue.
+    virtual auto drainQueue() noexcept -> bool = 0;
+
+  protected:
+    ~DrainableLogger() = default;
+  };
+
+  /// Single background thread per process that formats and writes the log entries of every TextLogger and BinaryLogger to their respective files.
+  /// It is also the housekeeping thread that periodically re-anchors the TSC clock, so that does not need a thread of its own.
+  /// Each Logger keeps its own lock free queue (mmap'd through the huge page allocator) written to by the thread that owns it,
+  /// so there is one consumer per queue and the hot threads do not compete with one flush thread per component.
+  /// The queues are per Logger, not per producer thread: a Logger must only be written to by one thread at a time. That holds for every component
+  /// here, each one logs from its own thread or, like MatchingEngine::replay(), before its thread is started. A component logging from more than
+  /// one thread at once needs a Logger per thread.
+  class LogDrain final {
+  public:
+    /// Core to pin the drain thread to, e.g. a housekeeping core, -1 leaves it unpinned.
+    /// Takes effect the next time the thread is started, i.e. call it before constructing the first Logger.
+    auto setCore(int core_id) noexcept {
+      core_id_ = core_id;
+    }
+
+    /// Start servicing a logger, the drain thread is started with the first one.
+    auto add(DrainableLogger *logger) noexcept -> void;
+
+    /// Stop servicing a logger, returns once the drain thread no longer accesses it. The drain thread is stopped with the last one.
+    auto remove(DrainableLogger *logger) noexcept -> void;
+
+  private:
+    /// Drains all the queues, sleeping with an exponential backoff while all of them are empty and not at all otherwise.
+    auto run() noexcept -> void;
+
+    /// Serializes add() and remove(), including starting and joining the drain thread.
+    std::mutex start_stop_mutex_;
+
+    /// Protects loggers_, held by the drain thread for one pass over all the queues.
+    std::mutex loggers_mutex_;
+    std::vector<DrainableLogger *> loggers_;
+
+    int core_id_ = -1;
+    std::atomic<bool> running_ = {false};
+    std::thread *drain_thread_ = nullptr;
+  };
+
+  /// Process wide LogDrain, never destroyed so that loggers which are not deleted before exit() are not drained by a destroyed object.
+  inline auto logDrain() noexcept -> LogDrain & {
+    static auto log_drain = new LogDrain();
+    return *log_drain;
+  }
+
+  /// Formats the log entries to text on the LogDrain thread. This is the Logger of the components unless they are built with BINARY_LOGGING.
+  class TextLogger final : public DrainableLogger {
+  public:
+    /// Consumes from the lock free queue of log entries, formats them into the staging buffer and writes it to the output log file.
+    /// Called by the LogDrain thread, returns whether there were any entries in the queue.
+    auto drainQueue() noexcept -> bool override {
+      const auto queue_depth = queue_.size();
+      if (queue_depth > stats_.peak_queue_depth_)
+        stats_.peak_queue_depth_ = queue_depth;
+
+      for (auto batch = queue_.getNextBatchToRead(LOG_MAX_QUEUE_BATCH); !batch.empty(); batch = queue_.getNextBatchToRead(LOG_MAX_QUEUE_BATCH)) {
+        for (const auto &log_element: batch) {
+          if (UNLIKELY(LOG_STAGING_BUFFER_SIZE - staging_size_ < LOG_ELEMENT_MAX_TEXT_SIZE))
+            writeStagingBuffer(false);
+          staging_size_ += formatElement(log_element, staging_buffer_ + staging_size_);
+        }
+        queue_.updateReadIndex(batch.size());
       }
+      writeStagingBuffer(false);
+
+      return (queue_depth != 0);
     }
 
-    explicit Logger(const std::string &file_name)
-        : file_name_(file_name), queue_(LOG_QUEUE_SIZE) {
-      file_.open(file_name);
-      ASSERT(file_.is_open(), "Could not open log file:" + file_name);
-      logger_thread_ = createAndStartThread(-1, "Common/Logger " + file_name_, [this]() { flushQueue(); });
-      ASSERT(logger_thread_ != nullptr, "Failed to start Logger thread.");
+    /// With direct_io the file is opened with O_DIRECT and only whole pages are written until the TextLogger is closed,
+    /// bypassing the page cache at the cost of holding back up to a page of log output.
+    explicit TextLogger(const std::string &file_name, bool direct_io = false)
+        : file_name_(file_name), direct_io_(direct_io), queue_(LOG_QUEUE_SIZE) {
+      fd_ = open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | (direct_io ? O_DIRECT : 0), 0644);
+      ASSERT(fd_ >= 0, "Could not open log file:" + file_name + " error:" + std::string(strerror(errno)));
+      staging_buffer_ = static_cast<char *>(OptCommon::allocateHugePages(LOG_STAGING_BUFFER_SIZE, true));
+      ASSERT(staging_buffer_ != nullptr, "Could not allocate staging buffer for log file:" + file_name);
+      logDrain().add(this);
     }
 
-    ~Logger() {
+    ~TextLogger() {
       std::string time_str;
-      std::cerr << Common::getCurrentTimeStr(&time_str) << " Flushing and closing Logger for " << file_name_ << std::endl;
+      std::cerr << Common::getCurrentTimeStr(&time_str) << " Flushing and closing TextLogger for " << file_name_ << std::endl;
 
       while (queue_.size()) {
         using namespace std::literals::chrono_literals;
         std::this_thread::sleep_for(1s);
       }
-      running_ = false;
-      logger_thread_->join();
+      logDrain().remove(this);
 
-      file_.close();
-      std::cerr << Common::getCurrentTimeStr(&time_str) << " Logger for " << file_name_ << " exiting." << std::endl;
+      writeStagingBuffer(true);
+      close(fd_);
+      OptCommon::freeHugePages(staging_buffer_, LOG_STAGING_BUFFER_SIZE);
+      std::cerr << Common::getCurrentTimeStr(&time_str) << " TextLogger for " << file_name_ << " exiting. " << stats_.toString() << std::endl;
     }
 
-    /// Overloaded methods to write different log entry types to the lock free queue.
-    /// Creates a LogElement of the correct type and writes it to the lock free queue.
-    auto pushValue(const LogElement &log_element) noexcept {
-      *(queue_.getNextToWriteTo()) = log_element;
-      queue_.updateWriteIndex();
+    auto stats() const noexcept -> const LoggerStats & {
+      return stats_;
     }
 
-    auto pushValue(const char value) noexcept {
-      pushValue(LogElement{LogType::CHAR, {.c = value}});
+    /// Number of LogElements pushValue() writes for a value, one for every type except strings.
+    template<typename T>
+    static auto numElements(const T &) noexcept -> size_t {
+      return 1;
     }
 
-    auto pushValue(const int value) noexcept {
-      pushValue(LogElement{LogType::INTEGER, {.i = value}});
+    static auto numElements(const char *value) noexcept -> size_t {
+      return numCharsElements(strlen(value));
     }
 
-    auto pushValue(const long value) noexcept {
-      pushValue(LogElement{LogType::LONG_INTEGER, {.l = value}});
+    static auto numElements(const std::string &value) noexcept -> size_t {
+      return numCharsElements(value.size());
     }
 
-    auto pushValue(const long long value) noexcept {
-      pushValue(LogElement{LogType::LONG_LONG_INTEGER, {.ll = value}});
+    /// Overloaded methods to write different log entry types to the slots reserved in the lock free queue.
+    /// Creates a LogElement of the correct type in the next reserved slot.
+    static auto pushValue(LogSlots &slots, const char value) noexcept {
+      *slots.next() = {LogType::CHAR, {.c = value}};
     }
 
-    auto pushValue(const unsigned value) noexcept {
-      pushValue(LogElement{LogType::UNSIGNED_INTEGER, {.u = value}});
+    static auto pushValue(LogSlots &slots, const int value) noexcept {
+      *slots.next() = {LogType::INTEGER, {.i = value}};
     }
 
-    auto pushValue(const unsigned long value) noexcept {
-      pushValue(LogElement{LogType::UNSIGNED_LONG_INTEGER, {.ul = value}});
+    static auto pushValue(LogSlots &slots, const long value) noexcept {
+      *slots.next() = {LogType::LONG_INTEGER, {.l = value}};
     }
 
-    auto pushValue(const unsigned long long value) noexcept {
-      pushValue(LogElement{LogType::UNSIGNED_LONG_LONG_INTEGER, {.ull = value}});
+    static auto pushValue(LogSlots &slots, const long long value) noexcept {
+      *slots.next() = {LogType::LONG_LONG_INTEGER, {.ll = value}};
     }
 
-    auto pushValue(const float value) noexcept {
-      pushValue(LogElement{LogType::FLOAT, {.f = value}});
+    static auto pushValue(LogSlots &slots, const unsigned value) noexcept {
+      *slots.next() = {LogType::UNSIGNED_INTEGER, {.u = value}};
     }
 
-    auto pushValue(const double value) noexcept {
-      pushValue(LogElement{LogType::DOUBLE, {.d = value}});
+    static auto pushValue(LogSlots &slots, const unsigned long value) noexcept {
+      *slots.next() = {LogType::UNSIGNED_LONG_INTEGER, {.ul = value}};
     }
 
-    auto pushValue(const char *value) noexcept {
-      while (*value) {
-        pushValue(*value);
-        ++value;
+    static auto pushValue(LogSlots &slots, const unsigned long long value) noexcept {
+      *slots.next() = {LogType::UNSIGNED_LONG_LONG_INTEGER, {.ull = value}};
+    }
+
+    static auto pushValue(LogSlots &slots, const float value) noexcept {
+      *slots.next() = {LogType::FLOAT, {.f = value}};
+    }
+
+    static auto pushValue(LogSlots &slots, const double value) noexcept {
+      *slots.next() = {LogType::DOUBLE, {.d = value}};
+    }
+
+    /// Strings are written LOG_ELEMENT_MAX_CHARS characters per LogElement instead of one LogElement per character.
+    static auto pushValue(LogSlots &slots, const char *value, size_t length) noexcept {
+      for (size_t i = 0; i < length; i += LOG_ELEMENT_MAX_CHARS) {
+        auto log_element = slots.next();
+        *log_element = {LogType::CHARS, {.s = {}}};
+        memcpy(log_element->u_.s, value + i, std::min(LOG_ELEMENT_MAX_CHARS, length - i));
       }
     }
 
-    auto pushValue(const std::string &value) noexcept {
-      pushValue(value.c_str());
+    static auto pushValue(LogSlots &slots, const char *value) noexcept {
+      pushValue(slots, value, strlen(value));
     }
 
-    /// Parse the format string, substitute % with the variable number of arguments passed and write the string to the lock free queue.
-    template<typename T, typename... A>
-    auto log(const char *s, const T &value, A... args) noexcept {
-      while (*s) {
-        if (*s == '%') {
-          if (UNLIKELY(*(s + 1) == '%')) { // to allow %% -> % escape character.
-            ++s;
-          } else {
-            pushValue(value); // substitute % with the value specified in the arguments.
-            log(s + 1, args...); // pop an argument and call self recursively.
-            return;
+    static auto pushValue(LogSlots &slots, const std::string &value) noexcept {
+      pushValue(slots, value.data(), value.size());
+    }
+
+    /// Write the literal characters of a format string segment, packing up to LOG_ELEMENT_MAX_CHARS of them per LogElement.
+    template<typename Segment>
+    static auto pushLiteral(LogSlots &slots, const char *format, const Segment &segment) noexcept {
+      const auto s = format + segment.offset_;
+      if (UNLIKELY(segment.has_escapes_)) {
+        LogElement *log_element = nullptr;
+        size_t num_chars = LOG_ELEMENT_MAX_CHARS;
+        for (size_t i = 0; i < segment.length_; ++i) {
+          if (s[i] == '%') // %% -> %, the format was already validated at compile time.
+            ++i;
+          if (num_chars == LOG_ELEMENT_MAX_CHARS) {
+            log_element = slots.next();
+            *log_element = {LogType::CHARS, {.s = {}}};
+            num_chars = 0;
           }
+          log_element->u_.s[num_chars++] = s[i];
         }
-        pushValue(*s++);
+        return;
       }
-      FATAL("extra arguments provided to log()");
-    }
-
-    /// Overload for case where no substitution in the string is necessary.
-    /// Note that this is overloading not specialization. gcc does not allow inline specializations.
-    auto log(const char *s) noexcept {
-      while (*s) {
-        if (*s == '%') {
-          if (UNLIKELY(*(s + 1) == '%')) { // to allow %% -> % escape character.
-            ++s;
-          } else {
-            FATAL("missing arguments to log()");
-          }
-        }
-        pushValue(*s++);
+
+      pushValue(slots, s, segment.length_);
+    }
+
+    /// Write the literal segments of the compile time parsed format string interleaved with the arguments to the lock free queue.
+    /// There is no parsing on this path, mismatched arguments are rejected when the LogFormat is constructed at compile time.
+    /// All the LogElements of the call are reserved up front and published to the background thread with a single release store.
+    /// If the queue does not have room for all of them the call is dropped and counted in LoggerStats::dropped_entries_ instead of
+    /// stalling the thread logging until the background thread catches up.
+    template<typename... A>
+    auto log(LogFormat<std::type_identity_t<A>...> format, const A &... args) noexcept {
+      const auto num_elements = format.num_literal_elements_ + (numElements(args) + ... + 0);
+      const auto [slots, wrapped_slots] = queue_.tryGetNextBatchToWriteTo(num_elements);
+      if (UNLIKELY(slots.empty())) {
+        if (num_elements)
+          stats_.dropped_entries_.store(stats_.dropped_entries_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
       }
+
+      LogSlots log_slots{slots.data(), slots.data() + slots.size(), wrapped_slots};
+      size_t slot = 0;
+      ((pushLiteral(log_slots, format.format_, format.segments_[slot++]), pushValue(log_slots, args)), ...);
+      pushLiteral(log_slots, format.format_, format.segments_[slot]);
+      queue_.updateWriteIndex(num_elements);
     }
 
     /// Deleted default, copy & move constructors and assignment-operators.
-    Logger() = delete;
+    TextLogger() = delete;
 
-    Logger(const Logger &) = delete;
+    TextLogger(const TextLogger &) = delete;
 
-    Logger(const Logger &&) = delete;
+    TextLogger(const TextLogger &&) = delete;
 
-    Logger &operator=(const Logger &) = delete;
+    TextLogger &operator=(const TextLogger &) = delete;
 
-    Logger &operator=(const Logger &&) = delete;
+    TextLogger &operator=(const TextLogger &&) = delete;
 
   private:
+    /// Format a single LogElement as text at the provided location and return the number of characters written, at most LOG_ELEMENT_MAX_TEXT_SIZE.
+    /// Floating point values are formatted like the default std::ostream formatting, i.e. %g with a precision of 6.
+    static auto formatElement(const LogElement &log_element, char *out) noexcept -> size_t {
+      auto end = out + LOG_ELEMENT_MAX_TEXT_SIZE;
+      switch (log_element.type_) {
+        case LogType::CHAR:
+          *out = log_element.u_.c;
+          return 1;
+        case LogType::INTEGER:
+          return std::to_chars(out, end, log_element.u_.i).ptr - out;
+        case LogType::LONG_INTEGER:
+          return std::to_chars(out, end, log_element.u_.l).ptr - out;
+        case LogType::LONG_LONG_INTEGER:
+          return std::to_chars(out, end, log_element.u_.ll).ptr - out;
+        case LogType::UNSIGNED_INTEGER:
+          return std::to_chars(out, end, log_element.u_.u).ptr - out;
+        case LogType::UNSIGNED_LONG_INTEGER:
+          return std::to_chars(out, end, log_element.u_.ul).ptr - out;
+        case LogType::UNSIGNED_LONG_LONG_INTEGER:
+          return std::to_chars(out, end, log_element.u_.ull).ptr - out;
+        case LogType::FLOAT:
+          return std::to_chars(out, end, log_element.u_.f, std::chars_format::general, 6).ptr - out;
+        case LogType::DOUBLE:
+          return std::to_chars(out, end, log_element.u_.d, std::chars_format::general, 6).ptr - out;
+        case LogType::CHARS: {
+          const auto length = strnlen(log_element.u_.s, LOG_ELEMENT_MAX_CHARS);
+          memcpy(out, log_element.u_.s, length);
+          return length;
+        }
+      }
+
+      return 0;
+    }
+
+    /// Hand the formatted contents of the staging buffer to the kernel.
+    /// With direct_io only the page aligned prefix is written and the remainder moved to the front of the buffer, unless this is the final write.
+    auto writeStagingBuffer(bool final) noexcept -> void {
+      if (final && direct_io_)
+        fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+
+      const auto write_size = (direct_io_ && !final ? staging_size_ / OptCommon::PAGE_SIZE_4K * OptCommon::PAGE_SIZE_4K : staging_size_);
+      for (size_t written = 0; written < write_size;) {
+        const auto n = ::write(fd_, staging_buffer_ + written, write_size - written);
+        if (UNLIKELY(n <= 0)) {
+          if (n < 0 && errno == EINTR)
+            continue;
+          stats_.dropped_bytes_ += write_size - written;
+          break;
+        }
+        written += n;
+        stats_.bytes_written_ += n;
+      }
+
+      staging_size_ -= write_size;
+      if (staging_size_)
+        memmove(staging_buffer_, staging_buffer_ + write_size, staging_size_);
+    }
+
     /// File to which the log entries will be written.
     const std::string file_name_;
-    std::ofstream file_;
+    int fd_ = -1;
+    const bool direct_io_ = false;
+
+    /// Page aligned buffer of formatted text not yet written to the file, only accessed by the drain thread until the TextLogger is removed from it.
+    char *staging_buffer_ = nullptr;
+    size_t staging_size_ = 0;
 
-    /// Lock free queue of log elements from main logging thread to background formatting and disk writer thread.
-    LFQueue<LogElement> queue_;
-    std::atomic<bool> running_ = {true};
+    LoggerStats stats_;
 
-    /// Background logging thread.
-    std::thread *logger_thread_ = nullptr;
+    /// Lock free queue of log elements from main logging thread to the LogDrain formatting and disk writer thread.
+    OptCommon::OptLFQueue<LogElement> queue_;
   };
+
+  inline auto LogDrain::add(DrainableLogger *logger) noexcept -> void {
+    std::lock_guard<std::mutex> start_stop_lock(start_stop_mutex_);
+    {
+      std::lock_guard<std::mutex> loggers_lock(loggers_mutex_);
+      loggers_.push_back(logger);
+    }
+
+    if (!drain_thread_) {
+      running_ = true;
+      drain_thread_ = createAndStartThread(core_id_, "Common/LogDrain", [this]() { run(); });
+      ASSERT(drain_thread_ != nullptr, "Failed to start LogDrain thread.");
+    }
+  }
+
+  inline auto LogDrain::remove(DrainableLogger *logger) noexcept -> void {
+    std::lock_guard<std::mutex> start_stop_lock(start_stop_mutex_);
+    {
+      // Waits for the drain thread to finish its current pass, which may be accessing this logger.
+      std::lock_guard<std::mutex> loggers_lock(loggers_mutex_);
+      loggers_.erase(std::find(loggers_.begin(), loggers_.end(), logger));
+      if (!loggers_.empty())
+        return;
+      running_ = false;
+    }
+
+    drain_thread_->join();
+    delete drain_thread_;
+    drain_thread_ = nullptr;
+  }
+
+  inline auto LogDrain::run() noexcept -> void {
+    int64_t sleep_micros = LOG_MIN_SLEEP_MICROS;
+    while (running_) {
+      tsc_clock.reanchorIfDue();
+
+      bool drained = false;
+      {
+        std::lock_guard<std::mutex> loggers_lock(loggers_mutex_);
+        for (auto logger: loggers_)
+          drained |= logger->drainQueue();
+      }
+
+      if (drained) {
+        sleep_micros = LOG_MIN_SLEEP_MICROS;
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(sleep_micros));
+        sleep_micros = std::min(sleep_micros * 2, LOG_MAX_SLEEP_MICROS);
+      }
+    }
+  }
+}
+
+/// Logger of the components. With the BINARY_LOGGING CMake option it is OptCommon::BinaryLogger, whose files are rendered by log_decoder.
+#if defined(BINARY_LOGGING)
+namespace OptCommon {
+  class BinaryLogger;
+}
+
+namespace Common {
+  using Logger = OptCommon::BinaryLogger;
+}
+
+#include "binary_logging.h"
+#else
+namespace Common {
+  using Logger = TextLogger;
 }
+#endif
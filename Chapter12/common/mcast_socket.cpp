@@ -1,11 +1,26 @@
 #include "mcast_socket.h"
 
 namespace Common {
+  McastSocket::McastSocket(Logger &logger, size_t max_batch_datagrams)
+      : max_batch_datagrams_(std::min(max_batch_datagrams, McastMaxBatchDatagrams)), logger_(logger) {
+    ASSERT(max_batch_datagrams_ > 0, "McastSocket needs to send and read at least one datagram per system call.");
+    outbound_data_.resize(McastBufferSize);
+    datagram_ends_.reserve(1024);
+    inbound_data_.resize(McastMaxBatchDatagrams * McastMaxDatagramSize);
+
+    for (size_t i = 0; i < McastMaxBatchDatagrams; ++i) {
+      recv_iovs_[i] = {inbound_data_.data() + i * McastMaxDatagramSize, McastMaxDatagramSize};
+      recv_msgs_[i].msg_hdr = {nullptr, 0, &recv_iovs_[i], 1, recv_control_[i].data(), recv_control_[i].size(), 0};
+    }
+  }
+
   /// Initialize multicast socket to read from or publish to a stream.
-  /// Does not join the multicast stream yet.
+  /// Does not join the multicast stream yet. Listening sockets get kernel receive timestamps.
   auto McastSocket::init(const std::string &ip, const std::string &iface, int port, bool is_listening) -> int {
-    const SocketCfg socket_cfg{ip, iface, port, true, is_listening, false};
+    const SocketCfg socket_cfg{ip, iface, port, true, is_listening, is_listening};
     socket_fd_ = createSocket(logger_, socket_cfg);
+    is_listening_ = is_listening;
+    recv_pending_ = true;
     return socket_fd_;
   }
 
@@ -20,26 +35,79 @@ namespace Common {
     socket_fd_ = -1;
   }
 
-  /// Publish outgoing data and read incoming data.
+  /// Publish outgoing data and read incoming data, a batch of datagrams per system call either way.
   auto McastSocket::sendAndRecv() noexcept -> bool {
-    // Read data and dispatch callbacks if data is available - non blocking.
-    const ssize_t n_rcv = recv(socket_fd_, inbound_data_.data() + next_rcv_valid_index_, McastBufferSize - next_rcv_valid_index_, MSG_DONTWAIT);
-    if (n_rcv > 0) {
-      next_rcv_valid_index_ += n_rcv;
-      logger_.log("%:% %() % read socket:% len:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), socket_fd_,
-                  next_rcv_valid_index_);
+    if (UNLIKELY(socket_fd_ < 0))
+      return false;
+
+    // Read a batch of datagrams and dispatch callbacks if data is available - non blocking.
+    num_rcv_datagrams_ = 0;
+    if (is_listening_ && recv_pending_) {
+      ++num_recv_calls_;
+      const auto n_rcv = recvmmsg(socket_fd_, recv_msgs_.data(), max_batch_datagrams_, MSG_DONTWAIT, nullptr);
+      num_rcv_datagrams_ = (n_rcv > 0 ? n_rcv : 0);
+
+      // A read shorter than a full batch drained the socket, the next EPOLLIN event sets recv_pending_ again.
+      if (epoll_edge_triggered_ && num_rcv_datagrams_ < max_batch_datagrams_)
+        recv_pending_ = false;
+    }
+    for (size_t i = 0; i < num_rcv_datagrams_; ++i) {
+      auto &msg_hdr = recv_msgs_[i].msg_hdr;
+
+      Nanos kernel_time = 0;
+      timeval time_kernel;
+      const auto cmsg = reinterpret_cast<const cmsghdr *>(recv_control_[i].data());
+      if (msg_hdr.msg_controllen >= sizeof(cmsghdr) &&
+          cmsg->cmsg_level == SOL_SOCKET &&
+          cmsg->cmsg_type == SCM_TIMESTAMP &&
+          cmsg->cmsg_len == CMSG_LEN(sizeof(time_kernel))) {
+        memcpy(&time_kernel, CMSG_DATA(cmsg), sizeof(time_kernel));
+        kernel_time = time_kernel.tv_sec * NANOS_TO_SECS + time_kernel.tv_usec * NANOS_TO_MICROS; // convert timestamp to nanoseconds.
+      }
+      rcv_datagrams_[i] = {static_cast<const char *>(recv_iovs_[i].iov_base), recv_msgs_[i].msg_len, kernel_time};
+
+      // The kernel shrinks it to the size of the control messages it wrote.
+      msg_hdr.msg_controllen = recv_control_[i].size();
+    }
+    if (num_rcv_datagrams_) {
+      logger_.log("%:% %() % read socket:% datagrams:% len:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), socket_fd_,
+                  num_rcv_datagrams_, rcv_datagrams_[0].len_);
       recv_callback_(this);
     }
 
-    // Publish market data in the send buffer to the multicast stream.
+    // Publish market data in the send buffer to the multicast stream, a batch of datagrams at a time.
     if (next_send_valid_index_ > 0) {
-      ssize_t n = ::send(socket_fd_, outbound_data_.data(), next_send_valid_index_, MSG_DONTWAIT | MSG_NOSIGNAL);
+      if (next_send_valid_index_ != (datagram_ends_.empty() ? 0 : datagram_ends_.back()))
+        datagram_ends_.push_back(next_send_valid_index_);
+
+      size_t datagram_start = 0;
+      for (size_t i = 0; i < datagram_ends_.size();) {
+        const auto batch_size = std::min(max_batch_datagrams_, datagram_ends_.size() - i);
+        for (size_t j = 0; j < batch_size; ++j) {
+          send_iovs_[j] = {outbound_data_.data() + datagram_start, datagram_ends_[i + j] - datagram_start};
+          send_msgs_[j].msg_hdr = {nullptr, 0, &send_iovs_[j], 1, nullptr, 0, 0};
+          datagram_start = datagram_ends_[i + j];
+        }
+
+        // Datagrams the kernel could not take right away are dropped, as with any UDP send.
+        size_t num_sent = 0;
+        while (num_sent < batch_size) {
+          ++num_send_calls_;
+          const auto n = sendmmsg(socket_fd_, send_msgs_.data() + num_sent, batch_size - num_sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+          if (n <= 0)
+            break;
+          num_sent += n;
+        }
+        i += batch_size;
 
-      logger_.log("%:% %() % send socket:% len:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), socket_fd_, n);
+        logger_.log("%:% %() % send socket:% datagrams:% sent:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                    socket_fd_, batch_size, num_sent);
+      }
     }
     next_send_valid_index_ = 0;
+    datagram_ends_.clear();
 
-    return (n_rcv > 0);
+    return (num_rcv_datagrams_ > 0);
   }
 
   /// Copy data to send buffers - does not send them out yet.
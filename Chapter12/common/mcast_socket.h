@@ -1,24 +1,36 @@
 #pragma once
 
+#include <array>
 #include <functional>
 
 #include "socket_utils.h"
 
 #include "logging.h"
+#include "huge_page_allocator.h"
 
 namespace Common {
-  /// Size of send and receive buffers in bytes.
+  /// Size of send buffers in bytes.
   constexpr size_t McastBufferSize = 64 * 1024 * 1024;
 
+  /// Maximum number of datagrams sent by a single sendmmsg() or read by a single recvmmsg() system call.
+  constexpr size_t McastMaxBatchDatagrams = 64;
+
+  /// Largest datagram that can be read, the largest UDP payload over IPv4.
+  constexpr size_t McastMaxDatagramSize = 65507;
+
+  /// A datagram read by the last sendAndRecv() call, with its kernel receive timestamp.
+  struct McastDatagram {
+    const char *data_ = nullptr;
+    size_t len_ = 0;
+    Nanos kernel_time_ = 0;
+  };
+
   struct McastSocket {
-    McastSocket(Logger &logger)
-        : logger_(logger) {
-      outbound_data_.resize(McastBufferSize);
-      inbound_data_.resize(McastBufferSize);
-    }
+    /// max_batch_datagrams limits how many datagrams a single system call sends or reads, up to McastMaxBatchDatagrams.
+    explicit McastSocket(Logger &logger, size_t max_batch_datagrams = McastMaxBatchDatagrams);
 
     /// Initialize multicast socket to read from or publish to a stream.
-    /// Does not join the multicast stream yet.
+    /// Does not join the multicast stream yet. Only sockets initialized with is_listening read from it.
     auto init(const std::string &ip, const std::string &iface, int port, bool is_listening) -> int;
 
     /// Add / Join membership / subscription to a multicast stream.
@@ -27,23 +39,69 @@ namespace Common {
     /// Remove / Leave membership / subscription to a multicast stream.
     auto leave(const std::string &ip, int port) -> void;
 
-    /// Publish outgoing data and read incoming data.
+    /// Publish outgoing data and read incoming data, a batch of datagrams per system call either way.
+    /// Makes no system call before init() or after leave(), none to read on a publishing socket or one whose owner's epoll has not reported it
+    /// readable, and none to publish if nothing was copied to the send buffers.
     auto sendAndRecv() noexcept -> bool;
 
     /// Copy data to send buffers - does not send them out yet.
     auto send(const void *data, size_t len) noexcept -> void;
 
+    /// End the datagram being built in the send buffers. sendAndRecv() sends every ended datagram separately, then whatever was copied after the
+    /// last one as a single datagram.
+    auto endDatagram() noexcept -> void {
+      datagram_ends_.push_back(next_send_valid_index_);
+    }
+
+    /// Deleted default, copy & move constructors and assignment-operators.
+    McastSocket() = delete;
+
+    McastSocket(const McastSocket &) = delete;
+
+    McastSocket(const McastSocket &&) = delete;
+
+    McastSocket &operator=(const McastSocket &) = delete;
+
+    McastSocket &operator=(const McastSocket &&) = delete;
+
     int socket_fd_ = -1;
 
-    /// Send and receive buffers, typically only one or the other is needed, not both.
-    std::vector<char> outbound_data_;
+    const size_t max_batch_datagrams_ = McastMaxBatchDatagrams;
+
+    /// Set by init(), publishing sockets never read.
+    bool is_listening_ = false;
+
+    /// Set by the owner of the socket when it registers it with edge-triggered epoll. recvmmsg() is then only called from the EPOLLIN event that
+    /// sets recv_pending_ until a read returns less than a full batch, instead of on every sendAndRecv() call.
+    bool epoll_edge_triggered_ = false;
+    bool recv_pending_ = true;
+
+    /// Send and receive buffers, typically only one or the other is needed, not both. Backed by huge pages.
+    std::vector<char, OptCommon::HugePageAllocator<char>> outbound_data_;
     size_t next_send_valid_index_ = 0;
-    std::vector<char> inbound_data_;
-    size_t next_rcv_valid_index_ = 0;
+    /// Offsets in outbound_data_ of the ends of the datagrams ended by endDatagram().
+    std::vector<size_t> datagram_ends_;
+    /// Every datagram of a batch is read into its own McastMaxDatagramSize slot.
+    std::vector<char, OptCommon::HugePageAllocator<char>> inbound_data_;
+
+    /// The datagrams read by the last sendAndRecv() call, in the order they were received. Valid until the next sendAndRecv() call.
+    std::array<McastDatagram, McastMaxBatchDatagrams> rcv_datagrams_;
+    size_t num_rcv_datagrams_ = 0;
+
+    /// Number of recvmmsg() and sendmmsg() system calls made.
+    size_t num_recv_calls_ = 0;
+    size_t num_send_calls_ = 0;
 
     /// Function wrapper for the method to call when data is read.
     std::function<void(McastSocket *s)> recv_callback_ = nullptr;
 
+    /// Message headers of the batched system calls, and the control buffers the kernel writes the receive timestamps to.
+    std::array<mmsghdr, McastMaxBatchDatagrams> recv_msgs_{};
+    std::array<iovec, McastMaxBatchDatagrams> recv_iovs_{};
+    alignas(cmsghdr) std::array<std::array<char, CMSG_SPACE(sizeof(timeval))>, McastMaxBatchDatagrams> recv_control_{};
+    std::array<mmsghdr, McastMaxBatchDatagrams> send_msgs_{};
+    std::array<iovec, McastMaxBatchDatagrams> send_iovs_{};
+
     std::string time_str_;
     Logger &logger_;
   };
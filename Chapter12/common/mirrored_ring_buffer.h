@@ -0,0 +1,93 @@
+#pragma once
+
+#include <bit>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "macros.h"
+
+namespace Common {
+  /// Byte ring buffer whose memory is mapped twice, back to back, in virtual memory. The readable bytes and the free space are then always
+  /// contiguous even when they wrap around the end of the ring, so messages can be parsed in place and nothing ever has to be moved.
+  /// The capacity is rounded up to a power of two of at least a page. Not thread safe.
+  class MirroredRingBuffer final {
+  public:
+    explicit MirroredRingBuffer(size_t capacity)
+        : capacity_(std::bit_ceil(std::max(capacity, static_cast<size_t>(sysconf(_SC_PAGESIZE))))), mask_(capacity_ - 1) {
+      const auto fd = memfd_create("MirroredRingBuffer", MFD_CLOEXEC);
+      ASSERT(fd >= 0, "memfd_create() failed. error:" + std::string(std::strerror(errno)));
+      ASSERT(fallocate(fd, 0, 0, capacity_) == 0, "fallocate() failed. error:" + std::string(std::strerror(errno)));
+
+      // Reserve the address range for both copies, then map the same pages, allocated above, into each half.
+      auto ptr = mmap(nullptr, 2 * capacity_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      ASSERT(ptr != MAP_FAILED, "mmap() reserve failed. error:" + std::string(std::strerror(errno)));
+      data_ = static_cast<char *>(ptr);
+      for (auto half: {data_, data_ + capacity_})
+        ASSERT(mmap(half, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED | MAP_POPULATE, fd, 0) == half,
+               "mmap() mirror failed. error:" + std::string(std::strerror(errno)));
+      close(fd);
+    }
+
+    ~MirroredRingBuffer() {
+      munmap(data_, 2 * capacity_);
+      data_ = nullptr;
+    }
+
+    /// Reader side: the size() bytes written and not read yet, contiguous.
+    auto readData() const noexcept -> const char * {
+      return data_ + read_index_;
+    }
+
+    auto size() const noexcept {
+      return size_;
+    }
+
+    /// Reader side: release the first n readable bytes.
+    auto updateReadIndex(size_t n) noexcept {
+      size_ -= n;
+      read_index_ = (size_ ? (read_index_ + n) & mask_ : 0);
+    }
+
+    /// Writer side: where the next writeCapacity() bytes go, contiguous.
+    auto writeData() noexcept -> char * {
+      return data_ + ((read_index_ + size_) & mask_);
+    }
+
+    auto writeCapacity() const noexcept {
+      return capacity_ - size_;
+    }
+
+    /// Writer side: publish n bytes written to writeData().
+    auto updateWriteIndex(size_t n) noexcept {
+      size_ += n;
+    }
+
+    auto capacity() const noexcept {
+      return capacity_;
+    }
+
+    /// Deleted default, copy & move constructors and assignment-operators.
+    MirroredRingBuffer() = delete;
+
+    MirroredRingBuffer(const MirroredRingBuffer &) = delete;
+
+    MirroredRingBuffer(const MirroredRingBuffer &&) = delete;
+
+    MirroredRingBuffer &operator=(const MirroredRingBuffer &) = delete;
+
+    MirroredRingBuffer &operator=(const MirroredRingBuffer &&) = delete;
+
+  private:
+    const size_t capacity_ = 0;
+    const size_t mask_ = 0;
+    char *data_ = nullptr;
+
+    /// Offset of the first readable byte in the first copy, reset to the start whenever the ring empties to keep the bytes in use warm.
+    size_t read_index_ = 0;
+    size_t size_ = 0;
+  };
+}
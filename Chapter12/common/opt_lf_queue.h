@@ -0,0 +1,152 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <span>
+#include <algorithm>
+#include <utility>
+
+#include "macros.h"
+#include "huge_page_allocator.h"
+
+namespace OptCommon {
+  /// Size of a cache line, used to keep the producer and consumer state from false sharing.
+  constexpr size_t CACHE_LINE_SIZE = 64;
+
+  /// Round up to the next power of two so that indices can be wrapped with a mask instead of a modulo.
+  inline constexpr auto nextPowerOfTwo(size_t n) noexcept {
+    size_t ret = 1;
+    while (ret < n)
+      ret <<= 1;
+    return ret;
+  }
+
+  /// Single producer single consumer lock free queue, same interface as Common::LFQueue.
+  /// Indices increase monotonically and are masked into the power-of-two sized store, so there is no shared element counter.
+  template<typename T>
+  class OptLFQueue final {
+  public:
+    explicit OptLFQueue(std::size_t num_elems) :
+        store_(nextPowerOfTwo(num_elems), T()) /* pre-allocation of vector storage. */, mask_(store_.size() - 1) {
+    }
+
+    /// Producer side: return the slot the next element should be written to.
+    /// Spins if the consumer has not freed up a slot yet instead of overwriting unread data.
+    auto getNextToWriteTo() noexcept {
+      const auto write_index = write_.index_.load(std::memory_order_relaxed);
+      if (UNLIKELY(write_index - write_.cached_other_index_ == store_.size())) {
+        while ((write_.cached_other_index_ = read_.index_.load(std::memory_order_acquire)) + store_.size() == write_index)
+          __builtin_ia32_pause();
+      }
+      return &store_[write_index & mask_];
+    }
+
+    /// Producer side: publish the element written to the slot returned by getNextToWriteTo().
+    auto updateWriteIndex() noexcept {
+      write_.index_.store(write_.index_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// Consumer side: return the next element to be read or nullptr if the queue is empty.
+    /// Only reloads the producer's index when the locally cached copy says the queue is empty.
+    auto getNextToRead() const noexcept -> const T * {
+      const auto read_index = read_.index_.load(std::memory_order_relaxed);
+      if (read_index == read_.cached_other_index_) {
+        read_.cached_other_index_ = write_.index_.load(std::memory_order_acquire);
+        if (read_index == read_.cached_other_index_)
+          return nullptr;
+      }
+      return &store_[read_index & mask_];
+    }
+
+    /// Consumer side: release the slot returned by getNextToRead() back to the producer.
+    auto updateReadIndex() noexcept {
+      const auto read_index = read_.index_.load(std::memory_order_relaxed);
+#if !defined(NDEBUG)
+      ASSERT(read_index != read_.cached_other_index_, "Read an invalid element in:" + std::to_string(pthread_self()));
+#endif
+      read_.index_.store(read_index + 1, std::memory_order_release);
+    }
+
+    /// Producer side: claim up to max_elems contiguous slots, fewer if the store wraps around or the consumer is behind.
+    /// Spins until at least one slot is free, the slots are published together with updateWriteIndex(n).
+    auto getNextBatchToWriteTo(size_t max_elems) noexcept -> std::span<T> {
+      const auto write_index = write_.index_.load(std::memory_order_relaxed);
+      if (UNLIKELY(write_index - write_.cached_other_index_ == store_.size())) {
+        while ((write_.cached_other_index_ = read_.index_.load(std::memory_order_acquire)) + store_.size() == write_index)
+          __builtin_ia32_pause();
+      }
+      const auto free_elems = store_.size() - (write_index - write_.cached_other_index_);
+      const auto contiguous_elems = store_.size() - (write_index & mask_);
+      return {&store_[write_index & mask_], std::min({max_elems, free_elems, contiguous_elems})};
+    }
+
+    /// Producer side: claim exactly n slots without spinning, as two contiguous spans where the second one is only non-empty if the slots wrap
+    /// around the end of the store. Both spans are empty if fewer than n slots are free, the slots are published together with updateWriteIndex(n).
+    auto tryGetNextBatchToWriteTo(size_t n) noexcept -> std::pair<std::span<T>, std::span<T>> {
+      const auto write_index = write_.index_.load(std::memory_order_relaxed);
+      if (UNLIKELY(write_index - write_.cached_other_index_ + n > store_.size())) {
+        write_.cached_other_index_ = read_.index_.load(std::memory_order_acquire);
+        if (write_index - write_.cached_other_index_ + n > store_.size())
+          return {};
+      }
+      const auto contiguous_elems = std::min(n, store_.size() - (write_index & mask_));
+      return {{&store_[write_index & mask_], contiguous_elems}, {&store_[0], n - contiguous_elems}};
+    }
+
+    /// Producer side: publish n elements written to the slots returned by getNextBatchToWriteTo() with a single release store.
+    auto updateWriteIndex(size_t n) noexcept {
+      write_.index_.store(write_.index_.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    /// Consumer side: return up to max_elems contiguous elements that are ready to be read, empty if the queue is empty.
+    auto getNextBatchToRead(size_t max_elems) const noexcept -> std::span<const T> {
+      const auto read_index = read_.index_.load(std::memory_order_relaxed);
+      if (read_.cached_other_index_ - read_index < max_elems)
+        read_.cached_other_index_ = write_.index_.load(std::memory_order_acquire);
+      const auto contiguous_elems = store_.size() - (read_index & mask_);
+      return {&store_[read_index & mask_], std::min({max_elems, read_.cached_other_index_ - read_index, contiguous_elems})};
+    }
+
+    /// Consumer side: release n elements returned by getNextBatchToRead() back to the producer with a single release store.
+    auto updateReadIndex(size_t n) noexcept {
+      const auto read_index = read_.index_.load(std::memory_order_relaxed);
+#if !defined(NDEBUG)
+      ASSERT(read_index + n <= read_.cached_other_index_, "Read invalid elements in:" + std::to_string(pthread_self()));
+#endif
+      read_.index_.store(read_index + n, std::memory_order_release);
+    }
+
+    /// Number of elements written but not yet read, safe to call from either side but is only a snapshot.
+    auto size() const noexcept {
+      return write_.index_.load(std::memory_order_acquire) - read_.index_.load(std::memory_order_acquire);
+    }
+
+    /// Deleted default, copy & move constructors and assignment-operators.
+    OptLFQueue() = delete;
+
+    OptLFQueue(const OptLFQueue &) = delete;
+
+    OptLFQueue(const OptLFQueue &&) = delete;
+
+    OptLFQueue &operator=(const OptLFQueue &) = delete;
+
+    OptLFQueue &operator=(const OptLFQueue &&) = delete;
+
+  private:
+    /// Index owned by one side and that side's private copy of the index owned by the other side.
+    /// Each side lives on its own cache line so the producer and the consumer only share a line when the cached copy runs out.
+    struct alignas(CACHE_LINE_SIZE) IndexPair {
+      std::atomic<size_t> index_ = {0};
+      mutable size_t cached_other_index_ = 0;
+    };
+
+    /// Underlying container of data accessed in FIFO order, only the pointer and mask are read by both sides.
+    /// Large queues are backed by huge pages.
+    std::vector<T, HugePageAllocator<T>> store_;
+    const size_t mask_;
+
+    IndexPair write_;
+    IndexPair read_;
+  };
+}
@@ -5,7 +5,7 @@
 #include <cstdio>
 
 #include "macros.h"
-#include "lf_queue.h"
+#include "opt_lf_queue.h"
 #include "thread_utils.h"
 #include "time_utils.h"
 
@@ -218,7 +218,7 @@ namespace OptCommon {
     std::ofstream file_;
 
     /// Lock free queue of log elements from main logging thread to background formatting and disk writer thread.
-    Common::LFQueue<LogElement> queue_;
+    OptLFQueue<LogElement> queue_;
     std::atomic<bool> running_ = {true};
 
     /// Background logging thread.
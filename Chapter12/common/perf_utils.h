@@ -1,5 +1,7 @@
 #pragma once
 
+#include <sys/resource.h>
+
 namespace Common {
   /// Read from the TSC register and return a uint64_t value to represent elapsed CPU clock cycles.
   inline auto rdtsc() noexcept {
@@ -7,16 +9,27 @@ namespace Common {
     __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
     return ((uint64_t) hi << 32) | lo;
   }
+
+  /// Number of minor page faults the calling thread took so far, e.g. the copy-on-write page copies after a fork().
+  inline auto threadMinorFaults() noexcept -> long {
+    rusage usage{};
+    getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_minflt;
+  }
 }
 
 /// Start latency measurement using rdtsc(). Creates a variable called TAG in the local scope.
 #define START_MEASURE(TAG) const auto TAG = Common::rdtsc()
 
-/// End latency measurement using rdtsc(). Expects a variable called TAG to already exist in the local scope.
-#define END_MEASURE(TAG, LOGGER)                                                              \
-      do {                                                                                    \
-        const auto end = Common::rdtsc();                                                     \
-        LOGGER.log("% RDTSC "#TAG" %\n", Common::getCurrentTimeStr(&time_str_), (end - TAG)); \
+#if defined(LOG_MEASUREMENTS)
+/// Log based measurements, enabled by compiling with -DLOG_MEASUREMENTS. Every measurement is a text log line for notebooks/perf_analysis.ipynb.
+
+/// End latency measurement using rdtsc() and log the elapsed time in nanoseconds using the calibrated TSC clock.
+/// Expects a variable called TAG to already exist in the local scope.
+#define END_MEASURE(TAG, LOGGER)                                                                                         \
+      do {                                                                                                               \
+        const auto end = Common::rdtsc();                                                                                \
+        LOGGER.log("% RDTSC "#TAG" %\n", Common::getCurrentTimeStr(&time_str_), Common::tsc_clock.ticksToNanos(end - TAG)); \
       } while(false)
 
 /// Log a current timestamp at the time this macro is invoked.
@@ -25,3 +38,25 @@ namespace Common {
         const auto TAG = Common::getCurrentNanos();                                           \
         LOGGER.log("% TTT "#TAG" %\n", Common::getCurrentTimeStr(&time_str_), TAG);           \
       } while(false)
+#else
+/// Histogram based measurements, the default. Each call site looks up the calling thread's histogram for TAG once and then only records into it.
+/// The histograms are written out by Common::dumpLatencyHistograms(), LOGGER is unused.
+
+/// End latency measurement using rdtsc() and record the elapsed ticks in the histogram of TAG.
+/// Expects a variable called TAG to already exist in the local scope.
+#define END_MEASURE(TAG, LOGGER)                                                              \
+      do {                                                                                    \
+        static thread_local auto histogram = Common::latencyHistogram(#TAG);                  \
+        histogram->record(Common::rdtsc() - TAG);                                             \
+      } while(false)
+
+/// Record the ticks elapsed since the previous TTT_MEASURE on the same thread in the histogram of the hop PREVIOUS_TAG->TAG, e.g.
+/// T1_OrderServer_TCP_read -> T2_OrderServer_LFQueue_write, and those since the latest stamp of the tags of Common::TTT_CROSS_THREAD_HOPS
+/// before TAG on other threads and in other processes, e.g. T2_OrderServer_LFQueue_write -> T3_MatchingEngine_LFQueue_read.
+/// The first hop of a loop iteration comes after the last hop of the previous one, that histogram is the idle time between two messages.
+#define TTT_MEASURE(TAG, LOGGER)                                                              \
+      do {                                                                                    \
+        static thread_local Common::TTTHistograms histograms(#TAG);                           \
+        histograms.record(Common::rdtsc());                                                   \
+      } while(false)
+#endif
@@ -7,20 +7,94 @@ namespace Common {
     return !epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket->socket_fd_, &ev);
   }
 
+  auto TCPServer::closeSocket(TCPSocket *socket) noexcept -> void {
+    logger_.log("%:% %() % closing socket:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), socket->socket_fd_);
+
+    receive_sockets_.erase(std::remove(receive_sockets_.begin(), receive_sockets_.end(), socket), receive_sockets_.end());
+    send_sockets_.erase(std::remove(send_sockets_.begin(), send_sockets_.end(), socket), send_sockets_.end());
+    if (disconnect_callback_)
+      disconnect_callback_(socket);
+
+    if (io_uring_) {
+      io_uring_->setFixedFile(socket->fixed_file_index_, -1);
+      io_uring_free_fixed_files_.push_back(socket->fixed_file_index_);
+    } else {
+      epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket->socket_fd_, nullptr);
+    }
+    close(socket->socket_fd_);
+    delete socket;
+  }
+
+  TCPServer::~TCPServer() {
+    // Closing the ring first cancels the receives and sends still referring to the sockets' buffers.
+    delete io_uring_;
+    io_uring_ = nullptr;
+
+    // Every accepted socket is in receive_sockets_.
+    for (auto socket: receive_sockets_) {
+      close(socket->socket_fd_);
+      delete socket;
+    }
+    receive_sockets_.clear();
+    send_sockets_.clear();
+
+    if (listener_socket_.socket_fd_ >= 0)
+      close(listener_socket_.socket_fd_);
+    if (epoll_fd_ >= 0)
+      close(epoll_fd_);
+  }
+
   /// Start listening for connections on the provided interface and port.
   auto TCPServer::listen(const std::string &iface, int port) -> void {
-    epoll_fd_ = epoll_create(1);
-    ASSERT(epoll_fd_ >= 0, "epoll_create() failed error:" + std::string(std::strerror(errno)));
+    if (backend_ == TCPServerBackend::EPOLL) {
+      epoll_fd_ = epoll_create(1);
+      ASSERT(epoll_fd_ >= 0, "epoll_create() failed error:" + std::string(std::strerror(errno)));
+    }
 
     ASSERT(listener_socket_.connect("", iface, port, true) >= 0,
            "Listener socket failed to connect. iface:" + iface + " port:" + std::to_string(port) + " error:" +
            std::string(std::strerror(errno)));
 
-    ASSERT(addToEpollList(&listener_socket_), "epoll_ctl() failed. error:" + std::string(std::strerror(errno)));
+    if (backend_ == TCPServerBackend::EPOLL) {
+      ASSERT(addToEpollList(&listener_socket_), "epoll_ctl() failed. error:" + std::string(std::strerror(errno)));
+      return;
+    }
+
+    // The listener takes slot 0 of the fixed file table, accepted sockets the slots after it.
+    io_uring_ = new IoUring(TCPServerIoUringEntries, backend_ == TCPServerBackend::IO_URING_SQPOLL, TCPServerMaxConnections + 1);
+    io_uring_->setupBufferRing(0, TCPServerIoUringRecvBuffers, TCPServerIoUringRecvBufferSize);
+    listener_socket_.fixed_file_index_ = 0;
+    for (auto fixed_file_index = static_cast<int>(TCPServerMaxConnections); fixed_file_index > 0; --fixed_file_index)
+      io_uring_free_fixed_files_.push_back(fixed_file_index);
+    ASSERT(io_uring_->setFixedFile(0, listener_socket_.socket_fd_), "io_uring fixed file update failed. error:" + std::string(std::strerror(errno)));
+    io_uring_recv_msg_.msg_controllen = CMSG_SPACE(sizeof(timeval));
+
+    logger_.log("%:% %() % backend:% listener_socket:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                tcpServerBackendToString(backend_), listener_socket_.socket_fd_);
+
+    ioUringQueueAccept();
+    io_uring_->submit();
   }
 
   /// Publish outgoing data from the send buffer and read incoming data from the receive buffer.
   auto TCPServer::sendAndRecv() noexcept -> void {
+    if (io_uring_) {
+      if (io_uring_recv_) { // There were some events and they have all been dispatched, inform listener.
+        io_uring_recv_ = false;
+        recv_finished_callback_();
+      }
+
+      // A socket with a send in flight queues what was written to it since once that send completes.
+      for (auto socket: receive_sockets_) {
+        if (UNLIKELY(socket->disconnect_))
+          ioUringDisconnect(socket);
+        else if (socket->outbound_data_.size() && !socket->send_in_flight_ && !socket->shut_down_)
+          ioUringQueueSend(socket);
+      }
+      io_uring_->submit();
+      return;
+    }
+
     auto recv = false;
 
     std::for_each(receive_sockets_.begin(), receive_sockets_.end(), [&recv](auto socket) {
@@ -33,10 +107,24 @@ namespace Common {
     std::for_each(send_sockets_.begin(), send_sockets_.end(), [](auto socket) {
       socket->sendAndRecv();
     });
+
+    // Close the connections that ended or whose peer stopped reading what is sent to it.
+    for (size_t i = 0; i < receive_sockets_.size();) {
+      if (UNLIKELY(receive_sockets_[i]->disconnect_))
+        closeSocket(receive_sockets_[i]);
+      else
+        ++i;
+    }
   }
 
   /// Check for new connections or dead connections and update containers that track the sockets.
   auto TCPServer::poll() noexcept -> void {
+    if (io_uring_) {
+      io_uring_->forEachCqe([this](const io_uring_cqe &cqe) { ioUringHandleCqe(cqe); });
+      io_uring_->submit();
+      return;
+    }
+
     const int max_events = 1 + send_sockets_.size() + receive_sockets_.size();
 
     const int n = epoll_wait(epoll_fd_, events_, max_events, 0);
@@ -55,6 +143,7 @@ namespace Common {
         }
         logger_.log("%:% %() % EPOLLIN socket:%\n", __FILE__, __LINE__, __FUNCTION__,
                     Common::getCurrentTimeStr(&time_str_), socket->socket_fd_);
+        socket->recv_pending_ = true;
         if (std::find(receive_sockets_.begin(), receive_sockets_.end(), socket) == receive_sockets_.end())
           receive_sockets_.push_back(socket);
       }
@@ -69,6 +158,7 @@ namespace Common {
       if (event.events & (EPOLLERR | EPOLLHUP)) {
         logger_.log("%:% %() % EPOLLERR socket:%\n", __FILE__, __LINE__, __FUNCTION__,
                     Common::getCurrentTimeStr(&time_str_), socket->socket_fd_);
+        socket->recv_pending_ = true;
         if (std::find(receive_sockets_.begin(), receive_sockets_.end(), socket) == receive_sockets_.end())
           receive_sockets_.push_back(socket);
       }
@@ -93,10 +183,187 @@ namespace Common {
       auto socket = new TCPSocket(logger_);
       socket->socket_fd_ = fd;
       socket->recv_callback_ = recv_callback_;
+      socket->epoll_edge_triggered_ = true;
       ASSERT(addToEpollList(socket), "Unable to add socket. error:" + std::string(std::strerror(errno)));
 
       if (std::find(receive_sockets_.begin(), receive_sockets_.end(), socket) == receive_sockets_.end())
         receive_sockets_.push_back(socket);
     }
   }
+
+  auto TCPServer::ioUringQueueAccept() noexcept -> void {
+    auto sqe = io_uring_->getSqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listener_socket_.fixed_file_index_;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = reinterpret_cast<uint64_t>(&listener_socket_) | static_cast<uint64_t>(IoUringOp::ACCEPT);
+  }
+
+  /// Multishot recvmsg(), it keeps posting a completion per read into a provided buffer until it runs out of buffers or the connection ends.
+  auto TCPServer::ioUringQueueRecv(TCPSocket *socket) noexcept -> void {
+    auto sqe = io_uring_->getSqe();
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = socket->fixed_file_index_;
+    sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->addr = reinterpret_cast<uint64_t>(&io_uring_recv_msg_);
+    sqe->len = 1;
+    sqe->buf_group = 0;
+    sqe->user_data = reinterpret_cast<uint64_t>(socket) | static_cast<uint64_t>(IoUringOp::RECV);
+    socket->recv_armed_ = true;
+  }
+
+  /// Send everything in the socket's send buffer, MSG_WAITALL has the kernel retry until all of it is sent.
+  auto TCPServer::ioUringQueueSend(TCPSocket *socket) noexcept -> void {
+    socket->send_in_flight_ = socket->outbound_data_.size();
+
+    auto sqe = io_uring_->getSqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = socket->fixed_file_index_;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->addr = reinterpret_cast<uint64_t>(socket->outbound_data_.readData());
+    sqe->len = static_cast<uint32_t>(socket->send_in_flight_);
+    sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+    sqe->user_data = reinterpret_cast<uint64_t>(socket) | static_cast<uint64_t>(IoUringOp::SEND);
+  }
+
+  auto TCPServer::ioUringHandleCqe(const io_uring_cqe &cqe) noexcept -> void {
+    auto socket = reinterpret_cast<TCPSocket *>(cqe.user_data & ~IoUringOpMask);
+    switch (static_cast<IoUringOp>(cqe.user_data & IoUringOpMask)) {
+      case IoUringOp::ACCEPT: {
+        if (!(cqe.flags & IORING_CQE_F_MORE))
+          ioUringQueueAccept();
+        if (cqe.res < 0) {
+          logger_.log("%:% %() % accept failed error:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                      std::strerror(-cqe.res));
+          break;
+        }
+
+        const int fd = cqe.res;
+        ASSERT(setNonBlocking(fd) && disableNagle(fd),
+               "Failed to set non-blocking or no-delay on socket:" + std::to_string(fd));
+
+        logger_.log("%:% %() % accepted socket:%\n", __FILE__, __LINE__, __FUNCTION__,
+                    Common::getCurrentTimeStr(&time_str_), fd);
+
+        if (UNLIKELY(io_uring_free_fixed_files_.empty())) {
+          logger_.log("%:% %() % too many connections, closing socket:%\n", __FILE__, __LINE__, __FUNCTION__,
+                      Common::getCurrentTimeStr(&time_str_), fd);
+          close(fd);
+          break;
+        }
+        const auto fixed_file_index = io_uring_free_fixed_files_.back();
+        io_uring_free_fixed_files_.pop_back();
+
+        auto accepted_socket = new TCPSocket(logger_);
+        accepted_socket->socket_fd_ = fd;
+        accepted_socket->recv_callback_ = recv_callback_;
+        accepted_socket->fixed_file_index_ = fixed_file_index;
+        ASSERT(io_uring_->setFixedFile(fixed_file_index, fd), "io_uring fixed file update failed. error:" + std::string(std::strerror(errno)));
+        receive_sockets_.push_back(accepted_socket);
+        ioUringQueueRecv(accepted_socket);
+      }
+        break;
+      case IoUringOp::RECV:
+        ioUringHandleRecv(socket, cqe);
+        break;
+      case IoUringOp::SEND:
+        ioUringHandleSend(socket, cqe);
+        break;
+    }
+  }
+
+  /// Copy the payload of a receive completion to the socket's receive buffer and dispatch it, re-arming the receive if it ended.
+  auto TCPServer::ioUringHandleRecv(TCPSocket *socket, const io_uring_cqe &cqe) noexcept -> void {
+    size_t read_size = 0;
+    if (cqe.flags & IORING_CQE_F_BUFFER) {
+      const auto buffer_id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+      const auto buffer = io_uring_->bufferData(buffer_id);
+
+      // The buffer holds a header, the source address - none was asked for - the control messages up to the size in the message header and
+      // the payload.
+      const auto out = reinterpret_cast<const io_uring_recvmsg_out *>(buffer);
+      const auto control = buffer + sizeof(io_uring_recvmsg_out) + io_uring_recv_msg_.msg_namelen;
+      const auto payload = control + io_uring_recv_msg_.msg_controllen;
+
+      Nanos kernel_time = 0;
+      timeval time_kernel;
+      const auto cmsg = reinterpret_cast<const cmsghdr *>(control);
+      if (out->controllen >= sizeof(cmsghdr) &&
+          cmsg->cmsg_level == SOL_SOCKET &&
+          cmsg->cmsg_type == SCM_TIMESTAMP &&
+          cmsg->cmsg_len == CMSG_LEN(sizeof(time_kernel))) {
+        memcpy(&time_kernel, CMSG_DATA(cmsg), sizeof(time_kernel));
+        kernel_time = time_kernel.tv_sec * NANOS_TO_SECS + time_kernel.tv_usec * NANOS_TO_MICROS; // convert timestamp to nanoseconds.
+      }
+
+      read_size = out->payloadlen;
+      if (UNLIKELY(socket->disconnect_)) {
+        // Whatever still arrives after the socket was disconnected is dropped.
+        read_size = 0;
+      } else if (UNLIKELY(read_size > socket->inbound_data_.writeCapacity())) {
+        logger_.log("%:% %() % receive buffer full socket:% pending:% dropping:%, disconnecting\n", __FILE__, __LINE__, __FUNCTION__,
+                    Common::getCurrentTimeStr(&time_str_), socket->socket_fd_, socket->inbound_data_.size(), read_size);
+        read_size = 0;
+        socket->disconnect_ = true;
+        ioUringDisconnect(socket);
+      } else {
+        memcpy(socket->inbound_data_.writeData(), payload, read_size);
+        socket->inbound_data_.updateWriteIndex(read_size);
+      }
+      io_uring_->recycleBuffer(buffer_id);
+
+      if (read_size) {
+        const auto user_time = getCurrentNanos();
+        logger_.log("%:% %() % read socket:% len:% utime:% ktime:% diff:%\n", __FILE__, __LINE__, __FUNCTION__,
+                    Common::getCurrentTimeStr(&time_str_), socket->socket_fd_, socket->inbound_data_.size(), user_time, kernel_time,
+                    (user_time - kernel_time));
+        io_uring_recv_ = true;
+        socket->recv_callback_(socket, kernel_time);
+      }
+    }
+
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+      // Running out of provided buffers ends a multishot receive as well, but only an error or end of stream ends the connection.
+      if ((read_size || cqe.res == -ENOBUFS) && !socket->shut_down_) {
+        ioUringQueueRecv(socket);
+      } else {
+        logger_.log("%:% %() % recv ended socket:% error:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                    socket->socket_fd_, (cqe.res < 0 ? std::strerror(-cqe.res) : "end of stream"));
+        socket->recv_armed_ = false;
+        if (!socket->send_in_flight_)
+          closeSocket(socket);
+      }
+    }
+  }
+
+  /// Release the bytes a completed send wrote, whatever is left and whatever send() appended while it was in flight goes out with the next one.
+  /// A failed send drops everything pending and disconnects the socket.
+  auto TCPServer::ioUringHandleSend(TCPSocket *socket, const io_uring_cqe &cqe) noexcept -> void {
+    logger_.log("%:% %() % send socket:% len:% of:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                socket->socket_fd_, cqe.res, socket->send_in_flight_);
+
+    if (UNLIKELY(cqe.res < 0)) {
+      logger_.log("%:% %() % send failed socket:% error:% dropping:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                  socket->socket_fd_, std::strerror(-cqe.res), socket->outbound_data_.size());
+      socket->outbound_data_.updateReadIndex(socket->outbound_data_.size());
+      ioUringDisconnect(socket);
+    } else {
+      // MSG_WAITALL only completes short if the connection broke or was shut down during the send.
+      socket->outbound_data_.updateReadIndex(static_cast<size_t>(cqe.res));
+    }
+    socket->send_in_flight_ = 0;
+
+    if (!socket->recv_armed_)
+      closeSocket(socket);
+  }
+
+  auto TCPServer::ioUringDisconnect(TCPSocket *socket) noexcept -> void {
+    if (!socket->shut_down_) {
+      logger_.log("%:% %() % disconnecting socket:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), socket->socket_fd_);
+      shutdown(socket->socket_fd_, SHUT_RDWR);
+      socket->shut_down_ = true;
+    }
+  }
 }
@@ -1,27 +1,106 @@
 #pragma once
 
 #include "tcp_socket.h"
+#include "io_uring.h"
 
 namespace Common {
+  /// Maximum number of connections a TCPServer with an io_uring backend accepts, the size of its fixed file table.
+  constexpr size_t TCPServerMaxConnections = 1024;
+
+  /// io_uring backend sizes: submission queue entries, and the number and size of the provided buffers every receive is read into.
+  constexpr unsigned TCPServerIoUringEntries = 1024;
+  constexpr unsigned TCPServerIoUringRecvBuffers = 1024;
+  constexpr unsigned TCPServerIoUringRecvBufferSize = 16 * 1024;
+
+  /// Mechanism a TCPServer uses for its network I/O.
+  enum class TCPServerBackend : uint8_t {
+    /// Edge-triggered epoll readiness, then non-blocking recvmsg() and send() calls per socket.
+    EPOLL = 0,
+    /// io_uring with a multishot accept, a multishot recvmsg() per socket into provided buffers and fixed files. Idle polling makes no system
+    /// calls, a loop iteration that queues requests makes one io_uring_enter() call for all of them.
+    IO_URING = 1,
+    /// IO_URING with a kernel thread polling the submission queue, io_uring_enter() is only called to wake that thread up after it went idle.
+    IO_URING_SQPOLL = 2
+  };
+
+  inline auto tcpServerBackendToString(TCPServerBackend backend) -> std::string {
+    switch (backend) {
+      case TCPServerBackend::EPOLL:
+        return "EPOLL";
+      case TCPServerBackend::IO_URING:
+        return "IO_URING";
+      case TCPServerBackend::IO_URING_SQPOLL:
+        return "IO_URING_SQPOLL";
+    }
+
+    return "UNKNOWN";
+  }
+
   struct TCPServer {
-    explicit TCPServer(Logger &logger)
-        : listener_socket_(logger), logger_(logger) {
+    explicit TCPServer(Logger &logger, TCPServerBackend backend = TCPServerBackend::EPOLL)
+        : backend_(backend), listener_socket_(logger), logger_(logger) {
     }
 
+    ~TCPServer();
+
     /// Start listening for connections on the provided interface and port.
     auto listen(const std::string &iface, int port) -> void;
 
     /// Check for new connections or dead connections and update containers that track the sockets.
+    /// With an io_uring backend this also reaps the receive completions and calls recv_callback_ for each of them.
     auto poll() noexcept -> void;
 
     /// Publish outgoing data from the send buffer and read incoming data from the receive buffer.
+    /// With an io_uring backend the data was read by poll(), this calls recv_finished_callback_ if there was any and queues the sends.
+    /// Sockets marked to be disconnected are closed, with an io_uring backend once their receive and send requests have completed.
     auto sendAndRecv() noexcept -> void;
 
+    /// Deleted default, copy & move constructors and assignment-operators.
+    TCPServer() = delete;
+
+    TCPServer(const TCPServer &) = delete;
+
+    TCPServer(const TCPServer &&) = delete;
+
+    TCPServer &operator=(const TCPServer &) = delete;
+
+    TCPServer &operator=(const TCPServer &&) = delete;
+
   private:
     /// Add and remove socket file descriptors to and from the EPOLL list.
     auto addToEpollList(TCPSocket *socket);
 
+    /// Remove an accepted socket from the containers, call disconnect_callback_, close it and delete it. With an io_uring backend its fixed
+    /// file slot is freed for the next connection, it must not have a receive or send in flight anymore.
+    auto closeSocket(TCPSocket *socket) noexcept -> void;
+
+    /// io_uring backend - submission queue entries are tagged with the socket they are for and the kind of request in the low bits of the pointer.
+    enum class IoUringOp : uint64_t {
+      ACCEPT = 0,
+      RECV = 1,
+      SEND = 2
+    };
+
+    static constexpr uint64_t IoUringOpMask = 3;
+
+    auto ioUringQueueAccept() noexcept -> void;
+
+    auto ioUringQueueRecv(TCPSocket *socket) noexcept -> void;
+
+    auto ioUringQueueSend(TCPSocket *socket) noexcept -> void;
+
+    auto ioUringHandleCqe(const io_uring_cqe &cqe) noexcept -> void;
+
+    auto ioUringHandleRecv(TCPSocket *socket, const io_uring_cqe &cqe) noexcept -> void;
+
+    auto ioUringHandleSend(TCPSocket *socket, const io_uring_cqe &cqe) noexcept -> void;
+
+    /// Shut the connection down so that its multishot receive ends, the socket is closed once that and any send in flight have completed.
+    auto ioUringDisconnect(TCPSocket *socket) noexcept -> void;
+
   public:
+    const TCPServerBackend backend_ = TCPServerBackend::EPOLL;
+
     /// Socket on which this server is listening for new connections on.
     int epoll_fd_ = -1;
     TCPSocket listener_socket_;
@@ -31,10 +110,21 @@ namespace Common {
     /// Collection of all sockets, sockets for incoming data, sockets for outgoing data and dead connections.
     std::vector<TCPSocket *> receive_sockets_, send_sockets_;
 
+    /// io_uring backend, the message header every multishot recvmsg() uses - only the size of the control messages matters - and whether
+    /// recv_callback_ was called since the last sendAndRecv().
+    IoUring *io_uring_ = nullptr;
+    msghdr io_uring_recv_msg_{};
+    bool io_uring_recv_ = false;
+
+    /// io_uring backend, the slots of the fixed file table no socket uses - the listener has slot 0.
+    std::vector<int> io_uring_free_fixed_files_;
+
     /// Function wrapper to call back when data is available.
     std::function<void(TCPSocket *s, Nanos rx_time)> recv_callback_ = nullptr;
     /// Function wrapper to call back when all data across all TCPSockets has been read and dispatched this round.
     std::function<void()> recv_finished_callback_ = nullptr;
+    /// Function wrapper to call back when a connection ended, right before its TCPSocket is closed and deleted.
+    std::function<void(TCPSocket *s)> disconnect_callback_ = nullptr;
 
     std::string time_str_;
     Logger &logger_;
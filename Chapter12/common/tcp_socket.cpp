@@ -16,46 +16,67 @@ namespace Common {
 
   /// Called to publish outgoing data from the buffers as well as check for and callback if data is available in the read buffers.
   auto TCPSocket::sendAndRecv() noexcept -> bool {
-    char ctrl[CMSG_SPACE(sizeof(struct timeval))];
-    auto cmsg = reinterpret_cast<struct cmsghdr *>(&ctrl);
-
-    iovec iov{inbound_data_.data() + next_rcv_valid_index_, TCPBufferSize - next_rcv_valid_index_};
-    msghdr msg{&socket_attrib_, sizeof(socket_attrib_), &iov, 1, ctrl, sizeof(ctrl), 0};
-
-    // Non-blocking call to read available data.
-    const auto read_size = recvmsg(socket_fd_, &msg, MSG_DONTWAIT);
-    if (read_size > 0) {
-      next_rcv_valid_index_ += read_size;
-
-      Nanos kernel_time = 0;
-      timeval time_kernel;
-      if (cmsg->cmsg_level == SOL_SOCKET &&
-          cmsg->cmsg_type == SCM_TIMESTAMP &&
-          cmsg->cmsg_len == CMSG_LEN(sizeof(time_kernel))) {
-        memcpy(&time_kernel, CMSG_DATA(cmsg), sizeof(time_kernel));
-        kernel_time = time_kernel.tv_sec * NANOS_TO_SECS + time_kernel.tv_usec * NANOS_TO_MICROS; // convert timestamp to nanoseconds.
-      }
+    ssize_t read_size = 0;
+    // With the inbound ring full recvmsg() would read nothing, recv_pending_ stays set so the data is read once the callback consumed some.
+    if (recv_pending_ && inbound_data_.writeCapacity() > 0) {
+      char ctrl[CMSG_SPACE(sizeof(struct timeval))];
+      auto cmsg = reinterpret_cast<struct cmsghdr *>(&ctrl);
+
+      iovec iov{inbound_data_.writeData(), inbound_data_.writeCapacity()};
+      msghdr msg{&socket_attrib_, sizeof(socket_attrib_), &iov, 1, ctrl, sizeof(ctrl), 0};
+
+      // Non-blocking call to read available data.
+      read_size = recvmsg(socket_fd_, &msg, MSG_DONTWAIT);
+      if (read_size > 0) {
+        inbound_data_.updateWriteIndex(read_size);
+
+        Nanos kernel_time = 0;
+        timeval time_kernel;
+        if (cmsg->cmsg_level == SOL_SOCKET &&
+            cmsg->cmsg_type == SCM_TIMESTAMP &&
+            cmsg->cmsg_len == CMSG_LEN(sizeof(time_kernel))) {
+          memcpy(&time_kernel, CMSG_DATA(cmsg), sizeof(time_kernel));
+          kernel_time = time_kernel.tv_sec * NANOS_TO_SECS + time_kernel.tv_usec * NANOS_TO_MICROS; // convert timestamp to nanoseconds.
+        }
 
-      const auto user_time = getCurrentNanos();
+        const auto user_time = getCurrentNanos();
 
-      logger_.log("%:% %() % read socket:% len:% utime:% ktime:% diff:%\n", __FILE__, __LINE__, __FUNCTION__,
-                  Common::getCurrentTimeStr(&time_str_), socket_fd_, next_rcv_valid_index_, user_time, kernel_time, (user_time - kernel_time));
-      recv_callback_(this, kernel_time);
+        logger_.log("%:% %() % read socket:% len:% utime:% ktime:% diff:%\n", __FILE__, __LINE__, __FUNCTION__,
+                    Common::getCurrentTimeStr(&time_str_), socket_fd_, inbound_data_.size(), user_time, kernel_time, (user_time - kernel_time));
+        recv_callback_(this, kernel_time);
+      } else if (read_size == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        logger_.log("%:% %() % recv ended socket:% error:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                    socket_fd_, (read_size < 0 ? std::strerror(errno) : "end of stream"));
+        disconnect_ = true;
+      }
+
+      // A read shorter than the space available drained the socket, the next EPOLLIN event sets recv_pending_ again.
+      if (epoll_edge_triggered_ && read_size < static_cast<ssize_t>(iov.iov_len))
+        recv_pending_ = false;
     }
 
-    if (next_send_valid_index_ > 0) {
-      // Non-blocking call to send data.
-      const auto n = ::send(socket_fd_, outbound_data_.data(), next_send_valid_index_, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (outbound_data_.size() > 0) {
+      // Non-blocking call to send data, whatever the kernel does not take now is sent by the next call.
+      const auto n = ::send(socket_fd_, outbound_data_.readData(), outbound_data_.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
       logger_.log("%:% %() % send socket:% len:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), socket_fd_, n);
+      if (n > 0)
+        outbound_data_.updateReadIndex(n);
     }
-    next_send_valid_index_ = 0;
 
     return (read_size > 0);
   }
 
   /// Write outgoing data to the send buffers.
   auto TCPSocket::send(const void *data, size_t len) noexcept -> void {
-    memcpy(outbound_data_.data() + next_send_valid_index_, data, len);
-    next_send_valid_index_ += len;
+    if (UNLIKELY(disconnect_))
+      return;
+    if (UNLIKELY(len > outbound_data_.writeCapacity())) {
+      logger_.log("%:% %() % send buffer full socket:% pending:% dropping:%, disconnecting\n", __FILE__, __LINE__, __FUNCTION__,
+                  Common::getCurrentTimeStr(&time_str_), socket_fd_, outbound_data_.size(), len);
+      disconnect_ = true;
+      return;
+    }
+    memcpy(outbound_data_.writeData(), data, len);
+    outbound_data_.updateWriteIndex(len);
   }
 }
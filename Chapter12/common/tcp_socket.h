@@ -4,16 +4,15 @@
 
 #include "socket_utils.h"
 #include "logging.h"
+#include "mirrored_ring_buffer.h"
 
 namespace Common {
-  /// Size of our send and receive buffers in bytes.
-  constexpr size_t TCPBufferSize = 64 * 1024 * 1024;
+  /// Size of our send and receive buffers in bytes, each connection has one of each.
+  constexpr size_t TCPBufferSize = 1024 * 1024;
 
   struct TCPSocket {
     explicit TCPSocket(Logger &logger)
-        : logger_(logger) {
-      outbound_data_.resize(TCPBufferSize);
-      inbound_data_.resize(TCPBufferSize);
+        : outbound_data_(TCPBufferSize), inbound_data_(TCPBufferSize), logger_(logger) {
     }
 
     /// Create TCPSocket with provided attributes to either listen-on / connect-to.
@@ -23,6 +22,7 @@ namespace Common {
     auto sendAndRecv() noexcept -> bool;
 
     /// Write outgoing data to the send buffers.
+    /// If the peer stopped reading and the send buffer cannot take the data, it is dropped and the socket is marked to be disconnected.
     auto send(const void *data, size_t len) noexcept -> void;
 
     /// Deleted default, copy & move constructors and assignment-operators.
@@ -39,11 +39,27 @@ namespace Common {
     /// File descriptor for the socket.
     int socket_fd_ = -1;
 
-    /// Send and receive buffers and trackers for read/write indices.
-    std::vector<char> outbound_data_;
-    size_t next_send_valid_index_ = 0;
-    std::vector<char> inbound_data_;
-    size_t next_rcv_valid_index_ = 0;
+    /// Send and receive rings. The receive callback parses the bytes in inbound_data_ in place and releases the complete messages it consumed,
+    /// a partial message at the end simply stays there until the rest of it is read. Bytes a send could not write stay in outbound_data_ too.
+    MirroredRingBuffer outbound_data_;
+    MirroredRingBuffer inbound_data_;
+
+    /// Set by TCPServer for the sockets it registers with edge-triggered epoll. recvmsg() is then only called from the EPOLLIN event that
+    /// sets recv_pending_ until a read finds no more data, instead of on every sendAndRecv() call.
+    bool epoll_edge_triggered_ = false;
+    bool recv_pending_ = true;
+
+    /// Set when the connection ended or the send buffer overflowed, everything sent after that is dropped. A TCPServer closes the socket.
+    bool disconnect_ = false;
+
+    /// Used by a TCPServer with an io_uring backend: the socket's slot in the fixed file table, and the number of readable bytes of
+    /// outbound_data_ handed to the kernel by a send that has not completed yet. send() keeps appending after them meanwhile.
+    /// The socket is closed once its multishot receive has ended and no send is in flight, shut_down_ is set once the connection was shut
+    /// down to end that receive.
+    int fixed_file_index_ = -1;
+    size_t send_in_flight_ = 0;
+    bool recv_armed_ = false;
+    bool shut_down_ = false;
 
     /// Socket attributes.
     struct sockaddr_in socket_attrib_{};
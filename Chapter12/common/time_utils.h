@@ -3,8 +3,11 @@
 #include <string>
 #include <chrono>
 #include <ctime>
+#include <ostream>
 
 #include "perf_utils.h"
+#include "tsc_clock.h"
+#include "latency_histogram.h"
 
 namespace Common {
   /// Represent a nanosecond timestamp.
@@ -17,14 +20,14 @@ namespace Common {
   constexpr Nanos NANOS_TO_MILLIS = NANOS_TO_MICROS * MICROS_TO_MILLIS;
   constexpr Nanos NANOS_TO_SECS = NANOS_TO_MILLIS * MILLIS_TO_SECS;
 
-  /// Get current nanosecond timestamp.
-  inline auto getCurrentNanos() noexcept {
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  /// Get current nanosecond timestamp since epoch from the calibrated TSC clock.
+  inline auto getCurrentNanos() noexcept -> Nanos {
+    return tsc_clock.nowNanos();
   }
 
   /// Format current timestamp to a human readable string.
   /// String formatting is inefficient.
-  inline auto& getCurrentTimeStr(std::string* time_str) {
+  inline auto& formatCurrentTimeStr(std::string* time_str) {
     const auto clock = std::chrono::system_clock::now();
     const auto time = std::chrono::system_clock::to_time_t(clock);
 
@@ -34,4 +37,29 @@ namespace Common {
 
     return *time_str;
   }
+
+#if defined(BINARY_LOGGING)
+  /// Time of day argument of a log() call. A BinaryLogger record already carries its rdtsc, so it only stores a marker for this argument and
+  /// log_decoder renders the record's time in its place. It is only formatted when used as text, e.g. streamed to std::cerr.
+  struct LogTimestamp {
+    std::string *time_str_;
+
+    operator const std::string &() const {
+      return formatCurrentTimeStr(time_str_);
+    }
+  };
+
+  inline auto &operator<<(std::ostream &out, const LogTimestamp &timestamp) {
+    return out << static_cast<const std::string &>(timestamp);
+  }
+
+  /// With binary logging the log() call sites do not pay for ctime() and sprintf(), see LogTimestamp.
+  inline auto getCurrentTimeStr(std::string* time_str) noexcept {
+    return LogTimestamp{time_str};
+  }
+#else
+  inline auto& getCurrentTimeStr(std::string* time_str) {
+    return formatCurrentTimeStr(time_str);
+  }
+#endif
 }
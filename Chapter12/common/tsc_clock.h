@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include <cpuid.h>
+#include <time.h>
+
+#include "macros.h"
+#include "perf_utils.h"
+
+namespace Common {
+  /// Minimum duration of the startup calibration of the TSC frequency against CLOCK_MONOTONIC_RAW.
+  constexpr int64_t TSC_CALIBRATION_NANOS = 10 * 1000 * 1000;
+
+  /// Interval at which the LogDrain thread re-anchors the TSC clock to CLOCK_REALTIME and refines its frequency, to correct for drift.
+  constexpr int64_t TSC_RECALIBRATION_NANOS = 1000 * 1000 * 1000;
+
+  /// Largest rate adjustment used to converge the TSC clock to CLOCK_REALTIME, the same 500ppm limit adjtime() slews the system clock with.
+  constexpr double TSC_MAX_SLEW = 0.0005;
+
+  inline auto clockNanos(clockid_t clock_id) noexcept -> int64_t {
+    timespec ts;
+    clock_gettime(clock_id, &ts);
+    return ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
+  }
+
+  /// Wall clock in nanoseconds since epoch computed from rdtsc(), calibrated against CLOCK_MONOTONIC_RAW and anchored to CLOCK_REALTIME.
+  /// Falls back to clock_gettime(CLOCK_REALTIME) if the TSC is not invariant, i.e. its rate changes with frequency scaling or it stops in deep sleep states.
+  /// The mains calibrate it with init() before starting their threads, anything else is calibrated the first time it reads the clock.
+  /// The LogDrain thread re-anchors it while any Logger exists, so nowNanos() is only an rdtsc() and a multiply. It never goes backwards: a
+  /// re-anchor keeps it continuous and slews its rate towards CLOCK_REALTIME, it is only stepped forward when it is behind by more than a slew
+  /// can make up for. Without a Logger it is not re-anchored and keeps the frequency measured by the calibration.
+  class TSCClock final {
+  public:
+    TSCClock() noexcept = default;
+
+    /// Calibrate the clock, busy waiting for TSC_CALIBRATION_NANOS on the calling thread. Only the first call calibrates.
+    auto init() noexcept -> void {
+      std::call_once(calibration_once_, [this]() { calibrate(); });
+    }
+
+    /// True if the cpu reports an invariant TSC or the kernel itself uses the TSC as its clocksource.
+    static auto isTSCInvariant() noexcept -> bool {
+      unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+      if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1 << 8)))
+        return true;
+
+      std::ifstream clocksource("/sys/devices/system/clocksource/clocksource0/current_clocksource");
+      std::string name;
+      return (clocksource >> name) && name == "tsc";
+    }
+
+    /// Current nanoseconds since epoch.
+    auto nowNanos() noexcept -> int64_t {
+      if (UNLIKELY(!calibrated_.load(std::memory_order_acquire)))
+        init();
+      if (UNLIKELY(!use_tsc_))
+        return clockNanos(CLOCK_REALTIME);
+
+      return tscToNanos(rdtsc());
+    }
+
+    /// Convert a difference of two rdtsc() values to nanoseconds. Only approximate if the TSC is not invariant, its rate may have changed since
+    /// the calibration.
+    auto ticksToNanos(uint64_t ticks) noexcept -> int64_t {
+      if (UNLIKELY(!calibrated_.load(std::memory_order_acquire)))
+        init();
+      return static_cast<int64_t>(static_cast<double>(ticks) * nanos_per_tick_.load(std::memory_order_relaxed));
+    }
+
+    auto usesTSC() noexcept {
+      init();
+      return use_tsc_;
+    }
+
+    auto nanosPerTick() noexcept {
+      init();
+      return nanos_per_tick_.load(std::memory_order_relaxed);
+    }
+
+    /// Re-anchor the clock if it was last anchored TSC_RECALIBRATION_NANOS ago or more, called on every pass of the LogDrain thread.
+    /// Does nothing until the clock has been calibrated, and must only be called from one thread.
+    auto reanchorIfDue() noexcept -> void {
+      if (!calibrated_.load(std::memory_order_acquire) || !use_tsc_)
+        return;
+      const auto ticks_since_anchor = rdtsc() - anchor_tsc_.load(std::memory_order_relaxed);
+      if (static_cast<double>(ticks_since_anchor) * nanos_per_tick_.load(std::memory_order_relaxed) >= TSC_RECALIBRATION_NANOS)
+        reanchor();
+    }
+
+    /// Deleted copy & move constructors and assignment-operators.
+    TSCClock(const TSCClock &) = delete;
+
+    TSCClock(const TSCClock &&) = delete;
+
+    TSCClock &operator=(const TSCClock &) = delete;
+
+    TSCClock &operator=(const TSCClock &&) = delete;
+
+  private:
+    /// Measure the TSC frequency and anchor the clock to CLOCK_REALTIME.
+    /// Busy waits instead of sleeping, so the calibration does not depend on how quickly this thread is woken up.
+    /// The frequency is calibrated even if the TSC is not invariant, ticksToNanos() then converts at the frequency during the calibration.
+    auto calibrate() noexcept -> void {
+      use_tsc_ = isTSCInvariant();
+
+      auto [start_tsc, start_raw] = sampleClock(CLOCK_MONOTONIC_RAW);
+      auto [end_tsc, end_raw] = sampleClock(CLOCK_MONOTONIC_RAW);
+      while (end_raw - start_raw < TSC_CALIBRATION_NANOS)
+        std::tie(end_tsc, end_raw) = sampleClock(CLOCK_MONOTONIC_RAW);
+
+      calibration_tsc_ = start_tsc;
+      calibration_raw_ = start_raw;
+      anchor(static_cast<double>(end_raw - start_raw) / static_cast<double>(end_tsc - start_tsc));
+      calibrated_.store(true, std::memory_order_release);
+    }
+
+    /// Convert an rdtsc() value to nanoseconds since epoch with the current anchor.
+    auto tscToNanos(uint64_t tsc) const noexcept -> int64_t {
+      uint64_t seq;
+      int64_t nanos;
+      do {
+        seq = seq_.load(std::memory_order_acquire);
+        const auto ticks_since_anchor = static_cast<int64_t>(tsc - anchor_tsc_.load(std::memory_order_relaxed));
+        nanos = anchor_nanos_.load(std::memory_order_relaxed) +
+                static_cast<int64_t>(static_cast<double>(ticks_since_anchor) * anchor_nanos_per_tick_.load(std::memory_order_relaxed));
+        std::atomic_thread_fence(std::memory_order_acquire);
+      } while (UNLIKELY((seq & 1) || seq != seq_.load(std::memory_order_relaxed)));
+
+      return nanos;
+    }
+
+    /// Read the provided clock and the TSC value at the midpoint of the clock_gettime() call.
+    /// Keeps the tightest of a few attempts, so that an interrupt or preemption in between does not skew the calibration.
+    static auto sampleClock(clockid_t clock_id) noexcept -> std::pair<uint64_t, int64_t> {
+      std::pair<uint64_t, int64_t> best = {0, 0};
+      uint64_t best_window = std::numeric_limits<uint64_t>::max();
+      for (int i = 0; i < 8; ++i) {
+        const auto before = rdtsc();
+        const auto nanos = clockNanos(clock_id);
+        const auto after = rdtsc();
+        if (after - before < best_window) {
+          best_window = after - before;
+          best = {before + (after - before) / 2, nanos};
+        }
+      }
+      return best;
+    }
+
+    /// Anchor the clock to CLOCK_REALTIME with the calibrated frequency, for the first time.
+    auto anchor(double nanos_per_tick) noexcept -> void {
+      const auto [tsc, nanos] = sampleClock(CLOCK_REALTIME);
+      publish(tsc, nanos, nanos_per_tick, nanos_per_tick);
+    }
+
+    /// Refine the frequency over the whole interval since the calibration and re-anchor the clock where it is now, with a rate that makes up for
+    /// its difference to CLOCK_REALTIME by the next re-anchor - within TSC_MAX_SLEW, any more it is behind by is stepped forward.
+    auto reanchor() noexcept -> void {
+      const auto [raw_tsc, raw_nanos] = sampleClock(CLOCK_MONOTONIC_RAW);
+      const auto nanos_per_tick = static_cast<double>(raw_nanos - calibration_raw_) / static_cast<double>(raw_tsc - calibration_tsc_);
+
+      const auto [tsc, realtime_nanos] = sampleClock(CLOCK_REALTIME);
+      auto nanos = tscToNanos(tsc);
+      const auto max_slew_nanos = static_cast<int64_t>(TSC_RECALIBRATION_NANOS * TSC_MAX_SLEW);
+      if (realtime_nanos - nanos > max_slew_nanos)
+        nanos = realtime_nanos - max_slew_nanos;
+      const auto slew = std::clamp(static_cast<double>(realtime_nanos - nanos) / TSC_RECALIBRATION_NANOS, -TSC_MAX_SLEW, TSC_MAX_SLEW);
+
+      publish(tsc, nanos, nanos_per_tick, nanos_per_tick * (1 + slew));
+    }
+
+    /// Publish a new frequency and anchor to readers through the sequence lock.
+    auto publish(uint64_t tsc, int64_t nanos, double nanos_per_tick, double anchor_nanos_per_tick) noexcept -> void {
+      const auto seq = seq_.load(std::memory_order_relaxed);
+      seq_.store(seq + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      nanos_per_tick_.store(nanos_per_tick, std::memory_order_relaxed);
+      anchor_nanos_per_tick_.store(anchor_nanos_per_tick, std::memory_order_relaxed);
+      anchor_tsc_.store(tsc, std::memory_order_relaxed);
+      anchor_nanos_.store(nanos, std::memory_order_relaxed);
+      seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    /// Set once calibrate() has completed, use_tsc_ and the calibration fields are not modified afterwards.
+    std::once_flag calibration_once_;
+    std::atomic<bool> calibrated_ = {false};
+    bool use_tsc_ = false;
+
+    /// Start of the calibration, the frequency is refined over the whole interval since then on every re-anchor.
+    uint64_t calibration_tsc_ = 0;
+    int64_t calibration_raw_ = 0;
+
+    /// Sequence lock protecting the anchor, odd while it is being updated. The fields are atomics only so concurrent reads are not a data race.
+    /// nanos_per_tick_ is the calibrated frequency used for durations, anchor_nanos_per_tick_ the slewed one used for timestamps.
+    std::atomic<uint64_t> seq_ = {0};
+    std::atomic<double> nanos_per_tick_ = {1};
+    std::atomic<double> anchor_nanos_per_tick_ = {1};
+    std::atomic<uint64_t> anchor_tsc_ = {0};
+    std::atomic<int64_t> anchor_nanos_ = {0};
+  };
+
+  /// Process wide TSC clock. Constructing it does nothing, so binaries that never read the clock do not pay for the calibration.
+  inline TSCClock tsc_clock;
+}
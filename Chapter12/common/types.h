@@ -16,6 +16,9 @@ namespace Common {
   constexpr size_t ME_MAX_CLIENT_UPDATES = 256 * 1024;
   constexpr size_t ME_MAX_MARKET_UPDATES = 256 * 1024;
 
+  /// Maximum number of messages drained from a lock free queue in a single batch by the components' main loops.
+  constexpr size_t ME_MAX_QUEUE_BATCH = 128;
+
   /// Maximum trading clients.
   constexpr size_t ME_MAX_NUM_CLIENTS = 256;
 
@@ -1,14 +1,17 @@
 #include <csignal>
+#include <cstdio>
 
 #include "matcher/matching_engine.h"
 #include "market_data/market_data_publisher.h"
 #include "order_server/order_server.h"
+#include "order_server/request_journal.h"
 
 /// Main components, made global to be accessible from the signal handler.
 Common::Logger *logger = nullptr;
-Exchange::MatchingEngine *matching_engine = nullptr;
+std::vector<Exchange::MatchingEngineBase *> matching_engines;
 Exchange::MarketDataPublisher *market_data_publisher = nullptr;
 Exchange::OrderServer *order_server = nullptr;
+Exchange::RequestJournal *request_journal = nullptr;
 
 /// Shut down gracefully on external signals to this server.
 void signal_handler(int) {
@@ -17,51 +20,181 @@ void signal_handler(int) {
 
   delete logger;
   logger = nullptr;
-  delete matching_engine;
-  matching_engine = nullptr;
+  for (auto &matching_engine: matching_engines) {
+    delete matching_engine;
+    matching_engine = nullptr;
+  }
   delete market_data_publisher;
   market_data_publisher = nullptr;
   delete order_server;
   order_server = nullptr;
+  delete request_journal;
+  request_journal = nullptr;
 
   std::this_thread::sleep_for(10s);
 
   exit(EXIT_SUCCESS);
 }
 
-int main(int, char **) {
+/// Create and start one matching engine shard using OrderBookT for its order books, with the provided clients' self-trade prevention modes.
+/// If OrderBookT can be checkpointed, the shard's last checkpoint is loaded and the shard checkpoints its order books every checkpoint_interval
+/// requests, never if it is 0. The journaled requests of the previous run not covered by the checkpoint are replayed into it, and the orders left
+/// resting are then canceled since their clients' sessions ended with the previous run. The market data publisher publishes the market updates
+/// as usual, the client responses are dropped since no client is connected yet.
+/// With reset_journal the shard's checkpoint is deleted and its request count restarted, for the caller to reset request_journal once every shard
+/// is started. Otherwise the cancels are appended to request_journal.
+template<typename OrderBookT>
+auto startMatchingEngine(Exchange::ClientRequestLFQueue *client_requests, Exchange::ClientResponseLFQueue *client_responses,
+                         Exchange::MEMarketUpdateLFQueue *market_updates, size_t shard, size_t num_shards, int core_id,
+                         const std::vector<std::pair<ClientId, Exchange::SelfTradePrevention>> &self_trade_prevention,
+                         Exchange::RequestJournal *request_journal, std::span<const Exchange::MEClientRequest> journaled_requests,
+                         bool reset_journal, size_t checkpoint_interval) -> Exchange::MatchingEngineBase * {
+  auto matching_engine = new Exchange::MatchingEngine<OrderBookT>(client_requests, client_responses, market_updates, shard, num_shards);
+  for (const auto &[client_id, client_self_trade_prevention]: self_trade_prevention)
+    matching_engine->setSelfTradePrevention(client_id, client_self_trade_prevention);
+
+  const auto drop_client_responses = [client_responses]() {
+    for (auto responses = client_responses->getNextBatchToRead(ME_MAX_QUEUE_BATCH); !responses.empty();
+         responses = client_responses->getNextBatchToRead(ME_MAX_QUEUE_BATCH))
+      client_responses->updateReadIndex(responses.size());
+  };
+  const auto checkpoint_file = "exchange_checkpoint_" + std::to_string(shard) + ".bin";
+  if constexpr (Exchange::CheckpointableOrderBook<OrderBookT>) {
+    matching_engine->enableCheckpoints(checkpoint_file, checkpoint_interval);
+    matching_engine->restoreCheckpoint(journaled_requests, drop_client_responses);
+  }
+  matching_engine->replay(journaled_requests, drop_client_responses);
+  const auto cancels = matching_engine->cancelOrders(drop_client_responses);
+  if (reset_journal) {
+    // Deleted before the journal is reset, a checkpoint of the previous run would otherwise be loaded on top of a later one.
+    std::remove(checkpoint_file.c_str());
+    matching_engine->resetProcessedRequests();
+  } else
+    request_journal->append(cancels);
+  matching_engine->start(core_id);
+  return matching_engine;
+}
+
+/// Usage: exchange_main [ORDER_BOOK [NUM_MATCHING_SHARDS [CORE_SHARD_0 CORE_SHARD_1 ...]]]
+/// ORDER_BOOK is the order book implementation used by the matching engine - MEOrderBook (default), LadderMEOrderBook or UnorderedMapMEOrderBook.
+/// Tickers are split across NUM_MATCHING_SHARDS matching engine threads (1 by default), each optionally pinned to a core (-1 to not pin).
+/// Every sequenced client request is journaled to exchange_requests.journal, on startup the requests in it are replayed to rebuild the order books
+/// before clients can connect, and every order still resting is canceled - clients start a new session with new sequence numbers and order ids.
+/// The replay publishes the market updates of the previous run followed by the cancels. The journal is then reset unless reset_journal is
+/// turned off, so it only holds the requests of the current run. Delete the file to start without replaying the previous run.
+/// With MEOrderBook and a non-zero checkpoint_interval every shard also checkpoints its order books to exchange_checkpoint_SHARD.bin, and on
+/// startup loads its checkpoint and only replays the journaled requests after it. The checkpoints have to be deleted along with the journal,
+/// resetting the journal deletes them.
+/// The process then uses transparent huge pages instead of the hugetlb pool.
+int main(int argc, char **argv) {
+  const std::string order_book = (argc > 1 ? argv[1] : "MEOrderBook");
+  ASSERT(order_book == "MEOrderBook" || order_book == "LadderMEOrderBook" || order_book == "UnorderedMapMEOrderBook",
+         "ORDER_BOOK must be one of MEOrderBook, LadderMEOrderBook or UnorderedMapMEOrderBook, not " + order_book);
+
+  // Number of client requests each MEOrderBook shard processes between two checkpoints of its order books, 0 to not write checkpoints.
+  // Shards fork() to write their checkpoints, nothing in the process can be on hugetlb pages then - not only the order books, the matching
+  // engine thread also writes to the queues and its logger's buffers while the child runs. Checkpointing moves the whole process to
+  // transparent huge pages, so it is off unless explicitly set here.
+  const size_t checkpoint_interval = 0;
+
+  // Reset the journal once the startup replay has canceled every order, nothing before the restart is needed to rebuild the order books then and
+  // the market order ids start over from 1. Turned off, the journal keeps the requests of every run including the startup cancels, and grows
+  // across restarts until it is full and the exchange aborts - it then has to be deleted along with the checkpoints.
+  const bool reset_journal = true;
+  OptCommon::setHugeTlbEnabled(!(order_book == "MEOrderBook" && checkpoint_interval));
+
+  // Core the LogDrain thread writing every component's log file and re-anchoring the TSC clock is pinned to, e.g. a housekeeping core away
+  // from the matching engine shards. -1 leaves it unpinned. It has to be set before the first Logger starts the thread.
+  const int log_drain_core = -1;
+  Common::logDrain().setCore(log_drain_core);
+
+  // Calibrate the TSC clock here rather than the first time a component thread reads it.
+  Common::tsc_clock.init();
+
   logger = new Common::Logger("exchange_main.log");
+  Common::dumpLatencyHistogramsAtExit("exchange_latency_histograms.txt");
 
   std::signal(SIGINT, signal_handler);
 
   const int sleep_time = 100 * 1000;
 
+  const size_t num_shards = (argc > 2 ? std::atoi(argv[2]) : 1);
+  ASSERT(num_shards >= 1 && num_shards <= Exchange::ME_MAX_MATCHING_SHARDS,
+         "NUM_MATCHING_SHARDS must be between 1 and " + std::to_string(Exchange::ME_MAX_MATCHING_SHARDS));
+
+  // Self-trade prevention mode of the clients whose aggressive orders must not match their own passive orders, the others trade freely.
+  const std::vector<std::pair<ClientId, Exchange::SelfTradePrevention>> self_trade_prevention = {};
+
+  // Network I/O mechanism of the order server, IO_URING and IO_URING_SQPOLL avoid the per socket system calls of EPOLL.
+  const auto order_server_backend = Common::TCPServerBackend::EPOLL;
+
   // The lock free queues to facilitate communication between order server <-> matching engine and matching engine -> market data publisher.
-  Exchange::ClientRequestLFQueue client_requests(ME_MAX_CLIENT_UPDATES);
-  Exchange::ClientResponseLFQueue client_responses(ME_MAX_CLIENT_UPDATES);
-  Exchange::MEMarketUpdateLFQueue market_updates(ME_MAX_MARKET_UPDATES);
+  // Every matching engine shard has its own set of queues.
+  std::vector<Exchange::ClientRequestLFQueue *> client_requests;
+  std::vector<Exchange::ClientResponseLFQueue *> client_responses;
+  std::vector<Exchange::MEMarketUpdateLFQueue *> market_updates;
 
   std::string time_str;
 
-  logger->log("%:% %() % Starting Matching Engine...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str));
-  matching_engine = new Exchange::MatchingEngine(&client_requests, &client_responses, &market_updates);
-  matching_engine->start();
+  const auto shard_core_id = [argc, argv](size_t shard) {
+    return (argc > static_cast<int>(3 + shard) ? std::atoi(argv[3 + shard]) : -1);
+  };
+
+  // A shard's queues, order books and logger are placed on the NUMA node of the core its matching engine thread is pinned to, not the main thread's.
+  for (size_t shard = 0; shard < num_shards; ++shard) {
+    OptCommon::NumaNodeScope numa_node_scope(OptCommon::numaNodeOfCpu(shard_core_id(shard)));
+    client_requests.push_back(new Exchange::ClientRequestLFQueue(ME_MAX_CLIENT_UPDATES));
+    client_responses.push_back(new Exchange::ClientResponseLFQueue(ME_MAX_CLIENT_UPDATES));
+    market_updates.push_back(new Exchange::MEMarketUpdateLFQueue(ME_MAX_MARKET_UPDATES));
+  }
 
   const std::string mkt_pub_iface = "lo";
   const std::string snap_pub_ip = "233.252.14.1", inc_pub_ip = "233.252.14.3";
   const int snap_pub_port = 20000, inc_pub_port = 20001;
 
   logger->log("%:% %() % Starting Market Data Publisher...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str));
-  market_data_publisher = new Exchange::MarketDataPublisher(&market_updates, mkt_pub_iface, snap_pub_ip, snap_pub_port, inc_pub_ip, inc_pub_port);
+  market_data_publisher = new Exchange::MarketDataPublisher(market_updates, mkt_pub_iface, snap_pub_ip, snap_pub_port, inc_pub_ip, inc_pub_port);
   market_data_publisher->start();
 
+  request_journal = new Exchange::RequestJournal("exchange_requests.journal");
+  const auto journaled_requests = request_journal->recoveredRequests();
+  logger->log("%:% %() % Replaying % journaled requests...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str),
+              journaled_requests.size());
+
+  for (size_t shard = 0; shard < num_shards; ++shard) {
+    const int core_id = shard_core_id(shard);
+    OptCommon::NumaNodeScope numa_node_scope(OptCommon::numaNodeOfCpu(core_id));
+    logger->log("%:% %() % Starting Matching Engine order-book:% shard:% of:% core:% checkpoint-interval:%...\n", __FILE__, __LINE__, __FUNCTION__,
+                Common::getCurrentTimeStr(&time_str), order_book, shard, num_shards, core_id, checkpoint_interval);
+    if (order_book == "LadderMEOrderBook")
+      matching_engines.push_back(startMatchingEngine<Exchange::LadderMEOrderBook>(client_requests[shard], client_responses[shard], market_updates[shard],
+                                                                                  shard, num_shards, core_id, self_trade_prevention, request_journal,
+                                                                                  journaled_requests, reset_journal, checkpoint_interval));
+    else if (order_book == "UnorderedMapMEOrderBook")
+      matching_engines.push_back(startMatchingEngine<Exchange::UnorderedMapMEOrderBook>(client_requests[shard], client_responses[shard],
+                                                                                        market_updates[shard], shard, num_shards, core_id,
+                                                                                        self_trade_prevention, request_journal, journaled_requests,
+                                                                                        reset_journal, checkpoint_interval));
+    else
+      matching_engines.push_back(startMatchingEngine<Exchange::MEOrderBook>(client_requests[shard], client_responses[shard], market_updates[shard],
+                                                                            shard, num_shards, core_id, self_trade_prevention, request_journal,
+                                                                            journaled_requests, reset_journal, checkpoint_interval));
+  }
+
+  if (reset_journal)
+    request_journal->reset();
+  request_journal->start();
+
   const std::string order_gw_iface = "lo";
   const int order_gw_port = 12345;
 
   logger->log("%:% %() % Starting Order Server...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str));
-  order_server = new Exchange::OrderServer(&client_requests, &client_responses, order_gw_iface, order_gw_port);
+  order_server = new Exchange::OrderServer(client_requests, client_responses, order_gw_iface, order_gw_port, request_journal->requestQueue(),
+                                           order_server_backend);
   order_server->start();
 
+  logger->log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str), OptCommon::hugePageReport());
+
   while (true) {
     logger->log("%:% %() % Sleeping for a few milliseconds..\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str));
     usleep(sleep_time * 1000);
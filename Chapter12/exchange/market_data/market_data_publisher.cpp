@@ -1,7 +1,7 @@
 #include "market_data_publisher.h"
 
 namespace Exchange {
-  MarketDataPublisher::MarketDataPublisher(MEMarketUpdateLFQueue *market_updates, const std::string &iface,
+  MarketDataPublisher::MarketDataPublisher(const std::vector<MEMarketUpdateLFQueue *> &market_updates, const std::string &iface,
                                            const std::string &snapshot_ip, int snapshot_port,
                                            const std::string &incremental_ip, int incremental_port)
       : outgoing_md_updates_(market_updates), snapshot_md_updates_(ME_MAX_MARKET_UPDATES),
@@ -15,31 +15,35 @@ namespace Exchange {
   auto MarketDataPublisher::run() noexcept -> void {
     logger_.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_));
     while (run_) {
-      for (auto market_update = outgoing_md_updates_->getNextToRead();
-           outgoing_md_updates_->size() && market_update; market_update = outgoing_md_updates_->getNextToRead()) {
-        TTT_MEASURE(T5_MarketDataPublisher_LFQueue_read, logger_);
-
-        logger_.log("%:% %() % Sending seq:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), next_inc_seq_num_,
-                    market_update->toString().c_str());
-
-        START_MEASURE(Exchange_McastSocket_send);
-        incremental_socket_.send(&next_inc_seq_num_, sizeof(next_inc_seq_num_));
-        incremental_socket_.send(market_update, sizeof(MEMarketUpdate));
-        END_MEASURE(Exchange_McastSocket_send, logger_);
-
-        outgoing_md_updates_->updateReadIndex();
-        TTT_MEASURE(T6_MarketDataPublisher_UDP_write, logger_);
-
-        // Forward this incremental market data update the snapshot synthesizer.
-        auto next_write = snapshot_md_updates_.getNextToWriteTo();
-        next_write->seq_num_ = next_inc_seq_num_;
-        next_write->me_market_update_ = *market_update;
-        snapshot_md_updates_.updateWriteIndex();
-
-        ++next_inc_seq_num_;
+      for (auto outgoing_md_updates: outgoing_md_updates_) {
+        const auto market_updates = outgoing_md_updates->getNextBatchToRead(ME_MAX_QUEUE_BATCH);
+        for (const auto &me_market_update: market_updates) {
+          const auto market_update = &me_market_update;
+          TTT_MEASURE(T5_MarketDataPublisher_LFQueue_read, logger_);
+
+          logger_.log("%:% %() % Sending seq:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), next_inc_seq_num_,
+                      market_update->toString().c_str());
+
+          START_MEASURE(Exchange_McastSocket_send);
+          addToPacket(market_update);
+          END_MEASURE(Exchange_McastSocket_send, logger_);
+
+          TTT_MEASURE(T6_MarketDataPublisher_UDP_write, logger_);
+
+          // Forward this incremental market data update the snapshot synthesizer.
+          auto next_write = snapshot_md_updates_.getNextToWriteTo();
+          next_write->seq_num_ = next_inc_seq_num_;
+          next_write->me_market_update_ = *market_update;
+          snapshot_md_updates_.updateWriteIndex();
+
+          ++next_inc_seq_num_;
+        }
+        if (!market_updates.empty())
+          outgoing_md_updates->updateReadIndex(market_updates.size());
       }
 
-      // Publish to the multicast stream.
+      // Publish to the multicast stream, the last packet ends with the batch even if it is not full.
+      endPacket();
       incremental_socket_.sendAndRecv();
     }
   }
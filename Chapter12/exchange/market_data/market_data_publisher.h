@@ -7,7 +7,8 @@
 namespace Exchange {
   class MarketDataPublisher {
   public:
-    MarketDataPublisher(MEMarketUpdateLFQueue *market_updates, const std::string &iface,
+    /// One market update queue per matching engine shard.
+    MarketDataPublisher(const std::vector<MEMarketUpdateLFQueue *> &market_updates, const std::string &iface,
                         const std::string &snapshot_ip, int snapshot_port,
                         const std::string &incremental_ip, int incremental_port);
 
@@ -54,8 +55,9 @@ namespace Exchange {
     /// Sequencer number tracker on the incremental market data stream.
     size_t next_inc_seq_num_ = 1;
 
-    /// Lock free queue from which we consume market data updates sent by the matching engine.
-    MEMarketUpdateLFQueue *outgoing_md_updates_ = nullptr;
+    /// Lock free queues from which we consume market data updates sent by the matching engine shards.
+    /// Updates for a ticker all come from the same shard, so they are published in the order the matching engine generated them.
+    std::vector<MEMarketUpdateLFQueue *> outgoing_md_updates_;
 
     /// Lock free queue on which we forward the incremental market data updates to send to the snapshot synthesizer.
     MDPMarketUpdateLFQueue snapshot_md_updates_;
@@ -68,7 +70,36 @@ namespace Exchange {
     /// Multicast socket to represent the incremental market data stream.
     Common::McastSocket incremental_socket_;
 
+    /// Offset in the incremental socket's send buffers of the header of the packet being built, and the number of market updates in it so far.
+    size_t packet_header_index_ = 0;
+    uint16_t packet_num_updates_ = 0;
+
     /// Snapshot synthesizer which synthesizes and publishes limit order book snapshots on the snapshot multicast stream.
     SnapshotSynthesizer *snapshot_synthesizer_ = nullptr;
+
+  private:
+    /// Copy the market update with sequence number next_inc_seq_num_ into the packet being built, starting a new packet if there is none.
+    /// A packet that reaches MDP_MAX_PACKET_UPDATES market updates is ended right away.
+    auto addToPacket(const MEMarketUpdate *market_update) noexcept {
+      if (!packet_num_updates_) {
+        packet_header_index_ = incremental_socket_.next_send_valid_index_;
+        const MDPPacketHeader packet_header{next_inc_seq_num_, 0};
+        incremental_socket_.send(&packet_header, sizeof(MDPPacketHeader));
+      }
+
+      incremental_socket_.send(market_update, sizeof(MEMarketUpdate));
+      if (UNLIKELY(++packet_num_updates_ == MDP_MAX_PACKET_UPDATES))
+        endPacket();
+    }
+
+    /// Write the number of market updates into the header of the packet being built and end its datagram, if there is one.
+    auto endPacket() noexcept -> void {
+      if (!packet_num_updates_)
+        return;
+
+      reinterpret_cast<MDPPacketHeader *>(incremental_socket_.outbound_data_.data() + packet_header_index_)->num_updates_ = packet_num_updates_;
+      incremental_socket_.endDatagram();
+      packet_num_updates_ = 0;
+    }
   };
 }
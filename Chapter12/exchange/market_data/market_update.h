@@ -3,7 +3,7 @@
 #include <sstream>
 
 #include "common/types.h"
-#include "common/lf_queue.h"
+#include "common/opt_lf_queue.h"
 
 using namespace Common;
 
@@ -88,9 +88,32 @@ namespace Exchange {
     }
   };
 
+  /// Header of a packet on the incremental market data stream, followed by num_updates_ market updates whose sequence numbers are consecutive,
+  /// starting at seq_num_. Every packet is a single datagram.
+  struct MDPPacketHeader {
+    size_t seq_num_ = 0;
+    uint16_t num_updates_ = 0;
+
+    auto toString() const {
+      std::stringstream ss;
+      ss << "MDPPacketHeader"
+         << " ["
+         << " seq:" << seq_num_
+         << " updates:" << num_updates_
+         << "]";
+      return ss.str();
+    }
+  };
+
 #pragma pack(pop) // Undo the packed binary structure directive moving forward.
 
+  /// Largest incremental market data packet, so that a packet fits in a single 1500 byte Ethernet frame after the IP and UDP headers.
+  constexpr size_t MDP_MAX_PACKET_SIZE = 1500 - 20 - 8;
+
+  /// Maximum number of market updates in an incremental market data packet.
+  constexpr size_t MDP_MAX_PACKET_UPDATES = (MDP_MAX_PACKET_SIZE - sizeof(MDPPacketHeader)) / sizeof(MEMarketUpdate);
+
   /// Lock free queues of matching engine market update messages and market data publisher market updates messages respectively.
-  typedef Common::LFQueue<Exchange::MEMarketUpdate> MEMarketUpdateLFQueue;
-  typedef Common::LFQueue<Exchange::MDPMarketUpdate> MDPMarketUpdateLFQueue;
+  typedef OptCommon::OptLFQueue<Exchange::MEMarketUpdate> MEMarketUpdateLFQueue;
+  typedef OptCommon::OptLFQueue<Exchange::MDPMarketUpdate> MDPMarketUpdateLFQueue;
 }
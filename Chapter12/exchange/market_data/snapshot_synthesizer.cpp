@@ -44,6 +44,7 @@ namespace Exchange {
 
         order->qty_ = me_market_update.qty_;
         order->price_ = me_market_update.price_;
+        order->priority_ = me_market_update.priority_;
       }
         break;
       case MarketUpdateType::CANCEL: {
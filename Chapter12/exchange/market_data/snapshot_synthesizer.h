@@ -2,10 +2,11 @@
 
 #include "common/types.h"
 #include "common/thread_utils.h"
-#include "common/lf_queue.h"
+#include "common/opt_lf_queue.h"
 #include "common/macros.h"
 #include "common/mcast_socket.h"
-#include "common/mem_pool.h"
+#include "common/free_list_mem_pool.h"
+#include "common/huge_page_allocator.h"
 #include "common/logging.h"
 
 #include "market_data/market_update.h"
@@ -14,7 +15,8 @@
 using namespace Common;
 
 namespace Exchange {
-  class SnapshotSynthesizer {
+  /// Its ticker-id x order-id lookup table makes it very large and mostly sparse, see OptCommon::HugePageObject.
+  class SnapshotSynthesizer : public OptCommon::HugePageObject {
   public:
     SnapshotSynthesizer(MDPMarketUpdateLFQueue *market_updates, const std::string &iface,
                         const std::string &snapshot_ip, int snapshot_port);
@@ -65,6 +67,6 @@ namespace Exchange {
     Nanos last_snapshot_time_ = 0;
 
     /// Memory pool to manage MEMarketUpdate messages for the orders in the snapshot limit order books.
-    MemPool<MEMarketUpdate> order_pool_;
+    OptCommon::FreeListMemPool<MEMarketUpdate> order_pool_;
   };
 }
@@ -0,0 +1,334 @@
+#include "ladder_me_order_book.h"
+
+#include "matcher/matching_engine.h"
+
+namespace Exchange {
+  LadderMEOrderBook::LadderMEOrderBook(TickerId ticker_id, Logger *logger, MatchingEngineBase *matching_engine, FillReporting fill_reporting,
+                                       size_t order_index_capacity)
+      : ticker_id_(ticker_id), matching_engine_(matching_engine), fill_reporting_(fill_reporting), cid_oid_to_order_(order_index_capacity),
+        order_pool_(ME_MAX_ORDER_IDS), logger_(logger) {
+  }
+
+  LadderMEOrderBook::~LadderMEOrderBook() {
+    logger_->log("%:% %() % OrderBook\n%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                toString(false, true));
+
+    matching_engine_ = nullptr;
+    best_bid_price_ = best_ask_price_ = Price_INVALID;
+  }
+
+  /// Match a new aggressive order with the provided parameters against a passive order held in the bid_itr object and generate client responses and market updates for the match.
+  /// It will update the passive order (bid_itr) based on the match and possibly remove it if fully matched.
+  /// It will return remaining quantity on the aggressive order in the leaves_qty parameter.
+  auto LadderMEOrderBook::match(TickerId ticker_id, ClientId client_id, Side side, OrderId client_order_id, OrderId new_market_order_id, MEOrder* itr, Qty* leaves_qty,
+                                bool report_per_level) noexcept {
+    const auto order = itr;
+    const auto order_qty = order->qty_;
+    const auto fill_qty = std::min(*leaves_qty, order_qty);
+
+    *leaves_qty -= fill_qty;
+    order->qty_ -= fill_qty;
+    ladder(order->side_).level_qty_[MEPriceLadder::priceToIndex(order->price_)] -= fill_qty;
+
+    if (LIKELY(!report_per_level)) {
+      client_response_ = {ClientResponseType::FILLED, client_id, ticker_id, client_order_id,
+                          new_market_order_id, side, itr->price_, fill_qty, *leaves_qty};
+      matching_engine_->sendClientResponse(&client_response_);
+    }
+
+    client_response_ = {ClientResponseType::FILLED, order->client_id_, ticker_id, order->client_order_id_,
+                        order->market_order_id_, order->side_, itr->price_, fill_qty, order->qty_};
+    matching_engine_->sendClientResponse(&client_response_);
+
+    if (LIKELY(!report_per_level)) {
+      market_update_ = {MarketUpdateType::TRADE, OrderId_INVALID, ticker_id, side, itr->price_, fill_qty, Priority_INVALID};
+      matching_engine_->sendMarketUpdate(&market_update_);
+    }
+
+    if (!order->qty_) {
+      market_update_ = {MarketUpdateType::CANCEL, order->market_order_id_, ticker_id, order->side_,
+                        order->price_, order_qty, Priority_INVALID};
+      matching_engine_->sendMarketUpdate(&market_update_);
+
+      START_MEASURE(Exchange_LadderMEOrderBook_removeOrder);
+      removeOrder(order);
+      END_MEASURE(Exchange_LadderMEOrderBook_removeOrder, (*logger_));
+    } else {
+      market_update_ = {MarketUpdateType::MODIFY, order->market_order_id_, ticker_id, order->side_,
+                        order->price_, order->qty_, order->priority_};
+      matching_engine_->sendMarketUpdate(&market_update_);
+    }
+  }
+
+  /// Check if a new order with the provided attributes would match against existing passive orders on the other side of the order book.
+  /// This will call the match() method to perform the match if there is a match to be made and return the quantity remaining if any on this new order.
+  auto LadderMEOrderBook::checkForMatch(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty, Qty new_market_order_id) noexcept {
+    auto leaves_qty = qty;
+
+    // With FillReporting::PER_LEVEL, the quantity already reported for the current price level that the passive orders have not matched yet.
+    Qty level_unmatched_qty = 0;
+
+    // Self-trade prevention can stop the aggressive order part way through a price level, so its fills are then reported per order.
+    const auto self_trade_prevention = matching_engine_->selfTradePrevention(client_id);
+    const auto report_per_level = (fill_reporting_ == FillReporting::PER_LEVEL && self_trade_prevention == SelfTradePrevention::NONE);
+
+    if (side == Side::BUY) {
+      while (leaves_qty && best_ask_price_ != Price_INVALID) {
+        if (LIKELY(price < best_ask_price_)) {
+          break;
+        }
+
+        const auto ask_itr = getFirstOrder(Side::SELL, best_ask_price_);
+
+        if (UNLIKELY(self_trade_prevention != SelfTradePrevention::NONE && ask_itr->client_id_ == client_id)) {
+          preventSelfTrade(self_trade_prevention, ticker_id, client_id, side, client_order_id, new_market_order_id, price, ask_itr, &leaves_qty);
+          continue;
+        }
+
+        if (UNLIKELY(report_per_level && !level_unmatched_qty)) {
+          level_unmatched_qty = std::min(leaves_qty, asks_.level_qty_[MEPriceLadder::priceToIndex(best_ask_price_)]);
+          reportLevelFill(ticker_id, client_id, side, client_order_id, new_market_order_id, best_ask_price_, level_unmatched_qty,
+                          leaves_qty - level_unmatched_qty);
+        }
+
+        const auto prev_leaves_qty = leaves_qty;
+        START_MEASURE(Exchange_LadderMEOrderBook_match);
+        match(ticker_id, client_id, side, client_order_id, new_market_order_id, ask_itr, &leaves_qty, report_per_level);
+        END_MEASURE(Exchange_LadderMEOrderBook_match, (*logger_));
+        level_unmatched_qty -= std::min(level_unmatched_qty, prev_leaves_qty - leaves_qty);
+      }
+    }
+    if (side == Side::SELL) {
+      while (leaves_qty && best_bid_price_ != Price_INVALID) {
+        if (LIKELY(price > best_bid_price_)) {
+          break;
+        }
+
+        const auto bid_itr = getFirstOrder(Side::BUY, best_bid_price_);
+
+        if (UNLIKELY(self_trade_prevention != SelfTradePrevention::NONE && bid_itr->client_id_ == client_id)) {
+          preventSelfTrade(self_trade_prevention, ticker_id, client_id, side, client_order_id, new_market_order_id, price, bid_itr, &leaves_qty);
+          continue;
+        }
+
+        if (UNLIKELY(report_per_level && !level_unmatched_qty)) {
+          level_unmatched_qty = std::min(leaves_qty, bids_.level_qty_[MEPriceLadder::priceToIndex(best_bid_price_)]);
+          reportLevelFill(ticker_id, client_id, side, client_order_id, new_market_order_id, best_bid_price_, level_unmatched_qty,
+                          leaves_qty - level_unmatched_qty);
+        }
+
+        const auto prev_leaves_qty = leaves_qty;
+        START_MEASURE(Exchange_LadderMEOrderBook_match);
+        match(ticker_id, client_id, side, client_order_id, new_market_order_id, bid_itr, &leaves_qty, report_per_level);
+        END_MEASURE(Exchange_LadderMEOrderBook_match, (*logger_));
+        level_unmatched_qty -= std::min(level_unmatched_qty, prev_leaves_qty - leaves_qty);
+      }
+    }
+
+    return leaves_qty;
+  }
+
+  /// Create and add a new order in the order book with provided attributes.
+  /// It will check to see if this new order matches an existing passive order with opposite side, and perform the matching if that is the case.
+  auto LadderMEOrderBook::add(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty) noexcept -> void {
+    const auto new_market_order_id = generateNewMarketOrderId();
+    client_response_ = {ClientResponseType::ACCEPTED, client_id, ticker_id, client_order_id, new_market_order_id, side, price, 0, qty};
+    matching_engine_->sendClientResponse(&client_response_);
+
+    START_MEASURE(Exchange_LadderMEOrderBook_checkForMatch);
+    const auto leaves_qty = checkForMatch(client_id, client_order_id, ticker_id, side, price, qty, new_market_order_id);
+    END_MEASURE(Exchange_LadderMEOrderBook_checkForMatch, (*logger_));
+
+    if (LIKELY(leaves_qty)) {
+      auto &price_ladder = ladder(side);
+      if (UNLIKELY(!price_ladder.contains(price) && !price_ladder.recenter(price))) {
+        logger_->log("%:% %() % Canceling order outside of the price ladder price:% base:% levels:%\n", __FILE__, __LINE__, __FUNCTION__,
+                     Common::getCurrentTimeStr(&time_str_), price, price_ladder.base_price_, price_ladder.num_levels_);
+        client_response_ = {ClientResponseType::CANCELED, client_id, ticker_id, client_order_id, new_market_order_id,
+                            side, price, Qty_INVALID, leaves_qty};
+        matching_engine_->sendClientResponse(&client_response_);
+        return;
+      }
+
+      const auto priority = getNextPriority(side, price);
+
+      auto order = order_pool_.allocate(ticker_id, client_id, client_order_id, new_market_order_id, side, price, leaves_qty, priority, nullptr,
+                                        nullptr);
+      START_MEASURE(Exchange_LadderMEOrderBook_addOrder);
+      addOrder(order);
+      END_MEASURE(Exchange_LadderMEOrderBook_addOrder, (*logger_));
+
+      market_update_ = {MarketUpdateType::ADD, new_market_order_id, ticker_id, side, price, leaves_qty, priority};
+      matching_engine_->sendMarketUpdate(&market_update_);
+    }
+  }
+
+  /// Match a new order that never rests in the order book, quantity that does not match immediately is canceled.
+  auto LadderMEOrderBook::addImmediate(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty,
+                                       TimeInForce time_in_force) noexcept -> void {
+    const auto new_market_order_id = generateNewMarketOrderId();
+    client_response_ = {ClientResponseType::ACCEPTED, client_id, ticker_id, client_order_id, new_market_order_id, side, clientPrice(price), 0, qty};
+    matching_engine_->sendClientResponse(&client_response_);
+
+    auto leaves_qty = qty;
+    if (LIKELY(time_in_force != TimeInForce::FOK || canFill(client_id, matching_engine_->selfTradePrevention(client_id), side, price, qty))) {
+      START_MEASURE(Exchange_LadderMEOrderBook_checkForMatch);
+      leaves_qty = checkForMatch(client_id, client_order_id, ticker_id, side, price, qty, new_market_order_id);
+      END_MEASURE(Exchange_LadderMEOrderBook_checkForMatch, (*logger_));
+    }
+
+    if (leaves_qty) {
+      client_response_ = {ClientResponseType::CANCELED, client_id, ticker_id, client_order_id, new_market_order_id,
+                          side, clientPrice(price), Qty_INVALID, leaves_qty};
+      matching_engine_->sendClientResponse(&client_response_);
+    }
+  }
+
+  /// Attempt to cancel an order in the order book, issue a cancel-rejection if order does not exist.
+  auto LadderMEOrderBook::cancel(ClientId client_id, OrderId order_id, TickerId ticker_id) noexcept -> void {
+    const auto order_itr = cid_oid_to_order_.find({client_id, order_id});
+    MEOrder *exchange_order = (order_itr ? *order_itr : nullptr);
+    const auto is_cancelable = (exchange_order != nullptr);
+
+    if (UNLIKELY(!is_cancelable)) {
+      client_response_ = {ClientResponseType::CANCEL_REJECTED, client_id, ticker_id, order_id, OrderId_INVALID,
+                          Side::INVALID, Price_INVALID, Qty_INVALID, Qty_INVALID};
+    } else {
+      client_response_ = {ClientResponseType::CANCELED, client_id, ticker_id, order_id, exchange_order->market_order_id_,
+                          exchange_order->side_, exchange_order->price_, Qty_INVALID, exchange_order->qty_};
+      market_update_ = {MarketUpdateType::CANCEL, exchange_order->market_order_id_, ticker_id, exchange_order->side_, exchange_order->price_, 0,
+                        exchange_order->priority_};
+
+      START_MEASURE(Exchange_LadderMEOrderBook_removeOrder);
+      removeOrder(exchange_order);
+      END_MEASURE(Exchange_LadderMEOrderBook_removeOrder, (*logger_));
+
+      matching_engine_->sendMarketUpdate(&market_update_);
+    }
+
+    matching_engine_->sendClientResponse(&client_response_);
+  }
+
+  /// Change the price and / or quantity of an order in the order book, issue a modify-rejection if order does not exist.
+  auto LadderMEOrderBook::modify(ClientId client_id, OrderId order_id, TickerId ticker_id, Side side, Price price, Qty qty) noexcept -> void {
+    const auto order_itr = cid_oid_to_order_.find({client_id, order_id});
+    MEOrder *exchange_order = (order_itr ? *order_itr : nullptr);
+    auto is_modifiable = (exchange_order != nullptr && exchange_order->side_ == side && price != Price_INVALID && qty && qty != Qty_INVALID);
+    if (LIKELY(is_modifiable)) {
+      auto &price_ladder = ladder(side);
+      is_modifiable = (price_ladder.contains(price) || price_ladder.recenter(price));
+    }
+
+    if (UNLIKELY(!is_modifiable)) {
+      client_response_ = {ClientResponseType::MODIFY_REJECTED, client_id, ticker_id, order_id, OrderId_INVALID,
+                          side, price, Qty_INVALID, Qty_INVALID};
+      matching_engine_->sendClientResponse(&client_response_);
+      return;
+    }
+
+    const auto market_order_id = exchange_order->market_order_id_;
+    client_response_ = {ClientResponseType::MODIFIED, client_id, ticker_id, order_id, market_order_id, side, price, 0, qty};
+    matching_engine_->sendClientResponse(&client_response_);
+
+    if (price == exchange_order->price_ && qty <= exchange_order->qty_) { // quantity decrease, keeps its place in the FIFO queue.
+      ladder(side).level_qty_[MEPriceLadder::priceToIndex(price)] -= (exchange_order->qty_ - qty);
+      exchange_order->qty_ = qty;
+      market_update_ = {MarketUpdateType::MODIFY, market_order_id, ticker_id, side, price, qty, exchange_order->priority_};
+      matching_engine_->sendMarketUpdate(&market_update_);
+      return;
+    }
+
+    // The order is re-inserted with its market order id kept. Market data sees a single MODIFY with the new price and priority,
+    // unless the new price crosses the book, in which case it sees a CANCEL, the trades and an ADD for the remaining quantity.
+    const auto crosses = (side == Side::BUY ? (best_ask_price_ != Price_INVALID && price >= best_ask_price_) :
+                          (best_bid_price_ != Price_INVALID && price <= best_bid_price_));
+    if (UNLIKELY(crosses)) {
+      market_update_ = {MarketUpdateType::CANCEL, market_order_id, ticker_id, side, exchange_order->price_, 0, exchange_order->priority_};
+      matching_engine_->sendMarketUpdate(&market_update_);
+    }
+
+    START_MEASURE(Exchange_LadderMEOrderBook_removeOrder);
+    removeOrder(exchange_order);
+    END_MEASURE(Exchange_LadderMEOrderBook_removeOrder, (*logger_));
+
+    START_MEASURE(Exchange_LadderMEOrderBook_checkForMatch);
+    const auto leaves_qty = checkForMatch(client_id, order_id, ticker_id, side, price, qty, market_order_id);
+    END_MEASURE(Exchange_LadderMEOrderBook_checkForMatch, (*logger_));
+
+    if (LIKELY(leaves_qty)) {
+      const auto priority = getNextPriority(side, price);
+
+      auto order = order_pool_.allocate(ticker_id, client_id, order_id, market_order_id, side, price, leaves_qty, priority, nullptr, nullptr);
+      START_MEASURE(Exchange_LadderMEOrderBook_addOrder);
+      addOrder(order);
+      END_MEASURE(Exchange_LadderMEOrderBook_addOrder, (*logger_));
+
+      market_update_ = {(crosses ? MarketUpdateType::ADD : MarketUpdateType::MODIFY), market_order_id, ticker_id, side, price, leaves_qty, priority};
+      matching_engine_->sendMarketUpdate(&market_update_);
+    }
+  }
+
+  auto LadderMEOrderBook::toString(bool detailed, bool validity_check) const -> std::string {
+    std::stringstream ss;
+
+    auto printer = [&](std::stringstream &ss, Side side, Price price, Price prev_price, Price next_price, Price &last_price, bool sanity_check) {
+      char buf[4096];
+      Qty qty = 0;
+      size_t num_orders = 0;
+      const auto first_order = getFirstOrder(side, price);
+
+      for (auto o_itr = first_order;; o_itr = o_itr->next_order_) {
+        qty += o_itr->qty_;
+        ++num_orders;
+        if (o_itr->next_order_ == first_order)
+          break;
+      }
+      sprintf(buf, " <px:%3s p:%3s n:%3s> %-3s @ %-5s(%-4s)",
+              priceToString(price).c_str(), priceToString(prev_price).c_str(), priceToString(next_price).c_str(),
+              priceToString(price).c_str(), qtyToString(qty).c_str(), std::to_string(num_orders).c_str());
+      ss << buf;
+      for (auto o_itr = first_order;; o_itr = o_itr->next_order_) {
+        if (detailed) {
+          sprintf(buf, "[oid:%s q:%s p:%s n:%s] ",
+                  orderIdToString(o_itr->market_order_id_).c_str(), qtyToString(o_itr->qty_).c_str(),
+                  orderIdToString(o_itr->prev_order_ ? o_itr->prev_order_->market_order_id_ : OrderId_INVALID).c_str(),
+                  orderIdToString(o_itr->next_order_ ? o_itr->next_order_->market_order_id_ : OrderId_INVALID).c_str());
+          ss << buf;
+        }
+        if (o_itr->next_order_ == first_order)
+          break;
+      }
+
+      ss << std::endl;
+
+      if (sanity_check) {
+        if ((side == Side::SELL && last_price >= price) || (side == Side::BUY && last_price <= price)) {
+          FATAL("Bids/Asks not sorted by ascending/descending prices last:" + priceToString(last_price) + " price:" + priceToString(price));
+        }
+        if (first_order->price_ != price || first_order->side_ != side) {
+          FATAL("Price level holds orders of another price/side price:" + priceToString(price) + " order:" + first_order->toString());
+        }
+        last_price = price;
+      }
+    };
+
+    ss << "Ticker:" << tickerIdToString(ticker_id_) << std::endl;
+    for (const auto side: {Side::SELL, Side::BUY}) {
+      auto last_price = (side == Side::SELL ? std::numeric_limits<Price>::min() : std::numeric_limits<Price>::max());
+      auto prev_price = Price_INVALID;
+      auto price = (side == Side::SELL ? best_ask_price_ : best_bid_price_);
+      for (size_t count = 0; price != Price_INVALID; ++count) {
+        ss << (side == Side::SELL ? "ASKS" : "BIDS") << " L:" << count << " => ";
+        const auto next_price = getNextLevelPrice(side, price);
+        printer(ss, side, price, prev_price, next_price, last_price, validity_check);
+        prev_price = price;
+        price = next_price;
+      }
+
+      if (side == Side::SELL)
+        ss << std::endl << "                          X" << std::endl << std::endl;
+    }
+
+    return ss.str();
+  }
+}
@@ -0,0 +1,326 @@
+#pragma once
+
+#include "common/types.h"
+#include "common/free_list_mem_pool.h"
+#include "common/hierarchical_bitmap.h"
+#include "common/huge_page_allocator.h"
+#include "common/logging.h"
+#include "order_server/client_request.h"
+#include "order_server/client_response.h"
+#include "market_data/market_update.h"
+
+#include "me_order.h"
+#include "me_order_book_matching.h"
+
+using namespace Common;
+
+namespace Exchange {
+  class MatchingEngineBase;
+
+  /// Number of consecutive prices each side of a LadderMEOrderBook can hold resting orders at.
+  constexpr size_t ME_LADDER_PRICE_LEVELS = HIERARCHICAL_BITMAP_SIZE;
+
+  /// One side of a LadderMEOrderBook - the first order of the FIFO queue at every price of a window of ME_LADDER_PRICE_LEVELS consecutive prices.
+  /// A price is stored at index (price % ME_LADDER_PRICE_LEVELS), so moving the window only changes base_price_ and never moves any price level.
+  /// Prices are unique within the window, so unlike MEOrderBook::priceToIndex() two live prices never share an index.
+  struct MEPriceLadder {
+    /// Lowest price in the window.
+    Price base_price_ = 0;
+
+    /// Number of non-empty price levels.
+    size_t num_levels_ = 0;
+
+    std::array<MEOrder *, ME_LADDER_PRICE_LEVELS> first_orders_ = {};
+
+    /// Total quantity of the orders at every price, so that the quantity available to a FOK order can be found without walking the orders.
+    std::array<Qty, ME_LADDER_PRICE_LEVELS> level_qty_ = {};
+
+    /// Indices of the non-empty price levels.
+    HierarchicalBitmap levels_;
+
+    static auto priceToIndex(Price price) noexcept {
+      return (static_cast<size_t>(price) & (ME_LADDER_PRICE_LEVELS - 1));
+    }
+
+    auto contains(Price price) const noexcept {
+      return (price >= base_price_ && price < base_price_ + static_cast<Price>(ME_LADDER_PRICE_LEVELS));
+    }
+
+    auto indexToPrice(size_t index) const noexcept -> Price {
+      return base_price_ + static_cast<Price>((index - priceToIndex(base_price_)) & (ME_LADDER_PRICE_LEVELS - 1));
+    }
+
+    /// Lowest price >= price with resting orders, Price_INVALID if there is none in the window.
+    auto firstLevelAtOrAbove(Price price) const noexcept -> Price {
+      price = std::max(price, base_price_);
+      if (UNLIKELY(!contains(price)))
+        return Price_INVALID;
+
+      // Prices from base_price_ upwards occupy indices [base_index, ME_LADDER_PRICE_LEVELS) and then wrap around to [0, base_index).
+      const auto base_index = priceToIndex(base_price_);
+      const auto index = priceToIndex(price);
+      auto found = levels_.findFirstAtOrAbove(index);
+      if (index >= base_index && found == HierarchicalBitmap::NONE)
+        found = levels_.findFirstAtOrAbove(0);
+      if (found == HierarchicalBitmap::NONE || (index >= base_index ? (found < index && found >= base_index) : found >= base_index))
+        return Price_INVALID;
+
+      return indexToPrice(found);
+    }
+
+    /// Highest price <= price with resting orders, Price_INVALID if there is none in the window.
+    auto lastLevelAtOrBelow(Price price) const noexcept -> Price {
+      price = std::min(price, base_price_ + static_cast<Price>(ME_LADDER_PRICE_LEVELS) - 1);
+      if (UNLIKELY(!contains(price)))
+        return Price_INVALID;
+
+      const auto base_index = priceToIndex(base_price_);
+      const auto index = priceToIndex(price);
+      auto found = levels_.findLastAtOrBelow(index);
+      if (index < base_index && found == HierarchicalBitmap::NONE)
+        found = levels_.findLastAtOrBelow(ME_LADDER_PRICE_LEVELS - 1);
+      if (found == HierarchicalBitmap::NONE || (found < base_index && (index >= base_index || found > index)))
+        return Price_INVALID;
+
+      return indexToPrice(found);
+    }
+
+    /// Move the window so that it contains price as well as every non-empty price level, keeping the levels centered in it.
+    /// Returns false if they span ME_LADDER_PRICE_LEVELS or more prices and cannot all be held.
+    auto recenter(Price price) noexcept {
+      if (!num_levels_) {
+        base_price_ = price - static_cast<Price>(ME_LADDER_PRICE_LEVELS / 2);
+        return true;
+      }
+
+      const auto low = std::min(price, firstLevelAtOrAbove(base_price_));
+      const auto high = std::max(price, lastLevelAtOrBelow(base_price_ + static_cast<Price>(ME_LADDER_PRICE_LEVELS) - 1));
+      if (UNLIKELY(high - low >= static_cast<Price>(ME_LADDER_PRICE_LEVELS)))
+        return false;
+
+      base_price_ = low - (static_cast<Price>(ME_LADDER_PRICE_LEVELS) - 1 - (high - low)) / 2;
+      return true;
+    }
+  };
+
+  /// Same interface and behaviour as MEOrderBook, but price levels are kept in a dense MEPriceLadder per side instead of a sorted linked list.
+  /// Inserting a new price level is an array store and a bitmap update instead of a walk through the price levels, and the next best price after
+  /// a level empties is found from the bitmap. The ladders are large and mostly sparse, see OptCommon::HugePageObject.
+  class LadderMEOrderBook final : public MEOrderBookMatching<LadderMEOrderBook>, public OptCommon::HugePageObject {
+  public:
+    /// order_index_capacity sizes the (ClientId, OrderId) lookup upfront for the expected peak number of live orders of this book.
+    explicit LadderMEOrderBook(TickerId ticker_id, Logger *logger, MatchingEngineBase *matching_engine, FillReporting fill_reporting = FillReporting::PER_ORDER,
+                               size_t order_index_capacity = ME_ORDER_INDEX_CAPACITY);
+
+    ~LadderMEOrderBook();
+
+    /// Create and add a new order in the order book with provided attributes.
+    /// It will check to see if this new order matches an existing passive order with opposite side, and perform the matching if that is the case.
+    /// A remaining quantity whose price is too far from the other resting orders on its side to fit in the ladder is canceled instead of added.
+    auto add(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty) noexcept -> void;
+
+    /// Match a new order that never rests in the order book, same as MEOrderBook::addImmediate().
+    auto addImmediate(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty,
+                      TimeInForce time_in_force) noexcept -> void;
+
+    /// Attempt to cancel an order in the order book, issue a cancel-rejection if order does not exist.
+    auto cancel(ClientId client_id, OrderId order_id, TickerId ticker_id) noexcept -> void;
+
+    /// Change the price and / or quantity of an order in the order book, issue a modify-rejection if order does not exist.
+    /// Same as MEOrderBook::modify(), a new price that cannot fit in the ladder is rejected and leaves the order untouched.
+    auto modify(ClientId client_id, OrderId order_id, TickerId ticker_id, Side side, Price price, Qty qty) noexcept -> void;
+
+    /// Call f with every resting order, same order as MEOrderBook::forEachOrder(). f must not change the order book.
+    template<typename F>
+    auto forEachOrder(F &&f) const noexcept {
+      for (const auto side: {Side::SELL, Side::BUY}) {
+        for (auto price = (side == Side::BUY ? best_bid_price_ : best_ask_price_); price != Price_INVALID; price = getNextLevelPrice(side, price)) {
+          const auto first_order = getFirstOrder(side, price);
+          for (auto order = first_order;; order = order->next_order_) {
+            f(*order);
+            if (order->next_order_ == first_order)
+              break;
+          }
+        }
+      }
+    }
+
+    /// Set the market order id of the next order, see MEOrderBook::restoreNextMarketOrderId().
+    auto restoreNextMarketOrderId(OrderId next_market_order_id) noexcept {
+      next_market_order_id_ = next_market_order_id;
+    }
+
+    auto toString(bool detailed, bool validity_check) const -> std::string;
+
+    /// Deleted default, copy & move constructors and assignment-operators.
+    LadderMEOrderBook() = delete;
+
+    LadderMEOrderBook(const LadderMEOrderBook &) = delete;
+
+    LadderMEOrderBook(const LadderMEOrderBook &&) = delete;
+
+    LadderMEOrderBook &operator=(const LadderMEOrderBook &) = delete;
+
+    LadderMEOrderBook &operator=(const LadderMEOrderBook &&) = delete;
+
+  private:
+    friend class MEOrderBookMatching<LadderMEOrderBook>;
+
+    TickerId ticker_id_ = TickerId_INVALID;
+
+    /// The parent matching engine instance, used to publish market data and client responses.
+    MatchingEngineBase *matching_engine_ = nullptr;
+
+    const FillReporting fill_reporting_ = FillReporting::PER_ORDER;
+
+    /// Hash map from (ClientId, OrderId) -> MEOrder.
+    ClientOrderHashMap cid_oid_to_order_;
+
+    /// Price levels of buy and sell orders.
+    MEPriceLadder bids_;
+    MEPriceLadder asks_;
+
+    /// Best / top of book prices, Price_INVALID when that side of the book is empty.
+    Price best_bid_price_ = Price_INVALID;
+    Price best_ask_price_ = Price_INVALID;
+
+    /// Memory pool to manage MEOrder objects.
+    OptCommon::FreeListMemPool<MEOrder> order_pool_;
+
+    /// These are used to publish client responses and market updates.
+    MEClientResponse client_response_;
+    MEMarketUpdate market_update_;
+
+    OrderId next_market_order_id_ = 1;
+
+    std::string time_str_;
+    Logger *logger_ = nullptr;
+
+  private:
+    auto generateNewMarketOrderId() noexcept -> OrderId {
+      return next_market_order_id_++;
+    }
+
+    auto ladder(Side side) noexcept -> MEPriceLadder & {
+      return (side == Side::BUY ? bids_ : asks_);
+    }
+
+    auto ladder(Side side) const noexcept -> const MEPriceLadder & {
+      return (side == Side::BUY ? bids_ : asks_);
+    }
+
+    /// First order in the FIFO queue at the provided price, nullptr if there is none.
+    auto getFirstOrder(Side side, Price price) const noexcept -> MEOrder * {
+      const auto &price_ladder = ladder(side);
+      return (price_ladder.contains(price) ? price_ladder.first_orders_[MEPriceLadder::priceToIndex(price)] : nullptr);
+    }
+
+    /// Next price level after the provided one in order from most aggressive to least aggressive price, Price_INVALID if there is none.
+    auto getNextLevelPrice(Side side, Price price) const noexcept {
+      return (side == Side::BUY ? bids_.lastLevelAtOrBelow(price - 1) : asks_.firstLevelAtOrAbove(price + 1));
+    }
+
+    auto getNextPriority(Side side, Price price) noexcept {
+      const auto first_order = getFirstOrder(side, price);
+      if (!first_order)
+        return 1lu;
+
+      return first_order->prev_order_->priority_ + 1;
+    }
+
+    /// True if the other side of the order book holds at least qty at prices that match the provided price, for a FOK order of client_id.
+    /// Walks the price levels using their total quantity and not the orders in them, unless the client has self-trade prevention - then the
+    /// client's own orders are left out and running into one that would stop the fill returns false.
+    auto canFill(ClientId client_id, SelfTradePrevention self_trade_prevention, Side side, Price price, Qty qty) const noexcept -> bool {
+      const auto other_side = (side == Side::BUY ? Side::SELL : Side::BUY);
+      const auto &price_ladder = ladder(other_side);
+      Qty available_qty = 0;
+      for (auto level_price = (side == Side::BUY ? best_ask_price_ : best_bid_price_); level_price != Price_INVALID;
+           level_price = getNextLevelPrice(other_side, level_price)) {
+        if (side == Side::BUY ? price < level_price : price > level_price)
+          break;
+        if (self_trade_prevention == SelfTradePrevention::NONE)
+          available_qty += price_ladder.level_qty_[MEPriceLadder::priceToIndex(level_price)];
+        else if (!addFillableQty(client_id, self_trade_prevention, getFirstOrder(other_side, level_price), qty, &available_qty))
+          return false;
+        if (available_qty >= qty)
+          return true;
+      }
+      return false;
+    }
+
+    /// Match a new aggressive order with the provided parameters against a passive order held in the bid_itr object and generate client responses and market updates for the match.
+    /// It will update the passive order (bid_itr) based on the match and possibly remove it if fully matched.
+    /// It will return remaining quantity on the aggressive order in the leaves_qty parameter.
+    /// With report_per_level the aggressor's fill has already been reported by reportLevelFill().
+    auto match(TickerId ticker_id, ClientId client_id, Side side, OrderId client_order_id, OrderId new_market_order_id, MEOrder* bid_itr, Qty* leaves_qty,
+               bool report_per_level) noexcept;
+
+    /// Check if a new order with the provided attributes would match against existing passive orders on the other side of the order book.
+    /// This will call the match() method to perform the match if there is a match to be made and return the quantity remaining if any on this new order.
+    auto checkForMatch(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty, Qty new_market_order_id) noexcept;
+
+    /// Take quantity off the total of the price level, for an order whose quantity is reduced in place.
+    auto reduceLevelQty(Side side, Price price, Qty qty) noexcept {
+      ladder(side).level_qty_[MEPriceLadder::priceToIndex(price)] -= qty;
+    }
+
+    /// Remove and de-allocate provided order from the containers.
+    auto removeOrder(MEOrder *order) noexcept {
+      auto &price_ladder = ladder(order->side_);
+      const auto index = MEPriceLadder::priceToIndex(order->price_);
+
+      if (order->prev_order_ == order) { // only one element, remove the price level.
+        price_ladder.first_orders_[index] = nullptr;
+        price_ladder.levels_.clear(index);
+        --price_ladder.num_levels_;
+
+        auto &best_price = (order->side_ == Side::BUY ? best_bid_price_ : best_ask_price_);
+        if (order->price_ == best_price)
+          best_price = getNextLevelPrice(order->side_, order->price_);
+      } else { // remove the link.
+        const auto order_before = order->prev_order_;
+        const auto order_after = order->next_order_;
+        order_before->next_order_ = order_after;
+        order_after->prev_order_ = order_before;
+
+        if (price_ladder.first_orders_[index] == order) {
+          price_ladder.first_orders_[index] = order_after;
+        }
+        price_ladder.level_qty_[index] -= order->qty_;
+      }
+      order->prev_order_ = order->next_order_ = nullptr;
+
+      cid_oid_to_order_.erase({order->client_id_, order->client_order_id_});
+      order_pool_.deallocate(order);
+    }
+
+    /// Add a single order at the end of the FIFO queue at the price level that this order belongs in.
+    /// The order's price must already be inside the ladder's window.
+    auto addOrder(MEOrder *order) noexcept {
+      auto &price_ladder = ladder(order->side_);
+      const auto index = MEPriceLadder::priceToIndex(order->price_);
+      const auto first_order = price_ladder.first_orders_[index];
+
+      if (!first_order) {
+        order->next_order_ = order->prev_order_ = order;
+        price_ladder.first_orders_[index] = order;
+        price_ladder.level_qty_[index] = order->qty_;
+        price_ladder.levels_.set(index);
+        ++price_ladder.num_levels_;
+
+        auto &best_price = (order->side_ == Side::BUY ? best_bid_price_ : best_ask_price_);
+        if (best_price == Price_INVALID || (order->side_ == Side::BUY ? order->price_ > best_price : order->price_ < best_price))
+          best_price = order->price_;
+      } else {
+        first_order->prev_order_->next_order_ = order;
+        order->prev_order_ = first_order->prev_order_;
+        order->next_order_ = first_order;
+        first_order->prev_order_ = order;
+        price_ladder.level_qty_[index] += order->qty_;
+      }
+
+      cid_oid_to_order_.insert({order->client_id_, order->client_order_id_}, order);
+    }
+  };
+}
@@ -1,21 +1,32 @@
 #include "matching_engine.h"
 
+#include <fcntl.h>
+#include <sys/wait.h>
+
 namespace Exchange {
-  MatchingEngine::MatchingEngine(ClientRequestLFQueue *client_requests, ClientResponseLFQueue *client_responses,
-                                 MEMarketUpdateLFQueue *market_updates)
-      : incoming_requests_(client_requests), outgoing_ogw_responses_(client_responses), outgoing_md_updates_(market_updates),
-        logger_("exchange_matching_engine.log") {
+  template<typename OrderBookT>
+  MatchingEngine<OrderBookT>::MatchingEngine(ClientRequestLFQueue *client_requests, ClientResponseLFQueue *client_responses,
+                                             MEMarketUpdateLFQueue *market_updates, size_t shard_index, size_t num_shards, FillReporting fill_reporting)
+      : MatchingEngineBase(client_responses, market_updates,
+                           num_shards > 1 ? "exchange_matching_engine_" + std::to_string(shard_index) + ".log" : "exchange_matching_engine.log"),
+        shard_index_(shard_index), num_shards_(num_shards), incoming_requests_(client_requests) {
+    ASSERT(num_shards && num_shards <= ME_MAX_MATCHING_SHARDS && shard_index < num_shards,
+           "Invalid matching engine shard:" + std::to_string(shard_index) + " of:" + std::to_string(num_shards));
     for(size_t i = 0; i < ticker_order_book_.size(); ++i) {
-      ticker_order_book_[i] = new MEOrderBook(i, &logger_, this);
+      ticker_order_book_[i] = (tickerIdToShard(i, num_shards) == shard_index ? new OrderBookT(i, &logger_, this, fill_reporting) : nullptr);
     }
   }
 
-  MatchingEngine::~MatchingEngine() {
+  template<typename OrderBookT>
+  MatchingEngine<OrderBookT>::~MatchingEngine() {
     stop();
 
     using namespace std::literals::chrono_literals;
     std::this_thread::sleep_for(1s);
 
+    if (checkpoint_pid_ > 0)
+      waitpid(checkpoint_pid_, nullptr, 0);
+
     incoming_requests_ = nullptr;
     outgoing_ogw_responses_ = nullptr;
     outgoing_md_updates_ = nullptr;
@@ -27,12 +38,88 @@ namespace Exchange {
   }
 
   /// Start and stop the matching engine main thread.
-  auto MatchingEngine::start() -> void {
+  template<typename OrderBookT>
+  auto MatchingEngine<OrderBookT>::start(int core_id) -> void {
     run_ = true;
-    ASSERT(Common::createAndStartThread(-1, "Exchange/MatchingEngine", [this]() { run(); }) != nullptr, "Failed to start MatchingEngine thread.");
+    ASSERT(Common::createAndStartThread(core_id, "Exchange/MatchingEngine " + std::to_string(shard_index_), [this]() { run(); }) != nullptr,
+           "Failed to start MatchingEngine thread.");
   }
 
-  auto MatchingEngine::stop() -> void {
+  template<typename OrderBookT>
+  auto MatchingEngine<OrderBookT>::stop() -> void {
     run_ = false;
   }
+
+  template<typename OrderBookT>
+  auto MatchingEngine<OrderBookT>::checkpoint() noexcept -> bool requires CheckpointableOrderBook<OrderBookT> {
+    next_checkpoint_requests_ = num_processed_requests_ + checkpoint_interval_;
+    if (!waitForCheckpoint(false)) {
+      logger_.log("%:% %() % Skipping checkpoint requests:%, pid:% is still writing the previous one.\n", __FILE__, __LINE__, __FUNCTION__,
+                  Common::getCurrentTimeStr(&time_str_), num_processed_requests_, checkpoint_pid_);
+      return false;
+    }
+
+    const auto start = Common::getCurrentNanos();
+    const auto pid = fork();
+    if (!pid)
+      _exit(writeCheckpointFile() ? EXIT_SUCCESS : EXIT_FAILURE);
+    const auto pause = Common::getCurrentNanos() - start;
+
+    if (pid < 0) {
+      logger_.log("%:% %() % fork() failed for checkpoint requests:% error:%\n", __FILE__, __LINE__, __FUNCTION__,
+                  Common::getCurrentTimeStr(&time_str_), num_processed_requests_, std::strerror(errno));
+      return false;
+    }
+    checkpoint_pid_ = pid;
+    checkpoint_minor_faults_ = Common::threadMinorFaults();
+
+    logger_.log("%:% %() % Checkpoint requests:% pid:% paused for:%ns\n", __FILE__, __LINE__, __FUNCTION__,
+                Common::getCurrentTimeStr(&time_str_), num_processed_requests_, checkpoint_pid_, pause);
+    return true;
+  }
+
+  template<typename OrderBookT>
+  auto MatchingEngine<OrderBookT>::waitForCheckpoint(bool block) noexcept -> bool requires CheckpointableOrderBook<OrderBookT> {
+    if (checkpoint_pid_ <= 0)
+      return true;
+
+    int status = 0;
+    const auto pid = waitpid(checkpoint_pid_, &status, block ? 0 : WNOHANG);
+    if (!pid)
+      return false;
+
+    const auto written = (pid == checkpoint_pid_ && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+    logger_.log("%:% %() % Checkpoint pid:% file:% written:% page faults since fork:%\n", __FILE__, __LINE__, __FUNCTION__,
+                Common::getCurrentTimeStr(&time_str_), checkpoint_pid_, checkpoint_file_, written, Common::threadMinorFaults() - checkpoint_minor_faults_);
+    checkpoint_pid_ = 0;
+    return true;
+  }
+
+  template<typename OrderBookT>
+  auto MatchingEngine<OrderBookT>::writeCheckpointFile() const noexcept -> bool requires CheckpointableOrderBook<OrderBookT> {
+    const auto fd = open(checkpoint_tmp_file_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+      return false;
+
+    MECheckpointHeader header;
+    header.shard_index_ = shard_index_;
+    header.num_shards_ = num_shards_;
+    header.num_requests_ = num_processed_requests_;
+    header.num_order_books_ = std::count_if(ticker_order_book_.begin(), ticker_order_book_.end(), [](auto order_book) { return order_book != nullptr; });
+
+    MECheckpointWriter writer(fd);
+    auto written = writer.write(header);
+    for (const auto order_book: ticker_order_book_) {
+      if (order_book)
+        written = written && order_book->writeCheckpoint(&writer);
+    }
+    written = written && writer.flush() && !fsync(fd);
+    written = !close(fd) && written;
+
+    return written && !rename(checkpoint_tmp_file_.c_str(), checkpoint_file_.c_str());
+  }
+
+  template class MatchingEngine<MEOrderBook>;
+  template class MatchingEngine<LadderMEOrderBook>;
+  template class MatchingEngine<UnorderedMapMEOrderBook>;
 }
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <concepts>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <vector>
+
 #include "common/thread_utils.h"
-#include "common/lf_queue.h"
+#include "common/opt_lf_queue.h"
 #include "common/macros.h"
 
 #include "order_server/client_request.h"
@@ -9,30 +15,136 @@
 #include "market_data/market_update.h"
 
 #include "me_order_book.h"
+#include "ladder_me_order_book.h"
+#include "unordered_map_me_order_book.h"
 
 namespace Exchange {
-  class MatchingEngine final {
+  /// The part of the matching engine that the order books publish through, it does not depend on the order book type so that the order books
+  /// themselves are not templates. Publishing is not virtual, only the destructor is so that owners can delete any MatchingEngine through this type.
+  class MatchingEngineBase {
   public:
+    MatchingEngineBase(ClientResponseLFQueue *client_responses, MEMarketUpdateLFQueue *market_updates, const std::string &log_file)
+        : outgoing_ogw_responses_(client_responses), outgoing_md_updates_(market_updates), logger_(log_file) {
+    }
+
+    virtual ~MatchingEngineBase() = default;
+
+    /// Self-trade prevention mode of the client's aggressive orders, NONE unless set. Only to be set before the matching engine is started.
+    auto setSelfTradePrevention(ClientId client_id, SelfTradePrevention self_trade_prevention) noexcept {
+      client_self_trade_prevention_.at(client_id) = self_trade_prevention;
+    }
+
+    auto selfTradePrevention(ClientId client_id) const noexcept {
+      return client_self_trade_prevention_.at(client_id);
+    }
+
+    /// Write client responses to the lock free queue for the order server to consume.
+    auto sendClientResponse(const MEClientResponse *client_response) noexcept {
+      if (LIKELY(log_messages_))
+        logger_.log("%:% %() % Sending %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), client_response->toString());
+      auto next_write = outgoing_ogw_responses_->getNextToWriteTo();
+      *next_write = std::move(*client_response);
+      outgoing_ogw_responses_->updateWriteIndex();
+      TTT_MEASURE(T4t_MatchingEngine_LFQueue_write, logger_);
+    }
+
+    /// Write market data update to the lock free queue for the market data publisher to consume.
+    auto sendMarketUpdate(const MEMarketUpdate *market_update) noexcept {
+      if (LIKELY(log_messages_))
+        logger_.log("%:% %() % Sending %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), market_update->toString());
+      auto next_write = outgoing_md_updates_->getNextToWriteTo();
+      *next_write = *market_update;
+      outgoing_md_updates_->updateWriteIndex();
+      TTT_MEASURE(T4_MatchingEngine_LFQueue_write, logger_);
+    }
+
+    /// Deleted default, copy & move constructors and assignment-operators.
+    MatchingEngineBase() = delete;
+
+    MatchingEngineBase(const MatchingEngineBase &) = delete;
+
+    MatchingEngineBase(const MatchingEngineBase &&) = delete;
+
+    MatchingEngineBase &operator=(const MatchingEngineBase &) = delete;
+
+    MatchingEngineBase &operator=(const MatchingEngineBase &&) = delete;
+
+  protected:
+    /// Lock free queues.
+    /// One to publish outgoing client responses to be consumed by the order server.
+    /// Second to publish outgoing market updates to be consumed by the market data publisher.
+    ClientResponseLFQueue *outgoing_ogw_responses_ = nullptr;
+    MEMarketUpdateLFQueue *outgoing_md_updates_ = nullptr;
+
+    /// Self-trade prevention mode indexed by ClientId.
+    std::array<SelfTradePrevention, ME_MAX_NUM_CLIENTS> client_self_trade_prevention_{};
+
+    /// Off while replay(), cancelOrders() and restoreCheckpoint() rebuild the order books, which then only log a summary instead of every message
+    /// published.
+    bool log_messages_ = true;
+
+    std::string time_str_;
+    Logger logger_;
+  };
+
+  /// Order books that can be written to and rebuilt from a checkpoint file, MEOrderBook. The checkpoint methods of MatchingEngine are only
+  /// available for these order books.
+  template<typename OrderBookT>
+  concept CheckpointableOrderBook = requires(OrderBookT *order_book, MECheckpointWriter *writer, const MECheckpointOrder &checkpoint_order) {
+    { order_book->writeCheckpoint(writer) } -> std::same_as<bool>;
+    order_book->restoreNextMarketOrderId(OrderId_INVALID);
+    order_book->restoreOrder(checkpoint_order);
+  };
+
+  /// OrderBookT is the order book implementation, every ticker gets one and client requests are dispatched to it without virtual calls.
+  /// It needs a (TickerId, Logger *, MatchingEngineBase *, FillReporting) constructor and the add(), addImmediate(), cancel() and modify()
+  /// methods of MEOrderBook. MEOrderBook, LadderMEOrderBook and UnorderedMapMEOrderBook are instantiated in matching_engine.cpp.
+  template<typename OrderBookT>
+  class MatchingEngine final : public MatchingEngineBase {
+  public:
+    /// With num_shards > 1 this matching engine is one of num_shards threads, it only holds the order books of the tickers for which
+    /// tickerIdToShard() returns shard_index and the queues are the ones dedicated to this shard.
+    /// fill_reporting selects how the order books report the fills of aggressive orders.
     MatchingEngine(ClientRequestLFQueue *client_requests,
                    ClientResponseLFQueue *client_responses,
-                   MEMarketUpdateLFQueue *market_updates);
+                   MEMarketUpdateLFQueue *market_updates,
+                   size_t shard_index = 0, size_t num_shards = 1,
+                   FillReporting fill_reporting = FillReporting::PER_ORDER);
 
-    ~MatchingEngine();
+    ~MatchingEngine() override;
 
-    /// Start and stop the matching engine main thread.
-    auto start() -> void;
+    /// Start and stop the matching engine main thread, optionally pinned to the provided core.
+    auto start(int core_id = -1) -> void;
 
     auto stop() -> void;
 
     /// Called to process a client request read from the lock free queue sent by the order server.
+    /// The FIFO sequencer only routes requests for the tickers this shard owns to its queue.
     auto processClientRequest(const MEClientRequest *client_request) noexcept {
       auto order_book = ticker_order_book_[client_request->ticker_id_];
       switch (client_request->type_) {
         case ClientRequestType::NEW: {
-          START_MEASURE(Exchange_MEOrderBook_add);
-          order_book->add(client_request->client_id_, client_request->order_id_, client_request->ticker_id_,
-                           client_request->side_, client_request->price_, client_request->qty_);
-          END_MEASURE(Exchange_MEOrderBook_add, logger_);
+          if (LIKELY(client_request->time_in_force_ != TimeInForce::IOC && client_request->time_in_force_ != TimeInForce::FOK)) {
+            START_MEASURE(Exchange_MEOrderBook_add);
+            order_book->add(client_request->client_id_, client_request->order_id_, client_request->ticker_id_,
+                            client_request->side_, client_request->price_, client_request->qty_);
+            END_MEASURE(Exchange_MEOrderBook_add, logger_);
+          } else {
+            START_MEASURE(Exchange_MEOrderBook_addImmediate);
+            order_book->addImmediate(client_request->client_id_, client_request->order_id_, client_request->ticker_id_,
+                                     client_request->side_, client_request->price_, client_request->qty_, client_request->time_in_force_);
+            END_MEASURE(Exchange_MEOrderBook_addImmediate, logger_);
+          }
+        }
+          break;
+
+        case ClientRequestType::MARKET: { // matches at any price, IOC unless FOK is requested.
+          const auto price = (client_request->side_ == Side::BUY ? MARKET_BUY_PRICE : MARKET_SELL_PRICE);
+          START_MEASURE(Exchange_MEOrderBook_addImmediate);
+          order_book->addImmediate(client_request->client_id_, client_request->order_id_, client_request->ticker_id_,
+                                   client_request->side_, price, client_request->qty_,
+                                   (client_request->time_in_force_ == TimeInForce::FOK ? TimeInForce::FOK : TimeInForce::IOC));
+          END_MEASURE(Exchange_MEOrderBook_addImmediate, logger_);
         }
           break;
 
@@ -43,6 +155,14 @@ namespace Exchange {
         }
           break;
 
+        case ClientRequestType::MODIFY: {
+          START_MEASURE(Exchange_MEOrderBook_modify);
+          order_book->modify(client_request->client_id_, client_request->order_id_, client_request->ticker_id_,
+                             client_request->side_, client_request->price_, client_request->qty_);
+          END_MEASURE(Exchange_MEOrderBook_modify, logger_);
+        }
+          break;
+
         default: {
           FATAL("Received invalid client-request-type:" + clientRequestTypeToString(client_request->type_));
         }
@@ -50,38 +170,164 @@ namespace Exchange {
       }
     }
 
-    /// Write client responses to the lock free queue for the order server to consume.
-    auto sendClientResponse(const MEClientResponse *client_response) noexcept {
-      logger_.log("%:% %() % Sending %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), client_response->toString());
-      auto next_write = outgoing_ogw_responses_->getNextToWriteTo();
-      *next_write = std::move(*client_response);
-      outgoing_ogw_responses_->updateWriteIndex();
-      TTT_MEASURE(T4t_MatchingEngine_LFQueue_write, logger_);
+    /// Rebuild the order books by processing journaled client requests on the calling thread, before start() is called.
+    /// Requests for tickers owned by other shards are skipped, and so are the requests already covered by a checkpoint loaded by
+    /// restoreCheckpoint(). Nothing else consumes the outgoing queues at this point unless the caller started it, so drain_outputs() is called
+    /// after every request to consume at least the client responses. The client responses and market updates are not logged.
+    template<typename F>
+    auto replay(std::span<const MEClientRequest> client_requests, F &&drain_outputs) noexcept {
+      const auto num_restored_requests = num_processed_requests_;
+      size_t num_owned_requests = 0;
+      log_messages_ = false;
+      for (const auto &client_request: client_requests) {
+        if (ticker_order_book_[client_request.ticker_id_] && num_owned_requests++ >= num_processed_requests_) {
+          processClientRequest(&client_request);
+          ++num_processed_requests_;
+          drain_outputs();
+        }
+      }
+      log_messages_ = true;
+
+      logger_.log("%:% %() % Replayed % requests, processed:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                  num_processed_requests_ - num_restored_requests, num_processed_requests_);
     }
 
-    /// Write market data update to the lock free queue for the market data publisher to consume.
-    auto sendMarketUpdate(const MEMarketUpdate *market_update) noexcept {
-      logger_.log("%:% %() % Sending %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), market_update->toString());
-      auto next_write = outgoing_md_updates_->getNextToWriteTo();
-      *next_write = *market_update;
-      outgoing_md_updates_->updateWriteIndex();
-      TTT_MEASURE(T4_MatchingEngine_LFQueue_write, logger_);
+    /// Cancel every order resting in the order books on the calling thread, after replay() rebuilt them and before start() is called.
+    /// Client sessions do not survive a restart - clients log in again from sequence number 1 and reuse the order ids of their previous session -
+    /// so nobody can cancel the replayed orders any more, and a new order reusing the id of one of them would replace it in the order lookup.
+    /// Every order is canceled by processing a CANCEL request for it, its CANCEL market update is published and drain_outputs() is called after
+    /// each one as in replay(). Returns the CANCEL requests, they have to be journaled after the replayed requests for the next replay to cancel
+    /// the orders at the same point.
+    template<typename F>
+    auto cancelOrders(F &&drain_outputs) -> std::vector<MEClientRequest> {
+      std::vector<MEClientRequest> cancels;
+      for (const auto order_book: ticker_order_book_) {
+        if (order_book)
+          order_book->forEachOrder([&cancels](const MEOrder &order) {
+            cancels.push_back({ClientRequestType::CANCEL, order.client_id_, order.ticker_id_, order.client_order_id_, order.side_, order.price_,
+                               order.qty_});
+          });
+      }
+
+      log_messages_ = false;
+      for (const auto &cancel: cancels) {
+        processClientRequest(&cancel);
+        ++num_processed_requests_;
+        drain_outputs();
+      }
+      log_messages_ = true;
+
+      logger_.log("%:% %() % Canceled % replayed orders, processed:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                  cancels.size(), num_processed_requests_);
+      return cancels;
+    }
+
+    /// Count the processed requests and number the orders from the start again, when the journal is reset once cancelOrders() left no order in
+    /// the order books - see RequestJournal::reset(). None of the orders that carried the previous market order ids is left.
+    /// Only to be called before start().
+    auto resetProcessedRequests() noexcept {
+      for (const auto order_book: ticker_order_book_) {
+        if (order_book)
+          order_book->restoreNextMarketOrderId(1);
+      }
+      num_processed_requests_ = 0;
+      next_checkpoint_requests_ = checkpoint_interval_;
+    }
+
+    /// Checkpoint the order books to checkpoint_file every checkpoint_interval client requests once started, never if checkpoint_interval is 0.
+    /// Also the file restoreCheckpoint() loads. Only to be called before start().
+    auto enableCheckpoints(const std::string &checkpoint_file, size_t checkpoint_interval) noexcept
+    requires CheckpointableOrderBook<OrderBookT> {
+      checkpoint_file_ = checkpoint_file;
+      checkpoint_tmp_file_ = checkpoint_file + ".tmp";
+      checkpoint_interval_ = checkpoint_interval;
+      next_checkpoint_requests_ = num_processed_requests_ + checkpoint_interval;
+    }
+
+    /// Checkpoint the order books now, on the matching engine thread or before start(). The process is forked and the child writes the checkpoint
+    /// from its copy-on-write view of the order books, so this thread is only paused for the fork() itself and then for the page copies of
+    /// the first writes to each page while the child is running - 4KB each as long as nothing is on hugetlb pages, see
+    /// OptCommon::setHugeTlbEnabled(). Those show up as the page faults logged when the child is reaped and in the processClientRequest latencies.
+    /// The child writes the file next to the checkpoint file and renames it over it once complete. Returns false without a checkpoint if the
+    /// previous one is still being written or fork() failed.
+    auto checkpoint() noexcept -> bool requires CheckpointableOrderBook<OrderBookT>;
+
+    /// Reap the process writing the last checkpoint, returns false if it is still writing and block is false.
+    auto waitForCheckpoint(bool block) noexcept -> bool requires CheckpointableOrderBook<OrderBookT>;
+
+    /// Load the order books from the checkpoint file on the calling thread, before replay() processes the journaled requests it does not cover.
+    /// Every restored order is published as an ADD market update, drain_outputs() is called after each one and nothing is logged as in replay().
+    /// The checkpoint is not loaded if it is missing or corrupt, was written by a different shard, or covers more requests for this shard than
+    /// journaled_requests holds - the journal writer lost requests the matching engine had processed, the journal alone is then replayed.
+    template<typename F>
+    auto restoreCheckpoint(std::span<const MEClientRequest> journaled_requests, F &&drain_outputs) noexcept -> bool
+    requires CheckpointableOrderBook<OrderBookT> {
+      std::ifstream file(checkpoint_file_, std::ios::binary);
+      const std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+      MECheckpointReader reader(data);
+
+      const auto num_owned_requests = std::count_if(journaled_requests.begin(), journaled_requests.end(), [this](const auto &client_request) {
+        return ticker_order_book_[client_request.ticker_id_] != nullptr;
+      });
+      // Check the whole file before touching the order books.
+      const auto header = reader.read<MECheckpointHeader>();
+      auto valid = (header && header->magic_ == ME_CHECKPOINT_MAGIC && header->shard_index_ == shard_index_ && header->num_shards_ == num_shards_ &&
+                    header->num_requests_ <= static_cast<size_t>(num_owned_requests));
+      for (size_t i = 0; valid && i < header->num_order_books_; ++i) {
+        const auto checkpoint_order_book = reader.read<MECheckpointOrderBook>();
+        valid = (checkpoint_order_book && checkpoint_order_book->ticker_id_ < ME_MAX_TICKERS && ticker_order_book_[checkpoint_order_book->ticker_id_] &&
+                 reader.read<MECheckpointOrder>(checkpoint_order_book->num_orders_));
+      }
+      if (!valid || !reader.done()) {
+        logger_.log("%:% %() % Not loading checkpoint:% size:% journaled requests:%\n", __FILE__, __LINE__, __FUNCTION__,
+                    Common::getCurrentTimeStr(&time_str_), checkpoint_file_, data.size(), num_owned_requests);
+        return false;
+      }
+
+      MECheckpointReader order_books_reader(data);
+      order_books_reader.read<MECheckpointHeader>();
+      log_messages_ = false;
+      for (size_t i = 0; i < header->num_order_books_; ++i) {
+        const auto checkpoint_order_book = order_books_reader.read<MECheckpointOrderBook>();
+        const auto checkpoint_orders = order_books_reader.read<MECheckpointOrder>(checkpoint_order_book->num_orders_);
+        auto order_book = ticker_order_book_[checkpoint_order_book->ticker_id_];
+        order_book->restoreNextMarketOrderId(checkpoint_order_book->next_market_order_id_);
+        for (size_t j = 0; j < checkpoint_order_book->num_orders_; ++j) {
+          order_book->restoreOrder(checkpoint_orders[j]);
+          drain_outputs();
+        }
+      }
+      log_messages_ = true;
+      num_processed_requests_ = header->num_requests_;
+      next_checkpoint_requests_ = num_processed_requests_ + checkpoint_interval_;
+
+      logger_.log("%:% %() % Loaded checkpoint:% order books:% requests:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                  checkpoint_file_, header->num_order_books_, num_processed_requests_);
+      return true;
     }
 
     /// Main loop for this thread - processes incoming client requests which in turn generates client responses and market updates.
     auto run() noexcept {
       logger_.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_));
       while (run_) {
-        const auto me_client_request = incoming_requests_->getNextToRead();
-        if (LIKELY(me_client_request)) {
+        const auto me_client_requests = incoming_requests_->getNextBatchToRead(ME_MAX_QUEUE_BATCH);
+        for (const auto &me_client_request: me_client_requests) {
           TTT_MEASURE(T3_MatchingEngine_LFQueue_read, logger_);
 
           logger_.log("%:% %() % Processing %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
-                      me_client_request->toString());
+                      me_client_request.toString());
           START_MEASURE(Exchange_MatchingEngine_processClientRequest);
-          processClientRequest(me_client_request);
+          processClientRequest(&me_client_request);
           END_MEASURE(Exchange_MatchingEngine_processClientRequest, logger_);
-          incoming_requests_->updateReadIndex();
+        }
+        if (LIKELY(!me_client_requests.empty())) {
+          incoming_requests_->updateReadIndex(me_client_requests.size());
+          num_processed_requests_ += me_client_requests.size();
+
+          if constexpr (CheckpointableOrderBook<OrderBookT>) {
+            if (UNLIKELY(checkpoint_interval_ && num_processed_requests_ >= next_checkpoint_requests_))
+              checkpoint();
+          }
         }
       }
     }
@@ -98,20 +344,38 @@ namespace Exchange {
     MatchingEngine &operator=(const MatchingEngine &&) = delete;
 
   private:
-    /// Hash map container from TickerId -> MEOrderBook.
-    OrderBookHashMap ticker_order_book_;
+    /// Write the checkpoint file, in the child process forked by checkpoint(). It only makes system calls, the other threads of the exchange do
+    /// not exist in the child, so the locks they might have held at the time of the fork() must not be taken.
+    auto writeCheckpointFile() const noexcept -> bool requires CheckpointableOrderBook<OrderBookT>;
 
-    /// Lock free queues.
-    /// One to consume incoming client requests sent by the order server.
-    /// Second to publish outgoing client responses to be consumed by the order server.
-    /// Third to publish outgoing market updates to be consumed by the market data publisher.
+    const size_t shard_index_ = 0;
+    const size_t num_shards_ = 1;
+
+    /// Hash map container from TickerId -> OrderBookT, nullptr for the tickers owned by the other shards.
+    std::array<OrderBookT *, ME_MAX_TICKERS> ticker_order_book_;
+
+    /// Lock free queue to consume incoming client requests sent by the order server.
     ClientRequestLFQueue *incoming_requests_ = nullptr;
-    ClientResponseLFQueue *outgoing_ogw_responses_ = nullptr;
-    MEMarketUpdateLFQueue *outgoing_md_updates_ = nullptr;
 
     volatile bool run_ = false;
 
-    std::string time_str_;
-    Logger logger_;
+    /// Client requests processed for this shard's tickers, including the ones covered by a restored checkpoint.
+    size_t num_processed_requests_ = 0;
+
+    /// Checkpoints are written to checkpoint_tmp_file_ and renamed to checkpoint_file_.
+    std::string checkpoint_file_;
+    std::string checkpoint_tmp_file_;
+    size_t checkpoint_interval_ = 0;
+    size_t next_checkpoint_requests_ = 0;
+
+    /// Process writing the last checkpoint, 0 once it has been reaped.
+    pid_t checkpoint_pid_ = 0;
+
+    /// Minor page faults of the thread that called checkpoint() at the time of the fork().
+    long checkpoint_minor_faults_ = 0;
   };
+
+  extern template class MatchingEngine<MEOrderBook>;
+  extern template class MatchingEngine<LadderMEOrderBook>;
+  extern template class MatchingEngine<UnorderedMapMEOrderBook>;
 }
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include <unistd.h>
+
+#include "common/types.h"
+#include "common/macros.h"
+
+using namespace Common;
+
+namespace Exchange {
+  /// First 8 bytes of every matching engine checkpoint file, "MECKPT01". Files written with a different layout are not loaded.
+  constexpr uint64_t ME_CHECKPOINT_MAGIC = 0x313054504b43454d;
+
+  /// The checkpoint file structures are written and read as raw bytes, so they are packed to remove system dependent extra padding.
+#pragma pack(push, 1)
+
+  /// Start of a checkpoint file, followed by num_order_books_ order books.
+  struct MECheckpointHeader {
+    uint64_t magic_ = ME_CHECKPOINT_MAGIC;
+
+    /// The matching engine shard that wrote the checkpoint, it only holds the order books of that shard.
+    uint32_t shard_index_ = 0;
+    uint32_t num_shards_ = 0;
+
+    /// Number of client requests the shard had processed, the checkpoint is the state after its first num_requests_ journaled requests.
+    uint64_t num_requests_ = 0;
+
+    uint32_t num_order_books_ = 0;
+  };
+
+  /// Start of the checkpoint of one order book, followed by its num_orders_ resting orders.
+  struct MECheckpointOrderBook {
+    TickerId ticker_id_ = TickerId_INVALID;
+    OrderId next_market_order_id_ = OrderId_INVALID;
+    uint64_t num_orders_ = 0;
+  };
+
+  /// A resting order. The orders of a side are written from the best price level to the worst and in FIFO order within a price level,
+  /// so the price levels are rebuilt by adding the orders back in file order.
+  struct MECheckpointOrder {
+    ClientId client_id_ = ClientId_INVALID;
+    OrderId client_order_id_ = OrderId_INVALID;
+    OrderId market_order_id_ = OrderId_INVALID;
+    Side side_ = Side::INVALID;
+    Price price_ = Price_INVALID;
+    Qty qty_ = Qty_INVALID;
+    Priority priority_ = Priority_INVALID;
+  };
+
+#pragma pack(pop)
+
+  /// Buffered writes of checkpoint structures to a file descriptor.
+  /// Used in the process forked to write a checkpoint, so it never allocates, locks or logs, and reports errors through its return values.
+  class MECheckpointWriter final {
+  public:
+    explicit MECheckpointWriter(int fd) noexcept : fd_(fd) {
+    }
+
+    template<typename T>
+    auto write(const T &record) noexcept -> bool {
+      if (UNLIKELY(size_ + sizeof(T) > buffer_.size()) && !flush())
+        return false;
+      std::memcpy(buffer_.data() + size_, &record, sizeof(T));
+      size_ += sizeof(T);
+      return true;
+    }
+
+    /// Write everything buffered so far to the file.
+    auto flush() noexcept -> bool {
+      for (size_t written = 0; written < size_;) {
+        const auto n = ::write(fd_, buffer_.data() + written, size_ - written);
+        if (n <= 0)
+          return false;
+        written += n;
+      }
+      size_ = 0;
+      return true;
+    }
+
+    /// Deleted default, copy & move constructors and assignment-operators.
+    MECheckpointWriter() = delete;
+
+    MECheckpointWriter(const MECheckpointWriter &) = delete;
+
+    MECheckpointWriter(const MECheckpointWriter &&) = delete;
+
+    MECheckpointWriter &operator=(const MECheckpointWriter &) = delete;
+
+    MECheckpointWriter &operator=(const MECheckpointWriter &&) = delete;
+
+  private:
+    const int fd_ = -1;
+
+    std::array<char, 64 * 1024> buffer_;
+    size_t size_ = 0;
+  };
+
+  /// Reads checkpoint structures in order from the contents of a checkpoint file.
+  class MECheckpointReader final {
+  public:
+    explicit MECheckpointReader(const std::vector<char> &data) noexcept : data_(data) {
+    }
+
+    /// The next count records of type T, nullptr if the file is too short to hold them.
+    template<typename T>
+    auto read(size_t count = 1) noexcept -> const T * {
+      if (UNLIKELY(count > (data_.size() - offset_) / sizeof(T)))
+        return nullptr;
+      const auto records = reinterpret_cast<const T *>(data_.data() + offset_);
+      offset_ += count * sizeof(T);
+      return records;
+    }
+
+    auto done() const noexcept {
+      return offset_ == data_.size();
+    }
+
+    /// Deleted default, copy & move constructors and assignment-operators.
+    MECheckpointReader() = delete;
+
+    MECheckpointReader(const MECheckpointReader &) = delete;
+
+    MECheckpointReader(const MECheckpointReader &&) = delete;
+
+    MECheckpointReader &operator=(const MECheckpointReader &) = delete;
+
+    MECheckpointReader &operator=(const MECheckpointReader &&) = delete;
+
+  private:
+    const std::vector<char> &data_;
+    size_t offset_ = 0;
+  };
+}
@@ -3,6 +3,7 @@
 #include <array>
 #include <sstream>
 #include "common/types.h"
+#include "common/flat_hash_map.h"
 
 using namespace Common;
 
@@ -22,7 +23,7 @@ namespace Exchange {
     MEOrder *prev_order_ = nullptr;
     MEOrder *next_order_ = nullptr;
 
-    /// Only needed for use with MemPool.
+    /// Only needed for use with the memory pools.
     MEOrder() = default;
 
     MEOrder(TickerId ticker_id, ClientId client_id, OrderId client_order_id, OrderId market_order_id, Side side, Price price,
@@ -33,11 +34,57 @@ namespace Exchange {
     auto toString() const -> std::string;
   };
 
-  /// Hash map from OrderId -> MEOrder.
-  typedef std::array<MEOrder *, ME_MAX_ORDER_IDS> OrderHashMap;
+  /// Key of the order lookup in the order books, the order id is only unique per client.
+  struct ClientOrderKey {
+    ClientId client_id_ = ClientId_INVALID;
+    OrderId client_order_id_ = OrderId_INVALID;
+
+    auto operator==(const ClientOrderKey &) const -> bool = default;
+  };
+
+  /// Mixes both ids so that the low bits used for the control byte and the high bits used for the slot index are independent.
+  struct ClientOrderKeyHash {
+    auto operator()(const ClientOrderKey &key) const noexcept -> size_t {
+      auto hash = key.client_order_id_ ^ (static_cast<uint64_t>(key.client_id_) << 40) ^ (static_cast<uint64_t>(key.client_id_) >> 24);
+      hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+      return (hash ^ (hash >> 31));
+    }
+  };
+
+  /// Hash map from (ClientId, OrderId) -> MEOrder, with memory proportional to the number of live orders.
+  typedef OptCommon::FlatHashMap<ClientOrderKey, MEOrder *, ClientOrderKeyHash> ClientOrderHashMap;
 
-  /// Hash map from ClientId -> OrderId -> MEOrder.
-  typedef std::array<OrderHashMap, ME_MAX_NUM_CLIENTS> ClientOrderHashMap;
+  /// Default capacity of the order lookup of an order book, enough for as many live orders as its MEOrder pool holds.
+  /// Growing the lookup allocates and fills a new table of twice the size, so add() must never have to do that on the matching thread. Erased
+  /// orders leave no tombstones behind, so the live orders alone decide when it grows and with this capacity it never does.
+  constexpr size_t ME_ORDER_INDEX_CAPACITY = ClientOrderHashMap::capacityFor(ME_MAX_ORDER_IDS);
+
+  /// Limit prices a MARKET order matches at, they only exist inside the order books. The responses to a MARKET order report Price_INVALID as
+  /// its price on both sides, see clientPrice().
+  constexpr Price MARKET_BUY_PRICE = std::numeric_limits<Price>::max();
+  constexpr Price MARKET_SELL_PRICE = std::numeric_limits<Price>::min();
+
+  /// Price of an aggressive order as reported in its client responses, Price_INVALID for a MARKET order.
+  constexpr auto clientPrice(Price price) noexcept -> Price {
+    return ((price == MARKET_BUY_PRICE || price == MARKET_SELL_PRICE) ? Price_INVALID : price);
+  }
+
+  /// How the order books report the fills of an aggressive order, passive orders always get one FILLED response per fill.
+  enum class FillReporting : uint8_t {
+    PER_ORDER = 0, // one FILLED response to the aggressor and one TRADE market update per passive order matched.
+    PER_LEVEL = 1  // one FILLED response to the aggressor and one TRADE market update per price level swept, with the quantity of the whole level.
+  };
+
+  /// What the order books do when a client's aggressive order would match a passive order of the same client, the aggressor's mode applies.
+  /// It is checked as the passive orders are reached in the match loop. A FOK order only matches if it fills in full without its own orders,
+  /// before it would reach one of them with CANCEL_NEWEST or DECREMENT_BOTH, so it is never filled in part.
+  enum class SelfTradePrevention : uint8_t {
+    NONE = 0,           // the orders match like orders of different clients.
+    CANCEL_NEWEST = 1,  // the remaining quantity of the aggressive order is canceled, the passive order is untouched.
+    CANCEL_OLDEST = 2,  // the passive order is canceled and the aggressive order carries on matching.
+    DECREMENT_BOTH = 3  // both orders lose the quantity they would have matched without a fill, an order left with no quantity is canceled.
+  };
 
   /// Used by the matching engine to represent a price level in the limit order book.
   /// Internally maintains a list of MEOrder objects arranged in FIFO order.
@@ -47,11 +94,14 @@ namespace Exchange {
 
     MEOrder *first_me_order_ = nullptr;
 
+    /// Total quantity of the orders at this price level, so that the quantity available to a FOK order can be found without walking the orders.
+    Qty qty_ = 0;
+
     /// MEOrdersAtPrice also serves as a node in a doubly linked list of price levels arranged in order from most aggressive to least aggressive price.
     MEOrdersAtPrice *prev_entry_ = nullptr;
     MEOrdersAtPrice *next_entry_ = nullptr;
 
-    /// Only needed for use with MemPool.
+    /// Only needed for use with the memory pools.
     MEOrdersAtPrice() = default;
 
     MEOrdersAtPrice(Side side, Price price, MEOrder *first_me_order, MEOrdersAtPrice *prev_entry, MEOrdersAtPrice *next_entry)
@@ -63,6 +113,7 @@ namespace Exchange {
          << "side:" << sideToString(side_) << " "
          << "price:" << priceToString(price_) << " "
          << "first_me_order:" << (first_me_order_ ? first_me_order_->toString() : "null") << " "
+         << "qty:" << qtyToString(qty_) << " "
          << "prev:" << priceToString(prev_entry_ ? prev_entry_->price_ : Price_INVALID) << " "
          << "next:" << priceToString(next_entry_ ? next_entry_->price_ : Price_INVALID) << "]";
 
@@ -3,9 +3,10 @@
 #include "matcher/matching_engine.h"
 
 namespace Exchange {
-  MEOrderBook::MEOrderBook(TickerId ticker_id, Logger *logger, MatchingEngine *matching_engine)
-      : ticker_id_(ticker_id), matching_engine_(matching_engine), orders_at_price_pool_(ME_MAX_PRICE_LEVELS), order_pool_(ME_MAX_ORDER_IDS),
-        logger_(logger) {
+  MEOrderBook::MEOrderBook(TickerId ticker_id, Logger *logger, MatchingEngineBase *matching_engine, FillReporting fill_reporting,
+                           size_t order_index_capacity)
+      : ticker_id_(ticker_id), matching_engine_(matching_engine), fill_reporting_(fill_reporting), cid_oid_to_order_(order_index_capacity),
+        orders_at_price_pool_(ME_MAX_PRICE_LEVELS), order_pool_(ME_MAX_ORDER_IDS), logger_(logger) {
   }
 
   MEOrderBook::~MEOrderBook() {
@@ -14,32 +15,35 @@ namespace Exchange {
 
     matching_engine_ = nullptr;
     bids_by_price_ = asks_by_price_ = nullptr;
-    for (auto &itr: cid_oid_to_order_) {
-      itr.fill(nullptr);
-    }
   }
 
   /// Match a new aggressive order with the provided parameters against a passive order held in the bid_itr object and generate client responses and market updates for the match.
   /// It will update the passive order (bid_itr) based on the match and possibly remove it if fully matched.
   /// It will return remaining quantity on the aggressive order in the leaves_qty parameter.
-  auto MEOrderBook::match(TickerId ticker_id, ClientId client_id, Side side, OrderId client_order_id, OrderId new_market_order_id, MEOrder* itr, Qty* leaves_qty) noexcept {
+  auto MEOrderBook::match(TickerId ticker_id, ClientId client_id, Side side, OrderId client_order_id, OrderId new_market_order_id, MEOrder* itr, Qty* leaves_qty,
+                          bool report_per_level) noexcept {
     const auto order = itr;
     const auto order_qty = order->qty_;
     const auto fill_qty = std::min(*leaves_qty, order_qty);
 
     *leaves_qty -= fill_qty;
     order->qty_ -= fill_qty;
+    getOrdersAtPrice(order->price_)->qty_ -= fill_qty;
 
-    client_response_ = {ClientResponseType::FILLED, client_id, ticker_id, client_order_id,
-                        new_market_order_id, side, itr->price_, fill_qty, *leaves_qty};
-    matching_engine_->sendClientResponse(&client_response_);
+    if (LIKELY(!report_per_level)) {
+      client_response_ = {ClientResponseType::FILLED, client_id, ticker_id, client_order_id,
+                          new_market_order_id, side, itr->price_, fill_qty, *leaves_qty};
+      matching_engine_->sendClientResponse(&client_response_);
+    }
 
     client_response_ = {ClientResponseType::FILLED, order->client_id_, ticker_id, order->client_order_id_,
                         order->market_order_id_, order->side_, itr->price_, fill_qty, order->qty_};
     matching_engine_->sendClientResponse(&client_response_);
 
-    market_update_ = {MarketUpdateType::TRADE, OrderId_INVALID, ticker_id, side, itr->price_, fill_qty, Priority_INVALID};
-    matching_engine_->sendMarketUpdate(&market_update_);
+    if (LIKELY(!report_per_level)) {
+      market_update_ = {MarketUpdateType::TRADE, OrderId_INVALID, ticker_id, side, itr->price_, fill_qty, Priority_INVALID};
+      matching_engine_->sendMarketUpdate(&market_update_);
+    }
 
     if (!order->qty_) {
       market_update_ = {MarketUpdateType::CANCEL, order->market_order_id_, ticker_id, order->side_,
@@ -61,6 +65,13 @@ namespace Exchange {
   auto MEOrderBook::checkForMatch(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty, Qty new_market_order_id) noexcept {
     auto leaves_qty = qty;
 
+    // With FillReporting::PER_LEVEL, the quantity already reported for the current price level that the passive orders have not matched yet.
+    Qty level_unmatched_qty = 0;
+
+    // Self-trade prevention can stop the aggressive order part way through a price level, so its fills are then reported per order.
+    const auto self_trade_prevention = matching_engine_->selfTradePrevention(client_id);
+    const auto report_per_level = (fill_reporting_ == FillReporting::PER_LEVEL && self_trade_prevention == SelfTradePrevention::NONE);
+
     if (side == Side::BUY) {
       while (leaves_qty && asks_by_price_) {
         const auto ask_itr = asks_by_price_->first_me_order_;
@@ -68,9 +79,22 @@ namespace Exchange {
           break;
         }
 
+        if (UNLIKELY(self_trade_prevention != SelfTradePrevention::NONE && ask_itr->client_id_ == client_id)) {
+          preventSelfTrade(self_trade_prevention, ticker_id, client_id, side, client_order_id, new_market_order_id, price, ask_itr, &leaves_qty);
+          continue;
+        }
+
+        if (UNLIKELY(report_per_level && !level_unmatched_qty)) {
+          level_unmatched_qty = std::min(leaves_qty, asks_by_price_->qty_);
+          reportLevelFill(ticker_id, client_id, side, client_order_id, new_market_order_id, ask_itr->price_, level_unmatched_qty,
+                          leaves_qty - level_unmatched_qty);
+        }
+
+        const auto prev_leaves_qty = leaves_qty;
         START_MEASURE(Exchange_MEOrderBook_match);
-        match(ticker_id, client_id, side, client_order_id, new_market_order_id, ask_itr, &leaves_qty);
+        match(ticker_id, client_id, side, client_order_id, new_market_order_id, ask_itr, &leaves_qty, report_per_level);
         END_MEASURE(Exchange_MEOrderBook_match, (*logger_));
+        level_unmatched_qty -= std::min(level_unmatched_qty, prev_leaves_qty - leaves_qty);
       }
     }
     if (side == Side::SELL) {
@@ -80,9 +104,22 @@ namespace Exchange {
           break;
         }
 
+        if (UNLIKELY(self_trade_prevention != SelfTradePrevention::NONE && bid_itr->client_id_ == client_id)) {
+          preventSelfTrade(self_trade_prevention, ticker_id, client_id, side, client_order_id, new_market_order_id, price, bid_itr, &leaves_qty);
+          continue;
+        }
+
+        if (UNLIKELY(report_per_level && !level_unmatched_qty)) {
+          level_unmatched_qty = std::min(leaves_qty, bids_by_price_->qty_);
+          reportLevelFill(ticker_id, client_id, side, client_order_id, new_market_order_id, bid_itr->price_, level_unmatched_qty,
+                          leaves_qty - level_unmatched_qty);
+        }
+
+        const auto prev_leaves_qty = leaves_qty;
         START_MEASURE(Exchange_MEOrderBook_match);
-        match(ticker_id, client_id, side, client_order_id, new_market_order_id, bid_itr, &leaves_qty);
+        match(ticker_id, client_id, side, client_order_id, new_market_order_id, bid_itr, &leaves_qty, report_per_level);
         END_MEASURE(Exchange_MEOrderBook_match, (*logger_));
+        level_unmatched_qty -= std::min(level_unmatched_qty, prev_leaves_qty - leaves_qty);
       }
     }
 
@@ -114,15 +151,32 @@ namespace Exchange {
     }
   }
 
+  /// Match a new order that never rests in the order book, quantity that does not match immediately is canceled.
+  auto MEOrderBook::addImmediate(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty,
+                                 TimeInForce time_in_force) noexcept -> void {
+    const auto new_market_order_id = generateNewMarketOrderId();
+    client_response_ = {ClientResponseType::ACCEPTED, client_id, ticker_id, client_order_id, new_market_order_id, side, clientPrice(price), 0, qty};
+    matching_engine_->sendClientResponse(&client_response_);
+
+    auto leaves_qty = qty;
+    if (LIKELY(time_in_force != TimeInForce::FOK || canFill(client_id, matching_engine_->selfTradePrevention(client_id), side, price, qty))) {
+      START_MEASURE(Exchange_MEOrderBook_checkForMatch);
+      leaves_qty = checkForMatch(client_id, client_order_id, ticker_id, side, price, qty, new_market_order_id);
+      END_MEASURE(Exchange_MEOrderBook_checkForMatch, (*logger_));
+    }
+
+    if (leaves_qty) {
+      client_response_ = {ClientResponseType::CANCELED, client_id, ticker_id, client_order_id, new_market_order_id,
+                          side, clientPrice(price), Qty_INVALID, leaves_qty};
+      matching_engine_->sendClientResponse(&client_response_);
+    }
+  }
+
   /// Attempt to cancel an order in the order book, issue a cancel-rejection if order does not exist.
   auto MEOrderBook::cancel(ClientId client_id, OrderId order_id, TickerId ticker_id) noexcept -> void {
-    auto is_cancelable = (client_id < cid_oid_to_order_.size());
-    MEOrder *exchange_order = nullptr;
-    if (LIKELY(is_cancelable)) {
-      auto &co_itr = cid_oid_to_order_.at(client_id);
-      exchange_order = co_itr.at(order_id);
-      is_cancelable = (exchange_order != nullptr);
-    }
+    const auto order_itr = cid_oid_to_order_.find({client_id, order_id});
+    MEOrder *exchange_order = (order_itr ? *order_itr : nullptr);
+    const auto is_cancelable = (exchange_order != nullptr);
 
     if (UNLIKELY(!is_cancelable)) {
       client_response_ = {ClientResponseType::CANCEL_REJECTED, client_id, ticker_id, order_id, OrderId_INVALID,
@@ -143,6 +197,90 @@ namespace Exchange {
     matching_engine_->sendClientResponse(&client_response_);
   }
 
+  /// Change the price and / or quantity of an order in the order book, issue a modify-rejection if order does not exist.
+  auto MEOrderBook::modify(ClientId client_id, OrderId order_id, TickerId ticker_id, Side side, Price price, Qty qty) noexcept -> void {
+    const auto order_itr = cid_oid_to_order_.find({client_id, order_id});
+    MEOrder *exchange_order = (order_itr ? *order_itr : nullptr);
+    const auto is_modifiable = (exchange_order != nullptr && exchange_order->side_ == side && price != Price_INVALID && qty && qty != Qty_INVALID);
+
+    if (UNLIKELY(!is_modifiable)) {
+      client_response_ = {ClientResponseType::MODIFY_REJECTED, client_id, ticker_id, order_id, OrderId_INVALID,
+                          side, price, Qty_INVALID, Qty_INVALID};
+      matching_engine_->sendClientResponse(&client_response_);
+      return;
+    }
+
+    const auto market_order_id = exchange_order->market_order_id_;
+    client_response_ = {ClientResponseType::MODIFIED, client_id, ticker_id, order_id, market_order_id, side, price, 0, qty};
+    matching_engine_->sendClientResponse(&client_response_);
+
+    if (price == exchange_order->price_ && qty <= exchange_order->qty_) { // quantity decrease, keeps its place in the FIFO queue.
+      getOrdersAtPrice(price)->qty_ -= (exchange_order->qty_ - qty);
+      exchange_order->qty_ = qty;
+      market_update_ = {MarketUpdateType::MODIFY, market_order_id, ticker_id, side, price, qty, exchange_order->priority_};
+      matching_engine_->sendMarketUpdate(&market_update_);
+      return;
+    }
+
+    // The order is re-inserted with its market order id kept. Market data sees a single MODIFY with the new price and priority,
+    // unless the new price crosses the book, in which case it sees a CANCEL, the trades and an ADD for the remaining quantity.
+    const auto crosses = (side == Side::BUY ? (asks_by_price_ && price >= asks_by_price_->price_) :
+                          (bids_by_price_ && price <= bids_by_price_->price_));
+    if (UNLIKELY(crosses)) {
+      market_update_ = {MarketUpdateType::CANCEL, market_order_id, ticker_id, side, exchange_order->price_, 0, exchange_order->priority_};
+      matching_engine_->sendMarketUpdate(&market_update_);
+    }
+
+    START_MEASURE(Exchange_MEOrderBook_removeOrder);
+    removeOrder(exchange_order);
+    END_MEASURE(Exchange_MEOrderBook_removeOrder, (*logger_));
+
+    START_MEASURE(Exchange_MEOrderBook_checkForMatch);
+    const auto leaves_qty = checkForMatch(client_id, order_id, ticker_id, side, price, qty, market_order_id);
+    END_MEASURE(Exchange_MEOrderBook_checkForMatch, (*logger_));
+
+    if (LIKELY(leaves_qty)) {
+      const auto priority = getNextPriority(price);
+
+      auto order = order_pool_.allocate(ticker_id, client_id, order_id, market_order_id, side, price, leaves_qty, priority, nullptr, nullptr);
+      START_MEASURE(Exchange_MEOrderBook_addOrder);
+      addOrder(order);
+      END_MEASURE(Exchange_MEOrderBook_addOrder, (*logger_));
+
+      market_update_ = {(crosses ? MarketUpdateType::ADD : MarketUpdateType::MODIFY), market_order_id, ticker_id, side, price, leaves_qty, priority};
+      matching_engine_->sendMarketUpdate(&market_update_);
+    }
+  }
+
+  auto MEOrderBook::writeCheckpoint(MECheckpointWriter *writer) const noexcept -> bool {
+    if (!writer->write(MECheckpointOrderBook{ticker_id_, next_market_order_id_, cid_oid_to_order_.size()}))
+      return false;
+
+    for (const auto best_orders_by_price: {asks_by_price_, bids_by_price_}) {
+      for (auto orders_at_price = best_orders_by_price; orders_at_price;
+           orders_at_price = (orders_at_price->next_entry_ == best_orders_by_price ? nullptr : orders_at_price->next_entry_)) {
+        for (auto order = orders_at_price->first_me_order_;; order = order->next_order_) {
+          if (!writer->write(MECheckpointOrder{order->client_id_, order->client_order_id_, order->market_order_id_, order->side_, order->price_,
+                                               order->qty_, order->priority_}))
+            return false;
+          if (order->next_order_ == orders_at_price->first_me_order_)
+            break;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  auto MEOrderBook::restoreOrder(const MECheckpointOrder &checkpoint_order) noexcept -> void {
+    auto order = order_pool_.allocate(ticker_id_, checkpoint_order.client_id_, checkpoint_order.client_order_id_, checkpoint_order.market_order_id_,
+                                      checkpoint_order.side_, checkpoint_order.price_, checkpoint_order.qty_, checkpoint_order.priority_, nullptr, nullptr);
+    addOrder(order);
+
+    market_update_ = {MarketUpdateType::ADD, order->market_order_id_, ticker_id_, order->side_, order->price_, order->qty_, order->priority_};
+    matching_engine_->sendMarketUpdate(&market_update_);
+  }
+
   auto MEOrderBook::toString(bool detailed, bool validity_check) const -> std::string {
     std::stringstream ss;
     std::string time_str;
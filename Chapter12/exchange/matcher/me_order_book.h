@@ -1,21 +1,28 @@
 #pragma once
 
 #include "common/types.h"
-#include "common/mem_pool.h"
+#include "common/free_list_mem_pool.h"
+#include "common/huge_page_allocator.h"
 #include "common/logging.h"
+#include "order_server/client_request.h"
 #include "order_server/client_response.h"
 #include "market_data/market_update.h"
 
 #include "me_order.h"
+#include "me_order_book_matching.h"
+#include "me_checkpoint.h"
 
 using namespace Common;
 
 namespace Exchange {
-  class MatchingEngine;
+  class MatchingEngineBase;
 
-  class MEOrderBook final {
+  /// The order book is placed on huge pages of its own, see OptCommon::HugePageObject.
+  class MEOrderBook final : public MEOrderBookMatching<MEOrderBook>, public OptCommon::HugePageObject {
   public:
-    explicit MEOrderBook(TickerId ticker_id, Logger *logger, MatchingEngine *matching_engine);
+    /// order_index_capacity sizes the (ClientId, OrderId) lookup upfront for the expected peak number of live orders of this book.
+    explicit MEOrderBook(TickerId ticker_id, Logger *logger, MatchingEngineBase *matching_engine, FillReporting fill_reporting = FillReporting::PER_ORDER,
+                         size_t order_index_capacity = ME_ORDER_INDEX_CAPACITY);
 
     ~MEOrderBook();
 
@@ -23,9 +30,49 @@ namespace Exchange {
     /// It will check to see if this new order matches an existing passive order with opposite side, and perform the matching if that is the case.
     auto add(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty) noexcept -> void;
 
+    /// Match a new order that never rests in the order book - an IOC or FOK limit order, or a market order with the most aggressive price as limit.
+    /// Quantity that does not match immediately is canceled, a FOK order is canceled in full without matching if it cannot be filled in full.
+    /// Unlike add() it never allocates an MEOrder or touches the order hash map, and does not publish ADD or CANCEL market updates for itself.
+    auto addImmediate(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty,
+                      TimeInForce time_in_force) noexcept -> void;
+
     /// Attempt to cancel an order in the order book, issue a cancel-rejection if order does not exist.
     auto cancel(ClientId client_id, OrderId order_id, TickerId ticker_id) noexcept -> void;
 
+    /// Change the price and / or quantity of an order in the order book, issue a modify-rejection if order does not exist.
+    /// A quantity decrease at the same price is applied in place and keeps the order's priority. Any other change moves the order to the back of
+    /// the FIFO queue at the new price, matching it first if the new price crosses the other side of the order book.
+    auto modify(ClientId client_id, OrderId order_id, TickerId ticker_id, Side side, Price price, Qty qty) noexcept -> void;
+
+    /// Call f with every resting order - asks then bids, each from the best price level to the worst and in FIFO order within a price level.
+    /// f must not change the order book.
+    template<typename F>
+    auto forEachOrder(F &&f) const noexcept {
+      for (const auto best_orders_by_price: {asks_by_price_, bids_by_price_}) {
+        for (auto orders_at_price = best_orders_by_price; orders_at_price;
+             orders_at_price = (orders_at_price->next_entry_ == best_orders_by_price ? nullptr : orders_at_price->next_entry_)) {
+          for (auto order = orders_at_price->first_me_order_;; order = order->next_order_) {
+            f(*order);
+            if (order->next_order_ == orders_at_price->first_me_order_)
+              break;
+          }
+        }
+      }
+    }
+
+    /// Write the order book's checkpoint - next_market_order_id_ and the resting orders, asks then bids, each from the best price level to the
+    /// worst and in FIFO order within a price level. Called in the process forked to write a checkpoint, it does not log or allocate.
+    auto writeCheckpoint(MECheckpointWriter *writer) const noexcept -> bool;
+
+    /// Rebuild the order book from its checkpoint, calling restoreOrder() for every order in file order.
+    /// Only before the order book processes any client request, or to number the orders from 1 again once the journal is reset with no order left.
+    auto restoreNextMarketOrderId(OrderId next_market_order_id) noexcept {
+      next_market_order_id_ = next_market_order_id;
+    }
+
+    /// Add the order at the back of the FIFO queue of its price level with its original market order id and priority, and publish it as an ADD.
+    auto restoreOrder(const MECheckpointOrder &checkpoint_order) noexcept -> void;
+
     auto toString(bool detailed, bool validity_check) const -> std::string;
 
     /// Deleted default, copy & move constructors and assignment-operators.
@@ -40,16 +87,20 @@ namespace Exchange {
     MEOrderBook &operator=(const MEOrderBook &&) = delete;
 
   private:
+    friend class MEOrderBookMatching<MEOrderBook>;
+
     TickerId ticker_id_ = TickerId_INVALID;
 
     /// The parent matching engine instance, used to publish market data and client responses.
-    MatchingEngine *matching_engine_ = nullptr;
+    MatchingEngineBase *matching_engine_ = nullptr;
+
+    const FillReporting fill_reporting_ = FillReporting::PER_ORDER;
 
-    /// Hash map from ClientId -> OrderId -> MEOrder.
+    /// Hash map from (ClientId, OrderId) -> MEOrder.
     ClientOrderHashMap cid_oid_to_order_;
 
     /// Memory pool to manage MEOrdersAtPrice objects.
-    MemPool<MEOrdersAtPrice> orders_at_price_pool_;
+    OptCommon::FreeListMemPool<MEOrdersAtPrice> orders_at_price_pool_;
 
     /// Pointers to beginning / best prices / top of book of buy and sell price levels.
     MEOrdersAtPrice *bids_by_price_ = nullptr;
@@ -59,7 +110,7 @@ namespace Exchange {
     OrdersAtPriceHashMap price_orders_at_price_;
 
     /// Memory pool to manage MEOrder objects.
-    MemPool<MEOrder> order_pool_;
+    OptCommon::FreeListMemPool<MEOrder> order_pool_;
 
     /// These are used to publish client responses and market updates.
     MEClientResponse client_response_;
@@ -154,6 +205,26 @@ namespace Exchange {
       orders_at_price_pool_.deallocate(orders_at_price);
     }
 
+    /// True if the other side of the order book holds at least qty at prices that match the provided price, for a FOK order of client_id.
+    /// Walks the price levels using their total quantity and not the orders in them, unless the client has self-trade prevention - then the
+    /// client's own orders are left out and running into one that would stop the fill returns false.
+    auto canFill(ClientId client_id, SelfTradePrevention self_trade_prevention, Side side, Price price, Qty qty) const noexcept {
+      const auto best_orders_by_price = (side == Side::BUY ? asks_by_price_ : bids_by_price_);
+      Qty available_qty = 0;
+      for (auto orders_at_price = best_orders_by_price; orders_at_price;
+           orders_at_price = (orders_at_price->next_entry_ == best_orders_by_price ? nullptr : orders_at_price->next_entry_)) {
+        if (side == Side::BUY ? price < orders_at_price->price_ : price > orders_at_price->price_)
+          break;
+        if (self_trade_prevention == SelfTradePrevention::NONE)
+          available_qty += orders_at_price->qty_;
+        else if (!addFillableQty(client_id, self_trade_prevention, orders_at_price->first_me_order_, qty, &available_qty))
+          return false;
+        if (available_qty >= qty)
+          return true;
+      }
+      return false;
+    }
+
     auto getNextPriority(Price price) noexcept {
       const auto orders_at_price = getOrdersAtPrice(price);
       if (!orders_at_price)
@@ -165,12 +236,19 @@ namespace Exchange {
     /// Match a new aggressive order with the provided parameters against a passive order held in the bid_itr object and generate client responses and market updates for the match.
     /// It will update the passive order (bid_itr) based on the match and possibly remove it if fully matched.
     /// It will return remaining quantity on the aggressive order in the leaves_qty parameter.
-    auto match(TickerId ticker_id, ClientId client_id, Side side, OrderId client_order_id, OrderId new_market_order_id, MEOrder* bid_itr, Qty* leaves_qty) noexcept;
+    /// With report_per_level the aggressor's fill has already been reported by reportLevelFill().
+    auto match(TickerId ticker_id, ClientId client_id, Side side, OrderId client_order_id, OrderId new_market_order_id, MEOrder* bid_itr, Qty* leaves_qty,
+               bool report_per_level) noexcept;
 
     /// Check if a new order with the provided attributes would match against existing passive orders on the other side of the order book.
     /// This will call the match() method to perform the match if there is a match to be made and return the quantity remaining if any on this new order.
     auto checkForMatch(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty, Qty new_market_order_id) noexcept;
 
+    /// Take quantity off the total of the price level, for an order whose quantity is reduced in place.
+    auto reduceLevelQty([[maybe_unused]] Side side, Price price, Qty qty) noexcept {
+      getOrdersAtPrice(price)->qty_ -= qty;
+    }
+
     /// Remove and de-allocate provided order from the containers.
     auto removeOrder(MEOrder *order) noexcept {
       auto orders_at_price = getOrdersAtPrice(order->price_);
@@ -186,11 +264,12 @@ namespace Exchange {
         if (orders_at_price->first_me_order_ == order) {
           orders_at_price->first_me_order_ = order_after;
         }
+        orders_at_price->qty_ -= order->qty_;
 
         order->prev_order_ = order->next_order_ = nullptr;
       }
 
-      cid_oid_to_order_.at(order->client_id_).at(order->client_order_id_) = nullptr;
+      cid_oid_to_order_.erase({order->client_id_, order->client_order_id_});
       order_pool_.deallocate(order);
     }
 
@@ -202,6 +281,7 @@ namespace Exchange {
         order->next_order_ = order->prev_order_ = order;
 
         auto new_orders_at_price = orders_at_price_pool_.allocate(order->side_, order->price_, order, nullptr, nullptr);
+        new_orders_at_price->qty_ = order->qty_;
         addOrdersAtPrice(new_orders_at_price);
       } else {
         auto first_order = (orders_at_price ? orders_at_price->first_me_order_ : nullptr);
@@ -210,12 +290,10 @@ namespace Exchange {
         order->prev_order_ = first_order->prev_order_;
         order->next_order_ = first_order;
         first_order->prev_order_ = order;
+        orders_at_price->qty_ += order->qty_;
       }
 
-      cid_oid_to_order_.at(order->client_id_).at(order->client_order_id_) = order;
+      cid_oid_to_order_.insert({order->client_id_, order->client_order_id_}, order);
     }
   };
-
-  /// A hash map from TickerId -> MEOrderBook.
-  typedef std::array<MEOrderBook *, ME_MAX_TICKERS> OrderBookHashMap;
 }
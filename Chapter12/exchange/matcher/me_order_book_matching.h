@@ -0,0 +1,116 @@
+#pragma once
+
+#include "common/types.h"
+#include "order_server/client_response.h"
+#include "market_data/market_update.h"
+
+#include "me_order.h"
+
+namespace Exchange {
+  /// The parts of matching an aggressive order that do not depend on how an order book keeps its price levels - fills reported per price level
+  /// and self-trade prevention - shared by MEOrderBook, LadderMEOrderBook and UnorderedMapMEOrderBook without virtual calls.
+  /// OrderBookT derives from MEOrderBookMatching<OrderBookT>, declares it a friend and provides matching_engine_, client_response_,
+  /// market_update_, removeOrder(MEOrder *) and reduceLevelQty(Side, Price, Qty) to take quantity off the total of a price level.
+  template<typename OrderBookT>
+  class MEOrderBookMatching {
+  protected:
+    /// Report the fill of an aggressive order against a whole price level with a single client response and trade, used with FillReporting::PER_LEVEL.
+    /// Called before the passive orders at the level are matched one at a time.
+    auto reportLevelFill(TickerId ticker_id, ClientId client_id, Side side, OrderId client_order_id, OrderId new_market_order_id,
+                         Price price, Qty fill_qty, Qty leaves_qty) noexcept -> void {
+      auto &book = orderBook();
+      book.client_response_ = {ClientResponseType::FILLED, client_id, ticker_id, client_order_id,
+                               new_market_order_id, side, price, fill_qty, leaves_qty};
+      book.matching_engine_->sendClientResponse(&book.client_response_);
+
+      book.market_update_ = {MarketUpdateType::TRADE, OrderId_INVALID, ticker_id, side, price, fill_qty, Priority_INVALID};
+      book.matching_engine_->sendMarketUpdate(&book.market_update_);
+    }
+
+    /// Apply the aggressor's self-trade prevention mode to a passive order of the same client, instead of matching the two orders.
+    /// It will return remaining quantity on the aggressive order in the leaves_qty parameter.
+    auto preventSelfTrade(SelfTradePrevention self_trade_prevention, TickerId ticker_id, ClientId client_id, Side side, OrderId client_order_id,
+                          OrderId new_market_order_id, Price price, MEOrder *order, Qty *leaves_qty) noexcept -> void {
+      auto &book = orderBook();
+      switch (self_trade_prevention) {
+        case SelfTradePrevention::CANCEL_NEWEST: {
+          book.client_response_ = {ClientResponseType::CANCELED, client_id, ticker_id, client_order_id, new_market_order_id,
+                                   side, clientPrice(price), Qty_INVALID, *leaves_qty};
+          book.matching_engine_->sendClientResponse(&book.client_response_);
+          *leaves_qty = 0;
+        }
+          break;
+
+        case SelfTradePrevention::CANCEL_OLDEST: {
+          book.client_response_ = {ClientResponseType::CANCELED, order->client_id_, ticker_id, order->client_order_id_, order->market_order_id_,
+                                   order->side_, order->price_, Qty_INVALID, order->qty_};
+          book.matching_engine_->sendClientResponse(&book.client_response_);
+          book.market_update_ = {MarketUpdateType::CANCEL, order->market_order_id_, ticker_id, order->side_, order->price_, 0, order->priority_};
+          book.matching_engine_->sendMarketUpdate(&book.market_update_);
+
+          book.removeOrder(order);
+        }
+          break;
+
+        case SelfTradePrevention::DECREMENT_BOTH: { // an order that keeps some quantity is told its new quantity with a MODIFIED response.
+          // Like cancel() and addImmediate(), a CANCELED response reports the quantity the order had left when it was canceled.
+          const auto aggressor_qty = *leaves_qty;
+          const auto passive_qty = order->qty_;
+          const auto decrement_qty = std::min(aggressor_qty, passive_qty);
+          *leaves_qty -= decrement_qty;
+          order->qty_ -= decrement_qty;
+          book.reduceLevelQty(order->side_, order->price_, decrement_qty);
+
+          book.client_response_ = (*leaves_qty ? MEClientResponse{ClientResponseType::MODIFIED, client_id, ticker_id, client_order_id, new_market_order_id,
+                                                                  side, clientPrice(price), 0, *leaves_qty} :
+                                   MEClientResponse{ClientResponseType::CANCELED, client_id, ticker_id, client_order_id, new_market_order_id,
+                                                    side, clientPrice(price), Qty_INVALID, aggressor_qty});
+          book.matching_engine_->sendClientResponse(&book.client_response_);
+
+          if (order->qty_) {
+            book.client_response_ = {ClientResponseType::MODIFIED, order->client_id_, ticker_id, order->client_order_id_, order->market_order_id_,
+                                     order->side_, order->price_, 0, order->qty_};
+            book.matching_engine_->sendClientResponse(&book.client_response_);
+            book.market_update_ = {MarketUpdateType::MODIFY, order->market_order_id_, ticker_id, order->side_, order->price_, order->qty_,
+                                   order->priority_};
+            book.matching_engine_->sendMarketUpdate(&book.market_update_);
+          } else {
+            book.client_response_ = {ClientResponseType::CANCELED, order->client_id_, ticker_id, order->client_order_id_, order->market_order_id_,
+                                     order->side_, order->price_, Qty_INVALID, passive_qty};
+            book.matching_engine_->sendClientResponse(&book.client_response_);
+            book.market_update_ = {MarketUpdateType::CANCEL, order->market_order_id_, ticker_id, order->side_, order->price_, 0, order->priority_};
+            book.matching_engine_->sendMarketUpdate(&book.market_update_);
+
+            book.removeOrder(order);
+          }
+        }
+          break;
+
+        default:
+          break;
+      }
+    }
+
+    /// Add the quantity a FOK order of client_id with self-trade prevention can fill from the FIFO queue of a price level, starting at first_order,
+    /// to available_qty, stopping once it reaches qty. Returns false if the FOK order runs into an order of its own client before that and its
+    /// mode would then keep it from filling in full - CANCEL_NEWEST cancels the rest of it and DECREMENT_BOTH takes quantity off without a fill.
+    /// CANCEL_OLDEST cancels the resting order and carries on, so those orders are only skipped.
+    static auto addFillableQty(ClientId client_id, SelfTradePrevention self_trade_prevention, const MEOrder *first_order, Qty qty,
+                               Qty *available_qty) noexcept -> bool {
+      for (auto order = first_order;; order = order->next_order_) {
+        if (order->client_id_ != client_id)
+          *available_qty += order->qty_;
+        else if (self_trade_prevention != SelfTradePrevention::CANCEL_OLDEST)
+          return false;
+
+        if (*available_qty >= qty || order->next_order_ == first_order)
+          return true;
+      }
+    }
+
+  private:
+    auto orderBook() noexcept -> OrderBookT & {
+      return *static_cast<OrderBookT *>(this);
+    }
+  };
+}
@@ -3,21 +3,24 @@
 #include <unordered_map>
 
 #include "common/types.h"
-#include "common/mem_pool.h"
+#include "common/free_list_mem_pool.h"
 #include "common/logging.h"
+#include "order_server/client_request.h"
 #include "order_server/client_response.h"
 #include "market_data/market_update.h"
 
 #include "me_order.h"
+#include "me_order_book_matching.h"
 
 using namespace Common;
 
 namespace Exchange {
-  class MatchingEngine;
+  class MatchingEngineBase;
 
-  class UnorderedMapMEOrderBook final {
+  /// Same interface and behaviour as MEOrderBook, but orders and price levels are looked up in std::unordered_map instead of flat hash maps and arrays.
+  class UnorderedMapMEOrderBook final : public MEOrderBookMatching<UnorderedMapMEOrderBook> {
   public:
-    explicit UnorderedMapMEOrderBook(TickerId ticker_id, Logger *logger, MatchingEngine *matching_engine);
+    explicit UnorderedMapMEOrderBook(TickerId ticker_id, Logger *logger, MatchingEngineBase *matching_engine, FillReporting fill_reporting = FillReporting::PER_ORDER);
 
     ~UnorderedMapMEOrderBook();
 
@@ -25,9 +28,40 @@ namespace Exchange {
     /// It will check to see if this new order matches an existing passive order with opposite side, and perform the matching if that is the case.
     auto add(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty) noexcept -> void;
 
+    /// Match a new order that never rests in the order book - an IOC or FOK limit order, or a market order with the most aggressive price as limit.
+    /// Quantity that does not match immediately is canceled, a FOK order is canceled in full without matching if it cannot be filled in full.
+    /// Unlike add() it never allocates an MEOrder or touches the order hash map, and does not publish ADD or CANCEL market updates for itself.
+    auto addImmediate(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty,
+                      TimeInForce time_in_force) noexcept -> void;
+
     /// Attempt to cancel an order in the order book, issue a cancel-rejection if order does not exist.
     auto cancel(ClientId client_id, OrderId order_id, TickerId ticker_id) noexcept -> void;
 
+    /// Change the price and / or quantity of an order in the order book, issue a modify-rejection if order does not exist.
+    /// A quantity decrease at the same price is applied in place and keeps the order's priority. Any other change moves the order to the back of
+    /// the FIFO queue at the new price, matching it first if the new price crosses the other side of the order book.
+    auto modify(ClientId client_id, OrderId order_id, TickerId ticker_id, Side side, Price price, Qty qty) noexcept -> void;
+
+    /// Call f with every resting order, same order as MEOrderBook::forEachOrder(). f must not change the order book.
+    template<typename F>
+    auto forEachOrder(F &&f) const noexcept {
+      for (const auto best_orders_by_price: {asks_by_price_, bids_by_price_}) {
+        for (auto orders_at_price = best_orders_by_price; orders_at_price;
+             orders_at_price = (orders_at_price->next_entry_ == best_orders_by_price ? nullptr : orders_at_price->next_entry_)) {
+          for (auto order = orders_at_price->first_me_order_;; order = order->next_order_) {
+            f(*order);
+            if (order->next_order_ == orders_at_price->first_me_order_)
+              break;
+          }
+        }
+      }
+    }
+
+    /// Set the market order id of the next order, see MEOrderBook::restoreNextMarketOrderId().
+    auto restoreNextMarketOrderId(OrderId next_market_order_id) noexcept {
+      next_market_order_id_ = next_market_order_id;
+    }
+
     auto toString(bool detailed, bool validity_check) const -> std::string;
 
     /// Deleted default, copy & move constructors and assignment-operators.
@@ -42,16 +76,20 @@ namespace Exchange {
     UnorderedMapMEOrderBook &operator=(const UnorderedMapMEOrderBook &&) = delete;
 
   private:
+    friend class MEOrderBookMatching<UnorderedMapMEOrderBook>;
+
     TickerId ticker_id_ = TickerId_INVALID;
 
     /// The parent matching engine instance, used to publish market data and client responses.
-    MatchingEngine *matching_engine_ = nullptr;
+    MatchingEngineBase *matching_engine_ = nullptr;
+
+    const FillReporting fill_reporting_ = FillReporting::PER_ORDER;
 
     /// Hash map from ClientId -> OrderId -> MEOrder.
     std::unordered_map<ClientId, std::unordered_map<OrderId, MEOrder *>> cid_oid_to_order_;
 
     /// Memory pool to manage MEOrdersAtPrice objects.
-    MemPool<MEOrdersAtPrice> orders_at_price_pool_;
+    OptCommon::FreeListMemPool<MEOrdersAtPrice> orders_at_price_pool_;
 
     /// Pointers to beginning / best prices / top of book of buy and sell price levels.
     MEOrdersAtPrice *bids_by_price_ = nullptr;
@@ -61,7 +99,7 @@ namespace Exchange {
     std::unordered_map<Price, MEOrdersAtPrice *> price_orders_at_price_;
 
     /// Memory pool to manage MEOrder objects.
-    MemPool<MEOrder> order_pool_;
+    OptCommon::FreeListMemPool<MEOrder> order_pool_;
 
     /// These are used to publish client responses and market updates.
     MEClientResponse client_response_;
@@ -89,6 +127,16 @@ namespace Exchange {
       return price_orders_at_price_.at(priceToIndex(price));
     }
 
+    /// Fetch and return the live order with the provided client and order ids, nullptr if there is none. Does not insert into the hash maps.
+    auto getOrder(ClientId client_id, OrderId order_id) const noexcept -> MEOrder * {
+      const auto client_orders = cid_oid_to_order_.find(client_id);
+      if (client_orders == cid_oid_to_order_.end())
+        return nullptr;
+
+      const auto order = client_orders->second.find(order_id);
+      return (order == client_orders->second.end() ? nullptr : order->second);
+    }
+
     /// Add a new MEOrdersAtPrice at the correct price into the containers - the hash map and the doubly linked list of price levels.
     auto addOrdersAtPrice(MEOrdersAtPrice *new_orders_at_price) noexcept {
       price_orders_at_price_[priceToIndex(new_orders_at_price->price_)] = new_orders_at_price;
@@ -159,6 +207,26 @@ namespace Exchange {
       orders_at_price_pool_.deallocate(orders_at_price);
     }
 
+    /// True if the other side of the order book holds at least qty at prices that match the provided price, for a FOK order of client_id.
+    /// Walks the price levels using their total quantity and not the orders in them, unless the client has self-trade prevention - then the
+    /// client's own orders are left out and running into one that would stop the fill returns false.
+    auto canFill(ClientId client_id, SelfTradePrevention self_trade_prevention, Side side, Price price, Qty qty) const noexcept {
+      const auto best_orders_by_price = (side == Side::BUY ? asks_by_price_ : bids_by_price_);
+      Qty available_qty = 0;
+      for (auto orders_at_price = best_orders_by_price; orders_at_price;
+           orders_at_price = (orders_at_price->next_entry_ == best_orders_by_price ? nullptr : orders_at_price->next_entry_)) {
+        if (side == Side::BUY ? price < orders_at_price->price_ : price > orders_at_price->price_)
+          break;
+        if (self_trade_prevention == SelfTradePrevention::NONE)
+          available_qty += orders_at_price->qty_;
+        else if (!addFillableQty(client_id, self_trade_prevention, orders_at_price->first_me_order_, qty, &available_qty))
+          return false;
+        if (available_qty >= qty)
+          return true;
+      }
+      return false;
+    }
+
     auto getNextPriority(Price price) noexcept {
       const auto orders_at_price = getOrdersAtPrice(price);
       if (!orders_at_price)
@@ -170,12 +238,19 @@ namespace Exchange {
     /// Match a new aggressive order with the provided parameters against a passive order held in the bid_itr object and generate client responses and market updates for the match.
     /// It will update the passive order (bid_itr) based on the match and possibly remove it if fully matched.
     /// It will return remaining quantity on the aggressive order in the leaves_qty parameter.
-    auto match(TickerId ticker_id, ClientId client_id, Side side, OrderId client_order_id, OrderId new_market_order_id, MEOrder* bid_itr, Qty* leaves_qty) noexcept;
+    /// With report_per_level the aggressor's fill has already been reported by reportLevelFill().
+    auto match(TickerId ticker_id, ClientId client_id, Side side, OrderId client_order_id, OrderId new_market_order_id, MEOrder* bid_itr, Qty* leaves_qty,
+               bool report_per_level) noexcept;
 
     /// Check if a new order with the provided attributes would match against existing passive orders on the other side of the order book.
     /// This will call the match() method to perform the match if there is a match to be made and return the quantity remaining if any on this new order.
     auto checkForMatch(ClientId client_id, OrderId client_order_id, TickerId ticker_id, Side side, Price price, Qty qty, Qty new_market_order_id) noexcept;
 
+    /// Take quantity off the total of the price level, for an order whose quantity is reduced in place.
+    auto reduceLevelQty([[maybe_unused]] Side side, Price price, Qty qty) noexcept {
+      getOrdersAtPrice(price)->qty_ -= qty;
+    }
+
     /// Remove and de-allocate provided order from the containers.
     auto removeOrder(MEOrder *order) noexcept {
       auto orders_at_price = getOrdersAtPrice(order->price_);
@@ -191,6 +266,7 @@ namespace Exchange {
         if (orders_at_price->first_me_order_ == order) {
           orders_at_price->first_me_order_ = order_after;
         }
+        orders_at_price->qty_ -= order->qty_;
 
         order->prev_order_ = order->next_order_ = nullptr;
       }
@@ -207,6 +283,7 @@ namespace Exchange {
         order->next_order_ = order->prev_order_ = order;
 
         auto new_orders_at_price = orders_at_price_pool_.allocate(order->side_, order->price_, order, nullptr, nullptr);
+        new_orders_at_price->qty_ = order->qty_;
         addOrdersAtPrice(new_orders_at_price);
       } else {
         auto first_order = (orders_at_price ? orders_at_price->first_me_order_ : nullptr);
@@ -215,6 +292,7 @@ namespace Exchange {
         order->prev_order_ = first_order->prev_order_;
         order->next_order_ = first_order;
         first_order->prev_order_ = order;
+        orders_at_price->qty_ += order->qty_;
       }
 
       cid_oid_to_order_[order->client_id_][order->client_order_id_] = order;
@@ -3,7 +3,7 @@
 #include <sstream>
 
 #include "common/types.h"
-#include "common/lf_queue.h"
+#include "common/opt_lf_queue.h"
 
 using namespace Common;
 
@@ -12,7 +12,9 @@ namespace Exchange {
   enum class ClientRequestType : uint8_t {
     INVALID = 0,
     NEW = 1,
-    CANCEL = 2
+    CANCEL = 2,
+    MODIFY = 3,
+    MARKET = 4 // new order without a price limit, it never rests in the order book.
   };
 
   inline std::string clientRequestTypeToString(ClientRequestType type) {
@@ -21,12 +23,39 @@ namespace Exchange {
         return "NEW";
       case ClientRequestType::CANCEL:
         return "CANCEL";
+      case ClientRequestType::MODIFY:
+        return "MODIFY";
+      case ClientRequestType::MARKET:
+        return "MARKET";
       case ClientRequestType::INVALID:
         return "INVALID";
     }
     return "UNKNOWN";
   }
 
+  /// How long the quantity of a new order that does not match immediately stays in the order book.
+  /// DAY orders rest until filled or canceled, IOC orders cancel it right away and FOK orders are canceled in full unless they can be filled in full.
+  enum class TimeInForce : uint8_t {
+    INVALID = 0,
+    DAY = 1,
+    IOC = 2,
+    FOK = 3
+  };
+
+  inline std::string timeInForceToString(TimeInForce time_in_force) {
+    switch (time_in_force) {
+      case TimeInForce::DAY:
+        return "DAY";
+      case TimeInForce::IOC:
+        return "IOC";
+      case TimeInForce::FOK:
+        return "FOK";
+      case TimeInForce::INVALID:
+        return "INVALID";
+    }
+    return "UNKNOWN";
+  }
+
   /// These structures go over the wire / network, so the binary structures are packed to remove system dependent extra padding.
 #pragma pack(push, 1)
 
@@ -40,6 +69,7 @@ namespace Exchange {
     Side side_ = Side::INVALID;
     Price price_ = Price_INVALID;
     Qty qty_ = Qty_INVALID;
+    TimeInForce time_in_force_ = TimeInForce::DAY;
 
     auto toString() const {
       std::stringstream ss;
@@ -52,6 +82,7 @@ namespace Exchange {
          << " side:" << sideToString(side_)
          << " qty:" << qtyToString(qty_)
          << " price:" << priceToString(price_)
+         << " tif:" << timeInForceToString(time_in_force_)
          << "]";
       return ss.str();
     }
@@ -76,5 +107,13 @@ namespace Exchange {
 #pragma pack(pop) // Undo the packed binary structure directive moving forward.
 
   /// Lock free queues of matching engine client order request messages.
-  typedef LFQueue<MEClientRequest> ClientRequestLFQueue;
+  typedef OptCommon::OptLFQueue<MEClientRequest> ClientRequestLFQueue;
+
+  /// Maximum number of matching engine threads, each one owns at least one ticker.
+  constexpr size_t ME_MAX_MATCHING_SHARDS = ME_MAX_TICKERS;
+
+  /// Index of the matching engine shard that owns the order book of the ticker, all requests for a ticker go through the same shard in order.
+  inline auto tickerIdToShard(TickerId ticker_id, size_t num_shards) noexcept -> size_t {
+    return (ticker_id % num_shards);
+  }
 }
@@ -3,7 +3,7 @@
 #include <sstream>
 
 #include "common/types.h"
-#include "common/lf_queue.h"
+#include "common/opt_lf_queue.h"
 
 using namespace Common;
 
@@ -14,7 +14,9 @@ namespace Exchange {
     ACCEPTED = 1,
     CANCELED = 2,
     FILLED = 3,
-    CANCEL_REJECTED = 4
+    CANCEL_REJECTED = 4,
+    MODIFIED = 5,
+    MODIFY_REJECTED = 6
   };
 
   inline std::string clientResponseTypeToString(ClientResponseType type) {
@@ -27,6 +29,10 @@ namespace Exchange {
         return "FILLED";
       case ClientResponseType::CANCEL_REJECTED:
         return "CANCEL_REJECTED";
+      case ClientResponseType::MODIFIED:
+        return "MODIFIED";
+      case ClientResponseType::MODIFY_REJECTED:
+        return "MODIFY_REJECTED";
       case ClientResponseType::INVALID:
         return "INVALID";
     }
@@ -85,5 +91,5 @@ namespace Exchange {
 #pragma pack(pop) // Undo the packed binary structure directive moving forward.
 
   /// Lock free queues of matching engine client order response messages.
-  typedef LFQueue<MEClientResponse> ClientResponseLFQueue;
+  typedef OptCommon::OptLFQueue<MEClientResponse> ClientResponseLFQueue;
 }
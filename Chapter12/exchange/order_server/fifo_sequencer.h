@@ -1,53 +1,98 @@
 #pragma once
 
+#include <algorithm>
+#include <vector>
+
 #include "common/thread_utils.h"
 #include "common/macros.h"
 
 #include "order_server/client_request.h"
 
 namespace Exchange {
-  /// Maximum number of unprocessed client request messages across all TCP connections in the order server / FIFO sequencer.
+  /// Number of unprocessed client request messages across all TCP connections the order server / FIFO sequencer has room for up front.
+  /// A poll cycle that receives more grows the pending containers instead of failing, at the cost of an allocation.
   constexpr size_t ME_MAX_PENDING_REQUESTS = 1024;
 
   class FIFOSequencer {
   public:
-    FIFOSequencer(ClientRequestLFQueue *client_requests, Logger *logger)
-        : incoming_requests_(client_requests), logger_(logger) {
+    /// One lock free queue per matching engine shard, requests are routed to the shard that owns their ticker.
+    /// If journal_requests is provided, every request is also written to it in the order they are sequenced, for the RequestJournal to persist
+    /// later - the shards do not wait for it.
+    FIFOSequencer(const std::vector<ClientRequestLFQueue *> &client_requests, Logger *logger, ClientRequestLFQueue *journal_requests = nullptr)
+        : incoming_requests_(client_requests), journal_requests_(journal_requests), logger_(logger) {
+      ASSERT(!incoming_requests_.empty() && incoming_requests_.size() <= ME_MAX_MATCHING_SHARDS,
+             "Invalid number of matching engine shards:" + std::to_string(incoming_requests_.size()));
+
+      pending_client_requests_.reserve(ME_MAX_PENDING_REQUESTS);
+      sequenced_client_requests_.reserve(ME_MAX_PENDING_REQUESTS);
+      run_starts_.reserve(ME_MAX_PENDING_REQUESTS + 1);
+      run_heads_.reserve(ME_MAX_PENDING_REQUESTS);
     }
 
     ~FIFOSequencer() {
     }
 
     /// Queue up a client request, not processed immediately, processed when sequenceAndPublish() is called.
+    /// The requests read from one TCP connection arrive in receive time order, so the pending requests form runs already in order - a request
+    /// received earlier than the one queued before it starts a new run, which is where the requests of the next connection usually begin.
     auto addClientRequest(Nanos rx_time, const MEClientRequest &request) {
-      if (pending_size_ >= pending_client_requests_.size()) {
-        FATAL("Too many pending requests");
+      if (UNLIKELY(pending_client_requests_.size() == pending_client_requests_.capacity())) {
+        logger_->log("%:% %() % Growing pending requests beyond %.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                     pending_client_requests_.capacity());
       }
-      pending_client_requests_.at(pending_size_++) = std::move(RecvTimeClientRequest{rx_time, request});
+      if (pending_client_requests_.empty() || rx_time < pending_client_requests_.back().recv_time_)
+        run_starts_.push_back(pending_client_requests_.size());
+      pending_client_requests_.push_back(RecvTimeClientRequest{rx_time, request});
     }
 
-    /// Sort pending client requests in ascending receive time order and then write them to the lock free queue for the matching engine to consume from.
+    /// Merge the runs of pending client requests in ascending receive time order and then write them to the lock free queues for the matching engine shards to consume from.
+    /// Every shard sees the requests for its tickers in receive time order, there is no ordering between requests handled by different shards.
     auto sequenceAndPublish() {
-      if (UNLIKELY(!pending_size_))
+      if (UNLIKELY(pending_client_requests_.empty()))
         return;
 
-      logger_->log("%:% %() % Processing % requests.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), pending_size_);
-
-      std::sort(pending_client_requests_.begin(), pending_client_requests_.begin() + pending_size_);
-
-      for (size_t i = 0; i < pending_size_; ++i) {
-        const auto &client_request = pending_client_requests_.at(i);
-
-        logger_->log("%:% %() % Writing RX:% Req:% to FIFO.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
-                     client_request.recv_time_, client_request.request_.toString());
+      const auto pending_size = pending_client_requests_.size();
+      logger_->log("%:% %() % Processing % requests in % runs.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), pending_size,
+                   run_starts_.size());
+
+      mergeRuns();
+
+      // The journal queue gets every request in the same order as the shards. The RequestJournal thread copies them to the file asynchronously,
+      // so a shard can process requests, and their responses go out, that never reach the file if the exchange crashes in between.
+      if (journal_requests_) {
+        for (size_t i = 0; i < pending_size;) {
+          const auto next_writes = journal_requests_->getNextBatchToWriteTo(pending_size - i);
+          for (auto &next_write: next_writes)
+            next_write = sequenced_client_requests_[i++]->request_;
+          journal_requests_->updateWriteIndex(next_writes.size());
+        }
+      }
 
-        auto next_write = incoming_requests_->getNextToWriteTo();
-        *next_write = std::move(client_request.request_);
-        incoming_requests_->updateWriteIndex();
-        TTT_MEASURE(T2_OrderServer_LFQueue_write, (*logger_));
+      // Publish the sequenced requests in as few batches as possible, each matching engine shard sees each batch with a single index update.
+      const auto num_shards = incoming_requests_.size();
+      for (size_t i = 0; i < pending_size; ++i) {
+        const auto &client_request = *sequenced_client_requests_[i];
+        const auto shard = tickerIdToShard(client_request.request_.ticker_id_, num_shards);
+
+        logger_->log("%:% %() % Writing RX:% Req:% to FIFO:%.\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                     client_request.recv_time_, client_request.request_.toString(), shard);
+
+        auto &next_writes = shard_next_writes_[shard];
+        auto &num_written = shard_num_written_[shard];
+        if (num_written == next_writes.size()) {
+          publish(shard);
+          while ((next_writes = incoming_requests_[shard]->getNextBatchToWriteTo(pending_size - i)).empty());
+        }
+        next_writes[num_written++] = client_request.request_;
+      }
+      for (size_t shard = 0; shard < num_shards; ++shard) {
+        publish(shard);
+        shard_next_writes_[shard] = {};
       }
 
-      pending_size_ = 0;
+      pending_client_requests_.clear();
+      sequenced_client_requests_.clear();
+      run_starts_.clear();
     }
 
     /// Deleted default, copy & move constructors and assignment-operators.
@@ -62,8 +107,66 @@ namespace Exchange {
     FIFOSequencer &operator=(const FIFOSequencer &&) = delete;
 
   private:
-    /// Lock free queue used to publish client requests to, so that the matching engine can consume them.
-    ClientRequestLFQueue *incoming_requests_ = nullptr;
+    /// Make the requests written so far to the shard's queue visible to its matching engine.
+    auto publish(size_t shard) noexcept -> void {
+      if (shard_num_written_[shard]) {
+        incoming_requests_[shard]->updateWriteIndex(shard_num_written_[shard]);
+        shard_num_written_[shard] = 0;
+        TTT_MEASURE(T2_OrderServer_LFQueue_write, (*logger_));
+      }
+    }
+
+    /// Fill sequenced_client_requests_ with the pending requests in ascending receive time order, by a k-way merge of the runs using a binary
+    /// heap of the run heads - O(n log k) for k runs instead of sorting all n requests. The next requests of the run at the top of the heap are
+    /// taken for as long as they come before the head of every other run, so long runs cost a single comparison per request.
+    /// Requests received at the same time keep the order they were queued in.
+    auto mergeRuns() noexcept -> void {
+      const auto num_runs = run_starts_.size();
+      run_starts_.push_back(pending_client_requests_.size()); // end of the last run.
+
+      if (LIKELY(num_runs == 1)) {
+        for (const auto &client_request: pending_client_requests_)
+          sequenced_client_requests_.push_back(&client_request);
+        return;
+      }
+
+      // Queue positions are unique, so this is a total order and the merge is stable.
+      const auto earlier = [this](size_t lhs, size_t rhs) noexcept {
+        const auto lhs_time = pending_client_requests_[lhs].recv_time_, rhs_time = pending_client_requests_[rhs].recv_time_;
+        return (lhs_time < rhs_time || (lhs_time == rhs_time && lhs < rhs));
+      };
+      const auto later_head = [&earlier](const RunHead &lhs, const RunHead &rhs) noexcept {
+        return earlier(rhs.next_, lhs.next_);
+      };
+
+      run_heads_.clear();
+      for (size_t run = 0; run < num_runs; ++run)
+        run_heads_.push_back({run_starts_[run], run_starts_[run + 1]});
+      std::make_heap(run_heads_.begin(), run_heads_.end(), later_head);
+
+      while (!run_heads_.empty()) {
+        std::pop_heap(run_heads_.begin(), run_heads_.end(), later_head);
+        auto &head = run_heads_.back();
+        do {
+          sequenced_client_requests_.push_back(&pending_client_requests_[head.next_++]);
+        } while (head.next_ != head.end_ && (run_heads_.size() == 1 || earlier(head.next_, run_heads_.front().next_)));
+
+        if (head.next_ == head.end_)
+          run_heads_.pop_back();
+        else
+          std::push_heap(run_heads_.begin(), run_heads_.end(), later_head);
+      }
+    }
+
+    /// Lock free queues used to publish client requests to, so that the matching engine shards can consume them.
+    std::vector<ClientRequestLFQueue *> incoming_requests_;
+
+    /// Lock free queue to the RequestJournal, nullptr if the requests are not journaled.
+    ClientRequestLFQueue *journal_requests_ = nullptr;
+
+    /// Slots of the current batch being written to each shard's queue and how many of them are filled.
+    std::array<std::span<MEClientRequest>, ME_MAX_MATCHING_SHARDS> shard_next_writes_;
+    std::array<size_t, ME_MAX_MATCHING_SHARDS> shard_num_written_ = {};
 
     std::string time_str_;
     Logger *logger_ = nullptr;
@@ -72,14 +175,22 @@ namespace Exchange {
     struct RecvTimeClientRequest {
       Nanos recv_time_ = 0;
       MEClientRequest request_;
-
-      auto operator<(const RecvTimeClientRequest &rhs) const {
-        return (recv_time_ < rhs.recv_time_);
-      }
     };
 
-    /// Queue of pending client requests, not sorted.
-    std::array<RecvTimeClientRequest, ME_MAX_PENDING_REQUESTS> pending_client_requests_;
-    size_t pending_size_ = 0;
+    /// Queue of pending client requests in the order they were added, made of runs in receive time order.
+    std::vector<RecvTimeClientRequest> pending_client_requests_;
+
+    /// Pending client requests in the order they are published, filled in by mergeRuns().
+    std::vector<const RecvTimeClientRequest *> sequenced_client_requests_;
+
+    /// Index in pending_client_requests_ of the first request of every run.
+    std::vector<size_t> run_starts_;
+
+    /// Next request not merged yet and end of a run, the heap of them used by mergeRuns().
+    struct RunHead {
+      size_t next_ = 0;
+      size_t end_ = 0;
+    };
+    std::vector<RunHead> run_heads_;
   };
 }
@@ -1,15 +1,17 @@
 #include "order_server.h"
 
 namespace Exchange {
-  OrderServer::OrderServer(ClientRequestLFQueue *client_requests, ClientResponseLFQueue *client_responses, const std::string &iface, int port)
+  OrderServer::OrderServer(const std::vector<ClientRequestLFQueue *> &client_requests, const std::vector<ClientResponseLFQueue *> &client_responses,
+                           const std::string &iface, int port, ClientRequestLFQueue *journal_requests, Common::TCPServerBackend backend)
       : iface_(iface), port_(port), outgoing_responses_(client_responses), logger_("exchange_order_server.log"),
-        tcp_server_(logger_), fifo_sequencer_(client_requests, &logger_) {
+        tcp_server_(logger_, backend), fifo_sequencer_(client_requests, &logger_, journal_requests) {
     cid_next_outgoing_seq_num_.fill(1);
     cid_next_exp_seq_num_.fill(1);
     cid_tcp_socket_.fill(nullptr);
 
     tcp_server_.recv_callback_ = [this](auto socket, auto rx_time) { recvCallback(socket, rx_time); };
     tcp_server_.recv_finished_callback_ = [this]() { recvFinishedCallback(); };
+    tcp_server_.disconnect_callback_ = [this](auto socket) { disconnectCallback(socket); };
   }
 
   OrderServer::~OrderServer() {
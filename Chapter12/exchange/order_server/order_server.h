@@ -13,7 +13,11 @@
 namespace Exchange {
   class OrderServer {
   public:
-    OrderServer(ClientRequestLFQueue *client_requests, ClientResponseLFQueue *client_responses, const std::string &iface, int port);
+    /// One request and one response queue per matching engine shard, the sequenced requests are also written to journal_requests if provided.
+    /// backend selects the network I/O mechanism of the TCP server the clients connect to.
+    OrderServer(const std::vector<ClientRequestLFQueue *> &client_requests, const std::vector<ClientResponseLFQueue *> &client_responses,
+                const std::string &iface, int port, ClientRequestLFQueue *journal_requests = nullptr,
+                Common::TCPServerBackend backend = Common::TCPServerBackend::EPOLL);
 
     ~OrderServer();
 
@@ -30,38 +34,53 @@ namespace Exchange {
 
         tcp_server_.sendAndRecv();
 
-        for (auto client_response = outgoing_responses_->getNextToRead(); outgoing_responses_->size() && client_response; client_response = outgoing_responses_->getNextToRead()) {
-          TTT_MEASURE(T5t_OrderServer_LFQueue_read, logger_);
-
-          auto &next_outgoing_seq_num = cid_next_outgoing_seq_num_[client_response->client_id_];
-          logger_.log("%:% %() % Processing cid:% seq:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
-                      client_response->client_id_, next_outgoing_seq_num, client_response->toString());
-
-          ASSERT(cid_tcp_socket_[client_response->client_id_] != nullptr,
-                 "Dont have a TCPSocket for ClientId:" + std::to_string(client_response->client_id_));
-          START_MEASURE(Exchange_TCPSocket_send);
-          cid_tcp_socket_[client_response->client_id_]->send(&next_outgoing_seq_num, sizeof(next_outgoing_seq_num));
-          cid_tcp_socket_[client_response->client_id_]->send(client_response, sizeof(MEClientResponse));
-          END_MEASURE(Exchange_TCPSocket_send, logger_);
-
-          outgoing_responses_->updateReadIndex();
-          TTT_MEASURE(T6t_OrderServer_TCP_write, logger_);
+        for (auto outgoing_responses: outgoing_responses_)
+          sendClientResponses(outgoing_responses);
+      }
+    }
 
+    /// Send a batch of client responses from one of the matching engine shards to the connected clients.
+    /// Responses to a client are sequenced in the order they are read here, each shard's responses stay in the order that shard produced them.
+    auto sendClientResponses(ClientResponseLFQueue *outgoing_responses) noexcept -> void {
+      const auto client_responses = outgoing_responses->getNextBatchToRead(ME_MAX_QUEUE_BATCH);
+      for (const auto &me_client_response: client_responses) {
+        const auto client_response = &me_client_response;
+        TTT_MEASURE(T5t_OrderServer_LFQueue_read, logger_);
+
+        auto &next_outgoing_seq_num = cid_next_outgoing_seq_num_[client_response->client_id_];
+        logger_.log("%:% %() % Processing cid:% seq:% %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                    client_response->client_id_, next_outgoing_seq_num, client_response->toString());
+
+        auto socket = cid_tcp_socket_[client_response->client_id_];
+        if (UNLIKELY(!socket)) { // the client's connection ended after the request was sequenced.
+          logger_.log("%:% %() % Dropping response, no TCPSocket for ClientId:%\n", __FILE__, __LINE__, __FUNCTION__,
+                      Common::getCurrentTimeStr(&time_str_), client_response->client_id_);
           ++next_outgoing_seq_num;
+          continue;
         }
+        START_MEASURE(Exchange_TCPSocket_send);
+        socket->send(&next_outgoing_seq_num, sizeof(next_outgoing_seq_num));
+        socket->send(client_response, sizeof(MEClientResponse));
+        END_MEASURE(Exchange_TCPSocket_send, logger_);
+
+        TTT_MEASURE(T6t_OrderServer_TCP_write, logger_);
+
+        ++next_outgoing_seq_num;
       }
+      if (!client_responses.empty())
+        outgoing_responses->updateReadIndex(client_responses.size());
     }
 
     /// Read client request from the TCP receive buffer, check for sequence gaps and forward it to the FIFO sequencer.
     auto recvCallback(TCPSocket *socket, Nanos rx_time) noexcept {
       TTT_MEASURE(T1_OrderServer_TCP_read, logger_);
       logger_.log("%:% %() % Received socket:% len:% rx:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
-                  socket->socket_fd_, socket->next_rcv_valid_index_, rx_time);
+                  socket->socket_fd_, socket->inbound_data_.size(), rx_time);
 
-      if (socket->next_rcv_valid_index_ >= sizeof(OMClientRequest)) {
+      if (socket->inbound_data_.size() >= sizeof(OMClientRequest)) {
         size_t i = 0;
-        for (; i + sizeof(OMClientRequest) <= socket->next_rcv_valid_index_; i += sizeof(OMClientRequest)) {
-          auto request = reinterpret_cast<const OMClientRequest *>(socket->inbound_data_.data() + i);
+        for (; i + sizeof(OMClientRequest) <= socket->inbound_data_.size(); i += sizeof(OMClientRequest)) {
+          auto request = reinterpret_cast<const OMClientRequest *>(socket->inbound_data_.readData() + i);
           logger_.log("%:% %() % Received %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), request->toString());
 
           if (UNLIKELY(cid_tcp_socket_[request->me_client_request_.client_id_] == nullptr)) { // first message from this ClientId.
@@ -88,8 +107,18 @@ namespace Exchange {
           fifo_sequencer_.addClientRequest(rx_time, request->me_client_request_);
           END_MEASURE(Exchange_FIFOSequencer_addClientRequest, logger_);
         }
-        memcpy(socket->inbound_data_.data(), socket->inbound_data_.data() + i, socket->next_rcv_valid_index_ - i);
-        socket->next_rcv_valid_index_ -= i;
+        socket->inbound_data_.updateReadIndex(i);
+      }
+    }
+
+    /// A client connection ended, responses to its ClientId are dropped from now on.
+    auto disconnectCallback(TCPSocket *socket) noexcept {
+      for (auto &cid_tcp_socket: cid_tcp_socket_) {
+        if (cid_tcp_socket == socket) {
+          logger_.log("%:% %() % Disconnected ClientId:% socket:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
+                      &cid_tcp_socket - cid_tcp_socket_.data(), socket->socket_fd_);
+          cid_tcp_socket = nullptr;
+        }
       }
     }
 
@@ -115,8 +144,8 @@ namespace Exchange {
     const std::string iface_;
     const int port_ = 0;
 
-    /// Lock free queue of outgoing client responses to be sent out to connected clients.
-    ClientResponseLFQueue *outgoing_responses_ = nullptr;
+    /// Lock free queues of outgoing client responses to be sent out to connected clients, one per matching engine shard.
+    std::vector<ClientResponseLFQueue *> outgoing_responses_;
 
     volatile bool run_ = false;
 
@@ -0,0 +1,95 @@
+#include "request_journal.h"
+
+#include <atomic>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace Exchange {
+  RequestJournal::RequestJournal(const std::string &file_name, size_t max_requests)
+      : file_name_(file_name), capacity_(max_requests), pending_requests_(ME_MAX_CLIENT_UPDATES), logger_("exchange_request_journal.log") {
+    fd_ = open(file_name_.c_str(), O_RDWR | O_CREAT, 0644);
+    ASSERT(fd_ >= 0, "open() failed for journal:" + file_name_ + " error:" + std::string(std::strerror(errno)));
+
+    // Grow the file to its full capacity upfront so that appending never has to remap it, the records not written yet read as zeroes.
+    struct stat file_stat;
+    ASSERT(fstat(fd_, &file_stat) == 0, "fstat() failed for journal:" + file_name_ + " error:" + std::string(std::strerror(errno)));
+    const auto file_size = capacity_ * sizeof(MEClientRequest);
+    if (static_cast<size_t>(file_stat.st_size) < file_size)
+      ASSERT(ftruncate(fd_, file_size) == 0, "ftruncate() failed for journal:" + file_name_ + " error:" + std::string(std::strerror(errno)));
+
+    auto ptr = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    ASSERT(ptr != MAP_FAILED, "mmap() failed for journal:" + file_name_ + " error:" + std::string(std::strerror(errno)));
+    requests_ = static_cast<MEClientRequest *>(ptr);
+
+    while (num_recovered_ < capacity_ && requests_[num_recovered_].type_ != ClientRequestType::INVALID)
+      ++num_recovered_;
+    num_requests_ = num_recovered_;
+
+    logger_.log("%:% %() % Opened journal:% recovered requests:% capacity:%\n", __FILE__, __LINE__, __FUNCTION__,
+                Common::getCurrentTimeStr(&time_str_), file_name_, num_recovered_, capacity_);
+  }
+
+  RequestJournal::~RequestJournal() {
+    stop();
+
+    using namespace std::literals::chrono_literals;
+    std::this_thread::sleep_for(1s);
+
+    munmap(requests_, capacity_ * sizeof(MEClientRequest));
+    requests_ = nullptr;
+    close(fd_);
+    fd_ = -1;
+  }
+
+  /// Start and stop the journal writer thread.
+  auto RequestJournal::start(int core_id) -> void {
+    run_ = true;
+    ASSERT(Common::createAndStartThread(core_id, "Exchange/RequestJournal", [this]() { run(); }) != nullptr,
+           "Failed to start RequestJournal thread.");
+  }
+
+  auto RequestJournal::stop() -> void {
+    run_ = false;
+  }
+
+  /// Mark the journal empty, then drop the disk blocks of the records by truncating the file and growing it back, which keeps the mapping valid.
+  auto RequestJournal::reset() noexcept -> void {
+    requests_[0].type_ = ClientRequestType::INVALID;
+
+    const auto file_size = capacity_ * sizeof(MEClientRequest);
+    ASSERT(ftruncate(fd_, 0) == 0 && ftruncate(fd_, file_size) == 0,
+           "ftruncate() failed for journal:" + file_name_ + " error:" + std::string(std::strerror(errno)));
+
+    logger_.log("%:% %() % Reset journal:% requests:%\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_), file_name_,
+                num_requests_);
+    num_recovered_ = 0;
+    num_requests_ = 0;
+  }
+
+  /// Copy the requests after the last record in the file, terminate them, and write the type of the first one last.
+  auto RequestJournal::append(std::span<const MEClientRequest> requests) noexcept -> void {
+    if (requests.empty())
+      return;
+    if (UNLIKELY(num_requests_ + requests.size() > capacity_))
+      FATAL("Journal full:" + file_name_ + " capacity:" + std::to_string(capacity_));
+
+    const auto records = requests_ + num_requests_;
+    std::copy(requests.begin() + 1, requests.end(), records + 1);
+
+    // Records left behind a shorter batch by a previous run that died part way through one would otherwise be recovered after this batch.
+    if (num_requests_ + requests.size() < capacity_)
+      records[requests.size()].type_ = ClientRequestType::INVALID;
+
+    auto first_request = requests.front();
+    const auto first_type = first_request.type_;
+    first_request.type_ = ClientRequestType::INVALID;
+    records[0] = first_request;
+    std::atomic_signal_fence(std::memory_order_release);
+    records[0].type_ = first_type;
+
+    num_requests_ = num_requests_ + requests.size();
+  }
+}
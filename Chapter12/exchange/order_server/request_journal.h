@@ -0,0 +1,102 @@
+#pragma once
+
+#include <span>
+
+#include "common/thread_utils.h"
+#include "common/macros.h"
+#include "common/logging.h"
+
+#include "order_server/client_request.h"
+
+namespace Exchange {
+  /// Maximum number of client requests a journal file can hold. The file is sparse, only the pages holding requests take up disk space.
+  constexpr size_t ME_MAX_JOURNAL_REQUESTS = 64 * 1024 * 1024;
+
+  /// Journal of the client requests in the order the FIFOSequencer published them to the matching engine shards, appended to until it is reset.
+  /// The file is a memory-mapped array of MEClientRequest records and the first record whose type is INVALID marks its end, so nothing else
+  /// has to be kept consistent with the records. The FIFOSequencer hands the sequenced requests over through a lock free queue, and a background
+  /// thread copies them into the mapped file, so the order server thread never touches the file.
+  /// Records are in the page cache as soon as they are copied, so they survive a crash of the exchange but not of the machine.
+  class RequestJournal final {
+  public:
+    /// Open the journal file or create it. Requests already in the file are kept, new ones are appended after them.
+    explicit RequestJournal(const std::string &file_name, size_t max_requests = ME_MAX_JOURNAL_REQUESTS);
+
+    ~RequestJournal();
+
+    /// Start and stop the thread writing the requests from the lock free queue to the journal file.
+    auto start(int core_id = -1) -> void;
+
+    auto stop() -> void;
+
+    /// Lock free queue the FIFOSequencer writes the sequenced client requests to.
+    auto requestQueue() noexcept {
+      return &pending_requests_;
+    }
+
+    /// The requests that were already in the journal file when it was opened, to be replayed before the exchange accepts new requests.
+    auto recoveredRequests() const noexcept -> std::span<const MEClientRequest> {
+      return {requests_, num_recovered_};
+    }
+
+    /// Copy the requests after the last record in the file and mark the record after them INVALID. The type of the first one is written last,
+    /// so that if the exchange dies part way through, the journal still ends at a complete request and nothing written after its end is recovered.
+    /// Called by the journal writer thread, and before start() for the requests the exchange generates itself on startup - see
+    /// MatchingEngine::cancelOrders().
+    auto append(std::span<const MEClientRequest> requests) noexcept -> void;
+
+    /// Empty the journal, once the requests in it are not needed to rebuild the order books any more. Only before start().
+    /// The first record is marked INVALID before anything else, so a crash part way through leaves an empty journal, and the file is then truncated
+    /// and grown back to release the disk space of the records - recoveredRequests() is empty afterwards.
+    auto reset() noexcept -> void;
+
+    /// Number of requests in the journal file, including the recovered ones.
+    auto size() const noexcept -> size_t {
+      return num_requests_;
+    }
+
+    /// Main loop for this thread - copies the requests from the lock free queue to the end of the journal file.
+    auto run() noexcept {
+      logger_.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_));
+      while (run_) {
+        const auto requests = pending_requests_.getNextBatchToRead(ME_MAX_QUEUE_BATCH);
+        if (requests.empty())
+          continue;
+
+        append(requests);
+        pending_requests_.updateReadIndex(requests.size());
+      }
+    }
+
+    /// Deleted default, copy & move constructors and assignment-operators.
+    RequestJournal() = delete;
+
+    RequestJournal(const RequestJournal &) = delete;
+
+    RequestJournal(const RequestJournal &&) = delete;
+
+    RequestJournal &operator=(const RequestJournal &) = delete;
+
+    RequestJournal &operator=(const RequestJournal &&) = delete;
+
+  private:
+    const std::string file_name_;
+
+    int fd_ = -1;
+
+    /// Records of the memory-mapped journal file, capacity_ of them.
+    MEClientRequest *requests_ = nullptr;
+    size_t capacity_ = 0;
+
+    size_t num_recovered_ = 0;
+    volatile size_t num_requests_ = 0;
+
+    /// Lock free queue of sequenced client requests from the FIFOSequencer, waiting to be written to the journal file.
+    ClientRequestLFQueue pending_requests_;
+
+    volatile bool run_ = false;
+
+    std::string time_str_;
+    Logger logger_;
+  };
+}
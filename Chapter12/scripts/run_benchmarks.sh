@@ -5,16 +5,101 @@ bash scripts/build.sh
 date
 
 echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
-echo " Benchmark before and after optimization for Logger string handling. "
+echo " Benchmark before and after optimization for Logger string handling, and the binary Logger which defers all formatting to log_decoder, and compile time vs runtime parsed format strings. "
 echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
 ./cmake-build-release/logger_benchmark
 
 echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
-echo " Benchmark before and after optimization for release builds. "
+echo " Stress test with five component Loggers logging concurrently, reporting bytes written, peak queue depth and dropped bytes per Logger. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/logger_stress_benchmark
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Benchmark before and after optimization for release builds, including memory pool allocation latency at 10%, 50% and 90% occupancy. "
 echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
 ./cmake-build-release/release_benchmark
 
 echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
 echo " Benchmark using std::arrays and std::unordered_maps as hash maps. "
 echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
-./cmake-build-release/hash_benchmark
\ No newline at end of file
+./cmake-build-release/hash_benchmark
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Benchmark one-way latency and throughput of the original and optimized lock free queues between two pinned cores, and batched throughput for batch sizes 1, 8, 32 and 128. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/lf_queue_benchmark 1 2
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Benchmark MEOrderBook::cancel latency and dTLB misses with the order book and memory pools on 4KB pages and on huge pages. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/huge_page_benchmark
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Benchmark call cost and jitter of std::chrono::system_clock, clock_gettime and the calibrated TSC clock. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/clock_benchmark
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Benchmark matching engine throughput under trading_main's random order flow on 8 tickers, sharded across 1, 2, 4 and 8 matching engine threads. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/matching_engine_benchmark 1
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Benchmark quote update round trip latency through the matching engine with cancel / new versus a single modify request. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/modify_benchmark 1 2
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Benchmark aggressive order latency and market updates published for a limit order plus cancel versus IOC and FOK orders. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/aggressive_order_benchmark
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Benchmark messages published and end to end latency of an aggressive order sweeping 10 price levels of 5 orders, with per-order and per-level fill reporting. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/sweep_benchmark 1 2
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Benchmark aggressive order sweeps with and without self trades, for every self-trade prevention mode. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/self_trade_benchmark
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Benchmark rebuilding the order books from the request journal, and check the replay publishes exactly what the live run did. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/journal_benchmark 1 2
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Benchmark the matching engine pause to checkpoint 1M resting orders, and restarting from the checkpoint plus the journal tail versus the whole journal. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/checkpoint_benchmark
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Benchmark incremental market data packets over loopback multicast - updates per second and per update latency at several burst sizes. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/market_data_benchmark
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Benchmark one datagram per system call versus batched sendmmsg() / recvmmsg() over loopback multicast - throughput and system calls per datagram. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/mcast_socket_benchmark
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Benchmark the epoll and io_uring TCPServer backends with 1, 16 and 256 clients over loopback - idle loop cost and echo round trips. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/tcp_server_benchmark
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Benchmark TCP receive buffers - memory per connection and parse cost per request of compacted flat buffers versus mirrored rings. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/tcp_buffer_benchmark
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Benchmark the FIFOSequencer - merge of per connection runs versus number of active clients and burst size, against sorting every poll cycle. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/fifo_sequencer_benchmark
+
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+echo " Replay the same requests into the matching engine with every order book and fill reporting mode, and check they all publish exactly the same output. "
+echo "---------------------------------------------------------------------------------------------------------------------------------------------------------"
+./cmake-build-release/order_book_conformance_benchmark
@@ -13,12 +13,16 @@ namespace Trading {
       recvCallback(socket);
     };
 
+    epoll_fd_ = epoll_create(1);
+    ASSERT(epoll_fd_ >= 0, "epoll_create() failed error:" + std::string(std::strerror(errno)));
+
     incremental_mcast_socket_.recv_callback_ = recv_callback;
     ASSERT(incremental_mcast_socket_.init(incremental_ip, iface, incremental_port, /*is_listening*/ true) >= 0,
            "Unable to create incremental mcast socket. error:" + std::string(std::strerror(errno)));
 
     ASSERT(incremental_mcast_socket_.join(incremental_ip),
            "Join failed on:" + std::to_string(incremental_mcast_socket_.socket_fd_) + " error:" + std::string(std::strerror(errno)));
+    ASSERT(addToEpollList(&incremental_mcast_socket_), "epoll_ctl() failed. error:" + std::string(std::strerror(errno)));
 
     snapshot_mcast_socket_.recv_callback_ = recv_callback;
   }
@@ -26,12 +30,32 @@ namespace Trading {
   /// Main loop for this thread - reads and processes messages from the multicast sockets - the heavy lifting is in the recvCallback() and checkSnapshotSync() methods.
   auto MarketDataConsumer::run() noexcept -> void {
     logger_.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_));
+    // The snapshot socket is closed outside of recovery.
+    const auto drained = [](const McastSocket &socket) noexcept {
+      return (socket.socket_fd_ < 0 || !socket.recv_pending_);
+    };
     while (run_) {
+      // Only ask epoll which sockets became readable once the ones that were have been drained, a single system call for both sockets.
+      if (drained(incremental_mcast_socket_) && drained(snapshot_mcast_socket_)) {
+        const int n = epoll_wait(epoll_fd_, events_, 2, 0);
+        for (int i = 0; i < n; ++i) {
+          if (events_[i].events & EPOLLIN)
+            reinterpret_cast<McastSocket *>(events_[i].data.ptr)->recv_pending_ = true;
+        }
+      }
+
       incremental_mcast_socket_.sendAndRecv();
       snapshot_mcast_socket_.sendAndRecv();
     }
   }
 
+  /// Register a subscriber socket with epoll_fd_, closing the socket removes it again.
+  auto MarketDataConsumer::addToEpollList(McastSocket *socket) -> bool {
+    epoll_event ev{EPOLLET | EPOLLIN, {reinterpret_cast<void *>(socket)}};
+    socket->epoll_edge_triggered_ = true;
+    return !epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket->socket_fd_, &ev);
+  }
+
   /// Start the process of snapshot synchronization by subscribing to the snapshot multicast stream.
   auto MarketDataConsumer::startSnapshotSync() -> void {
     snapshot_queued_msgs_.clear();
@@ -41,6 +65,7 @@ namespace Trading {
            "Unable to create snapshot mcast socket. error:" + std::string(std::strerror(errno)));
     ASSERT(snapshot_mcast_socket_.join(snapshot_ip_), // IGMP multicast subscription.
            "Join failed on:" + std::to_string(snapshot_mcast_socket_.socket_fd_) + " error:" + std::string(std::strerror(errno)));
+    ASSERT(addToEpollList(&snapshot_mcast_socket_), "epoll_ctl() failed. error:" + std::string(std::strerror(errno)));
   }
 
   /// Check if a recovery / synchronization is possible from the queued up market data updates from the snapshot and incremental market data streams.
@@ -162,6 +187,32 @@ namespace Trading {
     checkSnapshotSync();
   }
 
+  /// Process a single market update with its sequence number, read from the snapshot or the incremental stream.
+  auto MarketDataConsumer::processMarketUpdate(bool is_snapshot, const Exchange::MDPMarketUpdate *request) noexcept -> void {
+    const bool already_in_recovery = in_recovery_;
+    in_recovery_ = (already_in_recovery || request->seq_num_ != next_exp_inc_seq_num_);
+
+    if (UNLIKELY(in_recovery_)) {
+      if (UNLIKELY(!already_in_recovery)) { // if we just entered recovery, start the snapshot synchonization process by subscribing to the snapshot multicast stream.
+        logger_.log("%:% %() % Packet drops on % socket. SeqNum expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__,
+                    Common::getCurrentTimeStr(&time_str_), (is_snapshot ? "snapshot" : "incremental"), next_exp_inc_seq_num_, request->seq_num_);
+        startSnapshotSync();
+      }
+
+      queueMessage(is_snapshot, request); // queue up the market data update message and check if snapshot recovery / synchronization can be completed successfully.
+    } else if (!is_snapshot) { // not in recovery and received a packet in the correct order and without gaps, process it.
+      logger_.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__,
+                  Common::getCurrentTimeStr(&time_str_), request->toString());
+
+      ++next_exp_inc_seq_num_;
+
+      auto next_write = incoming_md_updates_->getNextToWriteTo();
+      *next_write = request->me_market_update_;
+      incoming_md_updates_->updateWriteIndex();
+      TTT_MEASURE(T8_MarketDataConsumer_LFQueue_write, logger_);
+    }
+  }
+
   /// Process a market data update, the consumer needs to use the socket parameter to figure out whether this came from the snapshot or the incremental stream.
   auto MarketDataConsumer::recvCallback(McastSocket *socket) noexcept -> void {
     TTT_MEASURE(T7_MarketDataConsumer_UDP_read, logger_);
@@ -169,47 +220,50 @@ namespace Trading {
     START_MEASURE(Trading_MarketDataConsumer_recvCallback);
     const auto is_snapshot = (socket->socket_fd_ == snapshot_mcast_socket_.socket_fd_);
     if (UNLIKELY(is_snapshot && !in_recovery_)) { // market update was read from the snapshot market data stream and we are not in recovery, so we dont need it and discard it.
-      socket->next_rcv_valid_index_ = 0;
-
       logger_.log("%:% %() % WARN Not expecting snapshot messages.\n",
                   __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_));
 
       return;
     }
 
-    if (socket->next_rcv_valid_index_ >= sizeof(Exchange::MDPMarketUpdate)) {
+    // The snapshot stream carries MDPMarketUpdate messages, the incremental stream packets of consecutive MEMarketUpdate messages.
+    // Every datagram holds whole messages, anything left over at the end of one is malformed and dropped.
+    for (size_t d = 0; d < socket->num_rcv_datagrams_; ++d) {
+      const auto &datagram = socket->rcv_datagrams_[d];
       size_t i = 0;
-      for (; i + sizeof(Exchange::MDPMarketUpdate) <= socket->next_rcv_valid_index_; i += sizeof(Exchange::MDPMarketUpdate)) {
-        auto request = reinterpret_cast<const Exchange::MDPMarketUpdate *>(socket->inbound_data_.data() + i);
-        logger_.log("%:% %() % Received % socket len:% %\n", __FILE__, __LINE__, __FUNCTION__,
-                    Common::getCurrentTimeStr(&time_str_),
-                    (is_snapshot ? "snapshot" : "incremental"), sizeof(Exchange::MDPMarketUpdate), request->toString());
-
-        const bool already_in_recovery = in_recovery_;
-        in_recovery_ = (already_in_recovery || request->seq_num_ != next_exp_inc_seq_num_);
-
-        if (UNLIKELY(in_recovery_)) {
-          if (UNLIKELY(!already_in_recovery)) { // if we just entered recovery, start the snapshot synchonization process by subscribing to the snapshot multicast stream.
-            logger_.log("%:% %() % Packet drops on % socket. SeqNum expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__,
-                        Common::getCurrentTimeStr(&time_str_), (is_snapshot ? "snapshot" : "incremental"), next_exp_inc_seq_num_, request->seq_num_);
-            startSnapshotSync();
+      if (is_snapshot) {
+        for (; i + sizeof(Exchange::MDPMarketUpdate) <= datagram.len_; i += sizeof(Exchange::MDPMarketUpdate)) {
+          auto request = reinterpret_cast<const Exchange::MDPMarketUpdate *>(datagram.data_ + i);
+          logger_.log("%:% %() % Received snapshot socket len:% ktime:% %\n", __FILE__, __LINE__, __FUNCTION__,
+                      Common::getCurrentTimeStr(&time_str_), sizeof(Exchange::MDPMarketUpdate), datagram.kernel_time_, request->toString());
+          processMarketUpdate(is_snapshot, request);
+        }
+      } else {
+        while (i + sizeof(Exchange::MDPPacketHeader) <= datagram.len_) {
+          auto packet_header = reinterpret_cast<const Exchange::MDPPacketHeader *>(datagram.data_ + i);
+          const auto packet_size = sizeof(Exchange::MDPPacketHeader) + packet_header->num_updates_ * sizeof(Exchange::MEMarketUpdate);
+          if (packet_size > datagram.len_ - i)
+            break;
+
+          logger_.log("%:% %() % Received incremental socket len:% ktime:% %\n", __FILE__, __LINE__, __FUNCTION__,
+                      Common::getCurrentTimeStr(&time_str_), packet_size, datagram.kernel_time_, packet_header->toString());
+          auto market_updates = reinterpret_cast<const Exchange::MEMarketUpdate *>(datagram.data_ + i + sizeof(Exchange::MDPPacketHeader));
+          for (size_t j = 0; j < packet_header->num_updates_; ++j) {
+            const Exchange::MDPMarketUpdate request{packet_header->seq_num_ + j, market_updates[j]};
+            processMarketUpdate(is_snapshot, &request);
           }
-
-          queueMessage(is_snapshot, request); // queue up the market data update message and check if snapshot recovery / synchronization can be completed successfully.
-        } else if (!is_snapshot) { // not in recovery and received a packet in the correct order and without gaps, process it.
-          logger_.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__,
-                      Common::getCurrentTimeStr(&time_str_), request->toString());
-
-          ++next_exp_inc_seq_num_;
-
-          auto next_write = incoming_md_updates_->getNextToWriteTo();
-          *next_write = std::move(request->me_market_update_);
-          incoming_md_updates_->updateWriteIndex();
-          TTT_MEASURE(T8_MarketDataConsumer_LFQueue_write, logger_);
+          i += packet_size;
         }
       }
-      memcpy(socket->inbound_data_.data(), socket->inbound_data_.data() + i, socket->next_rcv_valid_index_ - i);
-      socket->next_rcv_valid_index_ -= i;
+
+      if (UNLIKELY(i != datagram.len_)) {
+        logger_.log("%:% %() % WARN Dropping % malformed bytes at the end of a % datagram of len:%\n", __FILE__, __LINE__, __FUNCTION__,
+                    Common::getCurrentTimeStr(&time_str_), datagram.len_ - i, (is_snapshot ? "snapshot" : "incremental"), datagram.len_);
+      }
+
+      // Recovery completing leaves the snapshot stream, the rest of the datagrams read from it are not needed.
+      if (UNLIKELY(is_snapshot && !in_recovery_))
+        break;
     }
     END_MEASURE(Trading_MarketDataConsumer_recvCallback, logger_);
   }
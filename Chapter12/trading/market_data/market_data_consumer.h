@@ -4,7 +4,7 @@
 #include <map>
 
 #include "common/thread_utils.h"
-#include "common/lf_queue.h"
+#include "common/opt_lf_queue.h"
 #include "common/macros.h"
 #include "common/mcast_socket.h"
 
@@ -22,12 +22,13 @@ namespace Trading {
 
       using namespace std::literals::chrono_literals;
       std::this_thread::sleep_for(5s);
+      close(epoll_fd_);
     }
 
-    /// Start and stop the market data consumer main thread.
-    auto start() {
+    /// Start and stop the market data consumer main thread, pinned to core_id unless it is -1.
+    auto start(int core_id = -1) {
       run_ = true;
-      ASSERT(Common::createAndStartThread(-1, "Trading/MarketDataConsumer", [this]() { run(); }) != nullptr, "Failed to start MarketData thread.");
+      ASSERT(Common::createAndStartThread(core_id, "Trading/MarketDataConsumer", [this]() { run(); }) != nullptr, "Failed to start MarketData thread.");
     }
 
     auto stop() -> void {
@@ -60,6 +61,10 @@ namespace Trading {
     /// Multicast subscriber sockets for the incremental and market data streams.
     Common::McastSocket incremental_mcast_socket_, snapshot_mcast_socket_;
 
+    /// Edge-triggered epoll both subscriber sockets are registered with, so that they are only read once they have datagrams waiting.
+    int epoll_fd_ = -1;
+    epoll_event events_[2];
+
     /// Tracks if we are currently in the process of recovering / synchronizing with the snapshot market data stream either because we just started up or we dropped a packet.
     bool in_recovery_ = false;
 
@@ -75,9 +80,15 @@ namespace Trading {
     /// Main loop for this thread - reads and processes messages from the multicast sockets - the heavy lifting is in the recvCallback() and checkSnapshotSync() methods.
     auto run() noexcept -> void;
 
+    /// Register a subscriber socket with epoll_fd_, closing the socket removes it again.
+    auto addToEpollList(McastSocket *socket) -> bool;
+
     /// Process a market data update, the consumer needs to use the socket parameter to figure out whether this came from the snapshot or the incremental stream.
     auto recvCallback(McastSocket *socket) noexcept -> void;
 
+    /// Process a single market update with its sequence number, read from the snapshot or the incremental stream.
+    auto processMarketUpdate(bool is_snapshot, const Exchange::MDPMarketUpdate *request) noexcept -> void;
+
     /// Queue up a message in the *_queued_msgs_ containers, first parameter specifies if this update came from the snapshot or the incremental streams.
     auto queueMessage(bool is_snapshot, const Exchange::MDPMarketUpdate *request);
 
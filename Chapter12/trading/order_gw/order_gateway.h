@@ -24,12 +24,12 @@ namespace Trading {
       std::this_thread::sleep_for(5s);
     }
 
-    /// Start and stop the order gateway main thread.
-    auto start() {
+    /// Start and stop the order gateway main thread, pinned to core_id unless it is -1.
+    auto start(int core_id = -1) {
       run_ = true;
       ASSERT(tcp_socket_.connect(ip_, iface_, port_, false) >= 0,
              "Unable to connect to ip:" + ip_ + " port:" + std::to_string(port_) + " on iface:" + iface_ + " error:" + std::string(std::strerror(errno)));
-      ASSERT(Common::createAndStartThread(-1, "Trading/OrderGateway", [this]() { run(); }) != nullptr, "Failed to start OrderGateway thread.");
+      ASSERT(Common::createAndStartThread(core_id, "Trading/OrderGateway", [this]() { run(); }) != nullptr, "Failed to start OrderGateway thread.");
     }
 
     auto stop() -> void {
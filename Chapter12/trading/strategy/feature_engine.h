@@ -3,6 +3,8 @@
 #include "common/macros.h"
 #include "common/logging.h"
 
+#include "market_order.h"
+
 using namespace Common;
 
 namespace Trading {
@@ -16,8 +18,7 @@ namespace Trading {
     }
 
     /// Process a change in order book and in this case compute the fair market price.
-    auto onOrderBookUpdate(TickerId ticker_id, Price price, Side side, MarketOrderBook* book) noexcept -> void {
-      const auto bbo = book->getBBO();
+    auto onOrderBookUpdate(TickerId ticker_id, Price price, Side side, const BBO *bbo) noexcept -> void {
       if(LIKELY(bbo->bid_price_ != Price_INVALID && bbo->ask_price_ != Price_INVALID)) {
         mkt_price_ = (bbo->bid_price_ * bbo->ask_qty_ + bbo->ask_price_ * bbo->bid_qty_) / static_cast<double>(bbo->bid_qty_ + bbo->ask_qty_);
       }
@@ -28,8 +29,7 @@ namespace Trading {
     }
 
     /// Process a trade event and in this case compute the feature to capture aggressive trade quantity ratio against the BBO quantity.
-    auto onTradeUpdate(const Exchange::MEMarketUpdate *market_update, MarketOrderBook* book) noexcept -> void {
-      const auto bbo = book->getBBO();
+    auto onTradeUpdate(const Exchange::MEMarketUpdate *market_update, const BBO *bbo) noexcept -> void {
       if(LIKELY(bbo->bid_price_ != Price_INVALID && bbo->ask_price_ != Price_INVALID)) {
         agg_trade_qty_ratio_ = static_cast<double>(market_update->qty_) / (market_update->side_ == Side::BUY ? bbo->ask_qty_ : bbo->bid_qty_);
       }
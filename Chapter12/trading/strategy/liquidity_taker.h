@@ -11,23 +11,22 @@ using namespace Common;
 namespace Trading {
   class LiquidityTaker {
   public:
-    LiquidityTaker(Common::Logger *logger, TradeEngine *trade_engine, const FeatureEngine *feature_engine,
+    LiquidityTaker(Common::Logger *logger, TradeEngineBase *trade_engine, const FeatureEngine *feature_engine,
                    OrderManager *order_manager,
                    const TradeEngineCfgHashMap &ticker_cfg);
 
     /// Process order book updates, which for the liquidity taking algorithm is none.
-    auto onOrderBookUpdate(TickerId ticker_id, Price price, Side side, MarketOrderBook *) noexcept -> void {
+    auto onOrderBookUpdate(TickerId ticker_id, Price price, Side side, const BBO *) noexcept -> void {
       logger_->log("%:% %() % ticker:% price:% side:%\n", __FILE__, __LINE__, __FUNCTION__,
                    Common::getCurrentTimeStr(&time_str_), ticker_id, Common::priceToString(price).c_str(),
                    Common::sideToString(side).c_str());
     }
 
     /// Process trade events, fetch the aggressive trade ratio from the feature engine, check against the trading threshold and send aggressive orders.
-    auto onTradeUpdate(const Exchange::MEMarketUpdate *market_update, MarketOrderBook *book) noexcept -> void {
+    auto onTradeUpdate(const Exchange::MEMarketUpdate *market_update, const BBO *bbo) noexcept -> void {
       logger_->log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
                    market_update->toString().c_str());
 
-      const auto bbo = book->getBBO();
       const auto agg_qty_ratio = feature_engine_->getAggTradeQtyRatio();
 
       if (LIKELY(bbo->bid_price_ != Price_INVALID && bbo->ask_price_ != Price_INVALID && agg_qty_ratio != Feature_INVALID)) {
@@ -40,10 +39,11 @@ namespace Trading {
 
         if (agg_qty_ratio >= threshold) {
           START_MEASURE(Trading_OrderManager_moveOrders);
+          // IOC at the touch, so that whatever does not trade is not left resting in the order book.
           if (market_update->side_ == Side::BUY)
-            order_manager_->moveOrders(market_update->ticker_id_, bbo->ask_price_, Price_INVALID, clip);
+            order_manager_->moveOrders(market_update->ticker_id_, bbo->ask_price_, Price_INVALID, clip, Exchange::TimeInForce::IOC);
           else
-            order_manager_->moveOrders(market_update->ticker_id_, Price_INVALID, bbo->bid_price_, clip);
+            order_manager_->moveOrders(market_update->ticker_id_, Price_INVALID, bbo->bid_price_, clip, Exchange::TimeInForce::IOC);
           END_MEASURE(Trading_OrderManager_moveOrders, (*logger_));
         }
       }
@@ -11,17 +11,16 @@ using namespace Common;
 namespace Trading {
   class MarketMaker {
   public:
-    MarketMaker(Common::Logger *logger, TradeEngine *trade_engine, const FeatureEngine *feature_engine,
+    MarketMaker(Common::Logger *logger, TradeEngineBase *trade_engine, const FeatureEngine *feature_engine,
                 OrderManager *order_manager,
                 const TradeEngineCfgHashMap &ticker_cfg);
 
     /// Process order book updates, fetch the fair market price from the feature engine, check against the trading threshold and modify the passive orders.
-    auto onOrderBookUpdate(TickerId ticker_id, Price price, Side side, const MarketOrderBook *book) noexcept -> void {
+    auto onOrderBookUpdate(TickerId ticker_id, Price price, Side side, const BBO *bbo) noexcept -> void {
       logger_->log("%:% %() % ticker:% price:% side:%\n", __FILE__, __LINE__, __FUNCTION__,
                    Common::getCurrentTimeStr(&time_str_), ticker_id, Common::priceToString(price).c_str(),
                    Common::sideToString(side).c_str());
 
-      const auto bbo = book->getBBO();
       const auto fair_price = feature_engine_->getMktPrice();
 
       if (LIKELY(bbo->bid_price_ != Price_INVALID && bbo->ask_price_ != Price_INVALID && fair_price != Feature_INVALID)) {
@@ -36,13 +35,13 @@ namespace Trading {
         const auto ask_price = bbo->ask_price_ + (bbo->ask_price_ - fair_price >= threshold ? 0 : 1);
 
         START_MEASURE(Trading_OrderManager_moveOrders);
-        order_manager_->moveOrders(ticker_id, bid_price, ask_price, clip);
+        order_manager_->moveOrders(ticker_id, bid_price, ask_price, clip, Exchange::TimeInForce::DAY);
         END_MEASURE(Trading_OrderManager_moveOrders, (*logger_));
       }
     }
 
     /// Process trade events, which for the market making algorithm is none.
-    auto onTradeUpdate(const Exchange::MEMarketUpdate *market_update, MarketOrderBook * /* book */) noexcept -> void {
+    auto onTradeUpdate(const Exchange::MEMarketUpdate *market_update, const BBO * /* bbo */) noexcept -> void {
       logger_->log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
                    market_update->toString().c_str());
     }
@@ -19,7 +19,7 @@ namespace Trading {
     MarketOrder *prev_order_ = nullptr;
     MarketOrder *next_order_ = nullptr;
 
-    /// Only needed for use with MemPool.
+    /// Only needed for use with the memory pools.
     MarketOrder() = default;
 
     MarketOrder(OrderId order_id, Side side, Price price, Qty qty, Priority priority, MarketOrder *prev_order, MarketOrder *next_order) noexcept
@@ -43,7 +43,7 @@ namespace Trading {
     MarketOrdersAtPrice *prev_entry_ = nullptr;
     MarketOrdersAtPrice *next_entry_ = nullptr;
 
-    /// Only needed for use with MemPool.
+    /// Only needed for use with the memory pools.
     MarketOrdersAtPrice() = default;
 
     MarketOrdersAtPrice(Side side, Price price, MarketOrder *first_mkt_order, MarketOrdersAtPrice *prev_entry, MarketOrdersAtPrice *next_entry)
@@ -18,8 +18,8 @@ namespace Trading {
 
   /// Process market data update and update the limit order book.
   auto MarketOrderBook::onMarketUpdate(const Exchange::MEMarketUpdate *market_update) noexcept -> void {
-    const auto bid_updated = (bids_by_price_ && market_update->side_ == Side::BUY && market_update->price_ >= bids_by_price_->price_);
-    const auto ask_updated = (asks_by_price_ && market_update->side_ == Side::SELL && market_update->price_ <= asks_by_price_->price_);
+    auto bid_updated = (bids_by_price_ && market_update->side_ == Side::BUY && market_update->price_ >= bids_by_price_->price_);
+    auto ask_updated = (asks_by_price_ && market_update->side_ == Side::SELL && market_update->price_ <= asks_by_price_->price_);
 
     switch (market_update->type_) {
       case Exchange::MarketUpdateType::ADD: {
@@ -32,7 +32,23 @@ namespace Trading {
         break;
       case Exchange::MarketUpdateType::MODIFY: {
         auto order = oid_to_order_.at(market_update->order_id_);
-        order->qty_ = market_update->qty_;
+        if (UNLIKELY(order->price_ != market_update->price_ || order->priority_ != market_update->priority_)) {
+          // A modify request that lost its priority, the order moves to the back of the FIFO queue at its new price.
+          bid_updated |= (market_update->side_ == Side::BUY && order->price_ >= bids_by_price_->price_);
+          ask_updated |= (market_update->side_ == Side::SELL && order->price_ <= asks_by_price_->price_);
+
+          START_MEASURE(Trading_MarketOrderBook_removeOrder);
+          removeOrder(order);
+          END_MEASURE(Trading_MarketOrderBook_removeOrder, (*logger_));
+
+          order = order_pool_.allocate(market_update->order_id_, market_update->side_, market_update->price_,
+                                       market_update->qty_, market_update->priority_, nullptr, nullptr);
+          START_MEASURE(Trading_MarketOrderBook_addOrder);
+          addOrder(order);
+          END_MEASURE(Trading_MarketOrderBook_addOrder, (*logger_));
+        } else {
+          order->qty_ = market_update->qty_;
+        }
       }
         break;
       case Exchange::MarketUpdateType::CANCEL: {
@@ -43,7 +59,7 @@ namespace Trading {
       }
         break;
       case Exchange::MarketUpdateType::TRADE: {
-        trade_engine_->onTradeUpdate(market_update, this);
+        trade_engine_->onTradeUpdate(market_update, &bbo_);
         return;
       }
         break;
@@ -82,7 +98,7 @@ namespace Trading {
     logger_->log("%:% %() % % %", __FILE__, __LINE__, __FUNCTION__,
                  Common::getCurrentTimeStr(&time_str_), market_update->toString(), bbo_.toString());
 
-    trade_engine_->onOrderBookUpdate(market_update->ticker_id_, market_update->price_, market_update->side_, this);
+    trade_engine_->onOrderBookUpdate(market_update->ticker_id_, market_update->price_, market_update->side_, &bbo_);
   }
 
   auto MarketOrderBook::toString(bool detailed, bool validity_check) const -> std::string {
@@ -1,16 +1,19 @@
 #pragma once
 
 #include "common/types.h"
-#include "common/mem_pool.h"
+#include "common/free_list_mem_pool.h"
+#include "common/huge_page_allocator.h"
 #include "common/logging.h"
 
 #include "market_order.h"
 #include "exchange/market_data/market_update.h"
 
 namespace Trading {
-  class TradeEngine;
+  class TradeEngineBase;
 
-  class MarketOrderBook final {
+  /// The limit order book TradeEngine<MarketOrderBook> keeps for every ticker from market data, it reports changes to its BBO and trades to the trade engine.
+  /// Its order-id and price level lookup tables make it very large and mostly sparse, see OptCommon::HugePageObject.
+  class MarketOrderBook final : public OptCommon::HugePageObject {
   public:
     MarketOrderBook(TickerId ticker_id, Logger *logger);
 
@@ -19,7 +22,7 @@ namespace Trading {
     /// Process market data update and update the limit order book.
     auto onMarketUpdate(const Exchange::MEMarketUpdate *market_update) noexcept -> void;
 
-    auto setTradeEngine(TradeEngine *trade_engine) {
+    auto setTradeEngine(TradeEngineBase *trade_engine) {
       trade_engine_ = trade_engine;
     }
 
@@ -73,13 +76,13 @@ namespace Trading {
     const TickerId ticker_id_;
 
     /// Parent trade engine that owns this limit order book, used to send notifications when book changes or trades occur.
-    TradeEngine *trade_engine_ = nullptr;
+    TradeEngineBase *trade_engine_ = nullptr;
 
     /// Hash map from OrderId -> MarketOrder.
     OrderHashMap oid_to_order_;
 
     /// Memory pool to manage MarketOrdersAtPrice objects.
-    MemPool<MarketOrdersAtPrice> orders_at_price_pool_;
+    OptCommon::FreeListMemPool<MarketOrdersAtPrice> orders_at_price_pool_;
 
     /// Pointers to beginning / best prices / top of book of buy and sell price levels.
     MarketOrdersAtPrice *bids_by_price_ = nullptr;
@@ -89,7 +92,7 @@ namespace Trading {
     OrdersAtPriceHashMap price_orders_at_price_;
 
     /// Memory pool to manage MarketOrder objects.
-    MemPool<MarketOrder> order_pool_;
+    OptCommon::FreeListMemPool<MarketOrder> order_pool_;
 
     BBO bbo_;
 
@@ -223,6 +226,4 @@ namespace Trading {
     }
   };
 
-  /// Hash map from TickerId -> MarketOrderBook.
-  typedef std::array<MarketOrderBook *, ME_MAX_TICKERS> MarketOrderBookHashMap;
 }
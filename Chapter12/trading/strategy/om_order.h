@@ -13,7 +13,8 @@ namespace Trading {
     PENDING_NEW = 1,
     LIVE = 2,
     PENDING_CANCEL = 3,
-    DEAD = 4
+    DEAD = 4,
+    PENDING_MODIFY = 5
   };
 
   inline auto OMOrderStateToString(OMOrderState side) -> std::string {
@@ -26,6 +27,8 @@ namespace Trading {
         return "PENDING_CANCEL";
       case OMOrderState::DEAD:
         return "DEAD";
+      case OMOrderState::PENDING_MODIFY:
+        return "PENDING_MODIFY";
       case OMOrderState::INVALID:
         return "INVALID";
     }
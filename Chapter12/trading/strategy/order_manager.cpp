@@ -3,9 +3,9 @@
 
 namespace Trading {
   /// Send a new order with specified attribute, and update the OMOrder object passed here.
-  auto OrderManager::newOrder(OMOrder *order, TickerId ticker_id, Price price, Side side, Qty qty) noexcept -> void {
+  auto OrderManager::newOrder(OMOrder *order, TickerId ticker_id, Price price, Side side, Qty qty, Exchange::TimeInForce time_in_force) noexcept -> void {
     const Exchange::MEClientRequest new_request{Exchange::ClientRequestType::NEW, trade_engine_->clientId(), ticker_id,
-                                                next_order_id_, side, price, qty};
+                                                next_order_id_, side, price, qty, time_in_force};
     trade_engine_->sendClientRequest(&new_request);
 
     *order = {ticker_id, next_order_id_, side, price, qty, OMOrderState::PENDING_NEW};
@@ -29,4 +29,17 @@ namespace Trading {
                  Common::getCurrentTimeStr(&time_str_),
                  cancel_request.toString().c_str(), order->toString().c_str());
   }
+
+  /// Send a modify moving the specified order to a new price and quantity in a single round trip, and update the OMOrder object passed here.
+  auto OrderManager::modifyOrder(OMOrder *order, Price price, Qty qty) noexcept -> void {
+    const Exchange::MEClientRequest modify_request{Exchange::ClientRequestType::MODIFY, trade_engine_->clientId(),
+                                                   order->ticker_id_, order->order_id_, order->side_, price, qty};
+    trade_engine_->sendClientRequest(&modify_request);
+
+    order->order_state_ = OMOrderState::PENDING_MODIFY;
+
+    logger_->log("%:% %() % Sent modify % for %\n", __FILE__, __LINE__, __FUNCTION__,
+                 Common::getCurrentTimeStr(&time_str_),
+                 modify_request.toString().c_str(), order->toString().c_str());
+  }
 }
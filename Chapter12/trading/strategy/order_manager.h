@@ -3,6 +3,7 @@
 #include "common/macros.h"
 #include "common/logging.h"
 
+#include "exchange/order_server/client_request.h"
 #include "exchange/order_server/client_response.h"
 
 #include "om_order.h"
@@ -11,12 +12,12 @@
 using namespace Common;
 
 namespace Trading {
-  class TradeEngine;
+  class TradeEngineBase;
 
   /// Manages orders for a trading algorithm, hides the complexity of order management to simplify trading strategies.
   class OrderManager {
   public:
-    OrderManager(Common::Logger *logger, TradeEngine *trade_engine, RiskManager& risk_manager)
+    OrderManager(Common::Logger *logger, TradeEngineBase *trade_engine, RiskManager& risk_manager)
         : trade_engine_(trade_engine), risk_manager_(risk_manager), logger_(logger) {
     }
 
@@ -43,6 +44,24 @@ namespace Trading {
             order->order_state_ = OMOrderState::DEAD;
         }
           break;
+        case Exchange::ClientResponseType::MODIFIED: {
+          // Also sent when self-trade prevention decrements a LIVE order. A late MODIFIED for an earlier order on this side must not revive
+          // the slot, e.g. the one sent to an IOC order that was decremented before it was canceled.
+          if (client_response->client_order_id_ == order->order_id_ &&
+              (order->order_state_ == OMOrderState::PENDING_MODIFY || order->order_state_ == OMOrderState::LIVE)) {
+            order->order_state_ = OMOrderState::LIVE;
+            order->price_ = client_response->price_;
+            order->qty_ = client_response->leaves_qty_;
+          }
+        }
+          break;
+        case Exchange::ClientResponseType::MODIFY_REJECTED: {
+          // The order is still resting at its old price and quantity, e.g. the new price is outside of a LadderMEOrderBook's window.
+          // An order that was filled or canceled before the modify reached the exchange is already DEAD from the FILLED or CANCELED before this.
+          if (client_response->client_order_id_ == order->order_id_ && order->order_state_ == OMOrderState::PENDING_MODIFY)
+            order->order_state_ = OMOrderState::LIVE;
+        }
+          break;
         case Exchange::ClientResponseType::CANCEL_REJECTED:
         case Exchange::ClientResponseType::INVALID: {
         }
@@ -51,20 +70,34 @@ namespace Trading {
     }
 
     /// Send a new order with specified attribute, and update the OMOrder object passed here.
-    auto newOrder(OMOrder *order, TickerId ticker_id, Price price, Side side, Qty qty) noexcept -> void;
+    auto newOrder(OMOrder *order, TickerId ticker_id, Price price, Side side, Qty qty, Exchange::TimeInForce time_in_force) noexcept -> void;
 
     /// Send a cancel for the specified order, and update the OMOrder object passed here.
     auto cancelOrder(OMOrder *order) noexcept -> void;
 
+    /// Send a modify moving the specified order to a new price and quantity in a single round trip, and update the OMOrder object passed here.
+    auto modifyOrder(OMOrder *order, Price price, Qty qty) noexcept -> void;
+
     /// Move a single order on the specified side so that it has the specified price and quantity.
+    /// A live order is modified in place if the new price passes the risk checks, and canceled otherwise or if Price_INVALID is specified.
+    /// New orders are sent with the provided time in force.
     /// This will perform risk checks prior to sending the order, and update the OMOrder object passed here.
-    auto moveOrder(OMOrder *order, TickerId ticker_id, Price price, Side side, Qty qty) noexcept {
+    auto moveOrder(OMOrder *order, TickerId ticker_id, Price price, Side side, Qty qty, Exchange::TimeInForce time_in_force) noexcept {
       switch (order->order_state_) {
         case OMOrderState::LIVE: {
           if(order->price_ != price) {
-            START_MEASURE(Trading_OrderManager_cancelOrder);
-            cancelOrder(order);
-            END_MEASURE(Trading_OrderManager_cancelOrder, (*logger_));
+            START_MEASURE(Trading_RiskManager_checkPreTradeRisk);
+            const auto risk_result = (price != Price_INVALID ? risk_manager_.checkPreTradeRisk(ticker_id, side, qty) : RiskCheckResult::INVALID);
+            END_MEASURE(Trading_RiskManager_checkPreTradeRisk, (*logger_));
+            if(LIKELY(risk_result == RiskCheckResult::ALLOWED)) {
+              START_MEASURE(Trading_OrderManager_modifyOrder);
+              modifyOrder(order, price, qty);
+              END_MEASURE(Trading_OrderManager_modifyOrder, (*logger_));
+            } else {
+              START_MEASURE(Trading_OrderManager_cancelOrder);
+              cancelOrder(order);
+              END_MEASURE(Trading_OrderManager_cancelOrder, (*logger_));
+            }
           }
         }
           break;
@@ -76,7 +109,7 @@ namespace Trading {
             END_MEASURE(Trading_RiskManager_checkPreTradeRisk, (*logger_));
             if(LIKELY(risk_result == RiskCheckResult::ALLOWED)) {
               START_MEASURE(Trading_OrderManager_newOrder);
-              newOrder(order, ticker_id, price, side, qty);
+              newOrder(order, ticker_id, price, side, qty, time_in_force);
               END_MEASURE(Trading_OrderManager_newOrder, (*logger_));
             } else
               logger_->log("%:% %() % Ticker:% Side:% Qty:% RiskCheckResult:%\n", __FILE__, __LINE__, __FUNCTION__,
@@ -88,6 +121,7 @@ namespace Trading {
           break;
         case OMOrderState::PENDING_NEW:
         case OMOrderState::PENDING_CANCEL:
+        case OMOrderState::PENDING_MODIFY:
           break;
       }
     }
@@ -96,18 +130,19 @@ namespace Trading {
     /// This can result in new orders being sent if there are none.
     /// This can result in existing orders being cancelled if they are not at the specified price or of the specified quantity.
     /// Specifying Price_INVALID for the buy or sell prices indicates that we do not want an order there.
-    auto moveOrders(TickerId ticker_id, Price bid_price, Price ask_price, Qty clip) noexcept {
+    /// Orders sent with TimeInForce::IOC never rest at the exchange, whatever does not match immediately is canceled by the exchange.
+    auto moveOrders(TickerId ticker_id, Price bid_price, Price ask_price, Qty clip, Exchange::TimeInForce time_in_force) noexcept {
       {
         auto bid_order = &(ticker_side_order_.at(ticker_id).at(sideToIndex(Side::BUY)));
         START_MEASURE(Trading_OrderManager_moveOrder);
-        moveOrder(bid_order, ticker_id, bid_price, Side::BUY, clip);
+        moveOrder(bid_order, ticker_id, bid_price, Side::BUY, clip, time_in_force);
         END_MEASURE(Trading_OrderManager_moveOrder, (*logger_));
       }
 
       {
         auto ask_order = &(ticker_side_order_.at(ticker_id).at(sideToIndex(Side::SELL)));
         START_MEASURE(Trading_OrderManager_moveOrder);
-        moveOrder(ask_order, ticker_id, ask_price, Side::SELL, clip);
+        moveOrder(ask_order, ticker_id, ask_price, Side::SELL, clip, time_in_force);
         END_MEASURE(Trading_OrderManager_moveOrder, (*logger_));
       }
     }
@@ -130,7 +165,7 @@ namespace Trading {
 
   private:
     /// The parent trade engine object, used to send out client requests.
-    TradeEngine *trade_engine_ = nullptr;
+    TradeEngineBase *trade_engine_ = nullptr;
 
     /// Risk manager to perform pre-trade risk checks.
     const RiskManager& risk_manager_;
@@ -4,7 +4,7 @@
 
 #include "common/thread_utils.h"
 #include "common/time_utils.h"
-#include "common/lf_queue.h"
+#include "common/opt_lf_queue.h"
 #include "common/macros.h"
 #include "common/logging.h"
 
@@ -23,23 +23,21 @@
 #include "liquidity_taker.h"
 
 namespace Trading {
-  class TradeEngine {
+  /// The part of the trade engine that the market order books report to and the trading algorithms use, it does not depend on the market order
+  /// book type so that neither of them are templates. Order book changes and trades are passed on with the book's BBO, nothing is virtual
+  /// except the destructor so that owners can delete any TradeEngine through this type.
+  class TradeEngineBase {
   public:
-    TradeEngine(Common::ClientId client_id,
-                AlgoType algo_type,
-                const TradeEngineCfgHashMap &ticker_cfg,
-                Exchange::ClientRequestLFQueue *client_requests,
-                Exchange::ClientResponseLFQueue *client_responses,
-                Exchange::MEMarketUpdateLFQueue *market_updates);
+    TradeEngineBase(Common::ClientId client_id,
+                    AlgoType algo_type,
+                    const TradeEngineCfgHashMap &ticker_cfg,
+                    Exchange::ClientRequestLFQueue *client_requests,
+                    Exchange::ClientResponseLFQueue *client_responses,
+                    Exchange::MEMarketUpdateLFQueue *market_updates);
 
-    ~TradeEngine();
-
-    /// Start and stop the trade engine main thread.
-    auto start() -> void {
-      run_ = true;
-      ASSERT(Common::createAndStartThread(-1, "Trading/TradeEngine", [this] { run(); }) != nullptr, "Failed to start TradeEngine thread.");
-    }
+    virtual ~TradeEngineBase();
 
+    /// Stop the trade engine main thread once the queued client responses and market data updates are consumed.
     auto stop() -> void {
       while(incoming_ogw_responses_->size() || incoming_md_updates_->size()) {
         logger_.log("%:% %() % Sleeping till all updates are consumed ogw-size:% md-size:%\n", __FILE__, __LINE__, __FUNCTION__,
@@ -55,24 +53,21 @@ namespace Trading {
       run_ = false;
     }
 
-    /// Main loop for this thread - processes incoming client responses and market data updates which in turn may generate client requests.
-    auto run() noexcept -> void;
-
     /// Write a client request to the lock free queue for the order server to consume and send to the exchange.
     auto sendClientRequest(const Exchange::MEClientRequest *client_request) noexcept -> void;
 
     /// Process changes to the order book - updates the position keeper, feature engine and informs the trading algorithm about the update.
-    auto onOrderBookUpdate(TickerId ticker_id, Price price, Side side, MarketOrderBook *book) noexcept -> void;
+    auto onOrderBookUpdate(TickerId ticker_id, Price price, Side side, const BBO *bbo) noexcept -> void;
 
     /// Process trade events - updates the  feature engine and informs the trading algorithm about the trade event.
-    auto onTradeUpdate(const Exchange::MEMarketUpdate *market_update, MarketOrderBook *book) noexcept -> void;
+    auto onTradeUpdate(const Exchange::MEMarketUpdate *market_update, const BBO *bbo) noexcept -> void;
 
     /// Process client responses - updates the position keeper and informs the trading algorithm about the response.
     auto onOrderUpdate(const Exchange::MEClientResponse *client_response) noexcept -> void;
 
     /// Function wrappers to dispatch order book updates, trade events and client responses to the trading algorithm.
-    std::function<void(TickerId ticker_id, Price price, Side side, MarketOrderBook *book)> algoOnOrderBookUpdate_;
-    std::function<void(const Exchange::MEMarketUpdate *market_update, MarketOrderBook *book)> algoOnTradeUpdate_;
+    std::function<void(TickerId ticker_id, Price price, Side side, const BBO *bbo)> algoOnOrderBookUpdate_;
+    std::function<void(const Exchange::MEMarketUpdate *market_update, const BBO *bbo)> algoOnTradeUpdate_;
     std::function<void(const Exchange::MEClientResponse *client_response)> algoOnOrderUpdate_;
 
     auto initLastEventTime() {
@@ -88,23 +83,20 @@ namespace Trading {
     }
 
     /// Deleted default, copy & move constructors and assignment-operators.
-    TradeEngine() = delete;
+    TradeEngineBase() = delete;
 
-    TradeEngine(const TradeEngine &) = delete;
+    TradeEngineBase(const TradeEngineBase &) = delete;
 
-    TradeEngine(const TradeEngine &&) = delete;
+    TradeEngineBase(const TradeEngineBase &&) = delete;
 
-    TradeEngine &operator=(const TradeEngine &) = delete;
+    TradeEngineBase &operator=(const TradeEngineBase &) = delete;
 
-    TradeEngine &operator=(const TradeEngine &&) = delete;
+    TradeEngineBase &operator=(const TradeEngineBase &&) = delete;
 
-  private:
+  protected:
     /// This trade engine's ClientId.
     const ClientId client_id_;
 
-    /// Hash map container from TickerId -> MarketOrderBook.
-    MarketOrderBookHashMap ticker_order_book_;
-
     /// Lock free queues.
     /// One to publish outgoing client requests to be consumed by the order gateway and sent to the exchange.
     /// Second to consume incoming client responses from, written to by the order gateway based on data received from the exchange.
@@ -135,14 +127,15 @@ namespace Trading {
     MarketMaker *mm_algo_ = nullptr;
     LiquidityTaker *taker_algo_ = nullptr;
 
+  private:
     /// Default methods to initialize the function wrappers.
-    auto defaultAlgoOnOrderBookUpdate(TickerId ticker_id, Price price, Side side, MarketOrderBook *) noexcept -> void {
+    auto defaultAlgoOnOrderBookUpdate(TickerId ticker_id, Price price, Side side, const BBO *) noexcept -> void {
       logger_.log("%:% %() % ticker:% price:% side:%\n", __FILE__, __LINE__, __FUNCTION__,
                   Common::getCurrentTimeStr(&time_str_), ticker_id, Common::priceToString(price).c_str(),
                   Common::sideToString(side).c_str());
     }
 
-    auto defaultAlgoOnTradeUpdate(const Exchange::MEMarketUpdate *market_update, MarketOrderBook *) noexcept -> void {
+    auto defaultAlgoOnTradeUpdate(const Exchange::MEMarketUpdate *market_update, const BBO *) noexcept -> void {
       logger_.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str_),
                   market_update->toString().c_str());
     }
@@ -152,4 +145,44 @@ namespace Trading {
                   client_response->toString().c_str());
     }
   };
+
+  /// MarketOrderBookT is the limit order book implementation, every ticker gets one and market updates are dispatched to it without virtual calls.
+  /// It needs a (TickerId, Logger *) constructor, setTradeEngine(TradeEngineBase *) and onMarketUpdate(const Exchange::MEMarketUpdate *), and
+  /// reports to TradeEngineBase::onOrderBookUpdate() and onTradeUpdate() with its BBO. MarketOrderBook is instantiated in trade_engine.cpp.
+  template<typename MarketOrderBookT>
+  class TradeEngine final : public TradeEngineBase {
+  public:
+    TradeEngine(Common::ClientId client_id,
+                AlgoType algo_type,
+                const TradeEngineCfgHashMap &ticker_cfg,
+                Exchange::ClientRequestLFQueue *client_requests,
+                Exchange::ClientResponseLFQueue *client_responses,
+                Exchange::MEMarketUpdateLFQueue *market_updates);
+
+    ~TradeEngine() override;
+
+    /// Start the trade engine main thread, pinned to core_id unless it is -1.
+    auto start(int core_id = -1) -> void {
+      run_ = true;
+      ASSERT(Common::createAndStartThread(core_id, "Trading/TradeEngine", [this] { run(); }) != nullptr, "Failed to start TradeEngine thread.");
+    }
+
+    /// Main loop for this thread - processes incoming client responses and market data updates which in turn may generate client requests.
+    auto run() noexcept -> void;
+
+    /// Deleted default, copy & move constructors and assignment-operators.
+    TradeEngine() = delete;
+
+    TradeEngine(const TradeEngine &) = delete;
+
+    TradeEngine(const TradeEngine &&) = delete;
+
+    TradeEngine &operator=(const TradeEngine &) = delete;
+
+    TradeEngine &operator=(const TradeEngine &&) = delete;
+
+  private:
+    /// Hash map container from TickerId -> MarketOrderBookT.
+    std::array<MarketOrderBookT *, ME_MAX_TICKERS> ticker_order_book_;
+  };
 }
@@ -8,7 +8,7 @@
 
 /// Main components.
 Common::Logger *logger = nullptr;
-Trading::TradeEngine *trade_engine = nullptr;
+Trading::TradeEngine<Trading::MarketOrderBook> *trade_engine = nullptr;
 Trading::MarketDataConsumer *market_data_consumer = nullptr;
 Trading::OrderGateway *order_gateway = nullptr;
 
@@ -23,14 +23,22 @@ int main(int argc, char **argv) {
 
   const auto algo_type = stringToAlgoType(argv[2]);
 
+  // Core the LogDrain thread writing every component's log file and re-anchoring the TSC clock is pinned to, e.g. a housekeeping core.
+  // -1 leaves it unpinned. It has to be set before the first Logger starts the thread.
+  const int log_drain_core = -1;
+  Common::logDrain().setCore(log_drain_core);
+
+  // Calibrate the TSC clock here rather than the first time a component thread reads it.
+  Common::tsc_clock.init();
+
   logger = new Common::Logger("trading_main_" + std::to_string(client_id) + ".log");
+  Common::dumpLatencyHistogramsAtExit("trading_latency_histograms_" + std::to_string(client_id) + ".txt");
 
   const int sleep_time = 20 * 1000;
 
-  // The lock free queues to facilitate communication between order gateway <-> trade engine and market data consumer -> trade engine.
-  Exchange::ClientRequestLFQueue client_requests(ME_MAX_CLIENT_UPDATES);
-  Exchange::ClientResponseLFQueue client_responses(ME_MAX_CLIENT_UPDATES);
-  Exchange::MEMarketUpdateLFQueue market_updates(ME_MAX_MARKET_UPDATES);
+  // Cores the trade engine, order gateway and market data consumer threads are pinned to, -1 leaves a thread unpinned.
+  // Each component's order books, queues and socket buffers are placed on the NUMA node of its core, not the main thread's.
+  const int trade_engine_core = -1, order_gateway_core = -1, market_data_consumer_core = -1;
 
   std::string time_str;
 
@@ -46,21 +54,39 @@ int main(int argc, char **argv) {
                                       std::atof(argv[i + 4])}};
   }
 
-  logger->log("%:% %() % Starting Trade Engine...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str));
-  trade_engine = new Trading::TradeEngine(client_id, algo_type,
-                                          ticker_cfg,
-                                          &client_requests,
-                                          &client_responses,
-                                          &market_updates);
-  trade_engine->start();
+  logger->log("%:% %() % Starting Trade Engine core:%...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str),
+              trade_engine_core);
+
+  // The lock free queues to facilitate communication between order gateway <-> trade engine and market data consumer -> trade engine.
+  // They sit on the trade engine's node since it is on one end of all three.
+  Exchange::ClientRequestLFQueue *client_requests = nullptr;
+  Exchange::ClientResponseLFQueue *client_responses = nullptr;
+  Exchange::MEMarketUpdateLFQueue *market_updates = nullptr;
+  {
+    OptCommon::NumaNodeScope numa_node_scope(OptCommon::numaNodeOfCpu(trade_engine_core));
+    client_requests = new Exchange::ClientRequestLFQueue(ME_MAX_CLIENT_UPDATES);
+    client_responses = new Exchange::ClientResponseLFQueue(ME_MAX_CLIENT_UPDATES);
+    market_updates = new Exchange::MEMarketUpdateLFQueue(ME_MAX_MARKET_UPDATES);
+
+    trade_engine = new Trading::TradeEngine<Trading::MarketOrderBook>(client_id, algo_type,
+                                                                      ticker_cfg,
+                                                                      client_requests,
+                                                                      client_responses,
+                                                                      market_updates);
+    trade_engine->start(trade_engine_core);
+  }
 
   const std::string order_gw_ip = "127.0.0.1";
   const std::string order_gw_iface = "lo";
   const int order_gw_port = 12345;
 
-  logger->log("%:% %() % Starting Order Gateway...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str));
-  order_gateway = new Trading::OrderGateway(client_id, &client_requests, &client_responses, order_gw_ip, order_gw_iface, order_gw_port);
-  order_gateway->start();
+  logger->log("%:% %() % Starting Order Gateway core:%...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str),
+              order_gateway_core);
+  {
+    OptCommon::NumaNodeScope numa_node_scope(OptCommon::numaNodeOfCpu(order_gateway_core));
+    order_gateway = new Trading::OrderGateway(client_id, client_requests, client_responses, order_gw_ip, order_gw_iface, order_gw_port);
+    order_gateway->start(order_gateway_core);
+  }
 
   const std::string mkt_data_iface = "lo";
   const std::string snapshot_ip = "233.252.14.1";
@@ -68,9 +94,16 @@ int main(int argc, char **argv) {
   const std::string incremental_ip = "233.252.14.3";
   const int incremental_port = 20001;
 
-  logger->log("%:% %() % Starting Market Data Consumer...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str));
-  market_data_consumer = new Trading::MarketDataConsumer(client_id, &market_updates, mkt_data_iface, snapshot_ip, snapshot_port, incremental_ip, incremental_port);
-  market_data_consumer->start();
+  logger->log("%:% %() % Starting Market Data Consumer core:%...\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str),
+              market_data_consumer_core);
+  {
+    OptCommon::NumaNodeScope numa_node_scope(OptCommon::numaNodeOfCpu(market_data_consumer_core));
+    market_data_consumer = new Trading::MarketDataConsumer(client_id, market_updates, mkt_data_iface, snapshot_ip, snapshot_port, incremental_ip,
+                                                           incremental_port);
+    market_data_consumer->start(market_data_consumer_core);
+  }
+
+  logger->log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, Common::getCurrentTimeStr(&time_str), OptCommon::hugePageReport());
 
   usleep(10 * 1000 * 1000);
 
@@ -134,6 +167,9 @@ int main(int argc, char **argv) {
   market_data_consumer = nullptr;
   delete order_gateway;
   order_gateway = nullptr;
+  delete client_requests;
+  delete client_responses;
+  delete market_updates;
 
   std::this_thread::sleep_for(10s);
 